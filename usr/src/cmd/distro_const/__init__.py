@@ -24,4 +24,4 @@
 """init module for the distribution constructor"""
 
 __all__ = ["dc_checkpoint", "dc_defs", "dc_ti", "dc_tm",
-           "DefaultsModule", "ValidatorModule", "dc_utils"]
+           "DefaultsModule", "ValidatorModule", "dc_utils", "dc_pkgcache"]
@@ -381,6 +381,59 @@ def snapshot_list(cp):
 
     return snap_list
 
+#~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def dependent_clones(dataset, after=None):
+#~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Return the datasets cloned from snapshots of dataset.  A build which
+    names a snapshot of another build's build_data as its golden_image
+    is such a clone, and the snapshot can't be destroyed, nor can
+    build_data be rolled back past it, as long as the clone exists.
+
+    Input:
+        dataset - name of the dataset
+        after - if not None, only the clones of snapshots taken after
+                this snapshot of dataset are returned; they are what a
+                rollback to it destroys.
+    Returns:
+        list of (clone, origin snapshot) tuples
+
+    """
+    try:
+        snaps = Popen("/usr/sbin/zfs list -H -s creation -t snapshot " +
+                      "-o name -r " + dataset, shell=True,
+                      universal_newlines=True, stdout=PIPE,
+                      stderr=PIPE).communicate()[0].split()
+        lines = Popen("/usr/sbin/zfs list -H -t filesystem,volume " +
+                      "-o name,origin", shell=True,
+                      universal_newlines=True, stdout=PIPE,
+                      stderr=PIPE).communicate()[0].splitlines()
+    except OSError:
+        return []
+
+    snaps = [snap for snap in snaps if snap.startswith(dataset + "@")]
+    if after is not None:
+        if after not in snaps:
+            return []
+        snaps = snaps[snaps.index(after) + 1:]
+    clones = []
+    for line in lines:
+        fields = line.split("\t")
+        if len(fields) == 2 and fields[1] in snaps:
+            clones.append((fields[0], fields[1]))
+    return clones
+
+#~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def log_dependent_clones(dataset, log_handler, after=None):
+#~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Warn about the clones of dataset that a "zfs rollback -R" or
+    "zfs destroy -R" of it is about to destroy.  See dependent_clones().
+
+    """
+    for (clone, origin) in dependent_clones(dataset, after):
+        log_handler.info("Destroying " + clone + ", which was cloned " +
+                            "from " + origin + " (a golden_image of " +
+                            "another build); rebuild it afterwards")
+
 #~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def determine_resume_step(cp):
 #~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
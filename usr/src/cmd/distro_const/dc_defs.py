@@ -95,6 +95,7 @@ BOOT_ARCHIVE_BYTES_PER_INODE = OUTPUT_IMAGE_BOOT_ARCHIVE + "/nbpi"
 COMPRESSION_TYPE = IMG_PARAMS + "/live_img_compression/type"
 COMPRESSION_LEVEL = IMG_PARAMS + "/live_img_compression/level"
 BUILD_AREA = DISTRO_PARAMS + "/build_area"
+GOLDEN_IMAGE = DISTRO_PARAMS + "/golden_image"
 USER = IMG_PARAMS + "/user"
 USER_UID = USER + "/UID"
 LOCALE_LIST = IMG_PARAMS + "/locale_list"
@@ -152,6 +153,10 @@ BOOT_ARCHIVE = BUILD_DATA + "/boot_archive"
 MEDIA = "/media"
 LOGS = "/logs"
 
+# List of the packages im_pop installed, kept in the tmp area so that a
+# build cloned from a golden image knows which packages it inherited.
+INSTALLED_PKG_LIST = "installed_pkgs"
+
 # boot archive definitions
 BA_NAME = "boot_archive"
 BA_BASEPATH = "/platform"
@@ -0,0 +1,648 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+"""dc_pkgcache.py - Persistent package content cache for distro_const.
+
+Every distribution build downloads and decompresses the same package
+content from the repository again.  PkgCache keeps the manifests (keyed
+by FMRI) and the compressed file payloads (keyed by content hash) in a
+directory that survives between builds.  prefetch() resolves the package
+list against the repository catalog, fetches whatever the cache is
+missing concurrently, and verifies every payload against its hashes as
+it streams in, so no separate verification pass over the repository is
+needed.  seed_image() then links the cached payloads into the download
+cache of the pkg image so that "pkg install" finds them locally.
+
+Cache layout:
+
+    <cache>/pkg/<url quoted stem>/<url quoted version>   manifests
+    <cache>/file/<hash[0:2]>/<hash>                      gzip'ed payloads
+
+Repositories are either directory repositories (file:// URLs, as built by
+pkgrecv or pkgsend) or pkg depots (http:// and https:// URLs).
+
+"""
+
+import os
+import time
+import json
+import zlib
+import shutil
+import hashlib
+import logging
+import threading
+import urllib.parse
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+from osol_install.distro_const.dc_defs import DC_LOGGER_NAME
+
+PKG_CACHE_JOBS = 4
+READ_SIZE = 65536
+
+# Actions whose payload is delivered into the image.
+PAYLOAD_ACTIONS = ("file", "license")
+
+# Dependency types that pull another package into the image.
+DEPEND_TYPES = ("require", "group")
+
+
+# =============================================================================
+class PkgCacheError(Exception):
+# =============================================================================
+    """Raised when the repository can't supply a package or a payload
+    fails verification.
+    """
+    pass
+
+
+# =============================================================================
+class PkgFmri(object):
+# =============================================================================
+    """A package name and the version chosen from the repository catalog."""
+
+    # -------------------------------------------------------------------------
+    def __init__(self, publisher, stem, version):
+    # -------------------------------------------------------------------------
+        self.publisher = publisher
+        self.stem = stem
+        self.version = version
+
+    # -------------------------------------------------------------------------
+    def __str__(self):
+    # -------------------------------------------------------------------------
+        return "pkg://%s/%s@%s" % (self.publisher, self.stem, self.version)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def split_fmri(fmri):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Split a package name as given in a DC manifest or a depend action.
+
+    Args:
+      fmri: e.g. "SUNWcs", "pkg:/system/kernel@0.5.11" or
+          "pkg://opensolaris.org/entire@0.5.11-0.151"
+
+    Returns:
+      (publisher or None, stem, version or None)
+
+    Raises:
+      None
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    publisher = None
+    if fmri.startswith("pkg://"):
+        (publisher, fmri) = fmri[6:].split("/", 1)
+    elif fmri.startswith("pkg:/"):
+        fmri = fmri[5:]
+    fmri = fmri.lstrip("/")
+
+    version = None
+    if "@" in fmri:
+        (fmri, version) = fmri.split("@", 1)
+    return (publisher, fmri, version)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def parse_action(line):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Parse one line of a package manifest.
+
+    Only what the cache needs is parsed: the action name, the payload
+    hash (the first attribute if it has no '=') and the key=value
+    attributes, which may be double quoted.
+
+    Args:
+      line: manifest line
+
+    Returns:
+      (action name, payload hash or None, dictionary of attributes) or
+      None for blank lines and comments.
+
+    Raises:
+      None
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    line = line.strip()
+    if not line or line.startswith("#"):
+        return None
+
+    (name, _sep, rest) = line.partition(" ")
+    attrs = {}
+    payload = None
+    pos = 0
+    while pos < len(rest):
+        if rest[pos] == " ":
+            pos += 1
+            continue
+        end = pos
+        while end < len(rest) and rest[end] not in " =":
+            end += 1
+        key = rest[pos:end]
+        if end >= len(rest) or rest[end] == " ":
+            if payload is None and not attrs:
+                payload = key
+            pos = end
+            continue
+        end += 1
+        if end < len(rest) and rest[end] in "\"'":
+            quote = rest[end]
+            close = rest.find(quote, end + 1)
+            if close == -1:
+                close = len(rest)
+            value = rest[end + 1:close]
+            pos = close + 1
+        else:
+            close = rest.find(" ", end)
+            if close == -1:
+                close = len(rest)
+            value = rest[end:close]
+            pos = close
+        # Keys may be repeated (e.g. several fmri= on require-any).
+        attrs.setdefault(key, value)
+
+    if payload is None and "hash" in attrs:
+        payload = attrs["hash"]
+    return (name, payload, attrs)
+
+
+# =============================================================================
+class PkgRepo(object):
+# =============================================================================
+    """Read access to one publisher in a directory repository or depot."""
+
+    # -------------------------------------------------------------------------
+    def __init__(self, url, publisher):
+    # -------------------------------------------------------------------------
+        """
+        Args:
+          url: file://, http:// or https:// URL of the repository
+          publisher: publisher to read from the repository
+
+        Raises:
+          PkgCacheError: unsupported URL scheme
+        """
+        self.url = url.rstrip("/")
+        self.publisher = publisher
+        self.scheme = urllib.parse.urlparse(self.url).scheme
+        self.root = None
+
+        if self.scheme == "file":
+            path = urllib.request.url2pathname(
+                urllib.parse.urlparse(self.url).path)
+            # Version 4 repositories keep each publisher in its own tree.
+            pub_root = os.path.join(path, "publisher", publisher)
+            if os.path.isdir(pub_root):
+                self.root = pub_root
+            else:
+                self.root = path
+        elif self.scheme not in ("http", "https"):
+            raise PkgCacheError("unsupported repository URL: " + url)
+
+    # -------------------------------------------------------------------------
+    def _open(self, relpath, depot_path):
+    # -------------------------------------------------------------------------
+        """Open a repository resource for reading as a binary stream."""
+        if self.root is not None:
+            return open(os.path.join(self.root, relpath), "rb")
+        return urllib.request.urlopen("%s/%s/%s" % (self.url,
+                                      self.publisher, depot_path))
+
+    # -------------------------------------------------------------------------
+    def catalog(self):
+    # -------------------------------------------------------------------------
+        """Read the base part of the version 1 catalog.
+
+        Returns:
+          Dictionary of package stem to the list of its versions, oldest
+          first, as ordered by the catalog.
+        """
+        cfile = self._open("catalog/catalog.base.C",
+                           "catalog/1/catalog.base.C")
+        try:
+            data = json.loads(cfile.read().decode("utf-8"))
+        finally:
+            cfile.close()
+
+        entries = data.get(self.publisher, {})
+        if not entries:
+            # Older repositories only carry one publisher.
+            for (key, value) in data.items():
+                if not key.startswith("_"):
+                    entries = value
+                    break
+
+        versions = {}
+        for (stem, pkgs) in entries.items():
+            versions[stem] = [pkg["version"] for pkg in pkgs]
+        return versions
+
+    # -------------------------------------------------------------------------
+    def manifest(self, stem, version):
+    # -------------------------------------------------------------------------
+        """Return the text of the manifest of stem@version."""
+        mfile = self._open(os.path.join("pkg", urllib.parse.quote(stem, ""),
+                           urllib.parse.quote(version, "")),
+                           "manifest/0/" + urllib.parse.quote("%s@%s" %
+                           (stem, version), ""))
+        try:
+            return mfile.read().decode("utf-8")
+        finally:
+            mfile.close()
+
+    # -------------------------------------------------------------------------
+    def payload(self, fhash):
+    # -------------------------------------------------------------------------
+        """Open the gzip'ed payload with content hash fhash."""
+        return self._open(os.path.join("file", fhash[0:2], fhash),
+                          "file/0/" + fhash)
+
+
+# =============================================================================
+class PkgCache(object):
+# =============================================================================
+    """Persistent, content addressed package cache."""
+
+    # -------------------------------------------------------------------------
+    def __init__(self, cache_dir, repo, jobs=PKG_CACHE_JOBS, log=None):
+    # -------------------------------------------------------------------------
+        """
+        Args:
+          cache_dir: directory holding the cache; created if needed
+          repo: PkgRepo to fetch from
+          jobs: number of packages fetched concurrently
+          log: logger for progress and per-package timing
+        """
+        self.cache_dir = cache_dir
+        self.repo = repo
+        self.jobs = max(1, jobs)
+        if log is None:
+            log = logging.getLogger(DC_LOGGER_NAME)
+        self.log = log
+
+        self._catalog = None
+        self._lock = threading.Lock()
+        self._inflight = {}
+
+        # Totals for the summary, updated under _lock.
+        self.hits = 0
+        self.fetched = 0
+        self.fetched_bytes = 0
+
+        for subdir in ("pkg", "file"):
+            path = os.path.join(cache_dir, subdir)
+            if not os.path.isdir(path):
+                os.makedirs(path)
+
+    # -------------------------------------------------------------------------
+    def file_path(self, fhash):
+    # -------------------------------------------------------------------------
+        """Return the cache path of the payload with content hash fhash."""
+        return os.path.join(self.cache_dir, "file", fhash[0:2], fhash)
+
+    # -------------------------------------------------------------------------
+    def manifest_path(self, fmri):
+    # -------------------------------------------------------------------------
+        """Return the cache path of the manifest of fmri."""
+        return os.path.join(self.cache_dir, "pkg",
+                            urllib.parse.quote(fmri.stem, ""),
+                            urllib.parse.quote(fmri.version, ""))
+
+    # -------------------------------------------------------------------------
+    def _write(self, path, chunks):
+    # -------------------------------------------------------------------------
+        """Atomically create path from an iterable of byte strings.
+
+        Concurrent builds sharing the cache either see the complete file
+        or no file at all.
+        """
+        dirname = os.path.dirname(path)
+        if not os.path.isdir(dirname):
+            try:
+                os.makedirs(dirname)
+            except OSError:
+                if not os.path.isdir(dirname):
+                    raise
+        tmp_path = "%s.%d.%d" % (path, os.getpid(), threading.get_ident())
+        try:
+            with open(tmp_path, "wb") as tfile:
+                for chunk in chunks:
+                    tfile.write(chunk)
+            os.rename(tmp_path, path)
+        except BaseException:
+            if os.path.exists(tmp_path):
+                os.unlink(tmp_path)
+            raise
+
+    # -------------------------------------------------------------------------
+    def resolve(self, names):
+    # -------------------------------------------------------------------------
+        """Resolve package names to the versions the build will install.
+
+        Requested packages are resolved first so that any incorporation
+        among them (e.g. entire) constrains the versions picked for their
+        dependencies.  Packages the repository doesn't have are reported
+        and skipped; pkg install will fail on them as usual.
+
+        Args:
+          names: package names from the DC manifest
+
+        Returns:
+          (list of PkgFmri, dictionary of PkgFmri to manifest text)
+
+        Raises:
+          PkgCacheError: a requested package isn't in the repository
+        """
+        if self._catalog is None:
+            self._catalog = self.repo.catalog()
+
+        constraints = {}
+        resolved = {}
+        manifests = {}
+        order = []
+        queue = [(name, True) for name in names]
+
+        while queue:
+            (name, requested) = queue.pop(0)
+            (_pub, stem, version) = split_fmri(name)
+            stem = self._match_stem(stem)
+            if stem is None:
+                if requested:
+                    raise PkgCacheError("package not found in %s: %s" %
+                                        (self.repo.url, name))
+                continue
+            if stem in resolved:
+                continue
+
+            version = self._pick_version(stem,
+                                         version or constraints.get(stem))
+            if version is None:
+                if requested:
+                    raise PkgCacheError("no matching version in %s: %s" %
+                                        (self.repo.url, name))
+                continue
+
+            fmri = PkgFmri(self.repo.publisher, stem, version)
+            resolved[stem] = fmri
+            order.append(fmri)
+            text = self.get_manifest(fmri)
+            manifests[fmri] = text
+
+            for line in text.splitlines():
+                action = parse_action(line)
+                if action is None or action[0] != "depend":
+                    continue
+                attrs = action[2]
+                if "fmri" not in attrs:
+                    continue
+                if attrs.get("type") == "incorporate":
+                    (_pub, dstem, dversion) = split_fmri(attrs["fmri"])
+                    if dversion and dstem not in constraints:
+                        constraints[dstem] = dversion
+                elif attrs.get("type") in DEPEND_TYPES:
+                    queue.append((attrs["fmri"], False))
+
+        return (order, manifests)
+
+    # -------------------------------------------------------------------------
+    def _match_stem(self, stem):
+    # -------------------------------------------------------------------------
+        """Match a possibly abbreviated stem the way pkg install does."""
+        if stem in self._catalog:
+            return stem
+        matches = [full for full in self._catalog
+                   if full.endswith("/" + stem)]
+        if len(matches) == 1:
+            return matches[0]
+        return None
+
+    # -------------------------------------------------------------------------
+    def _pick_version(self, stem, want):
+    # -------------------------------------------------------------------------
+        """Return the newest catalog version of stem matching want."""
+        for version in reversed(self._catalog[stem]):
+            if want is None or version == want or \
+                version.startswith(want + ".") or \
+                version.startswith(want + ",") or \
+                version.startswith(want + "-") or \
+                version.startswith(want + ":"):
+                return version
+        return None
+
+    # -------------------------------------------------------------------------
+    def get_manifest(self, fmri):
+    # -------------------------------------------------------------------------
+        """Return the manifest of fmri, from the cache if possible."""
+        path = self.manifest_path(fmri)
+        try:
+            with open(path, "r") as mfile:
+                return mfile.read()
+        except IOError:
+            pass
+        text = self.repo.manifest(fmri.stem, fmri.version)
+        self._write(path, [text.encode("utf-8")])
+        return text
+
+    # -------------------------------------------------------------------------
+    def _claim(self, fhash):
+    # -------------------------------------------------------------------------
+        """Decide which thread fetches fhash.
+
+        Returns:
+          None if this thread is to fetch it, else an Event that is set
+          once another thread has fetched it.
+        """
+        with self._lock:
+            if fhash in self._inflight:
+                return self._inflight[fhash]
+            self._inflight[fhash] = threading.Event()
+            return None
+
+    # -------------------------------------------------------------------------
+    def fetch_payload(self, fhash, chash=None):
+    # -------------------------------------------------------------------------
+        """Make sure the payload for fhash is in the cache.
+
+        The compressed stream is hashed as it is read from the repository
+        and decompressed incrementally to hash the content, so both the
+        chash and the content hash are checked in the same pass as the
+        download.
+
+        Args:
+          fhash: SHA-1 of the uncompressed content
+          chash: SHA-1 of the compressed payload, if the manifest has it
+
+        Returns:
+          Number of bytes downloaded, 0 on a cache hit.
+
+        Raises:
+          PkgCacheError: the payload failed verification
+        """
+        path = self.file_path(fhash)
+        if os.path.exists(path):
+            with self._lock:
+                self.hits += 1
+            return 0
+
+        event = self._claim(fhash)
+        if event is not None:
+            event.wait()
+            return 0
+
+        try:
+            if os.path.exists(path):
+                return 0
+
+            csum = hashlib.sha1()
+            fsum = hashlib.sha1()
+            inflate = zlib.decompressobj(16 + zlib.MAX_WBITS)
+            nbytes = [0]
+
+            def verified_chunks(src):
+                """Yield src's blocks, hashing them on the way."""
+                while True:
+                    block = src.read(READ_SIZE)
+                    if not block:
+                        break
+                    nbytes[0] += len(block)
+                    csum.update(block)
+                    fsum.update(inflate.decompress(block))
+                    yield block
+                fsum.update(inflate.flush())
+
+                if chash is not None and csum.hexdigest() != chash:
+                    raise PkgCacheError("%s: compressed hash mismatch" %
+                                        fhash)
+                if fsum.hexdigest() != fhash:
+                    raise PkgCacheError("%s: content hash mismatch" % fhash)
+
+            src = self.repo.payload(fhash)
+            try:
+                self._write(path, verified_chunks(src))
+            except zlib.error as err:
+                raise PkgCacheError("%s: corrupt payload: %s" % (fhash, err))
+            finally:
+                src.close()
+
+            with self._lock:
+                self.fetched += 1
+                self.fetched_bytes += nbytes[0]
+            return nbytes[0]
+        finally:
+            with self._lock:
+                self._inflight.pop(fhash).set()
+
+    # -------------------------------------------------------------------------
+    def fetch_package(self, fmri, text):
+    # -------------------------------------------------------------------------
+        """Fetch and verify every payload of one package.
+
+        Returns:
+          (fmri, number of payloads, bytes downloaded, seconds taken)
+        """
+        start = time.time()
+        npayloads = 0
+        nbytes = 0
+        for line in text.splitlines():
+            action = parse_action(line)
+            if action is None or action[0] not in PAYLOAD_ACTIONS or \
+                action[1] is None:
+                continue
+            npayloads += 1
+            nbytes += self.fetch_payload(action[1], action[2].get("chash"))
+        return (fmri, npayloads, nbytes, time.time() - start)
+
+    # -------------------------------------------------------------------------
+    def prefetch(self, names):
+    # -------------------------------------------------------------------------
+        """Resolve names and populate the cache with everything they need.
+
+        Args:
+          names: package names from the DC manifest
+
+        Returns:
+          List of the PkgFmri objects of all packages fetched.
+
+        Raises:
+          PkgCacheError: a package couldn't be resolved or a payload
+              couldn't be fetched or verified
+        """
+        start = time.time()
+        (fmris, manifests) = self.resolve(names)
+        self.log.debug("Resolved %d packages in %.2f seconds" %
+                       (len(fmris), time.time() - start))
+
+        errors = []
+        with ThreadPoolExecutor(max_workers=self.jobs) as pool:
+            futures = [pool.submit(self.fetch_package, fmri, manifests[fmri])
+                       for fmri in fmris]
+            for future in futures:
+                try:
+                    (fmri, npayloads, nbytes, secs) = future.result()
+                except (PkgCacheError, IOError, OSError) as err:
+                    errors.append(str(err))
+                    continue
+                self.log.debug("%-60s %5d files %10d bytes fetched "
+                               "%7.2fs" % (fmri, npayloads, nbytes, secs))
+
+        self.log.info("Package cache: %d files fetched (%d bytes), %d "
+                      "reused, in %.2f seconds" % (self.fetched,
+                      self.fetched_bytes, self.hits, time.time() - start))
+        if errors:
+            raise PkgCacheError("; ".join(errors))
+        return fmris
+
+    # -------------------------------------------------------------------------
+    def seed_image(self, mntpt, fmris):
+    # -------------------------------------------------------------------------
+        """Link the payloads of fmris into the download cache of the pkg
+        image at mntpt so that pkg install doesn't fetch them again.
+
+        Hard links are used where the cache and the image share a file
+        system; otherwise the payloads are copied.
+
+        Returns:
+          Number of payloads seeded.
+        """
+        dest_root = os.path.join(mntpt, "var/pkg/publisher",
+                                 self.repo.publisher, "file")
+        seeded = 0
+        for fmri in fmris:
+            for line in self.get_manifest(fmri).splitlines():
+                action = parse_action(line)
+                if action is None or action[0] not in PAYLOAD_ACTIONS or \
+                    action[1] is None:
+                    continue
+                fhash = action[1]
+                dest = os.path.join(dest_root, fhash[0:2], fhash)
+                if os.path.exists(dest):
+                    continue
+                if not os.path.isdir(os.path.dirname(dest)):
+                    os.makedirs(os.path.dirname(dest))
+                try:
+                    os.link(self.file_path(fhash), dest)
+                except OSError:
+                    shutil.copyfile(self.file_path(fhash), dest)
+                seeded += 1
+        return seeded
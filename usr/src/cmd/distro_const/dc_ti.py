@@ -24,6 +24,9 @@
 
 """dc_ti.py - DC code to interface with the TI module. """
 
+import os
+import stat
+import shutil
 import logging
 from subprocess import Popen, PIPE
 
@@ -38,6 +41,9 @@ from osol_install.ti_defs import TI_ATTR_TARGET_TYPE, TI_TARGET_TYPE_DC_UFS, \
     TI_ATTR_DC_UFS_DEST, TI_TARGET_TYPE_ZFS_FS, TI_ATTR_ZFS_FS_POOL_NAME, \
     TI_ATTR_ZFS_FS_NUM, TI_ATTR_ZFS_FS_NAMES
  
+# Scratch areas of build_data, emptied in a build seeded from a golden
+# image: the golden build may have left files behind in them.
+SCRATCH_DIRS = (TMP, BOOT_ARCHIVE)
 
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def create_ufs_dir(pathname):
@@ -173,6 +179,236 @@ def create_ufs_build_data_area(ckp):
     # Create subdirs of build_data area.
     return create_bld_data_area_subdrs(mntpt)
 
+# Directories whose files are always copied by link_tree(): configuration
+# that the finalizer scripts and SMF edit in place, whatever its mode
+# (e.g. etc/sudoers, delivered read-only and appended to).
+COPY_UP_DIRS = ("etc", "var")
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def link_tree(src, dst):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Populate dst with a hard link farm of src.
+
+    A linked file is the golden image's own file, so anything the new
+    build changes in place in it (contents, mode, owner) changes the
+    golden image too.  Only files without any write permission are
+    linked, outside of the COPY_UP_DIRS directories: those are what pkg
+    delivers for binaries and libraries, and pkg and the finalizer
+    scripts replace rather than rewrite them.  Everything else is copied
+    up front.  Files on a different file system than dst are copied too,
+    which is always the case for a golden image read from a snapshot.
+
+    Args:
+            src - directory to link from
+            dst - directory to create the links in. Must exist.
+
+    Returns:
+            (number of files linked, number of files copied)
+
+    Raises:
+            OSError, IOError
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    linked = copied = 0
+    made_dirs = []
+
+    for root, dirs, files in os.walk(src):
+        rel = os.path.relpath(root, src)
+        tdir = os.path.join(dst, rel)
+        copy_up = any(part in COPY_UP_DIRS for part in rel.split(os.sep))
+        for name in dirs + files:
+            spath = os.path.join(root, name)
+            tpath = os.path.join(tdir, name)
+            sstat = os.lstat(spath)
+            mode = sstat.st_mode
+
+            if stat.S_ISLNK(mode):
+                os.symlink(os.readlink(spath), tpath)
+            elif stat.S_ISDIR(mode):
+                os.mkdir(tpath)
+                made_dirs.append((spath, tpath))
+            elif stat.S_ISREG(mode):
+                if not copy_up and not (mode & (stat.S_IWUSR |
+                    stat.S_IWGRP | stat.S_IWOTH)):
+                    try:
+                        os.link(spath, tpath)
+                        linked += 1
+                        continue
+                    except OSError:
+                        pass
+                shutil.copy2(spath, tpath)
+                copied += 1
+            else:
+                os.mknod(tpath, mode, sstat.st_rdev)
+                os.chmod(tpath, stat.S_IMODE(mode))
+            os.lchown(tpath, sstat.st_uid, sstat.st_gid)
+
+    # Directory times change as they are populated; set them last.
+    for (spath, tpath) in reversed(made_dirs):
+        shutil.copystat(spath, tpath)
+
+    return (linked, copied)
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def golden_image_path(golden):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Return the directory holding the contents of the golden image.
+
+    Args:
+            golden - ZFS snapshot name or directory path
+
+    Returns:
+            A ZFS snapshot is found in the .zfs/snapshot directory of
+            its dataset, a directory is returned as is.
+            None if the snapshot's dataset has no mountpoint.
+
+    """
+    if '@' not in golden:
+        return golden
+
+    (dataset, snap) = golden.split('@', 1)
+    cmd = "/usr/sbin/zfs list -H -o \"mountpoint\" " + dataset
+    try:
+        mntpt = Popen(cmd, shell=True, universal_newlines=True,
+                      stdout=PIPE).communicate()[0].strip()
+    except OSError:
+        return None
+    if not mntpt.startswith('/'):
+        return None
+    return os.path.join(mntpt, ".zfs", "snapshot", snap)
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def clone_zfs_build_data_area(ckp, golden):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Replace the build_data dataset with a zfs clone of the golden
+    snapshot.  The clone shares all its blocks with the golden image
+    until the build changes them.
+
+    The clone depends on the golden snapshot: as long as it exists, the
+    golden build can't destroy the snapshot or roll its build_data back
+    past it.  So when the golden build is rebuilt or resumed from an
+    earlier step, it destroys the clone along with its own snapshots
+    (see dc_checkpoint.dependent_clones()), and this build has to be
+    rebuilt after it.
+
+    Args:
+            ckp - checkpointing object
+            golden - zfs snapshot to clone
+
+    Returns:
+            -1 on Failure
+             0 on Success
+
+    """
+
+    dc_log = logging.getLogger(DC_LOGGER_NAME)
+    build_data = ckp.get_build_area_dataset() + BUILD_DATA
+
+    # build_data is destroyed below, so the golden snapshot must be
+    # known to exist and not be one of build_data or its descendants.
+    golden_fs = golden.split('@', 1)[0]
+    if golden_fs == build_data or golden_fs.startswith(build_data + "/"):
+        dc_log.error("Golden image " + golden + " is part of this " \
+                     "build's " + build_data + ", which is replaced")
+        return -1
+    if dc_ckp.shell_cmd("/usr/sbin/zfs list -H -o name -t snapshot " +
+                        golden + " >/dev/null 2>&1", dc_log):
+        dc_log.error("Golden image snapshot " + golden + " not found")
+        return -1
+
+    # This also destroys the @empty snapshot, which no longer
+    # describes what build_data gets rolled back to, and the builds
+    # which use this one as their golden image.
+    dc_ckp.log_dependent_clones(build_data, dc_log)
+    cmd = "/usr/sbin/zfs list -H -o name " + build_data + \
+          " >/dev/null 2>&1 && /usr/sbin/zfs destroy -R " + build_data
+    if dc_ckp.shell_cmd(cmd, dc_log):
+        dc_log.error("Unable to destroy " + build_data)
+        return -1
+
+    if dc_ckp.shell_cmd("/usr/sbin/zfs clone " + golden + " " +
+                        build_data, dc_log):
+        dc_log.error("Unable to clone " + golden + " to " + build_data)
+        return -1
+    clean_scratch_dirs(ckp)
+    return 0
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def clean_scratch_dirs(ckp):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Empty the scratch areas of a build_data area seeded from a golden
+    image, which has whatever the golden build left in them when its
+    snapshot was taken.  Only the package image is kept.
+
+    Args:
+            ckp - checkpointing object
+
+    Returns: None
+
+    """
+    mntpt = ckp.get_build_area_mntpt()
+    for scratch in SCRATCH_DIRS:
+        if os.path.isdir(mntpt + scratch):
+            dcu.cleanup_dir(mntpt + scratch)
+        else:
+            try:
+                os.mkdir(mntpt + scratch)
+            except OSError:
+                pass
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def clone_build_data_area(ckp, golden):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Base the build_data area on a golden image, so that im_pop only
+    needs to apply the package delta between the golden image and this
+    build.
+
+    A golden zfs snapshot is cloned if the build area is a zfs dataset.
+    Otherwise the build_data area is recreated as a hard link farm of
+    the golden image (see link_tree()).
+
+    Args:
+            ckp - checkpointing object
+            golden - zfs snapshot or directory of the golden build_data
+
+    Returns:
+            -1 on Failure
+             0 on Success
+
+    """
+
+    dc_log = logging.getLogger(DC_LOGGER_NAME)
+
+    if '@' in golden and ckp.get_build_area_dataset() is not None:
+        if clone_zfs_build_data_area(ckp, golden):
+            return -1
+        dc_log.info("Cloned build_data from " + golden)
+        return 0
+
+    src = golden_image_path(golden)
+    if src is None or \
+        not os.path.isdir(os.path.join(src, os.path.basename(PKG_IMAGE))):
+        dc_log.error("Golden image " + golden + " not found or has " \
+                     "no package image")
+        return -1
+
+    # create_build_area() has already made build_data (and its
+    # subdirs); empty it out so it can take the golden image's tree.
+    mntpt = ckp.get_build_area_mntpt()
+    dcu.cleanup_dir(mntpt + BUILD_DATA)
+
+    try:
+        (linked, copied) = link_tree(src, mntpt + BUILD_DATA)
+    except (OSError, IOError) as err:
+        dc_log.error("Unable to copy the golden image " + golden +
+                     ": " + str(err))
+        return -1
+    clean_scratch_dirs(ckp)
+    dc_log.info("Seeded build_data from " + golden + ": %d files linked, "
+                "%d copied" % (linked, copied))
+    return 0
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def create_subdirs(ckp):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
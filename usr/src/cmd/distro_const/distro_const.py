@@ -42,7 +42,8 @@ import osol_install.distro_const.dc_utils as dcu
 
 from osol_install.distro_const.dc_defs import DC_LOGGER_NAME, \
     DC_MANIFEST_DATA, BUILD_DATA, PKG_IMAGE, MEDIA, TMP, BOOT_ARCHIVE, \
-    LOGS, DISTRO_NAME, STOP_ON_ERR, SUCCESS, CHECKPOINT_RESUME 
+    LOGS, DISTRO_NAME, STOP_ON_ERR, SUCCESS, CHECKPOINT_RESUME, \
+    GOLDEN_IMAGE
 
 # =============================================================================
 # Error Handling
@@ -124,7 +125,8 @@ def get_manifest_server_obj(cp):
 #~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def start_manifest_server(manifest_server_obj):
 #~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    """Start up the socket for the manifest server.
+    """Start up the socket for the manifest server, and export the
+    manifest snapshot which the finalizer scripts read values from.
 
     Inputs:
            manifest_server_obj : A manifest server object which allows
@@ -133,6 +135,7 @@ def start_manifest_server(manifest_server_obj):
     """
 
     manifest_server_obj.start_socket_server()
+    manifest_server_obj.export_snapshot()
 
 #~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def parse_command_line(cp, manifest_server_obj):
@@ -388,8 +391,11 @@ def cleanup_build_data_area(cp):
         # Check to see if the empty snapshot is there.
         if (have_empty_snapshot(cp)):
 
-            # Rollback to the empty snapshot.
-            cmd = "/usr/sbin/zfs rollback -r " + dataset + \
+            # Rollback to the empty snapshot.  Builds which cloned a
+            # later snapshot as their golden_image go with it.
+            dc_ckp.log_dependent_clones(dataset + BUILD_DATA, dc_log,
+                                        dataset + BUILD_DATA + "@empty")
+            cmd = "/usr/sbin/zfs rollback -R " + dataset + \
                   BUILD_DATA + "@empty"
             try:
                 ret = dc_ckp.shell_cmd(cmd, dc_log)
@@ -406,7 +412,8 @@ def cleanup_build_data_area(cp):
             # destroy the old build_data area and recreate it
             # in order to get a clean build_data area.
 
-            cmd = "zfs destroy -r " + dataset + BUILD_DATA
+            dc_ckp.log_dependent_clones(dataset + BUILD_DATA, dc_log)
+            cmd = "zfs destroy -R " + dataset + BUILD_DATA
             try:
                 ret = dc_ckp.shell_cmd(cmd, dc_log)
             except OSError as err:
@@ -538,7 +545,15 @@ def main_func():
         # Cleanup the pkg_image area via either a remove of the files
         # if there is not checkpointing or rolling back to the @empty
         # snapshot if there is checkpointing.
-        if cleanup_build_data_area(cp) != 0:
+        #
+        # If a golden image is specified, start from a copy of it
+        # instead, so im_pop only has to apply the package delta.
+        golden = dcu.get_manifest_value(manifest_server_obj, GOLDEN_IMAGE)
+        if golden is not None:
+            ret = ti.clone_build_data_area(cp, golden)
+        else:
+            ret = cleanup_build_data_area(cp)
+        if ret != 0:
             dc_log.info("Build completed " + time.asctime(time.localtime()))
             dc_log.info("Build failed.")
             return 1
@@ -64,8 +64,11 @@ MESSAGE = sys.argv[LENGTH-1]
 
 DC_LOG = setup_dc_logging()
 
+# Builds which cloned a snapshot taken after this one as their golden_image
+# are destroyed with it.
 for snapshot in ZFS_SNAPSHOTS:
-    dc_ckp.shell_cmd("/usr/sbin/zfs rollback -r " + snapshot, DC_LOG)
+    dc_ckp.log_dependent_clones(snapshot.split("@", 1)[0], DC_LOG, snapshot)
+    dc_ckp.shell_cmd("/usr/sbin/zfs rollback -R " + snapshot, DC_LOG)
 
 DC_LOG.info(MESSAGE)
 
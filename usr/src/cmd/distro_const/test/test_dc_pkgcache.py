@@ -0,0 +1,276 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_dc_pkgcache.py
+
+'''
+
+import gzip
+import hashlib
+import json
+import logging
+import os
+import shutil
+import tempfile
+import unittest
+import urllib.parse
+
+from osol_install.distro_const.dc_pkgcache import parse_action, split_fmri, \
+    PkgCache, PkgCacheError, PkgRepo
+
+PUBLISHER = "test.org"
+
+
+class ParseActionTestCase(unittest.TestCase):
+
+    def test_payload(self):
+        ''' the first attribute without '=' is the payload hash '''
+        self.assertEqual(
+            parse_action("file 1234abcd chash=99ff path=usr/bin/ls "
+                         "mode=0555 owner=root group=bin"),
+            ("file", "1234abcd", {"chash": "99ff", "path": "usr/bin/ls",
+                                  "mode": "0555", "owner": "root",
+                                  "group": "bin"}))
+
+    def test_hash_attribute(self):
+        ''' without a positional hash, hash= is the payload '''
+        self.assertEqual(parse_action("license hash=5678 license=CDDL")[1],
+                         "5678")
+
+    def test_no_payload(self):
+        ''' directories and the like have no payload '''
+        self.assertEqual(parse_action("dir path=usr mode=0755"),
+                         ("dir", None, {"path": "usr", "mode": "0755"}))
+
+    def test_quoted(self):
+        ''' quoted values keep their blanks and lose their quotes '''
+        (name, payload, attrs) = parse_action(
+            'set name=pkg.summary value="Core Solaris, (Usr)"')
+        self.assertEqual(name, "set")
+        self.assertEqual(payload, None)
+        self.assertEqual(attrs, {"name": "pkg.summary",
+                                 "value": "Core Solaris, (Usr)"})
+
+        (name, payload, attrs) = parse_action(
+            "set name=info.classification value='org.opensolaris"
+            ".category.2008:System/Core' extra=1")
+        self.assertEqual(attrs["value"],
+                         "org.opensolaris.category.2008:System/Core")
+        self.assertEqual(attrs["extra"], "1")
+
+        # An unterminated quote runs to the end of the line.
+        self.assertEqual(parse_action('set value="a b')[2]["value"], "a b")
+
+    def test_repeated_key(self):
+        ''' the first of repeated keys is kept '''
+        self.assertEqual(
+            parse_action("depend type=require-any fmri=a fmri=b")[2]["fmri"],
+            "a")
+
+    def test_ignored(self):
+        ''' blank lines and comments aren't actions '''
+        self.assertEqual(parse_action(""), None)
+        self.assertEqual(parse_action("   \n"), None)
+        self.assertEqual(parse_action("# file 1234 path=x"), None)
+
+    def test_split_fmri(self):
+        ''' the forms of package names in DC manifests and depends '''
+        self.assertEqual(split_fmri("SUNWcs"), (None, "SUNWcs", None))
+        self.assertEqual(split_fmri("pkg:/system/kernel@0.5.11"),
+                         (None, "system/kernel", "0.5.11"))
+        self.assertEqual(split_fmri("pkg://test.org/entire@0.5.11-0.151"),
+                         ("test.org", "entire", "0.5.11-0.151"))
+
+
+class RepoTestCase(unittest.TestCase):
+    ''' a directory repository and a cache in a temporary directory '''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.repo_dir = os.path.join(self.tmpdir, "repo")
+        self.cache_dir = os.path.join(self.tmpdir, "cache")
+        self.catalog = {}
+        os.makedirs(os.path.join(self.repo_dir, "catalog"))
+        self.log = logging.getLogger("test_dc_pkgcache")
+        self.log.addHandler(logging.NullHandler())
+        self.log.propagate = False
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def add_payload(self, content):
+        ''' store content as a payload, returning (hash, chash) '''
+        data = gzip.compress(content)
+        fhash = hashlib.sha1(content).hexdigest()
+        path = os.path.join(self.repo_dir, "file", fhash[0:2], fhash)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        with open(path, "wb") as pfile:
+            pfile.write(data)
+        return (fhash, hashlib.sha1(data).hexdigest())
+
+    def add_package(self, stem, version, actions):
+        ''' publish stem@version with the given manifest lines '''
+        path = os.path.join(self.repo_dir, "pkg",
+                            urllib.parse.quote(stem, ""),
+                            urllib.parse.quote(version, ""))
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        with open(path, "w") as mfile:
+            mfile.write("\n".join(actions) + "\n")
+        self.catalog.setdefault(stem, []).append({"version": version})
+        with open(os.path.join(self.repo_dir, "catalog/catalog.base.C"),
+                  "w") as cfile:
+            json.dump({"_SIGNATURE": {}, PUBLISHER: self.catalog}, cfile)
+
+    def new_cache(self):
+        return PkgCache(self.cache_dir, PkgRepo("file://" + self.repo_dir,
+                        PUBLISHER), jobs=2, log=self.log)
+
+
+class FetchTestCase(RepoTestCase):
+
+    def test_verified(self):
+        ''' a good payload is cached, and found there the next time '''
+        (fhash, chash) = self.add_payload(b"hello\n")
+        cache = self.new_cache()
+        self.assertTrue(cache.fetch_payload(fhash, chash) > 0)
+        with gzip.open(cache.file_path(fhash)) as cfile:
+            self.assertEqual(cfile.read(), b"hello\n")
+        self.assertEqual(cache.fetch_payload(fhash, chash), 0)
+        self.assertEqual((cache.fetched, cache.hits), (1, 1))
+
+    def test_content_mismatch(self):
+        ''' a payload that doesn't inflate to its hash isn't cached '''
+        (fhash, chash) = self.add_payload(b"hello\n")
+        (other, ochash) = self.add_payload(b"goodbye\n")
+        shutil.copyfile(os.path.join(self.repo_dir, "file", other[0:2],
+                                     other),
+                        os.path.join(self.repo_dir, "file", fhash[0:2],
+                                     fhash))
+        cache = self.new_cache()
+        self.assertRaises(PkgCacheError, cache.fetch_payload, fhash)
+        self.assertFalse(os.path.exists(cache.file_path(fhash)))
+        self.assertEqual(os.listdir(os.path.dirname(cache.file_path(fhash))),
+                         [])
+
+    def test_chash_mismatch(self):
+        ''' the compressed hash is checked when the manifest has one '''
+        (fhash, chash) = self.add_payload(b"hello\n")
+        cache = self.new_cache()
+        self.assertRaises(PkgCacheError, cache.fetch_payload, fhash,
+                          "0" * 40)
+        self.assertFalse(os.path.exists(cache.file_path(fhash)))
+        self.assertTrue(cache.fetch_payload(fhash, chash) > 0)
+
+    def test_corrupt(self):
+        ''' a payload that isn't gzip'ed is refused '''
+        fhash = hashlib.sha1(b"hello\n").hexdigest()
+        path = os.path.join(self.repo_dir, "file", fhash[0:2], fhash)
+        os.makedirs(os.path.dirname(path))
+        with open(path, "wb") as pfile:
+            pfile.write(b"hello\n")
+        cache = self.new_cache()
+        self.assertRaises(PkgCacheError, cache.fetch_payload, fhash)
+        self.assertFalse(os.path.exists(cache.file_path(fhash)))
+
+
+class ResolveTestCase(RepoTestCase):
+
+    def setUp(self):
+        RepoTestCase.setUp(self)
+        (self.ls_hash, ls_chash) = self.add_payload(b"ls\n")
+        (self.cddl_hash, cddl_chash) = self.add_payload(b"CDDL\n")
+        self.add_package("system/core", "1.0,5.11-0.1", [
+            'set name=pkg.summary value="Core, old"',
+            "file %s chash=%s path=usr/bin/ls mode=0555" %
+            (self.ls_hash, ls_chash)])
+        self.add_package("system/core", "2.0,5.11-0.1", [
+            'set name=pkg.summary value="Core, new"'])
+        self.add_package("system/library", "1.0,5.11-0.1", [
+            "license %s chash=%s license=CDDL" % (self.cddl_hash,
+                                                   cddl_chash),
+            "depend fmri=system/core type=require"])
+        self.add_package("entire", "0.151,5.11-0.151", [
+            "depend fmri=system/core@1.0 type=incorporate",
+            "depend fmri=pkg:/system/library@1.0 type=require",
+            "depend fmri=system/missing type=require"])
+
+    def names(self, fmris):
+        return [str(fmri) for fmri in fmris]
+
+    def test_resolve(self):
+        ''' dependencies are followed and incorporations honored '''
+        (fmris, manifests) = self.new_cache().resolve(["entire"])
+        self.assertEqual(self.names(fmris),
+                         ["pkg://test.org/entire@0.151,5.11-0.151",
+                          "pkg://test.org/system/library@1.0,5.11-0.1",
+                          "pkg://test.org/system/core@1.0,5.11-0.1"])
+        self.assertTrue("Core, old" in manifests[fmris[2]])
+
+    def test_newest(self):
+        ''' without a constraint, the newest version is picked, and an
+        abbreviated stem is matched '''
+        (fmris, manifests) = self.new_cache().resolve(["core"])
+        self.assertEqual(self.names(fmris),
+                         ["pkg://test.org/system/core@2.0,5.11-0.1"])
+
+    def test_not_found(self):
+        ''' a requested package must be in the repository '''
+        self.assertRaises(PkgCacheError, self.new_cache().resolve,
+                          ["system/missing"])
+        self.assertRaises(PkgCacheError, self.new_cache().resolve,
+                          ["system/core@3.0"])
+
+    def test_populated_cache(self):
+        ''' a second build resolves and fetches from the cache alone '''
+        cache = self.new_cache()
+        fmris = cache.prefetch(["entire"])
+        self.assertEqual((cache.fetched, cache.hits), (2, 0))
+
+        # Only the catalog is left in the repository.
+        for subdir in ("pkg", "file"):
+            shutil.rmtree(os.path.join(self.repo_dir, subdir))
+
+        cache = self.new_cache()
+        self.assertEqual(self.names(cache.prefetch(["entire"])),
+                         self.names(fmris))
+        self.assertEqual((cache.fetched, cache.hits), (0, 2))
+
+        image = os.path.join(self.tmpdir, "image")
+        self.assertEqual(cache.seed_image(image, fmris), 2)
+        dest = os.path.join(image, "var/pkg/publisher", PUBLISHER, "file",
+                            self.ls_hash[0:2], self.ls_hash)
+        self.assertTrue(os.path.samefile(dest,
+                                         cache.file_path(self.ls_hash)))
+        self.assertEqual(cache.seed_image(image, fmris), 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
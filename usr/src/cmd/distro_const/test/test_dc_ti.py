@@ -0,0 +1,215 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_dc_ti.py
+
+'''
+
+import os
+import shutil
+import tempfile
+import unittest
+
+import osol_install.distro_const.dc_checkpoint as dc_ckp
+from osol_install.distro_const.dc_defs import BUILD_DATA, BOOT_ARCHIVE, \
+    PKG_IMAGE, TMP
+from osol_install.distro_const.dc_ti import clean_scratch_dirs, link_tree
+
+
+def write_file(path, data, mode):
+    dirname = os.path.dirname(path)
+    if not os.path.isdir(dirname):
+        os.makedirs(dirname)
+    with open(path, "w") as wfile:
+        wfile.write(data)
+    os.chmod(path, mode)
+
+
+def read_file(path):
+    with open(path) as rfile:
+        return rfile.read()
+
+
+class LinkTreeTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.golden = os.path.join(self.tmpdir, "golden")
+        self.build = os.path.join(self.tmpdir, "build")
+        os.mkdir(self.build)
+
+        pkg_image = os.path.join(self.golden, "pkg_image")
+        write_file(os.path.join(pkg_image, "usr/bin/ls"), "ls", 0o555)
+        write_file(os.path.join(pkg_image, "usr/lib/libc.so.1"), "libc",
+                   0o755)
+        write_file(os.path.join(pkg_image, "etc/sudoers"), "root ALL\n",
+                   0o440)
+        write_file(os.path.join(pkg_image, "etc/security/exec_attr"),
+                   "exec\n", 0o444)
+        write_file(os.path.join(pkg_image, "var/sadm/install/contents"),
+                   "contents\n", 0o444)
+        os.symlink("../usr/bin/ls", os.path.join(pkg_image, "etc/ls"))
+
+        self.counts = link_tree(self.golden, self.build)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def same_file(self, rel):
+        return os.path.samefile(os.path.join(self.golden, rel),
+                                os.path.join(self.build, rel))
+
+    def test_read_only_files_linked(self):
+        ''' read-only files outside of etc and var are shared '''
+        self.assertTrue(self.same_file("pkg_image/usr/bin/ls"))
+        self.assertEqual(self.counts, (1, 4))
+
+    def test_copy_up(self):
+        ''' writable files and configuration are copied '''
+        for rel in ("pkg_image/usr/lib/libc.so.1", "pkg_image/etc/sudoers",
+                    "pkg_image/etc/security/exec_attr",
+                    "pkg_image/var/sadm/install/contents"):
+            self.assertFalse(self.same_file(rel), rel)
+            self.assertEqual(read_file(os.path.join(self.golden, rel)),
+                             read_file(os.path.join(self.build, rel)))
+        self.assertEqual(
+            os.stat(os.path.join(self.build, "pkg_image/etc/sudoers")).st_mode
+            & 0o777, 0o440)
+        self.assertEqual(
+            os.readlink(os.path.join(self.build, "pkg_image/etc/ls")),
+            "../usr/bin/ls")
+
+    def test_changes_stay_in_build(self):
+        ''' in place changes by the build don't reach the golden image '''
+        sudoers = os.path.join(self.build, "pkg_image/etc/sudoers")
+        os.chmod(sudoers, 0o640)
+        with open(sudoers, "a") as sfile:
+            sfile.write("jack ALL\n")
+        os.chmod(sudoers, 0o440)
+
+        golden_sudoers = os.path.join(self.golden, "pkg_image/etc/sudoers")
+        self.assertEqual(read_file(golden_sudoers), "root ALL\n")
+        self.assertEqual(read_file(sudoers), "root ALL\njack ALL\n")
+
+        libc = "pkg_image/usr/lib/libc.so.1"
+        with open(os.path.join(self.build, libc), "a") as lfile:
+            lfile.write("patched")
+        self.assertEqual(read_file(os.path.join(self.golden, libc)), "libc")
+
+
+class FakeCheckpoint(object):
+    ''' the part of the checkpointing object clean_scratch_dirs uses '''
+
+    def __init__(self, mntpt):
+        self.mntpt = mntpt
+
+    def get_build_area_mntpt(self):
+        return self.mntpt
+
+
+class ScratchTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def test_leftovers_removed(self):
+        ''' the golden build's tmp and boot_archive files aren't kept '''
+        write_file(self.tmpdir + TMP + "/ba.img/etc/system", "x", 0o644)
+        write_file(self.tmpdir + BOOT_ARCHIVE + "/platform/unix", "x",
+                   0o444)
+        write_file(self.tmpdir + PKG_IMAGE + "/usr/bin/ls", "ls", 0o555)
+
+        clean_scratch_dirs(FakeCheckpoint(self.tmpdir))
+        self.assertEqual(os.listdir(self.tmpdir + TMP), [])
+        self.assertEqual(os.listdir(self.tmpdir + BOOT_ARCHIVE), [])
+        self.assertEqual(read_file(self.tmpdir + PKG_IMAGE + "/usr/bin/ls"),
+                         "ls")
+
+    def test_missing_created(self):
+        ''' the scratch areas exist afterwards '''
+        os.mkdir(self.tmpdir + BUILD_DATA)
+        clean_scratch_dirs(FakeCheckpoint(self.tmpdir))
+        self.assertTrue(os.path.isdir(self.tmpdir + TMP))
+        self.assertTrue(os.path.isdir(self.tmpdir + BOOT_ARCHIVE))
+
+
+class FakePopen(object):
+    ''' answers the zfs list commands of dependent_clones '''
+
+    snapshots = "rpool/dc/build_data@empty\n" \
+                "rpool/dc/build_data@.step_im-pop\n" \
+                "rpool/dc/build_data@golden\n" \
+                "rpool/dc/build_data@.step_ba-init\n" \
+                "rpool/dc/build_data2@golden\n"
+    datasets = "rpool\t-\n" \
+               "rpool/dc/build_data\t-\n" \
+               "rpool/dc/build_data2\t-\n" \
+               "rpool/dc2/build_data\trpool/dc/build_data@golden\n" \
+               "rpool/dc3/build_data\trpool/dc/build_data2@golden\n"
+
+    def __init__(self, cmd, **kwargs):
+        self.cmd = cmd
+
+    def communicate(self):
+        if "-t snapshot" in self.cmd:
+            return (self.snapshots, "")
+        return (self.datasets, "")
+
+
+class DependentClonesTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.popen = dc_ckp.Popen
+        dc_ckp.Popen = FakePopen
+
+    def tearDown(self):
+        dc_ckp.Popen = self.popen
+
+    def test_all(self):
+        ''' clones of any snapshot of the dataset, and only of it '''
+        self.assertEqual(dc_ckp.dependent_clones("rpool/dc/build_data"),
+                         [("rpool/dc2/build_data",
+                           "rpool/dc/build_data@golden")])
+
+    def test_after(self):
+        ''' a rollback only destroys clones of later snapshots '''
+        self.assertEqual(
+            dc_ckp.dependent_clones("rpool/dc/build_data",
+                                    "rpool/dc/build_data@.step_im-pop"),
+            [("rpool/dc2/build_data", "rpool/dc/build_data@golden")])
+        self.assertEqual(
+            dc_ckp.dependent_clones("rpool/dc/build_data",
+                                    "rpool/dc/build_data@golden"), [])
+
+
+if __name__ == '__main__':
+    unittest.main()
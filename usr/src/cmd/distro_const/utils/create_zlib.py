@@ -0,0 +1,357 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2008, 2010, Oracle and/or its affiliates. All rights reserved.
+#
+"""create_zlib - Build a lofi compressed hsfs image (solaris.zlib,
+solarismisc.zlib) from a directory tree in a single pass.
+
+mkisofs output is streamed straight into this module and cut into
+segments, which are compressed concurrently and written out in the
+on-disk format understood by lofi(7D).  The result can be mounted
+with "lofiadm -a" exactly like a file produced by "lofiadm -C".
+
+Usage:
+    create_zlib.py -a <alg> -o <output> [-V <volume label>] [-s <sort file>]
+        [-j <jobs>] [-S <segment size>] [-i <index file>] <source dir>
+
+"""
+import getopt
+import lzma
+import os
+import re
+import struct
+import sys
+import zlib
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+from subprocess import Popen, PIPE
+
+# A few commands
+MKISOFS = "/usr/bin/mkisofs"
+
+# Options used for all compressed images; these must stay in sync with
+# what media-fs-root expects to find when it mounts the image.
+MKISOFS_OPTS = ["-quiet", "-N", "-l", "-R", "-U", "-allow-multidot",
+                "-no-iso-translate", "-cache-inodes", "-d", "-D"]
+
+# lofi compressed file layout (see lofi(7D), lofiadm(1M)).
+LOFI_ALG_NAME_LEN = 36          # MAXALGLEN
+LOFI_SEGHDR = 1                 # per-segment compression flag
+LOFI_UNCOMPRESSED = 0
+LOFI_COMPRESSED = 1
+LOFI_DEF_SEGSIZE = 131072
+DEV_BSIZE = 512
+ISO_SECTOR_SIZE = 2048
+
+# lofi algorithm name -> (compressor type, level)
+LOFI_ALGS = {
+    "gzip": ("gzip", 6),
+    "gzip-6": ("gzip", 6),
+    "gzip-9": ("gzip", 9),
+    "lzma": ("lzma", 6)
+}
+
+# LZMA1 properties used by the lofi lzma compressor
+LZMA_LC = 3
+LZMA_LP = 0
+LZMA_PB = 2
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def usage():
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Print usage message and exit.
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    print(("Usage: %s -a <alg> -o <output> [-V <volume label>] " +
+        "[-s <sort file>]\n\t[-j <jobs>] [-S <segment size>] " +
+        "[-i <index file>] <source dir>") % sys.argv[0], file=sys.stderr)
+    sys.exit(1)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def compress_segment(alg, data):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Compress one segment the way lofiadm -C does.
+
+    Both zlib and lzma release the GIL while compressing, so this is
+    run from a thread pool.  A segment that doesn't shrink is stored
+    uncompressed, flagged in its header byte.
+
+    Args:
+      alg: (compressor type, level) tuple from LOFI_ALGS
+      data: uncompressed segment
+
+    Returns: segment as it is to be written to the image
+
+    Raises: None
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    ctype, level = alg
+    if ctype == "gzip":
+        comp = zlib.compress(data, level)
+    else:
+        dict_size = max(len(data), 4096)
+        # the header of a .lzma file: properties, then uncompressed size
+        comp = struct.pack("<BIQ", (LZMA_PB * 5 + LZMA_LP) * 9 + LZMA_LC,
+                           dict_size, len(data))
+        comp += lzma.compress(data, format=lzma.FORMAT_RAW,
+                              filters=[{"id": lzma.FILTER_LZMA1,
+                                        "preset": level,
+                                        "dict_size": dict_size,
+                                        "lc": LZMA_LC, "lp": LZMA_LP,
+                                        "pb": LZMA_PB}])
+
+    if len(comp) >= len(data):
+        return bytes([LOFI_UNCOMPRESSED]) + data
+    return bytes([LOFI_COMPRESSED]) + comp
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def mkisofs_cmd(srcdir, label, sort_file):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Assemble the mkisofs argument list for srcdir.
+
+    Args:
+      srcdir: directory tree to put into the image
+      label: volume label
+      sort_file: mkisofs sort file, or None
+
+    Returns: argument list suitable for Popen
+
+    Raises: None
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    cmd = [MKISOFS]
+    if sort_file:
+        cmd += ["-sort", sort_file]
+    cmd += MKISOFS_OPTS + ["-V", label, srcdir]
+    return cmd
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def image_size(cmd):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Ask mkisofs how big the hsfs image will be.
+
+    This is a metadata-only walk of the tree.  It lets the lofi header
+    and segment index be sized up front, so the compressed segments can
+    be written in place while mkisofs is still producing them.
+
+    Args:
+      cmd: mkisofs argument list as returned by mkisofs_cmd()
+
+    Returns: uncompressed image size in bytes
+
+    Raises: Exception if mkisofs fails or its output can't be parsed
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    size_cmd = cmd[:1] + ["-print-size"] + cmd[1:]
+    proc = Popen(size_cmd, stdout=PIPE, stderr=PIPE, universal_newlines=True)
+    (outs, errs) = proc.communicate()
+    if proc.returncode != 0:
+        raise Exception("mkisofs -print-size failed: " + errs.strip())
+
+    # Depending on -quiet, the extent count is either printed alone on
+    # stdout or as "Total extents scheduled to be written = N" on stderr.
+    extents = re.findall(r"(\d+)\s*$", outs + errs, re.MULTILINE)
+    if not extents:
+        raise Exception("Unable to determine image size from mkisofs")
+    return int(extents[-1]) * ISO_SECTOR_SIZE
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def read_segment(pipe, segsize):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Read up to segsize bytes from pipe, coping with short reads.
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    buf = bytearray()
+    while len(buf) < segsize:
+        chunk = pipe.read(segsize - len(buf))
+        if not chunk:
+            break
+        buf += chunk
+    return bytes(buf)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def create_zlib(srcdir, output, alg_name, label="compress", sort_file=None,
+                jobs=None, segsize=LOFI_DEF_SEGSIZE, index_file=None):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Build a lofi compressed hsfs image of srcdir.
+
+    The file is laid out as lofiadm -C lays it out: the algorithm name,
+    segment size, index entry count and uncompressed size of the last
+    segment, followed by the segment index and then the segments.
+    Index entries are big-endian offsets relative to the end of the
+    index; the extra final entry marks the end of the last segment.
+
+    Args:
+      srcdir: directory tree to put into the image
+      output: compressed image file to create
+      alg_name: lofi compression algorithm name (e.g. "gzip")
+      label: volume label
+      sort_file: mkisofs sort file, or None
+      jobs: number of compression threads; defaults to the CPU count
+      segsize: uncompressed segment size
+      index_file: if not None, a human-readable segment map is written
+          here as "segment uncomp_offset comp_offset comp_length flag"
+
+    Returns: (uncompressed size, compressed size)
+
+    Raises: Exception on invalid arguments or if mkisofs fails
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    if alg_name not in LOFI_ALGS:
+        raise Exception("invalid algorithm name: " + alg_name)
+    alg = LOFI_ALGS[alg_name]
+
+    if segsize <= 0 or segsize % DEV_BSIZE != 0:
+        raise Exception("segment size must be a multiple of %d" % DEV_BSIZE)
+
+    if jobs is None or jobs < 1:
+        jobs = os.cpu_count() or 1
+
+    cmd = mkisofs_cmd(srcdir, label, sort_file)
+    expected = image_size(cmd)
+
+    # Reserve room for the header and a full index
+    nsegs = (expected + segsize - 1) // segsize
+    index_entries = nsegs + 1
+    hdr_fmt = ">%dsIII" % LOFI_ALG_NAME_LEN
+    data_base = struct.calcsize(hdr_fmt) + index_entries * 8
+
+    index = [0]
+    idx_lines = []
+    total = 0
+    last_seg_size = segsize
+    offset = 0
+
+    proc = None
+    outfd = open(output, "wb")
+    try:
+        outfd.seek(data_base)
+        proc = Popen(cmd, stdout=PIPE)
+
+        with ThreadPoolExecutor(max_workers=jobs) as pool:
+            pending = deque()
+            eof = False
+            while not eof or pending:
+                # Keep the pool busy but the memory footprint bounded
+                while not eof and len(pending) < jobs * 2:
+                    data = read_segment(proc.stdout, segsize)
+                    if not data:
+                        eof = True
+                        break
+                    total += len(data)
+                    last_seg_size = len(data)
+                    pending.append(pool.submit(compress_segment, alg, data))
+                    if len(data) < segsize:
+                        eof = True
+
+                if not pending:
+                    break
+
+                # Segments are written in order as they complete
+                seg = pending.popleft().result()
+                outfd.write(seg)
+                idx_lines.append("%d %d %d %d %d\n" % (len(index) - 1,
+                    (len(index) - 1) * segsize, offset, len(seg), seg[0]))
+                offset += len(seg)
+                index.append(offset)
+
+        proc.stdout.close()
+        if proc.wait() != 0:
+            raise Exception("mkisofs of " + srcdir + " failed")
+
+        if total != expected:
+            raise Exception(("mkisofs produced %d bytes, %d expected") %
+                            (total, expected))
+
+        outfd.seek(0)
+        outfd.write(struct.pack(hdr_fmt, alg_name.encode(), segsize,
+                                len(index), last_seg_size))
+        outfd.write(struct.pack(">%dQ" % len(index), *index))
+    except BaseException:
+        # Don't leave mkisofs behind, blocked on a pipe nobody reads
+        if proc is not None:
+            if proc.poll() is None:
+                proc.kill()
+            proc.stdout.close()
+            proc.wait()
+        outfd.close()
+        os.unlink(output)
+        raise
+
+    outfd.close()
+
+    if index_file is not None:
+        with open(index_file, "w") as idxfd:
+            idxfd.writelines(idx_lines)
+
+    return (total, data_base + offset)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+# Main
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+if __name__ == "__main__":
+    try:
+        (OPTS, ARGS) = getopt.getopt(sys.argv[1:], "a:i:j:o:s:S:V:")
+    except getopt.GetoptError:
+        usage()
+
+    ALG = OUTPUT = INDEX_FILE = SORT_FILE = JOBS = None
+    SEGSIZE = LOFI_DEF_SEGSIZE
+    LABEL = "compress"
+    try:
+        for (opt, arg) in OPTS:
+            if opt == "-a":
+                ALG = arg
+            elif opt == "-i":
+                INDEX_FILE = arg
+            elif opt == "-j":
+                JOBS = int(arg)
+            elif opt == "-o":
+                OUTPUT = arg
+            elif opt == "-s":
+                SORT_FILE = arg
+            elif opt == "-S":
+                SEGSIZE = int(arg)
+            elif opt == "-V":
+                LABEL = arg
+    except ValueError:
+        usage()
+
+    if ALG is None or OUTPUT is None or len(ARGS) != 1:
+        usage()
+
+    try:
+        (USIZE, CSIZE) = create_zlib(ARGS[0], OUTPUT, ALG, LABEL,
+                                     SORT_FILE, JOBS, SEGSIZE, INDEX_FILE)
+    except Exception as err:
+        print(sys.argv[0] + ": " + str(err), file=sys.stderr)
+        sys.exit(1)
+
+    print("%s: %d bytes compressed to %d bytes" % (OUTPUT, USIZE, CSIZE))
+    sys.exit(0)
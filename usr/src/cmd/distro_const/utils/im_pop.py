@@ -36,6 +36,8 @@ import osol_install.distro_const.dc_utils as dcu
 import osol_install.transfer_mod as tm 
 from osol_install.install_utils import dir_size
 from osol_install.ManifestRead import ManifestRead
+from osol_install.distro_const.dc_pkgcache import PkgCache, PkgRepo, \
+    PkgCacheError, PKG_CACHE_JOBS
 
 from osol_install.distro_const.dc_defs import DEFAULT_MAIN_URL, \
     DEFAULT_MAIN_AUTHNAME, DEFAULT_MIRROR_URL, \
@@ -45,7 +47,7 @@ from osol_install.distro_const.dc_defs import DEFAULT_MAIN_URL, \
     POST_INSTALL_ADD_AUTH_URL, POST_INSTALL_ADD_URL_TO_AUTHNAME, \
     POST_INSTALL_ADD_URL_TO_MIRROR_URL, STOP_ON_ERR, \
     ADD_AUTH_URL_TO_MIRROR_URL, IMAGE_INFO_FILE, \
-    IMAGE_INFO_IMAGE_SIZE_KEYWORD
+    IMAGE_INFO_IMAGE_SIZE_KEYWORD, INSTALLED_PKG_LIST
 
 from osol_install.transfer_defs import TM_ATTR_MECHANISM, \
     TM_PERFORM_IPS, TM_IPS_ACTION, TM_IPS_INIT, TM_IPS_PKG_URL, \
@@ -100,6 +102,27 @@ def create_image_info(mntpt):
         print("Error in creating " + mntpt + "/.image_info", file=sys.stderr)
         return
 
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def read_pkg_list(file_name):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Read a list of packages, one per line, as written for ips_pkg_op().
+
+    Args:
+       file_name: file to read
+
+    Returns:
+       The list of packages, or an empty list if the file can't be read.
+
+    Raises:
+       None
+    """
+
+    try:
+        with open(file_name, "r") as pkgfile:
+            return [pkg for pkg in pkgfile.read().splitlines() if pkg]
+    except IOError:
+        return []
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def ips_init(pkg_url, pkg_auth, mntpt):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -242,6 +265,39 @@ def ips_contents_verify(file_name, mntpt):
         (TM_IPS_INIT_MNTPT, mntpt),
         (TM_PYTHON_LOG_HANDLER, DC_LOG)])
 
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def ips_cache_populate(pkgs, cache_dir, repo_url, auth, jobs, mntpt):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Fetch the packages listed, and everything they depend on, into the
+    persistent package cache and seed the pkg image's download cache from
+    it.  Payloads are verified as they are fetched, so this replaces
+    ips_contents_verify().
+
+    Inputs:
+            pkgs: list of pkgs to install
+            cache_dir: directory of the persistent package cache
+            repo_url: repository to fill the cache from
+            auth: publisher of the packages
+            jobs: number of packages to fetch concurrently
+            mntpt: Mount point for the pkg image area.
+
+    Returns:
+            0 : success
+            -1 : failure
+
+    """
+
+    try:
+        cache = PkgCache(cache_dir, PkgRepo(repo_url, auth), jobs, DC_LOG)
+        fmris = cache.prefetch(pkgs)
+        seeded = cache.seed_image(mntpt, fmris)
+    except (PkgCacheError, IOError, OSError, ValueError) as err:
+        print("Package cache: " + str(err), file=sys.stderr)
+        return -1
+
+    DC_LOG.debug("Seeded %d files into the package image" % seeded)
+    return 0
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def ips_pkg_op(file_name, mntpt, ips_pkg_op, generate_ips_index):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -321,6 +377,54 @@ def ips_cleanup_mirrors(unset_mirror_list, future_auth, mntpt):
                 return -1
     return 0
 
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def ips_uninstall_pkgs(pkgs, tmp_dir, mntpt, generate_ips_index):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Uninstall the packages, one at a time if they can't all be
+    uninstalled at once.
+
+    A pkg uninstall of several packages removes all of them or none, so
+    one package that can't be removed would keep all the others.  Each
+    package is then retried on its own, for as long as some of them
+    can be removed: one may only become removable once another of the
+    list that depends on it is gone.
+
+    Inputs:
+            pkgs: list of packages to uninstall
+            tmp_dir: temporary directory to use
+            mntpt: mount point of the pkg image area.
+            generate_ips_index: true or false indicating whether to
+                generate the ips index or not.
+
+    Returns:
+            list of the packages which couldn't be uninstalled
+
+    """
+
+    file_name = tmp_dir + "/uninstall_pkgs%s" % str(os.getpid())
+
+    def uninstall(names):
+        with open(file_name, 'w') as pkgfile:
+            pkgfile.write("\n".join(names) + "\n")
+        try:
+            return ips_pkg_op(file_name, mntpt, TM_IPS_UNINSTALL,
+                              generate_ips_index)
+        finally:
+            os.unlink(file_name)
+
+    if not pkgs or uninstall(pkgs) == TM_E_SUCCESS:
+        return []
+
+    remaining = list(pkgs)
+    progress = True
+    while remaining and progress:
+        progress = False
+        for pkg in remaining[:]:
+            if uninstall([pkg]) == TM_E_SUCCESS:
+                remaining.remove(pkg)
+                progress = True
+    return remaining
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def ips_purge_hist(mntpt):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -407,15 +511,36 @@ if __name__ == "__main__":
         print("WARNING: There's a problem with logging setup", file=sys.stderr)
         print("Error: " + str(err), file=sys.stderr)
 
-    # Initialize the IPS area. Use the default publisher.
-    print("Initializing the IPS package image area: " + \
-                         PKG_IMG_MNT_PT, file=sys.stderr)
-    print("Setting preferred publisher: " + PKG_AUTH, file=sys.stderr)
-    print("\tOrigin repository: " + PKG_URL, file=sys.stderr)
-    STATUS = ips_init(PKG_URL, PKG_AUTH, PKG_IMG_MNT_PT)
-    if STATUS != TM_E_SUCCESS:
-        raise Exception(sys.argv[0] +
-                          ": Unable to initialize the IPS image")
+    # When distro_const seeded the build area from a golden image, the
+    # package image already exists.  Point it back at the build
+    # repository, and only apply the difference between the golden
+    # image's package list and ours.
+    INSTALLED_PKG_FILE = os.path.join(TMP_DIR, INSTALLED_PKG_LIST)
+    GOLDEN_PKGS = []
+    if os.path.isdir(PKG_IMG_MNT_PT + "/var/pkg"):
+        print("Reusing the IPS package image area: " + \
+                             PKG_IMG_MNT_PT, file=sys.stderr)
+        print("Setting preferred publisher: " + PKG_AUTH, file=sys.stderr)
+        print("\tOrigin repository: " + PKG_URL, file=sys.stderr)
+        STATUS = ips_set_auth(PKG_URL, PKG_AUTH, PKG_IMG_MNT_PT,
+                              pref_flag=True)
+        if STATUS == TM_E_SUCCESS:
+            STATUS = ips_set_auth(PKG_URL, PKG_AUTH, PKG_IMG_MNT_PT,
+                                  refresh_flag=True)
+        if STATUS != TM_E_SUCCESS:
+            raise Exception(sys.argv[0] +
+                              ": Unable to reset the IPS image publisher")
+        GOLDEN_PKGS = read_pkg_list(INSTALLED_PKG_FILE)
+    else:
+        # Initialize the IPS area. Use the default publisher.
+        print("Initializing the IPS package image area: " + \
+                             PKG_IMG_MNT_PT, file=sys.stderr)
+        print("Setting preferred publisher: " + PKG_AUTH, file=sys.stderr)
+        print("\tOrigin repository: " + PKG_URL, file=sys.stderr)
+        STATUS = ips_init(PKG_URL, PKG_AUTH, PKG_IMG_MNT_PT)
+        if STATUS != TM_E_SUCCESS:
+            raise Exception(sys.argv[0] +
+                              ": Unable to initialize the IPS image")
 
     # Keep a list of authorities to cleanup at the end.
     UNSET_AUTH_LIST.append(PKG_AUTH)
@@ -506,8 +631,30 @@ if __name__ == "__main__":
         PKGFILE.write(pkg + '\n')
     PKGFILE.close()
 
-    print("Verifying the contents of the IPS repository", file=sys.stderr)
-    STATUS = ips_contents_verify(PKG_FILE_NAME, PKG_IMG_MNT_PT)
+    # With a package cache configured, the packages are fetched into
+    # the cache and verified in one pass; otherwise ask the repository
+    # whether it has them.
+    PKG_CACHE = dcu.get_manifest_value(MANIFEST_SERVER_OBJ, "pkg_cache",
+                                       is_key=True)
+    if PKG_CACHE is not None:
+        PKG_CACHE_REPO = dcu.get_manifest_value(MANIFEST_SERVER_OBJ,
+                                                "pkg_cache_repo",
+                                                is_key=True) or PKG_URL
+        PKG_CACHE_JOBS_STR = dcu.get_manifest_value(MANIFEST_SERVER_OBJ,
+                                                    "pkg_cache_jobs",
+                                                    is_key=True)
+        try:
+            JOBS = int(PKG_CACHE_JOBS_STR or PKG_CACHE_JOBS)
+        except ValueError:
+            JOBS = PKG_CACHE_JOBS
+        print("Fetching and verifying packages into " + PKG_CACHE,
+              file=sys.stderr)
+        STATUS = ips_cache_populate(PKGS, PKG_CACHE, PKG_CACHE_REPO,
+                                    PKG_AUTH, JOBS, PKG_IMG_MNT_PT)
+    else:
+        print("Verifying the contents of the IPS repository",
+              file=sys.stderr)
+        STATUS = ips_contents_verify(PKG_FILE_NAME, PKG_IMG_MNT_PT)
     if STATUS and QUIT_ON_PKG_FAILURE == 'true':
         os.unlink(PKG_FILE_NAME)
         raise Exception(sys.argv[0] + ": Unable to verify the " +
@@ -517,6 +664,23 @@ if __name__ == "__main__":
     GEN_IPS_INDEX = dcu.get_manifest_value(MANIFEST_SERVER_OBJ,
                                            GENERATE_IPS_INDEX).lower()
 
+    # Remove the golden image's packages that this build doesn't list.
+    # Any package left behind would make the image differ from the one
+    # a full build produces, so the build fails if one can't be removed.
+    DROP_PKGS = [pkg for pkg in GOLDEN_PKGS if pkg not in PKGS]
+    if DROP_PKGS:
+        print("Removing %d packages not in this build from the golden " \
+              "image" % len(DROP_PKGS), file=sys.stderr)
+        KEPT_PKGS = ips_uninstall_pkgs(DROP_PKGS, TMP_DIR, PKG_IMG_MNT_PT,
+                                       GEN_IPS_INDEX)
+        if KEPT_PKGS:
+            print("Unable to uninstall the golden image's packages " \
+                  "not in this build: " + " ".join(KEPT_PKGS),
+                  file=sys.stderr)
+            os.unlink(PKG_FILE_NAME)
+            raise Exception(sys.argv[0] + ": Unable to uninstall " +
+                            "the golden image's packages not in this " +
+                            "build; build without golden_image instead")
 
     # And finally install the designated packages.
     print("Installing the designated packages", file=sys.stderr)
@@ -530,7 +694,8 @@ if __name__ == "__main__":
         raise Exception(sys.argv[0] + ": Unable to retrieve all " +
                                    "of the specified packages")
 
-    os.unlink(PKG_FILE_NAME)
+    # Keep the list for builds that use this one as their golden image.
+    os.rename(PKG_FILE_NAME, INSTALLED_PKG_FILE)
 
     #
     # Check to see whether there are any packages that are specified
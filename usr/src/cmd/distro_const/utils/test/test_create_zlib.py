@@ -0,0 +1,136 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/share/distro_const
+3) python test_create_zlib.py
+
+'''
+
+import lzma
+import os
+import shutil
+import struct
+import subprocess
+import tempfile
+import unittest
+import zlib
+
+import create_zlib
+from create_zlib import compress_segment, LOFI_ALGS, LOFI_COMPRESSED, \
+    LOFI_UNCOMPRESSED, LOFI_DEF_SEGSIZE
+
+
+def make_segment(size=LOFI_DEF_SEGSIZE):
+    ''' compressible, but not trivially so '''
+    line = b"".join(struct.pack("<I", i * 2654435761 % (1 << 32))
+                    for i in range(64))
+    return (line * (size // len(line) + 1))[:size]
+
+
+class CompressSegmentTest(unittest.TestCase):
+
+    def test_lzma_header(self):
+        ''' lzma segments start with the 13 byte .lzma header '''
+        data = make_segment()
+        seg = compress_segment(LOFI_ALGS["lzma"], data)
+        self.assertEqual(seg[0], LOFI_COMPRESSED)
+        (props, dict_size, usize) = struct.unpack_from("<BIQ", seg, 1)
+        self.assertEqual(props, (2 * 5 + 0) * 9 + 3)
+        self.assertEqual(dict_size, len(data))
+        self.assertEqual(usize, len(data))
+
+    def test_lzma_round_trip(self):
+        ''' a standalone .lzma decoder gets the segment back '''
+        for size in (LOFI_DEF_SEGSIZE, 4096, 1000):
+            data = make_segment(size)
+            seg = compress_segment(LOFI_ALGS["lzma"], data)
+            self.assertEqual(seg[0], LOFI_COMPRESSED)
+            self.assertEqual(lzma.decompress(seg[1:],
+                                             format=lzma.FORMAT_ALONE),
+                             data)
+
+    def test_gzip_round_trip(self):
+        ''' gzip segments are zlib streams '''
+        data = make_segment()
+        for alg in ("gzip", "gzip-9"):
+            seg = compress_segment(LOFI_ALGS[alg], data)
+            self.assertEqual(seg[0], LOFI_COMPRESSED)
+            self.assertEqual(zlib.decompress(seg[1:]), data)
+
+    def test_uncompressible(self):
+        ''' segments which don't shrink are stored as they are '''
+        data = bytes(range(7))
+        for alg in ("gzip", "lzma"):
+            seg = compress_segment(LOFI_ALGS[alg], data)
+            self.assertEqual(seg, bytes([LOFI_UNCOMPRESSED]) + data)
+
+
+class FailureTest(unittest.TestCase):
+    ''' create_zlib() failing while mkisofs is still running '''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.output = os.path.join(self.tmpdir, "solaris.zlib")
+        self.procs = []
+        self.saved = (create_zlib.mkisofs_cmd, create_zlib.image_size,
+                      create_zlib.compress_segment, create_zlib.Popen)
+
+        def popen(*args, **kwargs):
+            proc = subprocess.Popen(*args, **kwargs)
+            self.procs.append(proc)
+            return proc
+
+        def compress(alg, data):
+            raise KeyboardInterrupt
+
+        # An endless mkisofs, and the compression interrupted
+        create_zlib.mkisofs_cmd = lambda srcdir, label, sort_file: ["yes"]
+        create_zlib.image_size = lambda cmd: 1 << 40
+        create_zlib.compress_segment = compress
+        create_zlib.Popen = popen
+
+    def tearDown(self):
+        (create_zlib.mkisofs_cmd, create_zlib.image_size,
+         create_zlib.compress_segment, create_zlib.Popen) = self.saved
+        for proc in self.procs:
+            if proc.poll() is None:
+                proc.kill()
+                proc.wait()
+        shutil.rmtree(self.tmpdir)
+
+    def test_mkisofs_reaped(self):
+        ''' mkisofs is killed and waited for, and the output removed '''
+        self.assertRaises(KeyboardInterrupt, create_zlib.create_zlib,
+                          self.tmpdir, self.output, "gzip", jobs=1)
+        self.assertEqual(len(self.procs), 1)
+        self.assertNotEqual(self.procs[0].returncode, None)
+        self.assertFalse(os.path.exists(self.output))
+
+
+if __name__ == '__main__':
+    unittest.main()
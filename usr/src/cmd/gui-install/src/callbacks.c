@@ -88,6 +88,46 @@ target_discovery_callback(om_callback_info_t *cb_data,
 	}
 }
 
+/*
+ * Called from the main loop when target discovery events are pending.
+ * Each event tells that the discovery phases before its own are over.
+ */
+gboolean
+discovery_events_ready(GIOChannel *source,
+					GIOCondition condition,
+					gpointer user_data)
+{
+	om_discovery_event_t events[DISCOVERY_EVENT_BATCH];
+	gboolean done = FALSE;
+	gint i, n;
+
+	n = om_get_discovery_events(events, G_N_ELEMENTS(events));
+	for (i = 0; i < n; i++) {
+		switch (events[i].type) {
+			case OM_DISCOVERY_DONE_EVENT:
+				MainWindow.MileStoneComplete[OM_UPGRADE_TARGET_DISCOVERY] =
+					TRUE;
+				done = TRUE;
+				/* FALLTHROUGH */
+			case OM_INSTANCE_FOUND_EVENT:
+				MainWindow.MileStoneComplete[OM_SLICE_DISCOVERY] = TRUE;
+				/* FALLTHROUGH */
+			case OM_SLICES_READY_EVENT:
+				MainWindow.MileStoneComplete[OM_PARTITION_DISCOVERY] = TRUE;
+				/* FALLTHROUGH */
+			case OM_PARTITIONS_READY_EVENT:
+				MainWindow.MileStoneComplete[OM_DISK_DISCOVERY] = TRUE;
+				break;
+			default:
+				break;
+		}
+		om_free_discovery_event(&events[i]);
+	}
+
+	/* Stop watching once discovery is over */
+	return (n >= 0 && !done);
+}
+
 gboolean
 gui_install_prompt_dialog(gboolean ok_cancel,
 					gboolean set_ok_default,
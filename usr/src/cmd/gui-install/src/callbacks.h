@@ -37,9 +37,16 @@ extern "C" {
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <orchestrator_api.h>
+
+#define	DISCOVERY_EVENT_BATCH	32
+
 void 		target_discovery_callback(om_callback_info_t *cb_data,
 				uintptr_t app_data);
 
+gboolean	discovery_events_ready(GIOChannel *source,
+				GIOCondition condition,
+				gpointer user_data);
+
 void		on_nextbutton_clicked(GtkButton *button,
 				gpointer user_data);
 
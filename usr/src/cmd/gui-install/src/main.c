@@ -549,6 +549,8 @@ main(int argc, char *argv[])
 	};
 	GOptionContext *option_context;
 	GError *error;
+	GIOChannel *discoverychannel;
+	gint discoveryfd;
 
 	option_context = g_option_context_new("installer-app");
 #ifdef ENABLE_NLS
@@ -603,7 +605,20 @@ main(int argc, char *argv[])
 	 */
 	initialize_milestone_completion();
 
-	omhandle = om_initiate_target_discovery(target_discovery_callback);
+	/*
+	 * Discovery progress is read from the main loop when events can
+	 * be had, otherwise it comes through the callback.
+	 */
+	if (om_enable_discovery_events(&discoveryfd) == OM_SUCCESS) {
+		omhandle = om_initiate_target_discovery(NULL);
+		if (omhandle != OM_FAILURE) {
+			discoverychannel = g_io_channel_unix_new(discoveryfd);
+			g_io_add_watch(discoverychannel, G_IO_IN,
+				discovery_events_ready, NULL);
+		}
+	} else
+		omhandle = om_initiate_target_discovery(
+			target_discovery_callback);
 
 	if (omhandle == OM_FAILURE) {
 		/* QUIT FATAL ERROR Target Discovery could not be started */
@@ -34,11 +34,15 @@ ManifestRead.py - Remote (AF-UNIX socket-based) XML data access
 # =============================================================================
 
 import errno
+import re
 import sys
 import getopt
 
 from osol_install.ManifestRead import ManifestRead
 
+# Names export_values() may assign to.
+SHELL_NAME = re.compile("^[A-Za-z_][A-Za-z0-9_]*$")
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def print_values(manifest_reader_obj, request_list, are_keys=False,
                  force_req_print=False):
@@ -68,17 +72,21 @@ def print_values(manifest_reader_obj, request_list, are_keys=False,
     Returns: None.  Output is printed to the screen.
 
     Raises:
-        Exceptions from get_value()
+        Exceptions from get_values_many()
 
     """
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     print_nodepath = ((len(request_list) > 1) or (force_req_print))
-    for request in request_list:
-        try:
-            result_list = manifest_reader_obj.get_values(request, are_keys)
-        except Exception as err:
-            print("Error getting values: " + str(err), file=sys.stderr)
-            raise
+
+    # All requests go to the server together.
+    try:
+        result_lists = manifest_reader_obj.get_values_many(request_list,
+                                                           are_keys)
+    except Exception as err:
+        print("Error getting values: " + str(err), file=sys.stderr)
+        raise
+
+    for (request, result_list) in zip(request_list, result_lists):
         if (print_nodepath):
             nodepath = request + " "
         else:
@@ -87,6 +95,94 @@ def print_values(manifest_reader_obj, request_list, are_keys=False,
             print("%s%s" % (nodepath, result))
 
 
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def parse_assignments(assignment_list, are_keys=False):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Split NAME=request assignments into names and requests.
+
+    An assignment may say what kind of request it has: NAME:k=<key> is a
+    key and NAME:n=<nodepath> is a nodepath, whatever are_keys says.
+    That lets a script read keys and nodepaths with one command.
+
+    Args:
+      assignment_list: List of NAME=request, NAME:k=request or
+        NAME:n=request strings.  NAME must be a valid shell variable
+        name.
+
+      are_keys: boolean: whether a plain NAME=request is a key.
+
+    Returns:
+      A (names, requests, keys) tuple of lists, in the order of the
+        assignments.  keys holds True for each request which is a key.
+
+    Raises:
+        ValueError: an assignment is malformed.
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    names = []
+    requests = []
+    keys = []
+    for assignment in assignment_list:
+        (name, sep, request) = assignment.partition("=")
+        (name, colon, kind) = name.partition(":")
+        if ((not sep) or (not SHELL_NAME.match(name)) or (not request) or
+            (colon and kind not in ("k", "n"))):
+            raise ValueError("Bad assignment: " + assignment)
+        names.append(name)
+        requests.append(request)
+        if (colon):
+            keys.append(kind == "k")
+        else:
+            keys.append(are_keys)
+    return (names, requests, keys)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def export_values(manifest_reader_obj, names, requests, are_keys=False):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Given lists of names and requests, print the found values as shell
+    variable assignments.
+
+    All requests are retrieved together, so that a shell script can get
+    all of its manifest data with one command:
+        eval "$(ManifestRead -e $MFEST_SOCKET NAME=nodepath NAME:k=key ...)"
+
+    Each assignment prints NAME='values', with the values separated by
+    newlines; that is what NAME=$(ManifestRead <socket> <request>) would
+    set.  NAME is set to the empty string if nothing is found.
+
+    Args:
+      manifest_reader_obj: Manifest Reader which connects to the server to
+        get the data.
+
+      names: List of shell variable names, as from parse_assignments().
+
+      requests: List of requests, one for each name.
+
+      are_keys: boolean: if True, the requests are interpreted as keys.
+        See print_values().  May also be a list with one boolean for each
+        request, as from parse_assignments().
+
+    Returns: None.  Output is printed to the screen.
+
+    Raises:
+        Exceptions from get_values_many()
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    try:
+        result_lists = manifest_reader_obj.get_values_many(requests,
+                                                           are_keys)
+    except Exception as err:
+        print("Error getting values: " + str(err), file=sys.stderr)
+        raise
+
+    for (name, result_list) in zip(names, result_lists):
+        value = "\n".join(result_list).replace("'", "'\\''")
+        print("%s='%s'" % (name, value))
+
+
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 def usage(msg_fd):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -105,9 +201,15 @@ def usage(msg_fd):
                       "[ ...<nodepath> ]") % (sys.argv[0]), file=msg_fd)
     print(("  %s [-d] [-r] [-k] <socket name> <key> [ ...<key> ]" %
                       (sys.argv[0])), file=msg_fd)
+    print(("  %s [-d] [-k] -e <socket name> NAME[:k|:n]=<request> " +
+                      "[ ...NAME[:k|:n]=<request> ]") % (sys.argv[0]),
+                      file=msg_fd)
     print("  %s [-h|-?]" % (sys.argv[0]), file=msg_fd)
     print("where:", file=msg_fd)
     print("  -d: turn on debug output", file=msg_fd)
+    print("  -e: print NAME='value' shell assignments, to eval", file=msg_fd)
+    print("      (NAME:k=<key> and NAME:n=<nodepath> override -k)",
+          file=msg_fd)
     print("  -h or -?: print this message", file=msg_fd)
     print("  -k: specify keys instead of nodepaths", file=msg_fd)
     print("  -r: Always print nodepath next to a value", file=msg_fd)
@@ -132,11 +234,11 @@ def main():
     # Initialize.
     err = None
     ret = 0
-    debug = are_keys = force_req_print = False
+    debug = are_keys = force_req_print = export = False
 
     # Parse commandline into options and args.
     try:
-        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "dhkr?")
+        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "dehkr?")
     except getopt.GetoptError as err:
         print("ManifestRead: " + str(err), file=sys.stderr)
     except IndexError as err:
@@ -150,6 +252,8 @@ def main():
         del optarg
         if (opt == "-d"):
             debug = True
+        elif (opt == "-e"):
+            export = True
         elif ((opt == "-h") or (opt == "-?")):
             usage(sys.stdout)
             sys.exit (0)
@@ -163,17 +267,29 @@ def main():
         usage(sys.stderr)
         sys.exit (errno.EINVAL)
 
+    # Check the assignments before going to the server.
+    if (export):
+        try:
+            (names, requests, keys) = parse_assignments(other_args[1:],
+                                                        are_keys)
+        except ValueError as val_err:
+            print("ManifestRead: " + str(val_err), file=sys.stderr)
+            usage(sys.stderr)
+            sys.exit (errno.EINVAL)
+
     # Do the work.
     try:
         mrobj = ManifestRead(other_args[0])
         mrobj.set_debug(debug)
-        print_values(mrobj, other_args[1:], are_keys, force_req_print)
+        if (export):
+            export_values(mrobj, names, requests, keys)
+        else:
+            print_values(mrobj, other_args[1:], are_keys, force_req_print)
     except (SystemExit, KeyboardInterrupt):
         pass
     except Exception as err:
         print("Error running Manifest Reader", file=sys.stderr)
-    if (err):
-        ret = err.args[0]
+        ret = getattr(err, "errno", None) or 1
     sys.exit(ret)
 
 
@@ -120,7 +120,8 @@ def usage(msg_fd):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     print(("Usage: %s [-d] [-h|-?] [-s] [-t] [-v] " +
                       "[-f <validation_file_base> ]") % sys.argv[0], file=msg_fd)
-    print(("    [-o <out_manifest.xml file> ] <manifest.xml file>"), file=msg_fd)
+    print(("    [-o <out_manifest.xml file> ] [-x <snapshot file> ] " +
+                      "<manifest.xml file>"), file=msg_fd)
     print("where:", file=msg_fd)
     print(("  -d: turn on socket debug output (valid when " +
                       "-s also specified)"), file=msg_fd)
@@ -137,6 +138,10 @@ def usage(msg_fd):
                       "<manifest_basename>_temp_<pid>"), file=msg_fd)
     print("  -v: verbose defaults/validation output", file=msg_fd)
     print(("  -s: start socket server for use by ManifestRead"), file=msg_fd)
+    print(("  -x <snapshot file>: export manifest values, after " +
+                      "defaults and validation"), file=msg_fd)
+    print(("      processing, to a file which ManifestRead " +
+                      "can read instead of a socket"), file=msg_fd)
     print(("  --dtd: use DTD validation (default is RelaxNG)"), file=msg_fd)
 
 
@@ -181,7 +186,7 @@ def main():
     # Options come first in the commandline.
     # See usage method for option explanations.
     try:
-        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "df:ho:stv?", "dtd")
+        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "df:ho:stvx:?", "dtd")
     except getopt.GetoptError as err:
         print("ManifestServ: " + str(err), file=sys.stderr)
     except IndexError as err:
@@ -192,6 +197,7 @@ def main():
 
     valfile_root = None
     out_manifest = None
+    snapshot = None
     for (opt, optarg) in opt_pairs:
         if (opt == "-d"):
             d_flag = True
@@ -208,6 +214,8 @@ def main():
             t_flag = True
         elif (opt == "-v"):
             v_flag = True
+        elif (opt == "-x"):
+            snapshot = optarg
         elif (opt == "--dtd"):
             dtd_flag = True
 
@@ -223,6 +231,9 @@ def main():
                                  out_manifest, v_flag, t_flag,
                                  dtd_schema=dtd_flag, socket_debug=d_flag)
 
+        if (snapshot is not None):
+            mfest_obj.export_snapshot(snapshot)
+
         # Start the socket server if requested.
         if (s_flag):
             mfest_obj.start_socket_server()
@@ -0,0 +1,200 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+install_monitor.py - Print the progress of an installation
+
+"""
+# =============================================================================
+# =============================================================================
+
+import errno
+import getopt
+import json
+import sys
+import time
+
+from osol_install.progress_ring import ProgressReader, ProgressRingError, \
+    PROGRESS_FILE, STATUS, LOG, POSTINSTALL_TASKS, FAILED
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def usage(msg_fd):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Display commandline options and arguments.
+
+	Args: msg_fd: file descriptor to write message to.
+
+	Returns: None
+
+	Raises: None
+	"""
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    print("Usage:", file=msg_fd)
+    print("  %s [-f] [-j] [-s] [-i <seconds>] [<ring>]" % (sys.argv[0]),
+          file=msg_fd)
+    print("  %s [-h|-?]" % (sys.argv[0]), file=msg_fd)
+    print("where:", file=msg_fd)
+    print("  -f: follow the installation until it completes or fails,",
+          file=msg_fd)
+    print("      waiting for it to start if needed", file=msg_fd)
+    print("  -j: print one JSON object per record instead of text",
+          file=msg_fd)
+    print("  -s: print only progress, not the lines of the install log",
+          file=msg_fd)
+    print("  -i: with -f, seconds between reads of the ring (default 0.5)",
+          file=msg_fd)
+    print("  <ring> defaults to %s" % PROGRESS_FILE, file=msg_fd)
+    print("  -h or -?: print this message", file=msg_fd)
+    print("", file=msg_fd)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def attach(ring, follow, interval):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Map the ring, waiting for an installation to create it if following.
+
+    Args:
+      ring: name of the ring
+
+      follow: wait for the ring instead of failing
+
+      interval: seconds between attempts
+
+    Returns:
+      ProgressReader
+
+    Raises:
+      IOError, OSError, ProgressRingError: The ring can't be read
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    while True:
+        try:
+            return ProgressReader(ring)
+        except (IOError, OSError, ProgressRingError):
+            if (not follow):
+                raise
+        time.sleep(interval)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def main():
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Main
+
+    Args: None.  (Use sys.argv[] to get args)
+
+    Returns: N/A
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    as_json = False
+    follow = False
+    status_only = False
+    interval = 0.5
+
+    try:
+        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "fhi:js?")
+    except getopt.GetoptError as err:
+        print("install_monitor: " + str(err), file=sys.stderr)
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        for (opt, optarg) in opt_pairs:
+            if (opt == "-f"):
+                follow = True
+            elif ((opt == "-h") or (opt == "-?")):
+                usage(sys.stdout)
+                sys.exit(0)
+            elif (opt == "-i"):
+                interval = float(optarg)
+            elif (opt == "-j"):
+                as_json = True
+            elif (opt == "-s"):
+                status_only = True
+    except ValueError:
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    if (len(other_args) > 1):
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+    ring = other_args[0] if other_args else PROGRESS_FILE
+
+    try:
+        reader = attach(ring, follow, interval)
+    except (IOError, OSError) as err:
+        print("install_monitor: " + str(err), file=sys.stderr)
+        sys.exit(err.errno or 1)
+    except ProgressRingError as err:
+        print("install_monitor: " + str(err), file=sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        while True:
+            (records, lost) = reader.read()
+            if (lost and not as_json):
+                print("(%d records lost)" % lost)
+            done = False
+            for rec in records:
+                if (status_only and (rec.rec_type == LOG)):
+                    continue
+                if (as_json):
+                    print(json.dumps(rec.to_dict()))
+                else:
+                    print(rec.line())
+                if ((rec.rec_type == STATUS) and
+                    ((rec.phase == FAILED) or
+                     ((rec.phase == POSTINSTALL_TASKS) and
+                      (rec.percent == 100)))):
+                    done = True
+            sys.stdout.flush()
+
+            if ((not follow) or done):
+                break
+            if (not records and reader.replaced()):
+                # a new installation started
+                reader.close()
+                reader = attach(ring, follow, interval)
+                continue
+            time.sleep(interval)
+    except KeyboardInterrupt:
+        pass
+
+    reader.close()
+    sys.exit(0)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+# Main
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+if __name__ == "__main__":
+    main()
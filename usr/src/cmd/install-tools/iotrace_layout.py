@@ -0,0 +1,211 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+iotrace_layout.py - Generate an ISO sort list and readahead manifest from
+                    boot I/O traces
+
+"""
+# =============================================================================
+# =============================================================================
+
+import errno
+import sys
+import getopt
+
+from osol_install.iotrace import LayoutOptimizer, read_trace, \
+    read_sort_list, DEFAULT_EXCLUDE, DEFAULT_PREFIX, DEFAULT_WINDOW, \
+    DEFAULT_BASE_WEIGHT, DEFAULT_CATCHALL
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def usage(msg_fd):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Display commandline options and arguments.
+
+	Args: msg_fd: file descriptor to write message to.
+
+	Returns: None
+
+	Raises: None
+	"""
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    print("Usage:", file=msg_fd)
+    print(("  %s [-o <sort file>] [-r <report file>] [-b <baseline sort>]\n" +
+           "      [-a <readahead manifest>] [-s <image sort list>]\n" +
+           "      [-m <phase>=<marker path>]...\n" +
+           "      [-p <preamble>] [-R <image root>] [-P <prefix>] " +
+           "[-x <exclude regex>]\n" +
+           "      [-w <window>] [-W <base weight>] " +
+           "<iosnoop output> [ ...<iosnoop output> ]") % (sys.argv[0]),
+          file=msg_fd)
+    print("  %s [-h|-?]" % (sys.argv[0]), file=msg_fd)
+    print("where:", file=msg_fd)
+    print("  -o: write the sort list here; without -o it goes to stdout,",
+          file=msg_fd)
+    print("      unless -a or -r is given", file=msg_fd)
+    print("  -r: write a seek reduction report here", file=msg_fd)
+    print("  -b: sort list to compare against in the report", file=msg_fd)
+    print("      (default is unsorted)", file=msg_fd)
+    print("  -a: write a readahead manifest here", file=msg_fd)
+    print("  -s: sort list the image is built with, which the readahead",
+          file=msg_fd)
+    print("      manifest follows (\"\" for an unsorted image); without -s",
+          file=msg_fd)
+    print("      the image is taken to be built with the -o sort list",
+          file=msg_fd)
+    print("  -m: start readahead phase <phase> at the first read of",
+          file=msg_fd)
+    print("      <marker path>; may be repeated, in boot order", file=msg_fd)
+    print("  -p: file copied to the top of the sort list", file=msg_fd)
+    print("  -R: image root used to skip directories and size files",
+          file=msg_fd)
+    print("  -P: path prefix of files to consider (default %s)" %
+          DEFAULT_PREFIX, file=msg_fd)
+    print("  -x: regular expression of trace lines to ignore", file=msg_fd)
+    print("      (\"\" to ignore nothing)", file=msg_fd)
+    print("  -w: files first read this close together are grouped " +
+          "(default %d)" % DEFAULT_WINDOW, file=msg_fd)
+    print("  -W: weight of the first sort list entry (default %d)" %
+          DEFAULT_BASE_WEIGHT, file=msg_fd)
+    print("  -h or -?: print this message", file=msg_fd)
+    print("", file=msg_fd)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def main():
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Main
+
+    Args: None.  (Use sys.argv[] to get args)
+
+    Returns: N/A
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    sort_out = report_out = baseline = preamble = root = None
+    readahead_out = image_sort = None
+    markers = []
+    prefix = DEFAULT_PREFIX
+    exclude = DEFAULT_EXCLUDE
+    window = DEFAULT_WINDOW
+    base_weight = DEFAULT_BASE_WEIGHT
+
+    try:
+        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:],
+                                                "a:b:hm:o:p:P:r:R:s:w:W:x:?")
+    except getopt.GetoptError as err:
+        print("iotrace_layout: " + str(err), file=sys.stderr)
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        for (opt, optarg) in opt_pairs:
+            if (opt == "-a"):
+                readahead_out = optarg
+            elif (opt == "-b"):
+                baseline = optarg
+            elif ((opt == "-h") or (opt == "-?")):
+                usage(sys.stdout)
+                sys.exit(0)
+            elif (opt == "-m"):
+                (phase, marker) = optarg.split("=", 1)
+                markers.append((phase, marker))
+            elif (opt == "-o"):
+                sort_out = optarg
+            elif (opt == "-p"):
+                preamble = optarg
+            elif (opt == "-P"):
+                prefix = optarg
+            elif (opt == "-r"):
+                report_out = optarg
+            elif (opt == "-R"):
+                root = optarg
+            elif (opt == "-s"):
+                image_sort = optarg
+            elif (opt == "-w"):
+                window = int(optarg)
+            elif (opt == "-W"):
+                base_weight = int(optarg)
+            elif (opt == "-x"):
+                exclude = optarg
+    except ValueError:
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    if (not other_args):
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        optimizer = LayoutOptimizer(window)
+        for tracefile in other_args:
+            optimizer.add_trace(read_trace(tracefile, prefix, exclude, root))
+
+        preamble_lines = None
+        if (preamble is not None):
+            with open(preamble, "r") as pfile:
+                preamble_lines = pfile.readlines()
+
+        lines = optimizer.sort_list(base_weight, DEFAULT_CATCHALL,
+                                    preamble_lines)
+        if (sort_out is not None):
+            with open(sort_out, "w") as sfile:
+                sfile.writelines(lines)
+        elif ((readahead_out is None) and (report_out is None)):
+            sys.stdout.writelines(lines)
+
+        if (readahead_out is not None):
+            order = None
+            if (image_sort == ""):
+                order = optimizer.media_order()
+            elif (image_sort is not None):
+                order = optimizer.media_order(read_sort_list(image_sort))
+            with open(readahead_out, "w") as afile:
+                afile.writelines(optimizer.readahead_manifest(markers, root,
+                                                              order=order))
+
+        if (report_out is not None):
+            base_order = None
+            if (baseline is not None):
+                base_order = read_sort_list(baseline)
+            with open(report_out, "w") as rfile:
+                rfile.write(optimizer.seek_report(base_order, root))
+    except (IOError, OSError) as err:
+        print("iotrace_layout: " + str(err), file=sys.stderr)
+        sys.exit(err.errno or 1)
+
+    sys.exit(0)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+# Main
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,194 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+ls_decode.py - Print the messages of liblogsvc binary journals
+
+"""
+# =============================================================================
+# =============================================================================
+
+import errno
+import getopt
+import json
+import sys
+
+from osol_install.lsjournal import read_journal, filter_messages, \
+    parse_time, JournalError
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def usage(msg_fd):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Display commandline options and arguments.
+
+	Args: msg_fd: file descriptor to write message to.
+
+	Returns: None
+
+	Raises: None
+	"""
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    print("Usage:", file=msg_fd)
+    print(("  %s [-j] [-m <module>]... [-l <level>] [-s <time>] " +
+           "[-e <time>]\n" +
+           "      <journal> [ ...<journal> ]") % (sys.argv[0]), file=msg_fd)
+    print("  %s [-h|-?]" % (sys.argv[0]), file=msg_fd)
+    print("where:", file=msg_fd)
+    print("  -j: print one JSON object per message instead of text",
+          file=msg_fd)
+    print("  -m: print only messages of this module id; may be repeated",
+          file=msg_fd)
+    print("  -l: print only log messages and debug messages of this",
+          file=msg_fd)
+    print("      level or lower (1 emergency .. 4 info)", file=msg_fd)
+    print("  -s: print only messages journaled at or after <time>",
+          file=msg_fd)
+    print("  -e: print only messages journaled before <time>", file=msg_fd)
+    print("  <time> is YYYY-MM-DDTHH:MM:SS (UTC), seconds since the",
+          file=msg_fd)
+    print("  epoch, or +<seconds> after the first message", file=msg_fd)
+    print("  -h or -?: print this message", file=msg_fd)
+    print("", file=msg_fd)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def resolve_time(time_str, messages):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Convert a -s or -e time to seconds since the epoch.
+
+    Args:
+      time_str: option argument, or None
+
+      messages: list of all messages, for times relative to the first
+
+    Returns:
+      seconds since the epoch, or None if time_str is None
+
+    Raises:
+      ValueError: time_str isn't a time
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    if (time_str is None):
+        return None
+    if (not time_str.startswith("+")):
+        return parse_time(time_str)
+    offset = float(time_str[1:])
+    times = [msg.time for msg in messages if (msg.time is not None)]
+    if (not times):
+        return offset
+    return min(times) + offset
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def main():
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Main
+
+    Args: None.  (Use sys.argv[] to get args)
+
+    Returns: N/A
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    as_json = False
+    modules = None
+    max_level = None
+    start = end = None
+
+    try:
+        (opt_pairs, other_args) = getopt.getopt(sys.argv[1:], "e:hjl:m:s:?")
+    except getopt.GetoptError as err:
+        print("ls_decode: " + str(err), file=sys.stderr)
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        for (opt, optarg) in opt_pairs:
+            if (opt == "-e"):
+                end = optarg
+            elif ((opt == "-h") or (opt == "-?")):
+                usage(sys.stdout)
+                sys.exit(0)
+            elif (opt == "-j"):
+                as_json = True
+            elif (opt == "-l"):
+                max_level = int(optarg)
+            elif (opt == "-m"):
+                if (modules is None):
+                    modules = []
+                modules.append(optarg)
+            elif (opt == "-s"):
+                start = optarg
+    except ValueError:
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    if (not other_args):
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    messages = []
+    try:
+        for journal in other_args:
+            messages.extend(read_journal(journal))
+    except (IOError, OSError) as err:
+        print("ls_decode: " + str(err), file=sys.stderr)
+        sys.exit(err.errno or 1)
+    except JournalError as err:
+        print("ls_decode: " + str(err), file=sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    try:
+        start = resolve_time(start, messages)
+        end = resolve_time(end, messages)
+    except ValueError:
+        usage(sys.stderr)
+        sys.exit(errno.EINVAL)
+
+    # Merge the processes (and journals) by time.  The sort is stable, so
+    # messages of one process keep their order, and those of processes
+    # whose start was lost come first.
+    messages.sort(key=lambda msg: (msg.time is not None, msg.time or 0))
+
+    for msg in filter_messages(messages, modules, max_level, start, end):
+        if (as_json):
+            print(json.dumps(msg.to_dict()))
+        else:
+            sys.stdout.write(msg.log_line())
+
+    sys.exit(0)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+# Main
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_manifest_read.py
+
+'''
+
+import errno
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import unittest
+
+import osol_install.SocketServProtocol as SocketServProtocol
+from osol_install.ManifestSnapshot import write_snapshot, SNAPSHOT_SUFFIX
+
+MANIFEST_READ = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             os.pardir, "ManifestRead.py")
+
+
+class ExportTestCase(unittest.TestCase):
+    ''' ManifestRead -e '''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.snap_name = os.path.join(self.tmpdir, "mfest" + SNAPSHOT_SUFFIX)
+        write_snapshot(self.snap_name, "root",
+                       {"pkgs/p": ["x", "y"], "pkgs/q": ["it's"],
+                        "pkgs/e": [""]}, {"a": ["1"]})
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def run_read(self, *args):
+        ''' run the command, returning its status, stdout and stderr '''
+        proc = subprocess.Popen([sys.executable, MANIFEST_READ] +
+                                list(args), stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE)
+        (out, err) = proc.communicate()
+        return (proc.returncode, out.decode(), err.decode())
+
+    def test_export(self):
+        ''' the assignments set what command substitution would '''
+        (ret, out, err) = self.run_read("-e", self.snap_name, "P=pkgs/p",
+                                        "Q=pkgs/q", "E=pkgs/e",
+                                        "N=nothing")
+        self.assertEqual(ret, 0)
+        self.assertEqual(out, "P='x\ny'\nQ='it'\\''s'\nE=''\nN=''\n")
+        script = out + 'printf "%s|%s|%s|%s" "$P" "$Q" "$E" "$N"'
+        self.assertEqual(subprocess.check_output(["/bin/sh", "-c", script]),
+                         b"x\ny|it's||")
+
+    def test_export_keys(self):
+        ''' with -k, the requests are keys '''
+        (ret, out, err) = self.run_read("-k", "-e", self.snap_name, "A=a")
+        self.assertEqual(ret, 0)
+        self.assertEqual(out, "A='1'\n")
+
+    def test_export_mixed(self):
+        ''' :k and :n choose the kind of each request, overriding -k '''
+        (ret, out, err) = self.run_read("-e", self.snap_name, "P=pkgs/p",
+                                        "A:k=a", "Q:n=pkgs/q")
+        self.assertEqual(ret, 0)
+        self.assertEqual(out, "P='x\ny'\nA='1'\nQ='it'\\''s'\n")
+
+        (ret, out, err) = self.run_read("-k", "-e", self.snap_name, "A=a",
+                                        "P:n=pkgs/p", "B:k=a")
+        self.assertEqual(ret, 0)
+        self.assertEqual(out, "A='1'\nP='x\ny'\nB='1'\n")
+
+    def test_bad_assignment(self):
+        ''' a malformed assignment is refused before reading anything '''
+        for bad in ("P", "=pkgs/p", "1P=pkgs/p", "P=", "P:x=pkgs/p",
+                    "P:=pkgs/p", ":k=a"):
+            (ret, out, err) = self.run_read("-e", self.snap_name,
+                                            "Q=pkgs/q", bad)
+            self.assertEqual(ret, errno.EINVAL)
+            self.assertEqual(out, "")
+            self.assertTrue(("Bad assignment: " + bad) in err)
+
+        # The socket isn't opened.
+        (ret, out, err) = self.run_read("-e",
+                                        os.path.join(self.tmpdir, "none"),
+                                        "P")
+        self.assertEqual(ret, errno.EINVAL)
+        self.assertTrue("Bad assignment: P" in err)
+
+    def test_no_server(self):
+        ''' a missing server isn't reported as a bad assignment '''
+        (ret, out, err) = self.run_read("-e",
+                                        os.path.join(self.tmpdir, "none"),
+                                        "P=pkgs/p")
+        self.assertEqual(ret, errno.ENOENT)
+        self.assertEqual(out, "")
+        self.assertTrue("Error running Manifest Reader" in err)
+
+    def test_bad_reply(self):
+        ''' a malformed reply isn't reported as a bad assignment '''
+        sock_name = os.path.join(self.tmpdir, "ManifestServ.1")
+        listen_sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        listen_sock.bind(sock_name)
+        listen_sock.listen(1)
+
+        def serve():
+            (conn, addr) = listen_sock.accept()
+            listen_sock.close()
+            SocketServProtocol.recv_exact(conn,
+                                          SocketServProtocol.PRE_REQ_SIZE)
+            conn.sendall(SocketServProtocol.PROTOCOL_VERSION.encode())
+            SocketServProtocol.recv_exact(conn,
+                                          SocketServProtocol.PRE_REQ_SIZE)
+            conn.sendall(b"x" * SocketServProtocol.BATCH_SIZE_LEN)
+            conn.recv(4096)
+            conn.close()
+        thread = threading.Thread(target=serve)
+        thread.start()
+
+        (ret, out, err) = self.run_read("-e", sock_name, "P=pkgs/p")
+        thread.join()
+        self.assertNotEqual(ret, 0)
+        self.assertNotEqual(ret, errno.EINVAL)
+        self.assertEqual(out, "")
+        self.assertFalse("Bad assignment" in err)
+        self.assertTrue("Error running Manifest Reader" in err)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,209 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Once media-fs-root has mounted the compressed /usr, every service that
+ * starts pulls its binaries and libraries in with small random reads,
+ * and on optical or USB media each of those is a seek.  distro_const
+ * can generate a readahead manifest from boot I/O traces (see
+ * iotrace_layout -a) that lists the extents read during boot, phase by
+ * phase, in the order they are laid out on the media.  This utility
+ * replays that manifest with large sequential reads so that the data
+ * is streamed into the page cache ahead of the services needing it.
+ *
+ * Manifest format:
+ *
+ *	phase <name>
+ *	<path> <offset> <length>
+ *	...
+ *
+ * Blank lines and lines starting with '#' are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+#define	DEFAULT_BUFSIZE	(1024 * 1024)
+
+static char *progname;
+static int verbose = 0;
+
+static void
+usage(void)
+{
+	(void) fprintf(stderr, "Usage: %s [-bv] [-p phase] [-r root] "
+	    "[-s bufsize] manifest\n", progname);
+	exit(2);
+}
+
+/*
+ * Read the extent [off, off + len) of path into the page cache.
+ * Returns the number of bytes read.
+ */
+static off_t
+replay_extent(const char *path, off_t off, off_t len, char *buf,
+    size_t bufsize)
+{
+	int fd;
+	ssize_t rd;
+	off_t done = 0;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		if (verbose)
+			(void) fprintf(stderr, "%s: %s: %s\n", progname, path,
+			    strerror(errno));
+		return (0);
+	}
+
+	while (done < len) {
+		size_t want = bufsize;
+
+		if ((off_t)want > len - done)
+			want = (size_t)(len - done);
+		rd = pread(fd, buf, want, off + done);
+		if (rd <= 0)
+			break;
+		done += rd;
+	}
+
+	(void) close(fd);
+	return (done);
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE *mfp;
+	char line[PATH_MAX + 64];
+	char path[PATH_MAX];
+	char fullpath[PATH_MAX];
+	char *phase = NULL, *root = "", *buf;
+	size_t bufsize = DEFAULT_BUFSIZE;
+	int background = 0, in_phase = 1, c;
+	long long off, len;
+	off_t total = 0;
+	int nfiles = 0;
+	hrtime_t start;
+
+	progname = argv[0];
+
+	while ((c = getopt(argc, argv, "bp:r:s:v")) != EOF) {
+		switch (c) {
+		case 'b':
+			background = 1;
+			break;
+		case 'p':
+			phase = optarg;
+			break;
+		case 'r':
+			root = optarg;
+			break;
+		case 's':
+			bufsize = strtoul(optarg, NULL, 0);
+			if (bufsize == 0)
+				usage();
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1)
+		usage();
+
+	if ((mfp = fopen(argv[optind], "r")) == NULL) {
+		(void) fprintf(stderr, "%s: %s: %s\n", progname, argv[optind],
+		    strerror(errno));
+		return (1);
+	}
+
+	if ((buf = malloc(bufsize)) == NULL) {
+		(void) fprintf(stderr, "%s: out of memory\n", progname);
+		return (1);
+	}
+
+	/*
+	 * Boot shouldn't wait for the whole manifest, only the services
+	 * racing us for the media should.
+	 */
+	if (background) {
+		pid_t pid = fork();
+
+		if (pid == -1) {
+			(void) fprintf(stderr, "%s: fork: %s\n", progname,
+			    strerror(errno));
+			return (1);
+		}
+		if (pid != 0)
+			return (0);
+		(void) setsid();
+	}
+
+	start = gethrtime();
+	while (fgets(line, sizeof (line), mfp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (strncmp(line, "phase ", 6) == 0) {
+			if (phase != NULL) {
+				line[strcspn(line, "\n")] = '\0';
+				in_phase = (strcmp(line + 6, phase) == 0);
+			}
+			continue;
+		}
+
+		if (!in_phase)
+			continue;
+
+		if (sscanf(line, "%1023s %lld %lld", path, &off, &len) != 3 ||
+		    off < 0 || len <= 0)
+			continue;
+
+		(void) snprintf(fullpath, sizeof (fullpath), "%s%s", root,
+		    path);
+		total += replay_extent(fullpath, (off_t)off, (off_t)len, buf,
+		    bufsize);
+		nfiles++;
+	}
+	(void) fclose(mfp);
+	free(buf);
+
+	if (verbose)
+		(void) fprintf(stderr, "%s: %d extents, %lld bytes in %lld ms\n",
+		    progname, nfiles, (long long)total,
+		    (long long)((gethrtime() - start) / 1000000));
+
+	return (0);
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/snadm/lib:${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_ti_install.py
+
+'''
+
+import logging
+import os
+import tempfile
+import threading
+import unittest
+
+import osol_install.text_install.ti_install as ti_install
+from osol_install.text_install.ti_install_utils import InstallationError
+from osol_install.progress_ring import ProgressReader, ProgressWriter, \
+    TARGET_INSTANTIATION, SOFTWARE_UPDATE, FAILED
+
+
+class InstallStatusTest(unittest.TestCase):
+    '''Tests for InstallStatus'''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.ring = os.path.join(self.tmpdir, "progress")
+        self.handlers = logging.getLogger().handlers[:]
+        self.saved_writer = ti_install.ProgressWriter
+        ti_install.ProgressWriter = lambda: ProgressWriter(self.ring)
+
+        self.shown = []
+        self.quit_event = threading.Event()
+        self.status = ti_install.InstallStatus(None, self.show,
+                                               self.quit_event)
+        self.reader = ProgressReader(self.ring)
+
+    def tearDown(self):
+        ti_install.ProgressWriter = self.saved_writer
+        logging.getLogger().handlers = self.handlers
+        self.reader.close()
+        self.status.progress.close()
+        os.unlink(self.ring)
+        os.rmdir(self.tmpdir)
+
+    def show(self, screen, overall_progress, message):
+        self.shown.append((round(overall_progress, 2), message))
+
+    def test_update_step_change(self):
+        '''the overall progress carries over from one step to the next'''
+        self.status.update(ti_install.InstallStatus.TI, 40, "ti 40")
+        self.status.update(ti_install.InstallStatus.TI, 100, "ti 100")
+        self.status.update(ti_install.InstallStatus.TM, 0, "tm 0")
+        self.status.update(ti_install.InstallStatus.TM, 50, "tm 50")
+        self.assertEqual(self.shown, [(2.0, "ti 40"), (5.0, "ti 100"),
+                                      (5.0, "tm 0"), (51.5, "tm 50")])
+
+        records = self.reader.read()[0]
+        self.assertEqual([(r.phase, r.percent) for r in records],
+                         [(TARGET_INSTANTIATION, 40),
+                          (TARGET_INSTANTIATION, 100),
+                          (SOFTWARE_UPDATE, 0), (SOFTWARE_UPDATE, 50)])
+
+    def test_update_quit(self):
+        '''update() raises InstallationError once the user quits'''
+        self.quit_event.set()
+        self.assertRaises(InstallationError, self.status.update,
+                          ti_install.InstallStatus.TM, 10, "tm 10")
+        self.assertEqual(self.shown, [])
+
+    def test_failed(self):
+        '''failed() posts the failure to the progress ring'''
+        self.status.update(ti_install.InstallStatus.TM, 10, "tm 10")
+        self.status.failed("Installation failed")
+        records = self.reader.read()[0]
+        self.assertEqual(records[-1].phase, FAILED)
+        self.assertEqual(records[-1].message, "Installation failed")
+
+    def test_failed_without_ring(self):
+        '''failed() does nothing when the ring couldn't be created'''
+        self.status.progress.close()
+        self.status.progress = None
+        self.status.failed("Installation failed")
+        self.status.progress = ProgressWriter(self.ring)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -40,6 +40,8 @@ from osol_install.transfer_defs import TM_ATTR_MECHANISM, \
     TM_PERFORM_CPIO, TM_CPIO_ACTION, TM_CPIO_ENTIRE, TM_CPIO_SRC_MNTPT, \
     TM_CPIO_DST_MNTPT, TM_SUCCESS
 from osol_install.install_utils import exec_cmd_outputs_to_log
+from osol_install.progress_ring import ProgressWriter, ProgressLogHandler, \
+    TARGET_INSTANTIATION, SOFTWARE_UPDATE, POSTINSTALL_TASKS
 from osol_install.profile.disk_info import PartitionInfo
 from osol_install.profile.network_info import NetworkInfo
 from osol_install.text_install import RELEASE
@@ -117,6 +119,18 @@ class InstallStatus(object):
         self.step_percent_completed = 0
         self.previous_overall_progress = 0
 
+        # Milestones reported to the progress ring, for install_monitor
+        self.phase = {InstallStatus.TI:TARGET_INSTANTIATION,
+                      InstallStatus.TM:SOFTWARE_UPDATE,
+                      InstallStatus.ICT:POSTINSTALL_TASKS}
+        try:
+            self.progress = ProgressWriter()
+            logging.getLogger().addHandler(ProgressLogHandler(self.progress))
+        except (IOError, OSError) as err:
+            logging.warning("Progress of the install won't be published: %s",
+                            err)
+            self.progress = None
+
     def update(self, step_name, percent_completed, message):
         '''Update the install status. Also checks the quit_event to see
         if the installation should be aborted.
@@ -133,8 +147,16 @@ class InstallStatus(object):
         overall_progress = (percent_completed * (self.ratio[step_name])) \
                            + self.step_percent_completed
         self.update_status_func(self.screen, overall_progress, message)
+        if self.progress is not None:
+            self.progress.post_status(self.phase[step_name],
+                                      int(percent_completed), message)
         self.previous_overall_progress = overall_progress
 
+    def failed(self, message):
+        '''Report the failure of the installation to the progress ring'''
+        if self.progress is not None:
+            self.progress.post_failure(1, message)
+
 
 def transfer_mod_callback(percent, message):
     '''Callback for transfer module to indicate percentage complete.'''
@@ -696,3 +718,5 @@ def perform_ti_install(install_profile, screen, update_status_func, quit_event,
         install_profile.install_succeeded = True
     except ti_utils.InstallationError:
         install_profile.install_succeeded = False
+        if INSTALL_STATUS is not None:
+            INSTALL_STATUS.failed("Installation failed")
@@ -0,0 +1,330 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+CompactTree.py - Compact XML document tree for TreeAcc, built with expat
+
+The nodes here implement only the part of the DOM interface which TreeAcc
+uses, with the same names and node types as xml.dom.minidom, so TreeAcc
+works on either.  Elements keep their attributes in a dictionary (or None
+when they have none) and their children in a flat list; element names
+and whitespace-only text are interned, so the many identical strings of
+a manifest are stored once.  There are no per-node owner documents,
+sibling links or attribute nodes.
+
+Elements, text, CDATA sections and comments are kept.  Processing
+instructions are dropped.
+"""
+# =============================================================================
+# =============================================================================
+
+import sys
+from xml.dom import Node
+from xml.parsers import expat
+
+# =============================================================================
+class CompactAttr(object):
+# =============================================================================
+    """ Stand-in for a DOM attribute node, returned by getAttributeNode().
+    Made on request; not stored in the tree.
+    """
+# =============================================================================
+    __slots__ = ("nodeName", "nodeValue")
+    nodeType = Node.ATTRIBUTE_NODE
+
+    def __init__(self, name, value):
+        self.nodeName = name
+        self.nodeValue = value
+
+
+# =============================================================================
+class CompactText(object):
+# =============================================================================
+    """ Text node.  CDATA sections are text nodes of CDATA_SECTION_NODE
+    type.
+    """
+# =============================================================================
+    __slots__ = ("data", "nodeType")
+
+    def __init__(self, data, node_type=Node.TEXT_NODE):
+        self.data = data
+        self.nodeType = node_type
+
+    def __get_value(self):
+        return self.data
+
+    def __set_value(self, value):
+        self.data = value
+
+    nodeValue = property(__get_value, __set_value)
+
+    def writexml(self, writer):
+        """ Write the node as minidom's writexml() does with no indent """
+        if (self.nodeType == Node.CDATA_SECTION_NODE):
+            writer.append("<![CDATA[%s]]>" % self.data)
+        else:
+            writer.append(escape(self.data))
+
+
+# =============================================================================
+class CompactComment(object):
+# =============================================================================
+    """ Comment node. """
+# =============================================================================
+    __slots__ = ("data", )
+    nodeType = Node.COMMENT_NODE
+
+    def __init__(self, data):
+        self.data = data
+
+    def writexml(self, writer):
+        """ Write the node as minidom's writexml() does with no indent """
+        writer.append("<!--%s-->" % self.data)
+
+
+# =============================================================================
+class CompactElement(object):
+# =============================================================================
+    """ Element node. """
+# =============================================================================
+    __slots__ = ("nodeName", "parentNode", "childNodes", "_attrs")
+    nodeType = Node.ELEMENT_NODE
+
+    def __init__(self, name, parent=None, attrs=None):
+        self.nodeName = name
+        self.parentNode = parent
+        self.childNodes = []
+        self._attrs = attrs
+
+    @property
+    def attributes(self):
+        """ Dictionary of attribute names and values.  Like minidom's
+        NamedNodeMap, it supports items().
+        """
+        if (self._attrs is None):
+            return {}
+        return self._attrs
+
+    def getAttributeNode(self, name):
+        """ Return a CompactAttr for the named attribute, or None. """
+        if ((self._attrs is None) or (name not in self._attrs)):
+            return None
+        return CompactAttr(name, self._attrs[name])
+
+    def getAttribute(self, name):
+        """ Return the value of the named attribute, or "". """
+        if (self._attrs is None):
+            return ""
+        return self._attrs.get(name, "")
+
+    def setAttribute(self, name, value):
+        """ Set (or add) the named attribute. """
+        if (self._attrs is None):
+            self._attrs = {}
+        self._attrs[sys.intern(name)] = value
+
+    def appendChild(self, child):
+        """ Make child the last child of this element. """
+        if (isinstance(child, CompactElement)):
+            child.parentNode = self
+        self.childNodes.append(child)
+        return child
+
+    def writexml(self, writer):
+        """ Write the element as minidom's writexml() does with no
+        indent.  writer is a list the output strings are appended to.
+        """
+        writer.append("<" + self.nodeName)
+        if (self._attrs is not None):
+            for (name, value) in self._attrs.items():
+                writer.append(" %s=\"%s\"" % (name, escape(value)))
+        if (not self.childNodes):
+            writer.append("/>")
+            return
+        writer.append(">")
+        for child in self.childNodes:
+            child.writexml(writer)
+        writer.append("</%s>" % self.nodeName)
+
+    def toprettyxml(self, indent="", newl=""):
+        """ Return the element as XML.  Only indent="" and newl="" (which
+        leave the text of the document as it is) are supported.
+        """
+        if (indent or newl):
+            raise NotImplementedError("CompactElement.toprettyxml indent")
+        writer = []
+        self.writexml(writer)
+        return "".join(writer)
+
+
+# =============================================================================
+class CompactDocumentType(object):
+# =============================================================================
+    """ DOCTYPE of a document. """
+# =============================================================================
+    __slots__ = ("name", "systemId", "publicId")
+
+    def __init__(self, name, system_id, public_id):
+        self.name = name
+        self.systemId = system_id
+        self.publicId = public_id
+
+
+# =============================================================================
+class CompactDocument(object):
+# =============================================================================
+    """ Document node.  Parent of the root element. """
+# =============================================================================
+    nodeType = Node.DOCUMENT_NODE
+    parentNode = None
+
+    def __init__(self):
+        self.documentElement = None
+        self.doctype = None
+
+    def createElement(self, name):
+        """ Return a new element, not yet in the tree. """
+        return CompactElement(sys.intern(name))
+
+    def createTextNode(self, data):
+        """ Return a new text node, not yet in the tree. """
+        return CompactText(data)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def escape(data):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Escape text and attribute values the way minidom does. """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    if (data):
+        data = data.replace("&", "&amp;").replace("<", "&lt;"). \
+            replace("\"", "&quot;").replace(">", "&gt;")
+    return data
+
+
+# =============================================================================
+class _Builder(object):
+# =============================================================================
+    """ expat handlers which build a CompactDocument. """
+# =============================================================================
+
+    def __init__(self):
+        self.document = CompactDocument()
+
+        # Element being built.  None outside of the root element, where
+        # only the DOCTYPE is kept.
+        self.current = None
+        self.in_cdata = False
+
+    def start_doctype(self, name, system_id, public_id, has_internal_subset):
+        del has_internal_subset
+        self.document.doctype = CompactDocumentType(name, system_id,
+                                                    public_id)
+
+    def start_element(self, name, attr_list):
+        attrs = None
+        if (attr_list):
+            attrs = {}
+            for i in range(0, len(attr_list), 2):
+                attrs[sys.intern(attr_list[i])] = attr_list[i + 1]
+        if (self.current is None):
+            element = CompactElement(sys.intern(name), self.document, attrs)
+            self.document.documentElement = element
+        else:
+            element = CompactElement(sys.intern(name), self.current, attrs)
+            self.current.childNodes.append(element)
+        self.current = element
+
+    def end_element(self, name):
+        del name
+        parent = self.current.parentNode
+        if (parent is self.document):
+            self.current = None
+        else:
+            self.current = parent
+
+    def character_data(self, data):
+        if (self.current is None):
+            return
+        children = self.current.childNodes
+        if (self.in_cdata):
+            children[-1].data += data
+            return
+
+        # As with minidom, adjacent text is one node.
+        if (children and (children[-1].nodeType == Node.TEXT_NODE)):
+            data = children[-1].data + data
+            children.pop()
+        if (data.isspace()):
+            data = sys.intern(data)
+        children.append(CompactText(data))
+
+    def start_cdata(self):
+        if (self.current is not None):
+            self.current.childNodes.append(
+                CompactText("", Node.CDATA_SECTION_NODE))
+            self.in_cdata = True
+
+    def end_cdata(self):
+        self.in_cdata = False
+
+    def comment(self, data):
+        if (self.current is not None):
+            self.current.childNodes.append(CompactComment(data))
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def parse(xml_file):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Load an XML file into a CompactDocument.
+
+    Args:
+      xml_file: name of the file to load
+
+    Returns:
+      CompactDocument of the file.
+
+    Raises:
+      IOError: Error opening or reading the file
+      ExpatError: Error parsing the file
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    builder = _Builder()
+    parser = expat.ParserCreate()
+    parser.buffer_text = True
+    parser.ordered_attributes = True
+    parser.StartDoctypeDeclHandler = builder.start_doctype
+    parser.StartElementHandler = builder.start_element
+    parser.EndElementHandler = builder.end_element
+    parser.CharacterDataHandler = builder.character_data
+    parser.StartCdataSectionHandler = builder.start_cdata
+    parser.EndCdataSectionHandler = builder.end_cdata
+    parser.CommentHandler = builder.comment
+
+    with open(xml_file, "rb") as xml_fp:
+        parser.ParseFile(xml_fp)
+    return builder.document
@@ -28,6 +28,9 @@ Module to validate defaults and contents info.
 # =============================================================================
 # =============================================================================
 
+import hashlib
+import os
+import stat
 import sys
 import subprocess
 
@@ -37,6 +40,12 @@ from osol_install.TreeAcc import TreeAccError
 from osol_install.install_utils import canaccess
 from osol_install.install_utils import space_parse
 
+# In-process RelaxNG validation.  XML_VALIDATOR is run if not available.
+try:
+    import osol_install.libxmlval as libxmlval
+except ImportError:
+    libxmlval = None
+
 # =============================================================================
 # Constants
 # =============================================================================
@@ -62,12 +71,23 @@ MANIFEST_SCHEMA = "/usr/lib/python3.9/vendor-packages/osol_install/" + \
 # Default XML value if invert isn't specified in the defval-manifest.
 DEFAULT_INVERT_VALUE_STR = "False"
 
+# Directory recording successful RelaxNG validations across runs, so an
+# unchanged document isn't validated again against an unchanged schema.
+# Each record is an empty file named <schema hash>.<document hash>.
+# Set to None to disable.
+SCHEMA_CACHE_DIR = "/var/tmp/install_schema_cache"
+
 # =============================================================================
 # General module initializion code
 # =============================================================================
 
 DEFAULT_INVERT_VALUE = (DEFAULT_INVERT_VALUE_STR == "True")
 
+# RelaxNG schemas compiled by libxmlval in this process, by schema hash.
+# Shared by all validations (and all ManifestServ instances) in the
+# process.
+compiled_schemas = {}
+
 # =============================================================================
 # Error handling classes
 # =============================================================================
@@ -237,6 +257,178 @@ class _HelperDicts:
         return _HelperDicts(modules, methods, inverts)
 
 
+# =============================================================================
+class _Directive(object):
+# =============================================================================
+    """ A "default" or "validate" node of the defval tree, with the parts
+        used in processing pulled out once.
+    """
+# =============================================================================
+    __slots__ = ("attributes", "value", "nodepath", "parent_nodepath",
+                 "child_nodepath")
+
+    def __init__(self, defval_node):
+        self.attributes = defval_node.get_attr_dict()
+        self.value = defval_node.get_value()
+        self.nodepath = self.attributes.get("nodepath")
+        self.parent_nodepath = None
+        self.child_nodepath = None
+
+        # Nodepaths which are direct children of the root are special
+        # cases.
+        if (self.nodepath is not None):
+            try:
+                (self.parent_nodepath, self.child_nodepath) = \
+                    self.nodepath.rsplit("/", 1)
+            except ValueError:	# No slashes present in nodepath
+                self.parent_nodepath = ""
+                self.child_nodepath = self.nodepath
+
+
+# =============================================================================
+class DirectivePlan(object):
+# =============================================================================
+    """ The defaults and validation directives of a defval tree, read once.
+
+    add_defaults() and validate_content() each build one of these when
+    not given one.  Callers processing more than one phase (or more than
+    one manifest) against the same defval tree should build it once and
+    pass it to each.  Each kind of directive is read on first use.
+
+    """
+# =============================================================================
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __init__(self, defval_tree):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Constructor.
+
+        Args:
+          defval_tree: Tree of defaults and validation nodes, as returned
+            by init_defval_tree().
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        self.defval_tree = defval_tree
+        self.helpers = {}	# _HelperDicts, by nodepath.
+        self.defaults = None
+        self.singles = None
+        self.groups = None
+        self.excludes = None
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def get_defaults(self):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Return the _Directives of the "default" nodes, in defval
+        manifest order.  Helpers may look at defaults set before them, so
+        the order is kept.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        if (self.defaults is None):
+            self.defaults = [_Directive(node) for node in
+                             self.defval_tree.find_node("default")]
+        return self.defaults
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def get_validations(self):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Return the "validate" nodes, sorted by kind.
+
+        Returns: tuple of:
+          - _Directives of the "validate nodepath=" nodes
+          - (validator ref, nodepaths) pairs of the "validate group=" nodes
+          - (validator ref, nodepaths) pairs of the "validate exclude="
+            nodes
+
+        Raises:
+          ManifestProcError: Nodepath, group or exclude attribute missing
+            from a "validate" node.
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        if (self.singles is not None):
+            return (self.singles, self.groups, self.excludes)
+
+        singles = []
+        groups = []
+        excludes = []
+        for node in self.defval_tree.find_node("validate"):
+            directive = _Directive(node)
+            attributes = directive.attributes
+            if (directive.nodepath is not None):
+                singles.append(directive)
+            elif ("group" in attributes):
+                groups.append((attributes["group"].strip(),
+                               [nodepath.strip() for nodepath in
+                                space_parse(directive.value)]))
+            elif ("exclude" in attributes):
+                excludes.append((attributes["exclude"].strip(),
+                                 [nodepath.strip() for nodepath in
+                                  space_parse(directive.value)]))
+            else:
+                # Schema should protect from ever getting here...
+                raise ManifestProcError("Nodepath, group or exclude " +
+                                        "attribute missing from " +
+                                        "\"validate\" entry")
+
+        (self.singles, self.groups, self.excludes) = \
+            (singles, groups, excludes)
+        return (singles, groups, excludes)
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def get_helpers(self, nodepath):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Return the _HelperDicts for nodepath, creating it (and
+        importing its modules) on first use.
+
+        Raises:
+          As for _HelperDicts.new()
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        helpers = self.helpers.get(nodepath)
+        if (helpers is None):
+            helpers = _HelperDicts.new(self.defval_tree, nodepath)
+            self.helpers[nodepath] = helpers
+        return helpers
+
+
+# =============================================================================
+class _RootLookups(object):
+# =============================================================================
+    """ Results of searches from the root of a manifest tree.
+
+    Many directives share a parent nodepath or skip_if_no_exist nodepath.
+    Each is searched for once, and the result reused until the tree
+    changes.  Returned lists must not be modified.
+    """
+# =============================================================================
+
+    def __init__(self, tree):
+        self.tree = tree
+        self.changes = tree.changes
+        self.found = {}
+
+    def find_node(self, nodepath):
+        """ Return tree.find_node(nodepath). """
+        if (self.changes != self.tree.changes):
+            self.changes = self.tree.changes
+            self.found = {}
+        nodes = self.found.get(nodepath)
+        if (nodes is None):
+            nodes = self.tree.find_node(nodepath)
+            self.found[nodepath] = nodes
+        return nodes
+
+
 # =============================================================================
 # Procedural functions, not part of a class
 # =============================================================================
@@ -247,9 +439,16 @@ def __validate_vs_schema(schema, in_xml_doc, out_xml_doc=None,
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Validate an XML document against a schema.
 
-    Runs the command given by XML_VALIDATOR.  Schema must follow the
-    XML_VALIDATOR string.  If out_xml_doc is specified, reformat the
-    xml doc  using the XML_REFORMAT_SW passed to the validator.
+    RelaxNG schemas are compiled and validated against in-process with
+    libxmlval when it is available.  Compiled schemas are kept for the
+    life of the process, and successful validations are recorded in
+    SCHEMA_CACHE_DIR, keyed by the schema and document contents, so a
+    document already validated isn't validated again.
+
+    Otherwise, and for DTD schemas, runs the command given by
+    XML_VALIDATOR.  Schema must follow the XML_VALIDATOR string.  If
+    out_xml_doc is specified, reformat the xml doc  using the
+    XML_REFORMAT_SW passed to the validator.
 
     Args:
       schema: The schema to validate against.
@@ -281,16 +480,107 @@ def __validate_vs_schema(schema, in_xml_doc, out_xml_doc=None,
     canaccess(schema, "r")
     canaccess(in_xml_doc, "r")
 
-    command_list = [XML_VALIDATOR]
-
     if dtd_schema:
-        command_list.append(XML_DTD_SCHEMA)
-        command_list.append(schema)
-        command_list.append(XML_DTD_DEFAULTS)
+        __run_validator([XML_VALIDATOR, XML_DTD_SCHEMA, schema,
+                         XML_DTD_DEFAULTS], in_xml_doc, out_xml_doc)
+        return
+
+    with open(schema, "rb") as schema_file:
+        schema_text = schema_file.read()
+    schema_hash = hashlib.sha1(schema_text).hexdigest()
+
+    # A schema pulling in other files isn't wholly covered by its hash.
+    record = None
+    if ((SCHEMA_CACHE_DIR is not None) and
+        (b"<include" not in schema_text) and
+        (b"externalRef" not in schema_text)):
+        with open(in_xml_doc, "rb") as doc_file:
+            doc_hash = hashlib.sha1(doc_file.read()).hexdigest()
+        record = os.path.join(SCHEMA_CACHE_DIR,
+                              schema_hash + "." + doc_hash)
+
+        # A reformatted copy has to be made even if validation
+        # isn't needed, so validate anyway in that case.
+        if ((out_xml_doc is None) and __cache_dir_trusted() and
+            os.path.exists(record)):
+            return
+
+    if (libxmlval is None):
+        __run_validator([XML_VALIDATOR, XML_RNG_SCHEMA, schema],
+                        in_xml_doc, out_xml_doc)
     else:
-        command_list.append(XML_RNG_SCHEMA)
-        command_list.append(schema)
+        compiled = compiled_schemas.get(schema_hash)
+        try:
+            if (compiled is None):
+                compiled = libxmlval.compile(schema)
+                compiled_schemas[schema_hash] = compiled
+            valid = libxmlval.validate(compiled, in_xml_doc, out_xml_doc)
+        except libxmlval.error as err:
+            print("validate_vs_schema: " + str(err), file=sys.stderr)
+            raise ManifestProcError("validate_vs_schema: " +
+                                    "Validator terminated abnormally")
+        if (not valid):
+            print(("validate_vs_schema: %s fails to validate against %s" %
+                   (in_xml_doc, schema)), file=sys.stderr)
+            raise ManifestProcError("validate_vs_schema: " +
+                                    "Validator terminated abnormally")
+
+    if (record is not None):
+        try:
+            if (not os.path.isdir(SCHEMA_CACHE_DIR)):
+                os.makedirs(SCHEMA_CACHE_DIR, 0o755)
+            if (__cache_dir_trusted()):
+                open(record, "w").close()
+        except (IOError, OSError):
+            pass
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def __cache_dir_trusted():
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Check that validation records in SCHEMA_CACHE_DIR can be believed.
+
+    Only a directory owned by this user and writable by no one else is
+    trusted, so that no one else can record a document as valid.
+
+    Returns:
+      True: SCHEMA_CACHE_DIR exists and is trusted
+      False: otherwise
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    try:
+        dir_stat = os.lstat(SCHEMA_CACHE_DIR)
+    except OSError:
+        return False
+    return (stat.S_ISDIR(dir_stat.st_mode) and
+            (dir_stat.st_uid == os.geteuid()) and
+            ((dir_stat.st_mode & (stat.S_IWGRP | stat.S_IWOTH)) == 0))
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def __run_validator(command_list, in_xml_doc, out_xml_doc):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Run XML_VALIDATOR on an XML document.
+
+    Args:
+      command_list: The validator command and its schema arguments.
+
+      in_xml_doc: The XML document to validate.
+
+      out_xml_doc: Reformatted XML doc, or None
+
+    Returns: N/A
+
+    Raises:
+      OSError: Error starting or running shell
+      ManifestProcError: The validator returned an error status or
+        was terminated by a signal.
 
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     if (out_xml_doc is not None):
         command_list.append(XML_REFORMAT_SW)
         outfile = open(out_xml_doc.strip(), "w")
@@ -471,8 +761,8 @@ def __do_skip_if_no_exist(attributes, manifest_tree, debug):
     Args:
       attributes: Attributes list to check for skip_if_no_exist in.
 
-      manifest_tree: tree to search for the node identified by the
-        skip_if_no_exist attribute.
+      manifest_tree: tree (or _RootLookups of the tree) to search for
+        the node identified by the skip_if_no_exist attribute.
 
       debug: Print tracing / debug messages when True
 
@@ -499,7 +789,7 @@ def __do_skip_if_no_exist(attributes, manifest_tree, debug):
 
 
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-def add_defaults(manifest_tree, defval_tree, debug=False):
+def add_defaults(manifest_tree, defval_tree, debug=False, plan=None):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Add defaults to manifest_tree, based on defval_tree specifications.
 
@@ -546,6 +836,8 @@ def add_defaults(manifest_tree, defval_tree, debug=False):
 
       debug: Turn on debug / tracing messages when True
 
+      plan: (optional) DirectivePlan of defval_tree.  Made if not given.
+
     Returns: N/A
 
     Raises:
@@ -562,33 +854,33 @@ def add_defaults(manifest_tree, defval_tree, debug=False):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     errors = False
 
+    if (plan is None):
+        plan = DirectivePlan(defval_tree)
+
     # Fetch dictionaries used to reference the helper methods and modules.
     try:
-        deflt_setters = _HelperDicts.new(defval_tree, "helpers/deflt_setter")
+        deflt_setters = plan.get_helpers("helpers/deflt_setter")
     except ManifestProcError as err:
         print(("add_defaults: Error getting default setter " +
                               "methods from defval XML file"), file=sys.stderr)
         print(str(err), file=sys.stderr)
         raise
 
-    # Get a list of all defaults to process.
-    defaults = defval_tree.find_node("default")
-    if (len(defaults) == 0):
-        return
+    lookups = _RootLookups(manifest_tree)
 
-    for curr_def in defaults:
-        attributes = curr_def.get_attr_dict()
+    for curr_def in plan.get_defaults():
+        attributes = curr_def.attributes
 
         manifest_nodepath = attributes["nodepath"]
         if (debug):
             print("Checking defaults for " + manifest_nodepath)
 
-        if __do_skip_if_no_exist(attributes, manifest_tree, debug):
+        if __do_skip_if_no_exist(attributes, lookups, debug):
             if (debug):
                 print("Ancestor doesn't exist.  Skipping...")
             continue
 
-        value_from_xml = curr_def.get_value()
+        value_from_xml = curr_def.value
         type_str = attributes["type"]
         via = attributes["from"]
 
@@ -597,20 +889,15 @@ def add_defaults(manifest_tree, defval_tree, debug=False):
         else:
             node_type = TreeAccNode.ATTRIBUTE
 
-        # Nodepaths which are direct children of the root are special cases
-        try:
-            (parent_nodepath, child_nodepath) = manifest_nodepath.rsplit("/",
-                                                                         1)
-        except ValueError:	# No slashes present in nodepath
-            parent_nodepath = ""
-            child_nodepath = manifest_nodepath
+        parent_nodepath = curr_def.parent_nodepath
+        child_nodepath = curr_def.child_nodepath
 
         # Fetch the parent nodes.  We cannot just search for the
         # children directly because we want to guarantee that every
         # viable parent has at least one child which matches the default
         # nodepath.  We need to correlate every element containing a
         # default nodepath to its parent.
-        parent_nodes = manifest_tree.find_node(parent_nodepath)
+        parent_nodes = lookups.find_node(parent_nodepath)
 
         # Missing parent nodes anywhere along the tree are errors
         # if they are those nodes are required.  This is not always the
@@ -876,7 +1163,7 @@ def __validate_node(validator_ref, validator_dicts, node, debug):
 
 
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-def validate_content(manifest_tree, defval_tree, debug=False):
+def validate_content(manifest_tree, defval_tree, debug=False, plan=None):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Validate nodes of manifest_tree, based on defval_tree specifications.
 
@@ -923,6 +1210,8 @@ def validate_content(manifest_tree, defval_tree, debug=False):
 
       debug: When true, prints debug / tracing messages
 
+      plan: (optional) DirectivePlan of defval_tree.  Made if not given.
+
     Returns: N/A
 
     Raises:
@@ -932,87 +1221,53 @@ def validate_content(manifest_tree, defval_tree, debug=False):
 
     """
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    group_validate = []
-    singles_validate = []
-    exclude_validate = []
+    if (plan is None):
+        plan = DirectivePlan(defval_tree)
 
     # Fetch dictionaries used to reference the helper methods, modules and
     # invert statuses.
     try:
-        validator_dicts = _HelperDicts.new(defval_tree, "helpers/validator")
+        validator_dicts = plan.get_helpers("helpers/validator")
     except ManifestProcError as err:
         print(("validate_content: Error getting validator " +
                               "methods from defval XML file"), file=sys.stderr)
         print(str(err), file=sys.stderr)
         raise
 
-    # Fetch all "validate" nodes from the defval tree.
-    to_validate = defval_tree.find_node("validate")
-    if not to_validate:
-        return
-
-    # Create separate lists of the different kinds of "validate" nodes.
-    for validateme in to_validate:
-        attributes = validateme.get_attr_dict()
-
-        # Do specific nodes specified with "nodepath" attribute, for
-        # this pass.
-        if ("nodepath" in attributes):
-            if (debug):
-                print(("Checking skip_if_no_exist for " +
-                       "validate nodepath=" + attributes["nodepath"]))
-            if __do_skip_if_no_exist(attributes, manifest_tree, debug):
-                if (debug):
-                    print("Node doesn't exist.  Skipping...")
-                continue
-
-            singles_validate.append(validateme)
-            continue
-
-        if ("group" in attributes):
-            group_validate.append(validateme)
-            continue
-
-        if ("exclude" in attributes):
-            exclude_validate.append(validateme)
-            continue
-
-        # Schema should protect from ever getting here...
-        print(("Nodepath, group or exclude attribute " +
-                              "missing from \"validate\" entry"), file=sys.stderr)
-        raise
+    # The tree doesn't change while it is validated, so searches from
+    # the root (shared parent nodepaths, skip_if_no_exist nodepaths and
+    # group nodepaths) are done once each.
+    lookups = _RootLookups(manifest_tree)
+    (singles, groups, excludes) = plan.get_validations()
 
-    if (len(singles_validate) > 0):
+    if (len(singles) > 0):
         if (debug):
             print("Processing singles validation")
-        __validate_singles(singles_validate, validator_dicts,
-                           manifest_tree, debug)
+        __validate_singles(singles, validator_dicts, lookups, debug)
 
-    if (len(group_validate) > 0):
+    if (len(groups) > 0):
         if (debug):
             print("Processing group validation")
-        __validate_group(group_validate, validator_dicts,
-                         manifest_tree, debug)
+        __validate_group(groups, validator_dicts, lookups, debug)
 
-    if (len(exclude_validate) > 0):
+    if (len(excludes) > 0):
         if (debug):
             print("Processing global validation")
-        __validate_exclude(exclude_validate, validator_dicts,
-                           manifest_tree, debug)
+        __validate_exclude(excludes, validator_dicts, manifest_tree, debug)
 
 
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-def __validate_singles(to_validate, validator_dicts, manifest_tree, debug):
+def __validate_singles(to_validate, validator_dicts, lookups, debug):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Process a list of "validate nodepath=" nodes.
 
     Args:
-      to_validate: List of items to validate.
+      to_validate: List of _Directives to validate.
 
       validator_dicts: _HelperDicts object containing validator method
          information.
 
-      manifest_tree: Tree containing nodes to validate.
+      lookups: _RootLookups of the tree containing nodes to validate.
 
       debug: When true, prints debug / tracing messages
 
@@ -1024,22 +1279,26 @@ def __validate_singles(to_validate, validator_dicts, manifest_tree, debug):
     """
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     errors = False
+    manifest_tree = lookups.tree
     for validateme in to_validate:
-        attributes = validateme.get_attr_dict()
-        manifest_nodepath = attributes["nodepath"]
+        attributes = validateme.attributes
+        manifest_nodepath = validateme.nodepath
+
+        if (debug):
+            print(("Checking skip_if_no_exist for " +
+                   "validate nodepath=" + manifest_nodepath))
+        if __do_skip_if_no_exist(attributes, lookups, debug):
+            if (debug):
+                print("Node doesn't exist.  Skipping...")
+            continue
 
         if (debug):
             print("Validating node(s) at nodepath " + manifest_nodepath)
 
-        validator_list = space_parse(validateme.get_value())
+        validator_list = space_parse(validateme.value)
 
-        # Nodepaths which are direct children of the root are special cases
-        try:
-            (parent_nodepath, child_nodepath) = manifest_nodepath.rsplit("/",
-                                                                         1)
-        except ValueError:	# No slashes present in nodepath
-            parent_nodepath = ""
-            child_nodepath = manifest_nodepath
+        parent_nodepath = validateme.parent_nodepath
+        child_nodepath = validateme.child_nodepath
 
         # Treat no "missing" attribute for this nodepath
         # as missing_parent = "error"
@@ -1047,7 +1306,7 @@ def __validate_singles(to_validate, validator_dicts, manifest_tree, debug):
 
         # Try to get the parent nodes which match the nodepath less the
         # final branch.
-        parent_nodes = manifest_tree.find_node(parent_nodepath)
+        parent_nodes = lookups.find_node(parent_nodepath)
 
         # An ancestor somewhere in the chain back to the root is missing
         if (len(parent_nodes) == 0):
@@ -1109,17 +1368,18 @@ def __validate_singles(to_validate, validator_dicts, manifest_tree, debug):
 
 
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-def __validate_group(to_validate, validator_dicts, manifest_tree, debug):
+def __validate_group(to_validate, validator_dicts, lookups, debug):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Process a list of "validate group=" nodes.
 
     Args:
-      to_validate: List of items to validate.
+      to_validate: List of (validator ref, nodepaths) pairs of the
+        "validate group=" nodes.
 
       validator_dicts: _HelperDicts object containing validator method
          information.
 
-      manifest_tree: Tree containing nodes to validate.
+      lookups: _RootLookups of the tree containing nodes to validate.
 
       debug: Print tracing / debug messages when True
 
@@ -1131,22 +1391,14 @@ def __validate_group(to_validate, validator_dicts, manifest_tree, debug):
     """
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     errors = False
-    for validateme in to_validate:
-        attributes = validateme.get_attr_dict()
-        validator_ref = attributes["group"].strip()
-
+    for (validator_ref, nodepaths) in to_validate:
         if (debug):
             print("  Processing group validated by " + validator_ref + "()")
 
-        # Get the list of nodepaths of nodes to validate as a string,
-        # then break into individual strings.
-        nodepaths = space_parse(validateme.get_value())
-
-        for raw_nodepath in nodepaths:
-            nodepath = raw_nodepath.strip()
+        for nodepath in nodepaths:
             if (debug):
                 print("  Validating nodes matching nodepath " + nodepath)
-            nodes = manifest_tree.find_node(nodepath)
+            nodes = lookups.find_node(nodepath)
 
             if (len(nodes) == 0):
                 if (debug):
@@ -1179,8 +1431,12 @@ def __validate_exclude(to_exclude, validator_dicts, manifest_tree, debug):
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     """ Process a list of "validate exclude=" nodes.
 
+    The tree is walked once, and each node is checked by every validator
+    whose exclude list doesn't have its path.
+
     Args:
-      to_validate: List of items to validate.
+      to_exclude: List of (validator ref, nodepaths) pairs of the
+        "validate exclude=" nodes.
 
       validator_dicts: _HelperDicts object containing validator method
          information.
@@ -1197,55 +1453,44 @@ def __validate_exclude(to_exclude, validator_dicts, manifest_tree, debug):
     """
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     errors = False
-    for excludeme in to_exclude:
-        attributes = excludeme.get_attr_dict()
-        validator_ref = attributes["exclude"].strip()
+    excludes = [(validator_ref, set(nodepaths))
+                for (validator_ref, nodepaths) in to_exclude]
 
-        if (debug):
-            print(("  Processing unexcluded nodes validated by " +
-                   validator_ref + "()"))
-        nodepaths = space_parse(excludeme.get_value())
+    # For every node in the tree do
+    walker = manifest_tree.get_tree_walker()
 
-        # For every node in the tree do
-        walker = manifest_tree.get_tree_walker()
+    # Get an element and its attributes as a list of nodes
+    # (TreeAccNodes)
+    curr_list = manifest_tree.walk_tree(walker)
+    while (curr_list is not None):
 
-        # Get an element and its attributes as a list of nodes
-        # (TreeAccNodes)
-        curr_list = manifest_tree.walk_tree(walker)
-        while (curr_list is not None):
+        # Cycle through all returned nodes.
+        for node in curr_list:
+            node_path = node.get_path()
+            if (debug):
+                print("Checking current node: " + node_path)
 
-            # Cycle through all returned nodes.
-            for node in curr_list:
+            for (validator_ref, inhibited) in excludes:
 
-                if (debug):
-                    print("Checking current node: " + node.get_path())
-
-                # Check through the list of nodepaths to be
-                # inhibited.  Note if the path of the current
-                # node is in the list.
-                inhibit = False
-                for raw_nodepath in nodepaths:
-                    nodepath = raw_nodepath.strip()
-                    if (debug):
-                        print("%s vs %s" % (nodepath, node.get_path()))
-                    if (nodepath == node.get_path()):
-                        inhibit = True
-                        break
+                # Skip the node if its path is in the list of
+                # nodepaths to be inhibited for this validator.
+                if (node_path in inhibited):
+                    continue
 
-                if (not inhibit):
-                    if (debug):
-                        print("Not inbibited.  Checking node")
-                    try:
-                        if (not __validate_node(validator_ref,
-                            validator_dicts, node, debug)):
-                            errors = True
-                    except Exception as err:
-                        print(("Exception while validating " +
-                                              "node " + node.get_path()), file=sys.stderr)
-                        print(str(err), file=sys.stderr)
+                if (debug):
+                    print(("Not inhibited for " + validator_ref +
+                           "().  Checking node"))
+                try:
+                    if (not __validate_node(validator_ref,
+                        validator_dicts, node, debug)):
                         errors = True
+                except Exception as err:
+                    print(("Exception while validating " +
+                                          "node " + node_path), file=sys.stderr)
+                    print(str(err), file=sys.stderr)
+                    errors = True
 
-            curr_list = manifest_tree.walk_tree(walker)
+        curr_list = manifest_tree.walk_tree(walker)
 
     if errors:
         raise ManifestProcError("validate_exclude: One or more validation " +
@@ -595,3 +595,44 @@ def parse_nodepath(nodepath):
 
     # Done!
     return parsed_tokens
+
+
+# Compiled nodepaths, keyed by nodepath string.  Trees are queried with the
+# same few hundred nodepaths over and over, so each is parsed only once.
+__COMPILED_NODEPATHS = {}
+__COMPILED_NODEPATHS_MAX = 4096
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def compile_nodepath(nodepath):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """Memoizing front end to parse_nodepath()
+
+	The list returned is the caller's to modify, but the ENTokens in it
+	are shared with other callers compiling the same nodepath and must
+	not be changed.
+
+	Args:
+	  nodepath: nodepath to parse
+
+	Returns:
+	  A list of parsed tokens as ENTokens
+
+	Raises:
+	  ParserError: see parse_nodepath()
+
+	"""
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    try:
+        return list(__COMPILED_NODEPATHS[nodepath])
+    except KeyError:
+        pass
+
+    tokens = tuple(parse_nodepath(nodepath))
+
+    # Nodepaths embedding arbitrary values could grow this without
+    # bound; start over rather than tracking use.
+    if (len(__COMPILED_NODEPATHS) >= __COMPILED_NODEPATHS_MAX):
+        __COMPILED_NODEPATHS.clear()
+    __COMPILED_NODEPATHS[nodepath] = tokens
+    return list(tokens)
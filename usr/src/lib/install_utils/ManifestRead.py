@@ -31,10 +31,13 @@ ManifestRead.py - Remote (AF-UNIX socket-based) XML data access
 # =============================================================================
 
 import errno
+import os
 import sys
 import socket
 
 import osol_install.SocketServProtocol as SocketServProtocol
+from osol_install.ManifestSnapshot import ManifestSnapshot, \
+    ManifestSnapshotError, SNAPSHOT_SUFFIX
 
 # =============================================================================
 class ManifestRead(object):
@@ -48,6 +51,11 @@ class ManifestRead(object):
     run a program that prints the results, and for python programs to
     retrieve results in a python list.
 
+    Version 2 of the protocol is used when the server supports it, so that
+    a list of requests costs a single round trip.  Requests are answered
+    from the server's snapshot file, when it exported one, with no round
+    trip at all.
+
     """
 # =============================================================================
 
@@ -58,18 +66,111 @@ class ManifestRead(object):
 
         Takes the name of a socket, created by the ManifestServ process.
         The socket remains open as long as this instance is intact.
+        The protocol version is agreed on with the server here.
+
+        If the server exported a snapshot next to the socket, it is used,
+        and the socket is opened only when a request isn't covered by the
+        snapshot.  A snapshot which its server no longer holds is ignored.
+        The name of a snapshot file may also be given instead of a
+        socket; requests not covered by it then fail.
 
         Args:
-          sock_name: String name of the socket.
+          sock_name: String name of the socket, or of a snapshot file.
 
         Raises:
           Exceptions for:
             Error creating listener socket
             Error connecting to listener socket
+            Error reading snapshot file
 
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         self.debug = False
+        self.client_sock = None
+        self.protocol_version = 0
+        self.snapshot = None
+
+        if (sock_name.endswith(SNAPSHOT_SUFFIX)):
+            self.sock_name = None
+            snapshot_name = sock_name
+        else:
+            self.sock_name = sock_name
+            snapshot_name = sock_name + SNAPSHOT_SUFFIX
+
+        if ((self.sock_name is None) or os.path.exists(snapshot_name)):
+            try:
+                self.snapshot = ManifestSnapshot(snapshot_name)
+            except (IOError, OSError, ManifestSnapshotError):
+                print(("Error reading snapshot file " +
+                                      snapshot_name), file=sys.stderr)
+                if (self.sock_name is None):
+                    raise
+
+        # A snapshot next to the socket is used only while the server
+        # which exported it is serving; one left behind by a server
+        # which died may be of another manifest.
+        if ((self.snapshot is not None) and (self.sock_name is not None) and
+            not self.snapshot.is_live()):
+            print(("Ignoring stale snapshot file " + snapshot_name),
+                  file=sys.stderr)
+            self.snapshot = None
+
+        if (self.snapshot is None):
+            self.__open_link()
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __open_link(self):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Connect to the server and agree on the
+        protocol version.
+
+        Args: None
+
+        Returns: None
+
+        Raises:
+          Exceptions for:
+            Error creating listener socket
+            Error connecting to listener socket
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        sock_name = self.sock_name
+        self.__connect(sock_name)
+
+        # A version 1 server closes the link on the version request.
+        # Start over with a new link in that case.
+        try:
+            self.client_sock.send(SocketServProtocol.VERSION_REQ.encode())
+            version = self.client_sock.recv(1).decode()
+        except socket.error:
+            version = ""
+        if (version == SocketServProtocol.PROTOCOL_VERSION):
+            self.protocol_version = 2
+        else:
+            self.client_sock.close()
+            self.__connect(sock_name)
+            self.protocol_version = 1
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __connect(self, sock_name):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Open the link to the server.
+
+        Args:
+          sock_name: String name of the socket.
+
+        Returns: None
+
+        Raises:
+          Exceptions for:
+            Error creating listener socket
+            Error connecting to listener socket
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         try:
             self.client_sock = socket.socket(socket.AF_UNIX,
                                              socket.SOCK_STREAM)
@@ -104,8 +205,9 @@ class ManifestRead(object):
         try:
             # We can't use SocketServProtocol.TERM_LINK here as it can already be
             # destroted at this point
-            self.client_sock.send(b'\x05')
-            self.client_sock.close()
+            if (self.client_sock is not None):
+                self.client_sock.send(b'\x05')
+                self.client_sock.close()
         except socket.error:
             pass
 
@@ -138,6 +240,199 @@ class ManifestRead(object):
             (For protocol errors, however, it prints a message and tries
             to muddle along.)
 
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        return self.get_values_many([request], is_key)[0]
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def get_values_many(self, requests, is_key=False):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Retrieve the values of a list of requests in one round trip.
+
+        Args:
+          requests: list of nodepaths (or keys).
+
+          is_key: boolean: if True, all requests are interpreted as keys.
+            See get_values().  May also be a list holding one boolean
+            for each request, to mix keys and nodepaths in one round
+            trip.
+
+        Returns:
+          A list holding a list of values for each request, in the order
+            of the requests.
+
+        Raises:
+            Exceptions due to socket errors.
+
+            socket.error with EPROTO if the reply is malformed.
+
+            socket.error with EMSGSIZE if a request is longer than
+                SocketServProtocol.MAX_REQ_SIZE bytes.
+
+            ManifestSnapshotError if only a snapshot is used and it
+                doesn't cover a request.
+
+            ValueError if is_key is a list of the wrong length.
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        if (not isinstance(is_key, (list, tuple))):
+            is_key = [is_key] * len(requests)
+        elif (len(is_key) != len(requests)):
+            raise ValueError("is_key doesn't match the requests")
+
+        results = [None] * len(requests)
+        if (self.snapshot is not None):
+            for i in range(len(requests)):
+                results[i] = self.snapshot.lookup(requests[i], is_key[i])
+        remaining = [i for i in range(len(requests)) if results[i] is None]
+        if (not remaining):
+            if (self.debug):
+                print("%d requests answered from snapshot" % len(requests))
+            return results
+
+        if (self.sock_name is None):
+            raise ManifestSnapshotError("Request not in snapshot: " +
+                                        requests[remaining[0]])
+        if (self.client_sock is None):
+            self.__open_link()
+
+        to_send = [requests[i] for i in remaining]
+        keys = [is_key[i] for i in remaining]
+        if (self.protocol_version >= 2):
+            fetched = self.__get_values_batch(to_send, keys)
+        else:
+            fetched = [self.__get_values_v1(request, key)
+                       for (request, key) in zip(to_send, keys)]
+        for (i, values) in zip(remaining, fetched):
+            results[i] = values
+        return results
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __get_values_batch(self, requests, is_key):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  get_values_many() using a version 2 batch.
+        Each request of a batch carries its own key flag.
+
+        Args: See get_values_many().  is_key is a list.
+
+        Returns: See get_values_many()
+
+        Raises: See get_values_many()
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        # The size of a batch has to fit in the prerequest.  Send as many
+        # batches as it takes to stay under that.
+        results = []
+        items = []
+        batch_size = 0
+        for (request, key) in zip(requests, is_key):
+            if (key):
+                flag = "1"
+            else:
+                flag = "0"
+            item = (flag + request + SocketServProtocol.STRING_SEP).encode()
+            if (len(item) > SocketServProtocol.MAX_REQ_SIZE):
+                raise socket.error(errno.EMSGSIZE, "Request is too long: " +
+                                   request[:40] + "...")
+            if (batch_size + len(item) > SocketServProtocol.MAX_REQ_SIZE):
+                results.extend(self.__send_batch(
+                    requests[len(results):len(results) + len(items)],
+                    b"".join(items)))
+                items = []
+                batch_size = 0
+            items.append(item)
+            batch_size += len(item)
+        if (items):
+            results.extend(self.__send_batch(requests[len(results):],
+                                             b"".join(items)))
+        return results
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __send_batch(self, requests, batch):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Send one batch and read its reply.
+
+        Args:
+          requests: list of the requests in the batch.
+
+          batch: the encoded batch, no bigger than
+            SocketServProtocol.MAX_REQ_SIZE bytes.
+
+        Returns: See get_values_many()
+
+        Raises: See get_values_many()
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        pre_request = SocketServProtocol.BATCH_REQ + " " + \
+            "%6.6d" % len(batch)
+
+        if (self.debug):
+            print("Sending batch of %d requests" % len(requests))
+        try:
+            self.client_sock.sendall(pre_request.encode() + batch)
+        except socket.error:
+            print("Error sending request batch to server", file=sys.stderr)
+            raise
+
+        try:
+            size_str = SocketServProtocol.recv_exact(self.client_sock,
+                SocketServProtocol.BATCH_SIZE_LEN)
+            size = int(size_str)
+            reply = SocketServProtocol.recv_exact(self.client_sock, size)
+        except (socket.error, ValueError):
+            print(("Protocol error: Did not receive batch " +
+                                  "reply."), file=sys.stderr)
+            raise
+        if (len(reply) != size):
+            raise socket.error(errno.EPROTO, "Protocol error: " +
+                                 "batch reply is truncated")
+
+        fields = reply.decode().split(SocketServProtocol.STRING_SEP)
+        results = []
+        idx = 0
+        try:
+            for request in requests:
+                count = int(fields[idx])
+                values = fields[idx + 1:idx + 1 + count]
+                if (len(values) != count):
+                    raise IndexError
+                results.append([
+                    ("" if (value == SocketServProtocol.EMPTY_STR) else value)
+                    for value in values])
+                if (self.debug):
+                    print("%s: %d results" % (request, count))
+                idx += count + 1
+        except (IndexError, ValueError):
+            raise socket.error(errno.EPROTO, "Protocol error: " +
+                                 "batch reply is malformed")
+
+        if ((idx != len(fields) - 1) or
+            (fields[idx] != SocketServProtocol.REQ_COMPLETE)):
+            print(("Protocol error: " +
+                                  "Improper request termination."), file=sys.stderr)
+        elif (self.debug):
+            print("Proper Termination protocol seen")
+
+        return results
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __get_values_v1(self, request, is_key):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  get_values() using version 1 of the protocol.
+
+        Args: See get_values()
+
+        Returns: See get_values()
+
+        Raises: See get_values()
+
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         results_list = []
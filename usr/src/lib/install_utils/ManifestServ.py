@@ -33,10 +33,14 @@ import errno
 import sys
 import _thread
 import os
+import selectors
 import socket
+import time
+import osol_install.ManifestSnapshot as ManifestSnapshot
 import osol_install.SocketServProtocol as SocketServProtocol
 
 from osol_install.DefValProc import add_defaults
+from osol_install.DefValProc import DirectivePlan
 from osol_install.DefValProc import init_defval_tree
 from osol_install.DefValProc import schema_validate
 from osol_install.DefValProc import validate_content
@@ -56,6 +60,37 @@ class ManifestServError(Exception):
     """Base Exception for ManifestServ errors"""
     pass
 
+# =============================================================================
+class ServConnection(object):
+# =============================================================================
+    """ State of one client connection to the socket server.
+
+    The server reads whatever a client has sent into inbuf, and takes
+    complete protocol messages off of it.  state says what the next
+    message is: a prerequest, a version 1 request of size bytes, the
+    client's acknowledge of a version 1 count and size (results are held
+    until then), or a version 2 batch of size bytes.  Replies wait in
+    outbuf until the socket takes them.
+
+    """
+# =============================================================================
+
+    PRE_REQUEST = 0
+    REQUEST = 1
+    PARAMS = 2
+    BATCH = 3
+
+    RECV_SIZE = 65536
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.state = ServConnection.PRE_REQUEST
+        self.is_key = False
+        self.size = 0
+        self.results = b""
+        self.inbuf = bytearray()
+        self.outbuf = bytearray()
+
 # =============================================================================
 class ManifestServ(object):
 # =============================================================================
@@ -93,7 +128,9 @@ class ManifestServ(object):
         - Initialize the project data (manifest) tree.
         - Add defaults to the manifest tree.
         - Validate semantics/content of manifest tree.
-        - Validate the manifest tree against the manifest schema.
+        - Validate the manifest tree against the manifest schema.  The
+            tree is saved to a temporary file for this only if adding
+            defaults changed it.
         - Optionally save a nicely-formatted XML file containing all
             adjustments.  This is the output_manifest.  Name is of
             the format:
@@ -154,8 +191,13 @@ class ManifestServ(object):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
         self.defval_tree = None
+        self.defval_plan = None
         self.manifest_tree = None
 
+        # Seconds spent in each phase of processing, by phase name.
+        self.phase_times = {}
+        start = time.time()
+
         # The lock is acquired while server is accepting requests
         self.lock = _thread.allocate_lock()
 
@@ -178,6 +220,8 @@ class ManifestServ(object):
         except TreeAccError:
             print("Error instantiating manifest tree:", file=sys.stderr)
             raise
+        self.manifest_name = manifest_name
+        self.phase_times["load"] = time.time() - start
 
         # Initialize default for valfile_base, if necessary.
         if (valfile_base is None):
@@ -215,6 +259,8 @@ class ManifestServ(object):
         # start_socket_server() having been called first.
         self.listen_sock_name = ("/tmp/ManifestServ." + self.strpid)
         self.listen_sock = None    # Filled in by start_server()
+        self.sock_snapshot_name = None    # Filled in by export_snapshot()
+        self.sock_snapshot_lock = None    # Filled in by export_snapshot()
         self.server_run = False
         self.socket_debug = socket_debug
 
@@ -234,6 +280,11 @@ class ManifestServ(object):
                                        self.temp_manifest_name, self.verbose,
                                        self.keep_temp_files)
 
+            if (self.verbose):
+                print("Manifest processing times:")
+                for (phase, seconds) in self.phase_times.items():
+                    print("    %-10s %.3fs" % (phase, seconds))
+
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     def schema_validate(self, schema_name=None, temp_manifest_name=None,
@@ -295,11 +346,23 @@ class ManifestServ(object):
                                     "_out" + ManifestServ.XML_SUFFIX)
             delete_out_manifest = True
 
+        # The tree is saved for validation only if it may differ from
+        # the manifest file it was read from (or if the temporary file is
+        # to be kept).
+        save_tree = (keep_temp_files or (self.manifest_name is None) or
+                     (self.manifest_tree.changes != 0))
+        if (save_tree):
+            in_manifest_name = temp_manifest_name
+        else:
+            in_manifest_name = self.manifest_name
+
         # Pylint bug: See http://www.logilab.org/ticket/8764
         # pylint: disable-msg=C0321
+        start = time.time()
         try:
-            self.__save_tree(temp_manifest_name)
-            schema_validate(schema_name, temp_manifest_name, out_manifest_name,
+            if (save_tree):
+                self.__save_tree(temp_manifest_name)
+            schema_validate(schema_name, in_manifest_name, out_manifest_name,
                             dtd_schema=dtd_schema)
 
             # For DTD Manifests, setting defaults entails taking the
@@ -311,6 +374,7 @@ class ManifestServ(object):
                 except TreeAccError:
                     print("Error re-instantiating manifest tree:", file=sys.stderr)
                     raise
+                self.manifest_name = None
 
         except ManifestProcError as err:
             print(("Error validating " +
@@ -321,22 +385,23 @@ class ManifestServ(object):
         # Check to delete the temporary file(s) whether or not an
         # exception occurred.
         finally:
-            if (not keep_temp_files):
+            self.phase_times["schema"] = time.time() - start
+            if (save_tree and not keep_temp_files):
                 if (verbose):
                     print(("Removing temporary file: " + temp_manifest_name))
                 os.unlink(temp_manifest_name)
 
-                if delete_out_manifest:
-                    if verbose:
-                        print(("Removing temporary file: " + out_manifest_name))
-                    os.unlink(out_manifest_name)
+            if (delete_out_manifest and not keep_temp_files):
+                if verbose:
+                    print(("Removing temporary file: " + out_manifest_name))
+                os.unlink(out_manifest_name)
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     def __load_defval_tree__(self, defval_manifest_name):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        """ Initialize and validate the defaults/content validation tree
-        if not already done.
+        """ Initialize and validate the defaults/content validation tree,
+        and read its directives, if not already done.
 
         Args:
           defval_manifest_name: Name of the defaults/content-validation
@@ -351,15 +416,18 @@ class ManifestServ(object):
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         if (self.defval_tree is None):
+            start = time.time()
 
             # Initialize and validate the defaults/content-validation tree.
             try:
                 self.defval_tree = init_defval_tree(defval_manifest_name)
+                self.defval_plan = DirectivePlan(self.defval_tree)
             except ManifestProcError as err:
                 print(("Error initializing defaults/" +
                                      "content-validation tree"), file=sys.stderr)
                 print(str(err), file=sys.stderr)
                 raise
+            self.phase_times["defval"] = time.time() - start
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -415,8 +483,10 @@ class ManifestServ(object):
         self.__load_defval_tree__(defval_manifest_name)
 
         # Add defaults to the project manifest data tree.
+        start = time.time()
         try:
-            add_defaults(self.manifest_tree, self.defval_tree, verbose)
+            add_defaults(self.manifest_tree, self.defval_tree, verbose,
+                         self.defval_plan)
         except (KeyError, ManifestProcError) as err:
             print("Error adding defaults to manifest tree", file=sys.stderr)
             print(str(err), file=sys.stderr)
@@ -425,6 +495,7 @@ class ManifestServ(object):
             if (keep_temp_files):
                 self.__save_tree(temp_manifest_name)
             raise
+        self.phase_times["defaults"] = time.time() - start
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -481,8 +552,10 @@ class ManifestServ(object):
 
         # Do semantic / content validation on the project manifest
         # data tree.
+        start = time.time()
         try:
-            validate_content(self.manifest_tree, self.defval_tree, verbose)
+            validate_content(self.manifest_tree, self.defval_tree, verbose,
+                             self.defval_plan)
         except (KeyError, ManifestProcError) as err:
             print("Error validating manifest tree content:", file=sys.stderr)
             print(str(err), file=sys.stderr)
@@ -491,6 +564,7 @@ class ManifestServ(object):
             if (keep_temp_files):
                 self.__save_tree(temp_manifest_name)
             raise
+        self.phase_times["semantic"] = time.time() - start
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -595,6 +669,16 @@ class ManifestServ(object):
                 os.unlink(self.listen_sock_name)
         except OSError:
             pass
+
+        try:
+            if (self.sock_snapshot_name is not None):
+                os.unlink(self.sock_snapshot_name)
+        except OSError:
+            pass
+
+        if (self.sock_snapshot_lock is not None):
+            self.sock_snapshot_lock.close()
+            self.sock_snapshot_lock = None
         
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -644,6 +728,34 @@ class ManifestServ(object):
         return strlist
 
 
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def get_values_many(self, requests, is_key=False, verbose=False):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ get_values() for a list of requests.
+
+        Provided so that callers can use a ManifestServ or a ManifestRead
+        object interchangeably.
+
+        Args:
+          requests: list of nodepaths (or keys).
+
+          is_key: boolean: if True, all requests are keys.  See get_values()
+
+          verbose: boolean: if True, print messages
+
+        Returns:
+           list of lists of string values, one list per request, in
+                the order of the requests
+
+        Raises:
+          ParserError: Errors generated while parsing a nodepath
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        return [self.get_values(request, is_key, verbose)
+                for request in requests]
+
+
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     def get_sockname(self):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -667,171 +779,352 @@ class ManifestServ(object):
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    def __process_srvr_requests(self, srvsock):
+    def export_snapshot(self, snapshot_name=None):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        """ Private method used to process remote (socket) request.
-    
-        Utilize the srvsock socket to communicate with a client using
-        the protocol set forth in the SocketServProtocol.py module.
-        Accepts a request, and then answers it.  Can accept and answer
-        multiple requests before terminating, all per the protocol.
-    
-        Please see the SocketServProtocol module for public definitions
-        for protocol, and their explanations.
-    
+        """ Export the manifest's values to a snapshot file.
+
+        Clients read the values of plain nodepaths and keys from the
+        snapshot without a round trip to the server.  See the
+        ManifestSnapshot module.  Call this after defaults are set and
+        the manifest is validated, and don't change the manifest after.
+
         Args:
-          srvsock: socket to communicate with the client
-    
-        Returns: None
-    
+          snapshot_name: Name of the file to write.  If None, the file
+            goes next to the socket (get_sockname() + SNAPSHOT_SUFFIX),
+            where ManifestRead looks for it, and stop_socket_server()
+            removes it.  This process keeps it locked until then, so
+            that ManifestRead can tell it from one left behind by a
+            server which died.
+
+        Returns:
+          The name of the snapshot file.
+
         Raises:
-          socket.error: ManifestServ Prerequest Protocol Error:key
-          socket.error: ManifestServ Prerequest Protocol Error:size
-          socket.error: ManifestServ Protocol Error
-          Other exceptions which can be raised by socket send() and recv()
-    
+          ManifestServError: Error writing the snapshot
+
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        # Receive a new request.
-        pre_request = srvsock.recv(SocketServProtocol.PRE_REQ_SIZE).decode()
+        if (snapshot_name is None):
+            snapshot_name = self.listen_sock_name + \
+                ManifestSnapshot.SNAPSHOT_SUFFIX
+            self.sock_snapshot_name = snapshot_name
+
+        # Every element and attribute path of the tree.
+        nodepath_values = {}
+        walker = self.manifest_tree.get_tree_walker()
+        cluster = self.manifest_tree.walk_tree(walker)
+        while (cluster is not None):
+            for node in cluster:
+                path = node.get_path()
+                if (path not in nodepath_values):
+                    nodepath_values[path] = self.get_values(path)
+            cluster = self.manifest_tree.walk_tree(walker)
+
+        key_values = {}
+        for key in nodepath_values.get(
+            SocketServProtocol.KEY_PATH.split("[")[0] + "/key", []):
+            try:
+                key_values[key] = self.get_values(key, True)
+            except TreeAccError:
+                continue
 
-        # Loop until client terminated (unexpectedly or per protocol)
-        while (pre_request and
-            (pre_request[0] != SocketServProtocol.TERM_LINK)):
+        try:
+            lock = ManifestSnapshot.write_snapshot(snapshot_name,
+                self.manifest_tree.treeroot_ta_node.get_name(),
+                nodepath_values, key_values,
+                snapshot_name == self.sock_snapshot_name)
+        except (IOError, OSError) as err:
+            raise ManifestServError("Error writing manifest snapshot %s: %s" %
+                                    (snapshot_name, str(err)))
+        if (lock is not None):
+            # The lock of a snapshot this one replaced goes with it.
+            if (self.sock_snapshot_lock is not None):
+                self.sock_snapshot_lock.close()
+            self.sock_snapshot_lock = lock
 
-            if (pre_request[0] == '0'):
-                is_key = False
-            elif (pre_request[0] == '1'):
-                is_key = True
-            else:
-                raise socket.error(errno.EPROTO, "ManifestServ Prerequest " +
-                                     "Protocol Error:key")
-            try:
-                request_size = int(pre_request[2:SocketServProtocol.
-                                   PRE_REQ_SIZE])
-            except ValueError:
-                raise socket.error(errno.EPROTO, "ManifestServ Prerequest " +
-                                     "Protocol Error:size")
-            if (self.socket_debug):
-                print(("Prerequest received: key is " + str(is_key) +
-                       " and size = " + str(request_size)))
+        if (self.socket_debug):
+            print("Exported %d nodepaths and %d keys to %s" %
+                  (len(nodepath_values), len(key_values), snapshot_name))
+        return snapshot_name
 
-            # Send the pre_request ack and wait for the request
-            srvsock.send(SocketServProtocol.PRE_REQ_ACK.encode())
-            request = srvsock.recv(request_size).decode()
 
-            # Query the request
-            if (self.socket_debug):
-                print("Received Request: " + request.strip())
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __answer_request(self, request, is_key):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Get the values for one remote request.
 
-            try:
-                values = self.get_values(request.strip(), is_key)
-            except TreeAccError as err:
+        Args:
+          request: nodepath or key received from the client
 
-                print(("Error parsing remote request \"" + request.strip() +
-                       "\": " + str(err)))
+          is_key: boolean: True if request is a key
 
-                # Treat bad search strings like good ones with no results.
-                srvsock.send("0,0".encode())
+        Returns:
+          List of values.  Bad search strings are treated like good ones
+            with no results.
 
-                values = []
-            else:
+        Raises: None
 
-                # Send the count and size.  In the case of found
-                # results, calculate the results string first to get
-                # the size.
-                if not values:    # No results found
-                    srvsock.send("0,0".encode())
-                else:
-                    results = ""
-                    for value in values:
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        if (self.socket_debug):
+            print("Received Request: " + request)
+        try:
+            return self.get_values(request, is_key)
+        except TreeAccError as err:
+            print(("Error parsing remote request \"" + request +
+                   "\": " + str(err)))
+            return []
 
-                        # Handle "empty string" results.
-                        if (value == ""):
-                            value = SocketServProtocol.EMPTY_STR
 
-                        # Concatenate results into single string
-                        results += (value + SocketServProtocol.STRING_SEP)
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __batch_reply(self, batch):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method used to answer a version 2 batch of requests.
 
-                    # Protocol results terminator.
-                    results += SocketServProtocol.REQ_COMPLETE
+        See the SocketServProtocol module for the format of the batch and
+        of the reply.
+
+        Args:
+          batch: the batch received, as bytes
+
+        Returns:
+          The reply to send, including its size, as bytes.
+
+        Raises:
+          socket.error: ManifestServ Protocol Error:batch
 
-                    # Send results count and size.
-                    srvsock.send((str(len(values)) + "," + str(len(results))).encode())
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        requests = batch.decode().split(SocketServProtocol.STRING_SEP)
 
-            # Wait for the count/size acknowledge from the client.
-            request = srvsock.recv(1).decode()
-            if ((not request) or
-                (request[0] != SocketServProtocol.RECV_PARAMS_RECVD)):
+        # The batch ends with a separator, leaving an empty last entry.
+        results = []
+        for request in requests[:-1]:
+            if ((not request) or (request[0] not in ("0", "1"))):
                 raise socket.error(errno.EPROTO,
-                                     "ManifestServ Protocol Error")
+                                     "ManifestServ Protocol Error:batch")
+            values = self.__answer_request(request[1:].strip(),
+                                           (request[0] == "1"))
+            results.append(str(len(values)))
+            for value in values:
+                if (value == ""):
+                    value = SocketServProtocol.EMPTY_STR
+                results.append(value)
+        results.append(SocketServProtocol.REQ_COMPLETE)
+
+        reply = SocketServProtocol.STRING_SEP.join(results).encode()
+        return ("%*.*d" % (SocketServProtocol.BATCH_SIZE_LEN,
+                           SocketServProtocol.BATCH_SIZE_LEN,
+                           len(reply))).encode() + reply
 
-            # Send the results.
-            if values:
-                srvsock.sendall(results.encode())
 
-            # Receive a new request.
-            pre_request = srvsock.recv(SocketServProtocol.PRE_REQ_SIZE).decode()
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __process_client_input(self, conn):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method used to process remote (socket) requests.
 
-        if (self.socket_debug):
-            print("termination requested")
+        Works through the input buffered for a client per the protocol
+        set forth in the SocketServProtocol.py module, as far as complete
+        messages have arrived, and queues the answers for sending.
+        Where the rest of a message is still to come, the connection's
+        state records what is awaited.
+
+        Please see the SocketServProtocol module for public definitions
+        for protocol, and their explanations.
+
+        Args:
+          conn: ServConnection of the client
+
+        Returns:
+          True: keep the link open
+          False: the client terminated the link
+
+        Raises:
+          socket.error: ManifestServ Prerequest Protocol Error:key
+          socket.error: ManifestServ Prerequest Protocol Error:size
+          socket.error: ManifestServ Protocol Error
+          socket.error: ManifestServ Protocol Error:batch
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        inbuf = conn.inbuf
+        while (True):
+            if (conn.state == ServConnection.PRE_REQUEST):
+                if (not inbuf):
+                    return True
+                if (inbuf[0:1] == SocketServProtocol.TERM_LINK.encode()):
+                    if (self.socket_debug):
+                        print("termination requested")
+                    return False
+                if (len(inbuf) < SocketServProtocol.PRE_REQ_SIZE):
+                    return True
+                pre_request = \
+                    inbuf[:SocketServProtocol.PRE_REQ_SIZE].decode()
+                del inbuf[:SocketServProtocol.PRE_REQ_SIZE]
+
+                # Version 2 client asking whether batches can be sent.
+                if (pre_request == SocketServProtocol.VERSION_REQ):
+                    if (self.socket_debug):
+                        print("Protocol version " +
+                              SocketServProtocol.PROTOCOL_VERSION +
+                              " agreed on")
+                    conn.outbuf += \
+                        SocketServProtocol.PROTOCOL_VERSION.encode()
+                    continue
+
+                if (pre_request[0] == SocketServProtocol.BATCH_REQ):
+                    conn.state = ServConnection.BATCH
+                elif (pre_request[0] in ("0", "1")):
+                    conn.is_key = (pre_request[0] == "1")
+                    conn.state = ServConnection.REQUEST
+                else:
+                    raise socket.error(errno.EPROTO, "ManifestServ " +
+                                         "Prerequest Protocol Error:key")
+                try:
+                    conn.size = int(pre_request[2:SocketServProtocol.
+                                    PRE_REQ_SIZE])
+                except ValueError:
+                    raise socket.error(errno.EPROTO, "ManifestServ " +
+                                         "Prerequest Protocol Error:size")
+                if (self.socket_debug):
+                    print(("Prerequest received: batch is " +
+                           str(conn.state == ServConnection.BATCH) +
+                           ", key is " + str(conn.is_key) +
+                           " and size = " + str(conn.size)))
+
+                # Version 1 requests wait for the prerequest ack.
+                if (conn.state == ServConnection.REQUEST):
+                    conn.outbuf += SocketServProtocol.PRE_REQ_ACK.encode()
+
+            elif (conn.state == ServConnection.REQUEST):
+                if (len(inbuf) < conn.size):
+                    return True
+                request = inbuf[:conn.size].decode().strip()
+                del inbuf[:conn.size]
+                values = self.__answer_request(request, conn.is_key)
+
+                # Send the count and size first, and the results once
+                # the client acknowledges them.  In the case of found
+                # results, calculate the results string first to get
+                # the size.
+                results = ""
+                for value in values:
+
+                    # Handle "empty string" results.
+                    if (value == ""):
+                        value = SocketServProtocol.EMPTY_STR
+
+                    # Concatenate results into single string
+                    results += (value + SocketServProtocol.STRING_SEP)
+
+                if values:
+                    # Protocol results terminator.
+                    results += SocketServProtocol.REQ_COMPLETE
+
+                conn.outbuf += (str(len(values)) + "," +
+                                str(len(results))).encode()
+                conn.results = results.encode()
+                conn.state = ServConnection.PARAMS
+
+            elif (conn.state == ServConnection.PARAMS):
+                if (not inbuf):
+                    return True
+                if (inbuf[0:1] !=
+                    SocketServProtocol.RECV_PARAMS_RECVD.encode()):
+                    raise socket.error(errno.EPROTO,
+                                         "ManifestServ Protocol Error")
+                del inbuf[:1]
+                conn.outbuf += conn.results
+                conn.results = b""
+                conn.state = ServConnection.PRE_REQUEST
+
+            else:    # ServConnection.BATCH
+                if (len(inbuf) < conn.size):
+                    return True
+                batch = bytes(inbuf[:conn.size])
+                del inbuf[:conn.size]
+                conn.outbuf += self.__batch_reply(batch)
+                conn.state = ServConnection.PRE_REQUEST
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    def __serve(self, srvsock):
+    def __serve(self, selector, conn, events):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        """ Private method invoked by thread used to process client requests
-    
+        """ Private method.  Service a client whose socket is ready.
+
         Catches all socket exceptions so server keeps running to
         process other clients even if a particular client had a problem.
-    
+        Closes the client's socket when the client is done or failed.
+
         Args:
-          srvsock: socket used to process a set of client requests.
-              Note that this socket is assumed already opened.
-    
+          selector: selector the client's socket is registered with
+
+          conn: ServConnection of the client
+
+          events: selector events the socket is ready for
+
         Returns: None
-    
+
         Raises: None
 
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        if (self.socket_debug):
-            print("Starting new serve thread")
-
-        # Process client requests.  Eat all exceptions, some of
-        # which can come in somewhat expectedly (as when a
-        # client terminates).
-        # Pylint bug: See http://www.logilab.org/ticket/8764
-        # pylint: disable-msg=C0321
+        # Eat all exceptions, some of which can come in somewhat
+        # expectedly (as when a client terminates).
+        keep_open = True
         try:
-            self.__process_srvr_requests(srvsock)
+            if (events & selectors.EVENT_READ):
+                data = conn.sock.recv(ServConnection.RECV_SIZE)
+                if (data):
+                    conn.inbuf += data
+                    keep_open = self.__process_client_input(conn)
+                else:
+                    keep_open = False
+            if (keep_open and conn.outbuf):
+                sent = conn.sock.send(conn.outbuf)
+                del conn.outbuf[:sent]
+        except BlockingIOError:
+            pass
         except socket.error as err:
             if (err.args[0] != errno.EPIPE):
                 print("Exception in socket serve:", file=sys.stderr)
                 print(str(err), file=sys.stderr)
             elif (self.socket_debug):
                 print("Socket closed")
+            keep_open = False
 
-        # Always close the socket when done with it.
-        finally:
-            srvsock.close()
+        if (not keep_open):
+            selector.unregister(conn.sock)
+            conn.sock.close()
+            if (self.socket_debug):
+                print("Closed client connection")
+            return
 
-        if (self.socket_debug):
-            print("Terminating client-specific server thread")
+        # Only ask to hear about writability while there is output.
+        if (conn.outbuf):
+            selector.modify(conn.sock,
+                            selectors.EVENT_READ | selectors.EVENT_WRITE,
+                            conn)
+        else:
+            selector.modify(conn.sock, selectors.EVENT_READ, conn)
 
 
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     def __socket_server_main(self):
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        """ Initialize and start the socket server.  Wait for clients.
-    
+        """ Initialize and start the socket server.  Serve clients.
+
+        A single thread serves all clients, multiplexing their sockets
+        with a selector.  Requests are short, so no client waits long
+        behind another, and there is no lock or thread per client.
+
         Args: None
-    
+
         Returns: None
-    
+
         Raises: None
-            (However, it reports errors when setting up socket.)          
-    
+            (However, it reports errors when setting up socket.)
+
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
@@ -858,30 +1151,49 @@ class ManifestServ(object):
             print(str(err), file=sys.stderr)
             return
 
+        selector = selectors.DefaultSelector()
+        selector.register(self.listen_sock, selectors.EVENT_READ, None)
+
         # Take a lock - we are starting accepting requests
         self.lock.acquire()
 
-        # Now wait for clients.  Start a new thread for each client.
+        # Now wait for clients, and for requests from connected clients.
         while (self.server_run):
             try:
-                srvsock, addr = self.listen_sock.accept()
-                del addr
+                ready = selector.select()
             except KeyboardInterrupt:
                 break
-            except socket.error as err:
-                print("Error accepting new connection", file=sys.stderr)
-                print(str(err), file=sys.stderr)
-                continue
 
-            # stop_socket_server() clears this flag when it's time to stop.
-            if (not self.server_run):
-                break
-            try:
-                _thread.start_new_thread(self.__serve, (srvsock, ))
-            except _thread.error as err:
-                print("Error starting new connection thread:", file=sys.stderr)
-                print(str(err), file=sys.stderr)
-       
+            for (key, events) in ready:
+                if (key.data is not None):
+                    self.__serve(selector, key.data, events)
+                    continue
+
+                try:
+                    srvsock, addr = self.listen_sock.accept()
+                    del addr
+                except socket.error as err:
+                    print("Error accepting new connection", file=sys.stderr)
+                    print(str(err), file=sys.stderr)
+                    continue
+
+                # stop_socket_server() clears this flag when it's time
+                # to stop.
+                if (not self.server_run):
+                    srvsock.close()
+                    break
+                if (self.socket_debug):
+                    print("Accepted new client connection")
+                srvsock.setblocking(False)
+                selector.register(srvsock, selectors.EVENT_READ,
+                                  ServConnection(srvsock))
+
+        # Drop clients still connected.
+        for key in list(selector.get_map().values()):
+            if (key.data is not None):
+                key.data.sock.close()
+        selector.close()
+
         # Release lock - this will let stop_socket_server() know that we
         # have finished
-        self.lock.release()  
+        self.lock.release()
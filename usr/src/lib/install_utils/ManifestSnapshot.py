@@ -0,0 +1,329 @@
+#!/usr/bin/python3.9
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+ManifestSnapshot.py - Flat, memory-mapped snapshot of manifest values
+
+A ManifestServ can export the values of its (defaulted and validated)
+manifest once into a snapshot file, which clients then read without
+talking to the server.  The snapshot holds the values of every plain
+nodepath (no values in brackets, no "..") which finds anything, and of
+every key in the key_value_pairs section.  Other requests have to go to
+the server.
+
+File layout (all integers are unsigned 32 bit, big-endian):
+
+	SNAPSHOT_MAGIC
+	process ID of the writer
+	number of entries
+	entry index, sorted by name: name offset, name length,
+	    value offset, value length
+	string area
+
+Names are "E" + nodepath (relative to the root), "K" + key, or "R" for the
+entry holding the name of the root element.  Values are the strings
+get_values() returns for the request, each followed by
+SocketServProtocol.STRING_SEP.
+
+A server which exports a snapshot next to its socket holds a lock on it
+for as long as it serves, so a snapshot left behind by a server which
+died is recognized as stale (see ManifestSnapshot.is_live()).
+"""
+# =============================================================================
+# =============================================================================
+
+import errno
+import fcntl
+import mmap
+import os
+import struct
+
+import osol_install.SocketServProtocol as SocketServProtocol
+
+SNAPSHOT_MAGIC = b"MFSNAP02"
+SNAPSHOT_SUFFIX = ".snap"
+
+# Prefixes of entry names.
+NODEPATH_ENTRY = "E"
+KEY_ENTRY = "K"
+ROOT_ENTRY = "R"
+
+HEADER = struct.Struct(">8sII")
+INDEX_ENTRY = struct.Struct(">IIII")
+
+# =============================================================================
+class ManifestSnapshotError(Exception):
+# =============================================================================
+    """Exception for snapshot files which can't be read."""
+    pass
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def write_snapshot(snapshot_name, root_name, nodepath_values, key_values,
+                   lock=False):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Write a snapshot file.
+
+    The file is written under a temporary name and renamed into place, so
+    readers never see a partial snapshot.  With lock, the file is locked
+    before it is renamed, so it is never in place without the lock.
+
+    Args:
+      snapshot_name: name of the file to write
+
+      root_name: name of the manifest's root element
+
+      nodepath_values: dictionary of plain nodepaths, relative to the
+        root, to the lists of values get_values() returns for them.
+
+      key_values: dictionary of keys to their lists of values.
+
+      lock: boolean: if True, keep the file open and locked.  The lock
+        lasts until the returned file is closed or this process exits.
+
+    Returns:
+      The locked file, with lock
+      None: otherwise
+
+    Raises:
+      IOError, OSError: Error writing the file
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    entries = [(ROOT_ENTRY, [root_name])]
+    for (nodepath, values) in nodepath_values.items():
+        entries.append((NODEPATH_ENTRY + nodepath, values))
+    for (key, values) in key_values.items():
+        entries.append((KEY_ENTRY + key, values))
+
+    encoded = []
+    for (name, values) in entries:
+        encoded.append((name.encode(),
+                        "".join([value + SocketServProtocol.STRING_SEP
+                                 for value in values]).encode()))
+    encoded.sort()
+
+    index = []
+    strings = []
+    offset = HEADER.size + (INDEX_ENTRY.size * len(encoded))
+    for (name, value) in encoded:
+        index.append(INDEX_ENTRY.pack(offset, len(name),
+                                      offset + len(name), len(value)))
+        strings.append(name)
+        strings.append(value)
+        offset += len(name) + len(value)
+
+    tmp_name = "%s.%d" % (snapshot_name, os.getpid())
+    snap_file = open(tmp_name, "w+b")
+    try:
+        snap_file.write(HEADER.pack(SNAPSHOT_MAGIC, os.getpid(),
+                                    len(encoded)))
+        snap_file.write(b"".join(index))
+        snap_file.write(b"".join(strings))
+        snap_file.flush()
+        if (lock):
+            fcntl.lockf(snap_file.fileno(), fcntl.LOCK_EX)
+        os.rename(tmp_name, snapshot_name)
+    except (IOError, OSError):
+        snap_file.close()
+        try:
+            os.unlink(tmp_name)
+        except OSError:
+            pass
+        raise
+
+    if (not lock):
+        snap_file.close()
+        return None
+    return snap_file
+
+
+# =============================================================================
+class ManifestSnapshot(object):
+# =============================================================================
+    """ Read-only access to a snapshot file.
+
+    The file is mapped into memory and entries are found by binary search
+    of the index, so opening a snapshot costs the same however large the
+    manifest is.
+
+    """
+# =============================================================================
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __init__(self, snapshot_name):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Constructor.  Map the snapshot file.
+
+        Args:
+          snapshot_name: name of the snapshot file.
+
+        Raises:
+          IOError, OSError: Error opening the file
+          ManifestSnapshotError: The file isn't a snapshot
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        self.snapshot_name = snapshot_name
+        with open(snapshot_name, "rb") as snap_file:
+            self.snap_stat = os.fstat(snap_file.fileno())
+            try:
+                self.snap = mmap.mmap(snap_file.fileno(), 0,
+                                      access=mmap.ACCESS_READ)
+            except (ValueError, mmap.error):
+                raise ManifestSnapshotError("Empty snapshot file " +
+                                            snapshot_name)
+
+        if (len(self.snap) < HEADER.size):
+            raise ManifestSnapshotError("Bad snapshot file " + snapshot_name)
+        (magic, self.owner_pid, self.count) = HEADER.unpack_from(self.snap, 0)
+        if ((magic != SNAPSHOT_MAGIC) or
+            (len(self.snap) < HEADER.size + INDEX_ENTRY.size * self.count)):
+            raise ManifestSnapshotError("Bad snapshot file " + snapshot_name)
+
+        root_values = self.__find(ROOT_ENTRY.encode())
+        if (not root_values):
+            raise ManifestSnapshotError("Bad snapshot file " + snapshot_name)
+        self.root_name = root_values[0]
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def is_live(self):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Check that the server which exported the snapshot still
+        serves it.
+
+        The server holds a lock on the snapshot while it serves.  The lock
+        goes away with the server, even if it dies without removing the
+        snapshot, and a server which starts later with the same socket
+        name writes a new file, so a snapshot is live only if the mapped
+        file is still in place and its lock is held.
+
+        Args: None
+
+        Returns:
+          True: the snapshot is in place and locked by its server
+          False: the snapshot is stale
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        # A process doesn't conflict with its own locks, and testing one
+        # would release it when the file is closed.
+        if (self.owner_pid == os.getpid()):
+            return True
+
+        try:
+            with open(self.snapshot_name, "rb") as snap_file:
+                snap_stat = os.fstat(snap_file.fileno())
+                if ((snap_stat.st_dev != self.snap_stat.st_dev) or
+                    (snap_stat.st_ino != self.snap_stat.st_ino)):
+                    return False
+                try:
+                    fcntl.lockf(snap_file.fileno(),
+                                fcntl.LOCK_SH | fcntl.LOCK_NB)
+                except (IOError, OSError) as err:
+                    if (err.errno in (errno.EACCES, errno.EAGAIN)):
+                        return True
+                    raise
+        except (IOError, OSError):
+            pass
+        return False
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __find(self, name):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Binary search the index for an entry.
+
+        Args:
+          name: entry name, as bytes
+
+        Returns:
+          list of values of the entry
+          None: no such entry
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        low = 0
+        high = self.count
+        while (low < high):
+            mid = (low + high) // 2
+            (name_off, name_len, value_off, value_len) = \
+                INDEX_ENTRY.unpack_from(self.snap,
+                                        HEADER.size + INDEX_ENTRY.size * mid)
+            mid_name = self.snap[name_off:name_off + name_len]
+            if (mid_name < name):
+                low = mid + 1
+            elif (mid_name > name):
+                high = mid
+            else:
+                value = self.snap[value_off:value_off + value_len].decode()
+                return value.split(SocketServProtocol.STRING_SEP)[:-1]
+        return None
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def lookup(self, request, is_key=False):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Return the values of a request, if the snapshot can answer it.
+
+        Args:
+          request: nodepath or key, as for ManifestRead.get_values()
+
+          is_key: boolean: if True, request is a key.
+
+        Returns:
+          list of values for the request (empty if nothing matches)
+          None: the snapshot doesn't cover this kind of request.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        request = request.strip()
+        if (is_key):
+            values = self.__find((KEY_ENTRY + request).encode())
+            if (values is None):
+                return []
+            return values
+
+        # Only plain nodepaths are in the snapshot.
+        for special in ("[", "]", "=", "\"", ".."):
+            if (special in request):
+                return None
+
+        # As with find_node(), the root element's name is optional.
+        parts = request.split("/")
+        if (parts[0] == self.root_name):
+            parts = parts[1:]
+        values = self.__find((NODEPATH_ENTRY + "/".join(parts)).encode())
+        if (values is None):
+            return []
+        return values
+
@@ -36,6 +36,11 @@ SocketServProtocol.py: Public definitions for Socket Server protocol.
 
 PRE_REQ_SIZE = 8
 
+# The size field holds six digits, so no request (or batch of requests, see
+# below) can be bigger than MAX_REQ_SIZE bytes.
+
+MAX_REQ_SIZE = 999999
+
 # Next, server sends PRE_REQ_ACK.  Then client can send the request.
 
 PRE_REQ_ACK = '\001'
@@ -91,6 +96,38 @@ STRING_SEP = '\0'
 # 
 # - - - - -
 #
+# Version 2 of the protocol sends any number of requests in one message and
+# gets all their results back in one reply.  A client which wants it sends
+# VERSION_REQ in place of a prerequest.  A version 2 server answers with the
+# single character PROTOCOL_VERSION.  (A version 1 server drops the link, as
+# VERSION_REQ isn't a valid prerequest; the client then reconnects and uses
+# version 1.)  Once version 2 is agreed on, version 1 prerequests are still
+# accepted on the same link.
+#
+# Client->server: VERSION_REQ
+# Server->client: PROTOCOL_VERSION
+# Client->server: Batch prerequest: BATCH_REQ in byte 0, byte 1 blank, then
+#	the size of the batch in bytes (as for the version 1 prerequest),
+#	followed immediately by the batch.  The batch is the requests,
+#	each preceded by "0" (not key) or "1" (key), with STRING_SEP after
+#	each.  A client with more than MAX_REQ_SIZE bytes of requests
+#	sends them as several batches.
+# Server->client: The size of the reply in bytes, as BATCH_SIZE_LEN
+#	digits, followed immediately by the reply.  For each request, in
+#	order, the reply holds the count of values found and then the
+#	values, each followed by STRING_SEP.  EMPTY_STR stands in for
+#	empty strings.  A bad request has no values.  REQ_COMPLETE ends the
+#	reply.
+# Client->server: Another request, or TERM_LINK is sent.
+
+PROTOCOL_VERSION = '2'
+VERSION_REQ = 'V 000002'
+BATCH_REQ = 'B'
+BATCH_SIZE_LEN = 10
+
+#
+# - - - - -
+#
 # The manifest schema defines the path to key/value pairs.
 # Both the client and server have methods which can translate a key into the
 # right nodepath to fetch that key's value(s) from the manifest.  KEY_PATH is
@@ -105,3 +142,33 @@ STRING_SEP = '\0'
 #	</key_value_pairs>
 #
 KEY_PATH = "key_value_pairs/pair[key=%s]/value"
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def recv_exact(sock, size):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Receive exactly size bytes from sock.
+
+    Args:
+      sock: connected socket
+
+      size: number of bytes to receive
+
+    Returns:
+      The bytes received.  Fewer than size bytes are returned only if the
+        other end closed the link.
+
+    Raises:
+      Exceptions raised by socket recv()
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    chunks = []
+    remaining = size
+    while (remaining > 0):
+        chunk = sock.recv(remaining)
+        if (not chunk):
+            break
+        chunks.append(chunk)
+        remaining -= len(chunk)
+    return b"".join(chunks)
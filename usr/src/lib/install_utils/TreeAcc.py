@@ -31,11 +31,10 @@ TreeAcc.py - XML DOM tree access and manipulation module
 import errno
 
 from xml.dom import Node
-from xml.dom import minidom
-from xml.dom import DOMException
 from xml.parsers.expat import ExpatError
+from osol_install import CompactTree
 from osol_install.ENParser import ENToken
-from osol_install.ENParser import parse_nodepath
+from osol_install.ENParser import compile_nodepath
 from osol_install.ENParser import ParserError
 
 # =============================================================================
@@ -252,7 +251,10 @@ class TreeAccNode:
 
         if (self.is_attr()):
             return True
-        return (self.__element_node.getElementsByTagName("*").length == 0)
+        for child in self.__element_node.childNodes:
+            if (child.nodeType == Node.ELEMENT_NODE):
+                return False
+        return True
 
     def is_attr(self):
         """ Return True or False that this node represents an ATTRIBUTE. """
@@ -370,8 +372,12 @@ class TreeAcc:
     middle, add new elements and attributes, replace values of existing
     elements and attributes, and saving the tree in an XML document.
 
-    The underlying DOM tree is created when an instance of this class is
-    instantiated.
+    The underlying DOM tree, a CompactTree, is created when an instance of
+    this class is instantiated.  An index from element path to the
+    elements at that path is built along with it, so that searches don't
+    have to walk the tree from the root.  add_node() keeps the index
+    current; the DOM tree must not be changed other than through this
+    class.
 
     """
 # =============================================================================
@@ -403,10 +409,8 @@ class TreeAcc:
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         attr_dict = {}
-        attr_map = element_node.attributes
-        for i in range(attr_map.length):
-            attr_node = attr_map.item(i)
-            attr_dict[attr_node.nodeName] = attr_node.nodeValue.strip()
+        for (name, value) in element_node.attributes.items():
+            attr_dict[name] = value.strip()
         return attr_dict
 
 
@@ -506,20 +510,32 @@ class TreeAcc:
 
         # Read file into memory.
         try:
-            self.treedoc = minidom.parse(xml_file.strip())
+            self.treedoc = CompactTree.parse(xml_file.strip())
         except IOError as err:
             raise TreeAccError("Error opening xml file %s: %s" %
                                 (xml_file.strip(), errno.errorcode[err.errno]))
-        except (DOMException, ExpatError) as err:
+        except ExpatError as err:
             raise TreeAccError("Error parsing xml file %s" %
                                  (xml_file.strip()))
 
         # Save root document element.
         self.treeroot = self.treedoc.documentElement
 
+        # Count of changes made through add_node() and replace_value()
+        # (not counting replacements with the same value).  Lets callers
+        # tell whether the tree differs from xml_file.
+        self.changes = 0
+
+        # Element path index: path from the root (inclusive) to lists of
+        # DOM elements at that path, in document order.  Element values
+        # are cached as they are looked up.
+        self.__path_index = {}
+        self.__value_cache = {}
+        self.__build_path_index()
+
         # Create a TreeAccNode representation of the root element.
         # It will be used as a default for find_node() and other methods
-        value = TreeAcc.__get_element_value(self.treeroot)
+        value = self.__element_value(self.treeroot)
         attrs = TreeAcc.__create_attr_dict(self.treeroot)
         self.treeroot_ta_node = TreeAccNode(self.treeroot.nodeName,
                                             TreeAccNode.ELEMENT, value, attrs,
@@ -560,7 +576,7 @@ class TreeAcc:
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
         try:
-            return self.__find_node_w_pathlist(parse_nodepath(path),
+            return self.__find_node_w_pathlist(compile_nodepath(path),
                                                starting_ta_node)
         except ParserError as err:
             raise BadNodepathError("Error parsing nodepath: " + str(err))
@@ -620,6 +636,11 @@ class TreeAcc:
             # Note whether ".." is part of the path.
             pathlist_has_dots = self.__pathlist_has_dots(path_tokens)
 
+            # Without "..", resolve the path level by level, starting
+            # from the index.
+            if (not pathlist_has_dots):
+                return self.__search_indexed(path_tokens)
+
             # Actual searching uses DOM tree elements.
             # No searching on an attribute is necessary here, since
             # beginning will always be the root element.
@@ -645,6 +666,9 @@ class TreeAcc:
             # Note whether ".." is part of the path.
             pathlist_has_dots = self.__pathlist_has_dots(path_tokens)
 
+            if (not pathlist_has_dots):
+                return self.__search_levels([start_node], path_tokens)
+
             #__search_node requires the first path token match the
             # starting node.  At this point starting_node is the
             # parent of the node represented by path_tokens[0].
@@ -677,22 +701,117 @@ class TreeAcc:
         # Chances are, though, that paths with ".." in them will be few
         # and far between, and that they will be for starting mid-tree
         # searches and so won't return many nodes.
+        #
+        # Of duplicates, the last one found is kept.  TreeAccNodes are
+        # equal when they share DOM element and type, which is what
+        # the key below captures.
         if (pathlist_has_dots):
-            i = len(found_nodes) - 1
-            while (i > 0):	# Don't need to check element 0
+            seen = set()
+            unique_nodes = []
+            for check_node in reversed(found_nodes):
+                key = (id(check_node.get_element_node()),
+                       check_node.is_element())
+                if (key not in seen):
+                    seen.add(key)
+                    unique_nodes.append(check_node)
+            unique_nodes.reverse()
+            found_nodes = unique_nodes
 
-                # Search backwards looking for duplicates.
-                check_node = found_nodes[i]
-                count = found_nodes.count(check_node)
+        return found_nodes
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __search_indexed(self, path_tokens):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private.  Search from the root for a path without "..".
 
-                # Remove count-1 nodes
-                j = 1
-                while (j < count):
-                    # This removes the lower indexed dup.
-                    found_nodes.remove(check_node)
-                    j += 1
-                i -= count	# Decr one beyond number removed
+        Leading path tokens which are plain names (no values) are looked
+        up in the path index in one step.  The rest of the path is
+        resolved level by level by __search_levels().  The last token is
+        always resolved from its parents, since it can name an attribute
+        of a parent which has no child element by that name.
 
+        Args:
+          path_tokens: list of ENTokens, starting with the root element's.
+
+        Returns:
+          List of TreeAccNodes found, in document order.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        num_plain = 0
+        while ((num_plain < len(path_tokens) - 1) and
+               (len(path_tokens[num_plain].values) == 0)):
+            num_plain += 1
+
+        if (num_plain == 0):
+            # The root token itself carries a value to match.
+            if (self.__match(path_tokens[0], self.treeroot,
+                             Node.ELEMENT_NODE) is None):
+                return []
+            if (len(path_tokens) == 1):
+                return [self.get_treeaccnode_from_element(self.treeroot)]
+            return self.__search_levels([self.treeroot], path_tokens[1:])
+
+        key = "/".join([token.name for token in path_tokens[:num_plain]])
+        return self.__search_levels(self.__path_index.get(key, []),
+                                    path_tokens[num_plain:])
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __search_levels(self, parents, path_tokens):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private.  Breadth-first equivalent of __search_node() for paths
+        without "..".
+
+        Args:
+          parents: DOM elements whose children path_tokens[0] refers to,
+                in document order.
+
+          path_tokens: list of ENTokens without "..".  Not changed.
+
+        Returns:
+          List of TreeAccNodes found, in document order.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        last = len(path_tokens) - 1
+        for level in range(last):
+            token = path_tokens[level]
+            children = []
+            for parent in parents:
+                for child in parent.childNodes:
+                    if ((child.nodeType == Node.ELEMENT_NODE) and
+                        (self.__match(token, child,
+                                      Node.ELEMENT_NODE) is not None)):
+                        children.append(child)
+            if (len(children) == 0):
+                return []
+            parents = children
+
+        # As in __search_node(), the last token names an attribute of a
+        # parent only if no child element of that parent matches it.
+        token = path_tokens[last]
+        found_nodes = []
+        for parent in parents:
+            num_found = len(found_nodes)
+            for child in parent.childNodes:
+                if ((child.nodeType == Node.ELEMENT_NODE) and
+                    (self.__match(token, child,
+                                  Node.ELEMENT_NODE) is not None)):
+                    found_nodes.append(
+                        self.get_treeaccnode_from_element(child))
+            if ((len(found_nodes) == num_found) and
+                (self.__match(token, parent,
+                              Node.ATTRIBUTE_NODE) is not None)):
+                attr_value = parent.getAttributeNode(token.name).nodeValue
+                found_nodes.append(TreeAccNode(token.name,
+                                   TreeAccNode.ATTRIBUTE, attr_value,
+                                   {token.name: attr_value}, parent, self))
         return found_nodes
 
 
@@ -777,7 +896,7 @@ class TreeAcc:
 
         elif (node_type == Node.ELEMENT_NODE):
 
-            value = self.__get_element_value(curr_node)
+            value = self.__element_value(curr_node)
 
             # Save if want all values, or if want a
             # specific value and node value matches.
@@ -848,7 +967,7 @@ class TreeAcc:
         if (node_type == TreeAccNode.ELEMENT):
             if (curr_node.nodeName != token.name):
                 return None
-            chk_value = self.__get_element_value(curr_node)
+            chk_value = self.__element_value(curr_node)
         else:
             attr_node = curr_node.getAttributeNode(token.name)
             if (attr_node is None):
@@ -901,7 +1020,7 @@ class TreeAcc:
 
             cmp_match = False
             vp_matches = []
-            path_tokens = parse_nodepath(valpaths[i])
+            path_tokens = compile_nodepath(valpaths[i])
 
             # Eat any next tokens with ".."
             # If run out of tokens, append the element ended up at,
@@ -1014,7 +1133,7 @@ class TreeAcc:
 
         # Path tokens list exhausted.  Add current node to found_nodes.
         if (len(path_tokens) == 0):
-            value = self.__get_element_value(curr_node)
+            value = self.__element_value(curr_node)
             if ((search_value is None) or (value == search_value)):
                 attrs = TreeAcc.__create_attr_dict(curr_node)
                 found_nodes.append(TreeAccNode(curr_node.nodeName,
@@ -1054,7 +1173,7 @@ class TreeAcc:
 
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        path_tokens = parse_nodepath(path)
+        path_tokens = compile_nodepath(path)
 
         # Search for the target.
         matches = self.__find_node_w_pathlist(path_tokens, starting_ta_node)
@@ -1079,6 +1198,9 @@ class TreeAcc:
 
             # Change the attribute value.
             # The last branch of the path is the attribute name.
+            if (element_node.getAttribute(path_tokens[-1].name) !=
+                new_value):
+                self.changes += 1
             element_node.setAttribute(path_tokens[-1].name, new_value)
 
         # Element.
@@ -1145,7 +1267,7 @@ class TreeAcc:
                 raise InvalidArgError("add_node: is_unique must be True " +
                                         "when adding attributes")
 
-        path_tokens = parse_nodepath(path)
+        path_tokens = compile_nodepath(path)
         if (len(path_tokens) == 0):
             raise InvalidArgError((
                                     "add_node: provided path is empty"))
@@ -1222,6 +1344,7 @@ class TreeAcc:
             parent_element = matches[0].get_element_node()
 
         # Add the new node and return a new TreeAccNode.
+        self.changes += 1
         if (node_type == TreeAccNode.ATTRIBUTE):
             # Note: parent_element here means the (element) node
             # corresponding to the parent path.  The attribute will
@@ -1239,6 +1362,7 @@ class TreeAcc:
             if (value is not None):
                 new_text = self.treedoc.createTextNode(value)
                 new_element.appendChild(new_text)
+            self.__index_element(new_element)
             return TreeAccNode(new_name, TreeAccNode.ELEMENT, value,
                                {}, new_element, self)
 
@@ -1400,7 +1524,7 @@ class TreeAcc:
 
         # Build the TreeAccNode to return and return it
         name = element_node.nodeName
-        value = TreeAcc.__get_element_value(element_node)
+        value = self.__element_value(element_node)
         attrs = TreeAcc.__create_attr_dict(element_node)
         return TreeAccNode(name, TreeAccNode.ELEMENT, value, attrs,
                            element_node, self)
@@ -1472,9 +1596,126 @@ class TreeAcc:
 
         """
     # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        self.__value_cache.pop(element_node, None)
         for child in element_node.childNodes:
             if (child.nodeType == Node.TEXT_NODE):
+                if (child.nodeValue != new_value):
+                    self.changes += 1
                 child.nodeValue = new_value
                 return
+        self.changes += 1
         new_text = self.treedoc.createTextNode(new_value)
         element_node.appendChild(new_text)
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __element_value(self, element_node):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Cached front end to __get_element_value().
+
+        Args:
+          element_node: The node to get the associated value.
+
+        Returns:
+          The string value of the element.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        try:
+            return self.__value_cache[element_node]
+        except KeyError:
+            value = TreeAcc.__get_element_value(element_node)
+            self.__value_cache[element_node] = value
+            return value
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    @staticmethod
+    def __element_path(element_node):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Return the path index key of an element: the
+        names of the elements from the root down to it, "/" separated.
+
+        Args:
+          element_node: DOM element node
+
+        Returns:
+          Path string, starting with the root element's name.
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        names = []
+        curr_node = element_node
+        while ((curr_node is not None) and
+               (curr_node.nodeType == Node.ELEMENT_NODE)):
+            names.append(curr_node.nodeName)
+            curr_node = curr_node.parentNode
+        names.reverse()
+        return "/".join(names)
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __build_path_index(self):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Index every element of the tree by its path.
+
+        Args: None
+
+        Returns: N/A
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        self.__path_index = {}
+
+        # Depth first, in document order.
+        stack = [(self.treeroot, self.treeroot.nodeName)]
+        while stack:
+            (element_node, path) = stack.pop()
+            self.__path_index.setdefault(path, []).append(element_node)
+            children = [child for child in element_node.childNodes
+                        if (child.nodeType == Node.ELEMENT_NODE)]
+            for child in reversed(children):
+                stack.append((child, path + "/" + child.nodeName))
+
+
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    def __index_element(self, element_node):
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        """ Private method.  Add a new, childless element to the path index.
+
+        The element has just been appended to its parent, so it goes
+        after the elements at the same path under the same parent or
+        under parents earlier in the document.
+
+        Args:
+          element_node: DOM element node just added to the tree.
+
+        Returns: N/A
+
+        Raises: None
+
+        """
+    # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+        parent = element_node.parentNode
+        parent_path = TreeAcc.__element_path(parent)
+        entries = self.__path_index.setdefault(
+            parent_path + "/" + element_node.nodeName, [])
+
+        parent_rank = {}
+        for rank, indexed_parent in enumerate(
+            self.__path_index.get(parent_path, [])):
+            parent_rank[id(indexed_parent)] = rank
+        my_rank = parent_rank[id(parent)]
+
+        pos = len(entries)
+        while ((pos > 0) and
+               (parent_rank.get(id(entries[pos - 1].parentNode), -1) >
+                my_rank)):
+            pos -= 1
+        entries.insert(pos, element_node)
@@ -24,6 +24,8 @@
 """ Module body for osol_install package
 """
 
-__all__ = ["DefValProc", "ENParser", "TreeAcc", "install_utils", "finalizer",
-    "ManifestServ", "ManifestRead", "SocketServProtocol",
+__all__ = ["DefValProc", "ENParser", "CompactTree", "TreeAcc", "install_utils",
+    "finalizer", "iotrace", "lsjournal", "ManifestServ", "ManifestRead",
+    "ManifestSnapshot", "progress_ring",
+    "SocketServProtocol",
     "PasswordFile", "UserattrFile"]
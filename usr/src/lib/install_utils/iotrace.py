@@ -0,0 +1,572 @@
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+# =============================================================================
+# =============================================================================
+"""
+iotrace - Boot I/O trace analysis and media layout optimization.
+
+Traces are the "iosnoop -Deg" output captured by the live-io-tracing
+service.  Traces from any number of boots are combined to rank files by
+how early and how consistently they are read, files which are read
+together are grouped, and the result is emitted as an mkisofs sort list.
+A simple seek model compares the proposed layout against a baseline.
+
+The same traces also drive a readahead manifest, which lists the extents
+each boot phase reads in media order so they can be streamed into the
+page cache early in boot (see readahead(1M) in cmd/slim-install).
+"""
+# =============================================================================
+# =============================================================================
+
+import os
+import re
+
+# Lines matching this are dropped from the trace.  This is the list the
+# old proc_tracedata script filtered with.
+DEFAULT_EXCLUDE = "xkblayout|unknown|librt|libm|iosnp|etc|PATHNAME|zlib|" \
+    "sched|dtrace|repository|var|libc|bsnp|sout|devices"
+
+# Only files under this prefix live in solaris.zlib
+DEFAULT_PREFIX = "/usr"
+
+# Files whose first accesses are this many files apart or less are
+# considered to be read together.
+DEFAULT_WINDOW = 5
+
+# Weight given to the first file in the sort list.  mkisofs places files
+# with higher weights first.
+DEFAULT_BASE_WEIGHT = 2000000
+
+# Catch-all sort list entry for everything that wasn't traced
+DEFAULT_CATCHALL = "usr"
+
+# Size assumed for a file when nothing better is known
+MIN_FILE_SIZE = 2048
+
+# Readahead extents are rounded up to this, the default lofi segment size
+READAHEAD_CHUNK = 131072
+
+# Name of the phase before the first phase marker is seen
+DEFAULT_PHASE = "boot"
+
+# iosnoop -Deg field positions: DEVICE DELTA UID PID D BLOCK SIZE PATHNAME ARGS
+(__F_DEVICE, __F_DELTA, __F_UID, __F_PID, __F_DIR, __F_BLOCK, __F_SIZE,
+ __F_PATH, __F_ARGS) = list(range(9))
+
+
+# =============================================================================
+class IOEvent:
+# =============================================================================
+    """ One I/O from a trace. """
+
+    __slots__ = ["seq", "path", "size", "block"]
+
+    def __init__(self, seq, path, size, block):
+        self.seq = seq
+        self.path = path
+        self.size = size
+        self.block = block
+
+
+# =============================================================================
+class BootTrace:
+# =============================================================================
+    """ The filtered I/O events of one boot.
+
+    Attributes:
+      name: name of the trace, usually its filename
+      events: list of IOEvent in trace order
+      order: list of distinct paths in order of first access
+      rank: dictionary of path -> index in order
+      count: dictionary of path -> number of I/Os
+      nbytes: dictionary of path -> number of bytes read
+    """
+
+    def __init__(self, name):
+        self.name = name
+        self.events = []
+        self.order = []
+        self.rank = {}
+        self.count = {}
+        self.nbytes = {}
+
+    # -------------------------------------------------------------------------
+    def add_event(self, path, size, block=0):
+    # -------------------------------------------------------------------------
+        """ Append an I/O to the trace.
+
+        Args:
+          path: file the I/O was done on
+          size: I/O size in bytes
+          block: device block number, if known
+
+        Returns: None
+        """
+        self.events.append(IOEvent(len(self.events), path, size, block))
+        if path not in self.rank:
+            self.rank[path] = len(self.order)
+            self.order.append(path)
+            self.count[path] = 0
+            self.nbytes[path] = 0
+        self.count[path] += 1
+        self.nbytes[path] += size
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def parse_iosnoop(lines, name="trace", prefix=DEFAULT_PREFIX,
+                  exclude=DEFAULT_EXCLUDE, root=None):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Parse "iosnoop -Deg" output into a BootTrace.
+
+    When iosnoop couldn't resolve a pathname it prints "<none>", in
+    which case the first word of the command arguments is used, as
+    that is the program being exec'ed.
+
+    Args:
+      lines: iterable of trace lines
+      name: name to give the trace
+      prefix: only paths starting with this are kept
+      exclude: regular expression; matching lines are dropped.  None
+          disables filtering.
+      root: if not None, the image root used to weed out directories.
+          Paths that don't exist under root are kept.
+
+    Returns: BootTrace
+
+    Raises: None
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    trace = BootTrace(name)
+    excl_re = re.compile(exclude) if exclude else None
+    isdir_cache = {}
+
+    for line in lines:
+        if excl_re is not None and excl_re.search(line):
+            continue
+        fields = line.split()
+        if len(fields) <= __F_PATH or not fields[__F_SIZE].isdigit():
+            continue
+
+        path = fields[__F_PATH]
+        if path == "<none>":
+            if len(fields) <= __F_ARGS:
+                continue
+            path = fields[__F_ARGS]
+        if path.endswith("\\0"):
+            path = path[:-2]
+
+        if not path.startswith(prefix) or path.endswith("/"):
+            continue
+
+        if root is not None:
+            if path not in isdir_cache:
+                isdir_cache[path] = os.path.isdir(os.path.join(root,
+                                                  path.lstrip("/")))
+            if isdir_cache[path]:
+                continue
+
+        block = int(fields[__F_BLOCK]) if fields[__F_BLOCK].isdigit() else 0
+        trace.add_event(path, int(fields[__F_SIZE]), block)
+
+    return trace
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def read_trace(filename, prefix=DEFAULT_PREFIX, exclude=DEFAULT_EXCLUDE,
+               root=None):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Read and parse an iosnoop trace file.  See parse_iosnoop(). """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    with open(filename, "r", errors="replace") as tfile:
+        return parse_iosnoop(tfile, os.path.basename(filename), prefix,
+                             exclude, root)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def read_sort_list(filename):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Read an mkisofs sort list.
+
+    Args:
+      filename: sort list, one "path<whitespace>weight" per line
+
+    Returns: list of absolute paths, in the order mkisofs would lay them
+        out (highest weight first)
+
+    Raises: IOError if the file can't be read
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    entries = []
+    with open(filename, "r") as sfile:
+        for line in sfile:
+            fields = line.split()
+            if len(fields) != 2:
+                continue
+            try:
+                entries.append((-int(fields[1]), len(entries),
+                                "/" + fields[0].lstrip("/")))
+            except ValueError:
+                continue
+    entries.sort()
+    return [entry[2] for entry in entries]
+
+
+# =============================================================================
+class LayoutOptimizer:
+# =============================================================================
+    """ Combine boot traces into an optimized file layout.
+
+    Each file is scored by its normalized first-access position in each
+    boot, counting boots in which it wasn't read at all as "last".  This
+    favors files which are both read early and read on every boot.
+    Files are then grouped: starting from each file in score order, the
+    following files which were read within "window" files of the group
+    in most boots are pulled into the group so they end up adjacent.
+    """
+
+    def __init__(self, window=DEFAULT_WINDOW):
+        self.window = window
+        self.traces = []
+        self.__ranked = None
+        self.__groups = None
+
+    # -------------------------------------------------------------------------
+    def add_trace(self, trace):
+    # -------------------------------------------------------------------------
+        """ Add a BootTrace.  Empty traces are ignored. """
+        if trace.order:
+            self.traces.append(trace)
+            self.__ranked = None
+            self.__groups = None
+
+    # -------------------------------------------------------------------------
+    def score(self, path):
+    # -------------------------------------------------------------------------
+        """ Return the mean normalized first-access position of path. """
+        total = 0.0
+        for trace in self.traces:
+            if path in trace.rank:
+                total += trace.rank[path] / float(len(trace.order))
+            else:
+                total += 1.0
+        return total / len(self.traces)
+
+    # -------------------------------------------------------------------------
+    def frequency(self, path):
+    # -------------------------------------------------------------------------
+        """ Return (boots in which path was read, total I/Os to path). """
+        boots = ios = 0
+        for trace in self.traces:
+            if path in trace.count:
+                boots += 1
+                ios += trace.count[path]
+        return (boots, ios)
+
+    # -------------------------------------------------------------------------
+    def ranked(self):
+    # -------------------------------------------------------------------------
+        """ Return all traced paths, best candidates for early placement
+        first.  Ties are broken by frequency, then by name.
+        """
+        if self.__ranked is None:
+            paths = set()
+            for trace in self.traces:
+                paths.update(trace.order)
+            keys = {}
+            for path in paths:
+                (boots, ios) = self.frequency(path)
+                keys[path] = (self.score(path), -boots, -ios, path)
+            self.__ranked = sorted(paths, key=keys.__getitem__)
+        return self.__ranked
+
+    # -------------------------------------------------------------------------
+    def coaccess(self, path1, path2):
+    # -------------------------------------------------------------------------
+        """ Return the number of boots in which path1 and path2 were first
+        read within window files of each other.
+        """
+        together = 0
+        for trace in self.traces:
+            if path1 in trace.rank and path2 in trace.rank and \
+                abs(trace.rank[path1] - trace.rank[path2]) <= self.window:
+                together += 1
+        return together
+
+    # -------------------------------------------------------------------------
+    def groups(self):
+    # -------------------------------------------------------------------------
+        """ Return the ranked paths partitioned into co-accessed groups. """
+        if self.__groups is not None:
+            return self.__groups
+
+        ranked = self.ranked()
+        quorum = len(self.traces) // 2 + 1
+        lookahead = self.window * 4
+        assigned = set()
+        self.__groups = []
+        for idx, path in enumerate(ranked):
+            if path in assigned:
+                continue
+            group = [path]
+            assigned.add(path)
+            for cand in ranked[idx + 1:idx + 1 + lookahead]:
+                if cand in assigned:
+                    continue
+                if self.coaccess(group[-1], cand) >= quorum:
+                    group.append(cand)
+                    assigned.add(cand)
+            self.__groups.append(group)
+        return self.__groups
+
+    # -------------------------------------------------------------------------
+    def layout(self):
+    # -------------------------------------------------------------------------
+        """ Return the proposed file order. """
+        return [path for group in self.groups() for path in group]
+
+    # -------------------------------------------------------------------------
+    def sort_list(self, base_weight=DEFAULT_BASE_WEIGHT,
+                  catchall=DEFAULT_CATCHALL, preamble=None):
+    # -------------------------------------------------------------------------
+        """ Return the proposed layout as mkisofs sort list lines.
+
+        Args:
+          base_weight: weight of the first file; each following file
+              gets one less.
+          catchall: if not None, a final entry given the next weight
+          preamble: if not None, lines copied verbatim to the top
+
+        Returns: list of lines, each newline-terminated
+        """
+        lines = list(preamble) if preamble else []
+        weight = base_weight
+        for path in self.layout():
+            lines.append("%s\t%d\n" % (path.lstrip("/"), weight))
+            weight -= 1
+        if catchall is not None:
+            lines.append("%s\t%d\n" % (catchall, weight))
+        return lines
+
+    # -------------------------------------------------------------------------
+    def media_order(self, sort_order=None):
+    # -------------------------------------------------------------------------
+        """ Return all traced paths in the order of an image built with a
+        sort list.
+
+        Traced files not in the sort list are placed after it in name
+        order, which is what mkisofs does for unsorted files.
+
+        Args:
+          sort_order: list of paths in sort list order, e.g. from
+              read_sort_list().  None means unsorted (name order).
+
+        Returns: list of paths
+        """
+        paths = set(self.ranked())
+        order = [path for path in (sort_order or []) if path in paths]
+        listed = set(order)
+        order += sorted(path for path in paths if path not in listed)
+        return order
+
+    # -------------------------------------------------------------------------
+    def phases(self, markers=None, order=None):
+    # -------------------------------------------------------------------------
+        """ Assign every traced path to a boot phase.
+
+        A phase starts at the first access of its marker file.  Within
+        each boot a file belongs to the last phase whose marker was read
+        before it; across boots the earliest such phase wins, since
+        reading a file ahead too early is cheaper than too late.
+
+        Args:
+          markers: list of (phase name, marker path) tuples in boot order.
+              Files read before the first marker are in DEFAULT_PHASE.
+          order: list of all traced paths in media order, e.g. from
+              media_order().  None means the proposed layout.
+
+        Returns: list of (phase name, [paths in media order])
+        """
+        names = [DEFAULT_PHASE] + [name for (name, path) in (markers or [])]
+        assigned = {}
+        for trace in self.traces:
+            starts = []
+            for (idx, (name, path)) in enumerate(markers or []):
+                if path in trace.rank:
+                    starts.append((trace.rank[path], idx + 1))
+            starts.sort()
+            for path in trace.order:
+                phase = 0
+                for (start, idx) in starts:
+                    if trace.rank[path] >= start:
+                        phase = idx
+                assigned[path] = min(assigned.get(path, phase), phase)
+
+        if order is None:
+            order = self.layout()
+        result = [(name, []) for name in names]
+        for path in order:
+            result[assigned[path]][1].append(path)
+        return [(name, paths) for (name, paths) in result if paths]
+
+    # -------------------------------------------------------------------------
+    def readahead_manifest(self, markers=None, root=None,
+                           chunk=READAHEAD_CHUNK, order=None):
+    # -------------------------------------------------------------------------
+        """ Return readahead manifest lines.
+
+        The manifest has a "phase <name>" line starting each phase,
+        followed by "<path> <offset> <length>" extent lines in the order
+        the files are laid out on the media.  That is the proposed layout
+        only if the image is built with sort_list(); otherwise order has
+        to give the order of the image.  iosnoop doesn't report
+        offsets within a file, so each file gets one extent from its start
+        covering the most it was read in any boot, rounded up to chunk and
+        capped at the file size when root is given.
+
+        Args:
+          markers: see phases()
+          root: image root used to cap extents at file sizes
+          chunk: extent length granularity
+          order: see phases()
+
+        Returns: list of lines, each newline-terminated
+        """
+        needed = {}
+        for trace in self.traces:
+            for path, nbytes in trace.nbytes.items():
+                needed[path] = max(needed.get(path, 0), nbytes)
+
+        lines = []
+        for (name, paths) in self.phases(markers, order):
+            lines.append("phase %s\n" % name)
+            for path in paths:
+                length = (needed[path] + chunk - 1) // chunk * chunk
+                if root is not None:
+                    try:
+                        length = min(length, os.stat(os.path.join(root,
+                            path.lstrip("/"))).st_size)
+                    except OSError:
+                        pass
+                if length > 0:
+                    lines.append("%s 0 %d\n" % (path, length))
+        return lines
+
+    # -------------------------------------------------------------------------
+    def file_sizes(self, root=None):
+    # -------------------------------------------------------------------------
+        """ Return a dictionary of path -> size for all traced paths.
+
+        The on-disk size under root is used when available, otherwise the
+        largest amount read in any one boot.
+        """
+        sizes = {}
+        for trace in self.traces:
+            for path, nbytes in trace.nbytes.items():
+                sizes[path] = max(sizes.get(path, 0), nbytes, MIN_FILE_SIZE)
+        if root is not None:
+            for path in sizes:
+                try:
+                    sizes[path] = max(os.stat(os.path.join(root,
+                        path.lstrip("/"))).st_size, MIN_FILE_SIZE)
+                except OSError:
+                    pass
+        return sizes
+
+    # -------------------------------------------------------------------------
+    def seek_report(self, baseline=None, root=None):
+    # -------------------------------------------------------------------------
+        """ Model the seeks each boot would incur under the baseline and
+        proposed layouts.
+
+        A seek is counted whenever an I/O moves to a file that isn't the
+        one laid out directly after the previous file; its distance is
+        the gap between the end of the previous file and the start of the
+        new one.  The baseline is laid out as by media_order().
+
+        Args:
+          baseline: list of paths in baseline order, e.g. from
+              read_sort_list().  None means unsorted (name order).
+          root: image root used for file sizes, see file_sizes()
+
+        Returns: report text
+        """
+        sizes = self.file_sizes(root)
+        base_pos = self.__positions(self.media_order(baseline), sizes)
+        opt_pos = self.__positions(self.layout(), sizes)
+
+        lines = ["%-20s %8s %10s %10s %14s %14s\n" % ("BOOT", "IOS",
+            "SEEKS-BASE", "SEEKS-OPT", "DIST-BASE", "DIST-OPT")]
+        totals = [0, 0, 0, 0, 0]
+        for trace in self.traces:
+            (bseeks, bdist) = self.__seeks(trace, base_pos, sizes)
+            (oseeks, odist) = self.__seeks(trace, opt_pos, sizes)
+            row = [len(trace.events), bseeks, oseeks, bdist, odist]
+            totals = [tot + val for tot, val in zip(totals, row)]
+            lines.append("%-20s %8d %10d %10d %14d %14d\n" %
+                         tuple([trace.name[:20]] + row))
+        lines.append("%-20s %8d %10d %10d %14d %14d\n" %
+                     tuple(["total"] + totals))
+        lines.append("Expected seek reduction: %.1f%% of seeks, "
+                     "%.1f%% of seek distance\n" %
+                     (self.__pct(totals[1], totals[2]),
+                      self.__pct(totals[3], totals[4])))
+        return "".join(lines)
+
+    # -------------------------------------------------------------------------
+    @staticmethod
+    def __positions(order, sizes):
+    # -------------------------------------------------------------------------
+        """ Map each path in order to (index, start offset). """
+        positions = {}
+        offset = 0
+        for idx, path in enumerate(order):
+            positions[path] = (idx, offset)
+            offset += sizes[path]
+        return positions
+
+    # -------------------------------------------------------------------------
+    @staticmethod
+    def __seeks(trace, positions, sizes):
+    # -------------------------------------------------------------------------
+        """ Return (seek count, seek distance) of trace under positions. """
+        seeks = distance = 0
+        prev = None
+        for event in trace.events:
+            if prev is not None and event.path != prev:
+                (pidx, poff) = positions[prev]
+                (idx, off) = positions[event.path]
+                if idx != pidx + 1:
+                    seeks += 1
+                    distance += abs(off - (poff + sizes[prev]))
+            prev = event.path
+        return (seeks, distance)
+
+    # -------------------------------------------------------------------------
+    @staticmethod
+    def __pct(before, after):
+    # -------------------------------------------------------------------------
+        """ Return the percentage reduction from before to after. """
+        if before == 0:
+            return 0.0
+        return 100.0 * (before - after) / before
@@ -0,0 +1,393 @@
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+
+# =============================================================================
+# =============================================================================
+"""
+lsjournal - Reader for the binary message journal of liblogsvc.
+
+With the LS_DEST_JOURNAL destination, liblogsvc records each message as
+the id of its format string and its raw arguments, instead of formatting
+it (see lib/liblogsvc/ls_journal.c for the format).  This module reads
+journals, renders their messages as the text log would show them, and
+converts them for JSON output.  ls_decode(1) is its command line
+interface.
+"""
+# =============================================================================
+# =============================================================================
+
+import calendar
+import re
+import struct
+import time
+
+JOURNAL_MAGIC = b"LSJ1"
+CHUNK_HEADER_LEN = 16
+RECORD_HEADER_LEN = 3
+
+# Record types
+REC_PROCESS = ord("H")
+REC_FORMAT = ord("F")
+REC_MESSAGE = ord("M")
+
+# Level of log messages.  Other levels are debug levels.
+LOG_LEVEL = -1
+
+# Debug levels, as LS_DBG_LVL sets them, and their tags in the text log
+LEVEL_TAGS = {1: "!", 2: "E", 3: "W", 4: "I"}
+
+# Sizes of argument values, by tag.  Strings are handled separately.
+ARG_FORMATS = {"i": "i", "l": "q", "d": "d", "p": "Q"}
+
+# A printf conversion specification
+CONVERSION = re.compile(r"%(?P<flags>[-+ #0']*)(?P<width>\*|\d+)?"
+                        r"(?:\.(?P<prec>\*|\d*))?"
+                        r"(?P<length>hh|h|ll|l|j|z|t|L)?"
+                        r"(?P<conv>[diouxXcsfFeEgGaApn%])")
+
+# Bits of integers printed with a length modifier, when it narrows them
+LENGTH_BITS = {"hh": 8, "h": 16}
+
+
+# =============================================================================
+class JournalError(Exception):
+# =============================================================================
+    """Exception for journals which can't be read."""
+    pass
+
+
+# =============================================================================
+class JournalMessage(object):
+# =============================================================================
+    """ One journaled message.
+
+    Attributes:
+      pid: id of the process which journaled the message
+      hrtime: gethrtime() when journaled, in nanoseconds
+      time: time of day when journaled (seconds since the epoch, as a
+        float), or None if the journal lacks the start of the process
+      module: module id
+      level: debug level, or LOG_LEVEL for log messages
+      fmt: format string
+      args: list of arguments
+    """
+# =============================================================================
+    __slots__ = ("pid", "hrtime", "time", "module", "level", "fmt", "args")
+
+    def __init__(self, pid, hrtime, msg_time, module, level, fmt, args):
+        self.pid = pid
+        self.hrtime = hrtime
+        self.time = msg_time
+        self.module = module
+        self.level = level
+        self.fmt = fmt
+        self.args = args
+
+    def text(self):
+        """ Return the message formatted, as printf would have. """
+        return render_format(self.fmt, self.args)
+
+    def tag(self):
+        """ Return module id and level as the text log shows them. """
+        if (self.level == LOG_LEVEL):
+            return self.module
+        return "%s_%s" % (self.module, LEVEL_TAGS.get(self.level, "?"))
+
+    def log_line(self):
+        """ Return the message as posted to the text log. """
+        if (self.time is None):
+            stamp = "--:--:--"
+        else:
+            # asctime() without weekday and year, as ls_format_timestamp()
+            # does it: "Jan  5 00:00:00", in English whatever the locale.
+            stamp = time.asctime(time.gmtime(int(self.time)))[4:19]
+        return "<%s %s> %s" % (self.tag(), stamp, self.text())
+
+    def to_dict(self):
+        """ Return the message as a dictionary, for JSON output. """
+        if (self.level == LOG_LEVEL):
+            level = "log"
+        else:
+            level = self.level
+        return {"pid": self.pid, "hrtime": self.hrtime, "time": self.time,
+                "module": self.module, "level": level, "format": self.fmt,
+                "args": self.args, "message": self.text()}
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def render_format(fmt, args):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Format arguments with a C printf format string.
+
+    Args:
+      fmt: printf format string
+
+      args: list of arguments, as journaled: integers are 32 or 64 bit
+        signed values, whichever the conversion used.
+
+    Returns:
+      Formatted string.  Conversions lacking arguments are left as they
+      are.
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    out = []
+    arg_iter = iter(args)
+    pos = 0
+    for match in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:match.start()])
+        pos = match.end()
+        conv = match.group("conv")
+        if (conv == "%"):
+            out.append("%")
+            continue
+        try:
+            width = match.group("width") or ""
+            if (width == "*"):
+                width = str(next(arg_iter))
+            prec = match.group("prec")
+            if (prec == "*"):
+                prec = str(next(arg_iter))
+            if (conv == "n"):
+                continue
+            value = next(arg_iter)
+        except StopIteration:
+            out.append(match.group(0))
+            continue
+
+        flags = match.group("flags").replace("'", "")
+        if (width.startswith("-")):
+            flags += "-"
+            width = width[1:]
+        spec = "%" + flags + width
+        if (prec is not None):
+            spec += "." + prec
+
+        length = match.group("length")
+        if (conv in "diouxXc"):
+            bits = LENGTH_BITS.get(length)
+            if (bits is not None):
+                value &= (1 << bits) - 1
+                if ((conv in "di") and (value >> (bits - 1))):
+                    value -= 1 << bits
+            if (conv in "ouxX"):
+                if (bits is None):
+                    bits = 32 if (-(1 << 31) <= value < (1 << 31)) else 64
+                    if (length in ("l", "ll", "j", "z", "t")):
+                        bits = 64
+                value &= (1 << bits) - 1
+            if (conv in "iu"):
+                conv = "d"
+            elif (conv == "c"):
+                value = chr(value & 0xff)
+                conv = "s"
+        elif (conv == "p"):
+            spec = "%" + flags + width
+            conv = "s"
+            value = "0x%x" % value
+        elif (conv in "aA"):
+            value = float(value).hex()
+            conv = "s"
+        out.append((spec + conv) % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def __parse_args(data, pos, order):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Return the list of tagged arguments in data, from pos on. """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    args = []
+    while (pos < len(data)):
+        tag = chr(data[pos])
+        pos += 1
+        if (tag == "s"):
+            (slen, ) = struct.unpack_from(order + "H", data, pos)
+            pos += 2
+            args.append(data[pos:pos + slen].decode("utf-8", "replace"))
+            pos += slen
+        elif (tag in ARG_FORMATS):
+            arg_fmt = order + ARG_FORMATS[tag]
+            args.append(struct.unpack_from(arg_fmt, data, pos)[0])
+            pos += struct.calcsize(arg_fmt)
+        else:
+            raise JournalError("Unknown argument tag %r" % tag)
+    return args
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def read_journal(journal_name):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Read the messages of a journal.
+
+    Args:
+      journal_name: name of the journal file
+
+    Returns:
+      List of JournalMessage, in journal order.  Messages of one process
+      are in the order journaled; processes sharing the journal write
+      in chunks, which interleave.
+
+    Raises:
+      IOError, OSError: Error reading the file
+      JournalError: The file isn't a journal, or is corrupt.  A chunk cut
+        short at the end of the file (by a crash) isn't an error.
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    with open(journal_name, "rb") as jfile:
+        data = jfile.read()
+
+    # Per process: format strings by id, and (time of day, hrtime) of
+    # the process start.
+    formats = {}
+    starts = {}
+
+    messages = []
+    pos = 0
+    while (pos + CHUNK_HEADER_LEN <= len(data)):
+        if (data[pos:pos + 4] != JOURNAL_MAGIC):
+            raise JournalError("%s: bad chunk at offset %d" %
+                               (journal_name, pos))
+        if (data[pos + 4:pos + 8] == b"\x04\x03\x02\x01"):
+            order = "<"
+        elif (data[pos + 4:pos + 8] == b"\x01\x02\x03\x04"):
+            order = ">"
+        else:
+            raise JournalError("%s: bad byte order at offset %d" %
+                               (journal_name, pos))
+        (chunk_len, pid) = struct.unpack_from(order + "II", data, pos + 8)
+        end = pos + chunk_len
+        if (end > len(data)):
+            break
+        pos += CHUNK_HEADER_LEN
+
+        try:
+            while (pos < end):
+                (rec_len, ) = struct.unpack_from(order + "H", data, pos)
+                rec_type = data[pos + 2]
+                rec = data[pos + RECORD_HEADER_LEN:pos + rec_len]
+                pos += rec_len
+                if (rec_len < RECORD_HEADER_LEN):
+                    raise JournalError("%s: bad record length" %
+                                       journal_name)
+
+                if (rec_type == REC_PROCESS):
+                    (sec, nsec, hrtime) = struct.unpack_from(order + "qqq",
+                                                             rec)
+                    starts[pid] = (sec + nsec / 1e9, hrtime)
+                    formats[pid] = {}
+                elif (rec_type == REC_FORMAT):
+                    (fmt_id, ) = struct.unpack_from(order + "I", rec)
+                    formats.setdefault(pid, {})[fmt_id] = \
+                        rec[4:].rstrip(b"\0").decode("utf-8", "replace")
+                elif (rec_type == REC_MESSAGE):
+                    (hrtime, fmt_id, level, id_len) = \
+                        struct.unpack_from(order + "qIbB", rec)
+                    module = rec[14:14 + id_len].decode("utf-8", "replace")
+                    args = __parse_args(rec, 14 + id_len, order)
+                    fmt = formats.get(pid, {}).get(fmt_id)
+                    if (fmt is None):
+                        fmt = "<unknown format %d>" % fmt_id
+                    msg_time = None
+                    if (pid in starts):
+                        (start_time, start_hrtime) = starts[pid]
+                        msg_time = start_time + \
+                            (hrtime - start_hrtime) / 1e9
+                    messages.append(JournalMessage(pid, hrtime, msg_time,
+                                                   module, level, fmt,
+                                                   args))
+        except struct.error:
+            raise JournalError("%s: record cut short" % journal_name)
+
+    return messages
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def parse_time(time_str):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Parse a time given to filter messages with.
+
+    Args:
+      time_str: UTC time as YYYY-MM-DDTHH:MM:SS, or seconds since the
+        epoch
+
+    Returns:
+      seconds since the epoch
+
+    Raises:
+      ValueError: time_str is neither
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    try:
+        return float(time_str)
+    except ValueError:
+        return calendar.timegm(time.strptime(time_str, "%Y-%m-%dT%H:%M:%S"))
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def filter_messages(messages, modules=None, max_level=None, start=None,
+                    end=None):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Select messages.
+
+    Args:
+      messages: list of JournalMessage
+
+      modules: if not None, only messages of these module ids are kept
+
+      max_level: if not None, only log messages and debug messages of this
+        level or lower (more severe) are kept
+
+      start, end: if not None, only messages journaled at or after start,
+        and before end, (seconds since the epoch) are kept.  Messages of
+        unknown time are dropped then.
+
+    Returns:
+      list of the selected messages
+
+    Raises: None
+
+    """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    selected = []
+    for msg in messages:
+        if ((modules is not None) and (msg.module not in modules)):
+            continue
+        if ((max_level is not None) and (msg.level != LOG_LEVEL) and
+            (msg.level > max_level)):
+            continue
+        if ((start is not None) or (end is not None)):
+            if (msg.time is None):
+                continue
+            if ((start is not None) and (msg.time < start)):
+                continue
+            if ((end is not None) and (msg.time >= end)):
+                continue
+        selected.append(msg)
+    return selected
@@ -0,0 +1,370 @@
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+
+# =============================================================================
+# =============================================================================
+"""
+progress_ring - Reader and writer of the install progress ring.
+
+While installing, liborchestrator posts the progress of each phase and
+the lines of its log as fixed size records to a ring in a shared file
+(see lib/liborchestrator/om_progress.c for the format).  This module
+follows the ring, and lets the text installer, which doesn't install
+through liborchestrator, write one the same way.  install_monitor(1) is
+its command line interface.
+"""
+# =============================================================================
+# =============================================================================
+
+import logging
+import mmap
+import os
+import struct
+import threading
+import time
+
+PROGRESS_FILE = "/tmp/install_progress"
+PROGRESS_MAGIC = b"OMP1"
+PROGRESS_RECORDS = 1024
+
+# Layout of the header and of a record, as om_progress.c has them
+HEADER_FORMAT = "=4sIIiIIq32x"
+HEADER_LEN = struct.calcsize(HEADER_FORMAT)
+NEXT_OFFSET = 16
+MESSAGE_LEN = 216
+RECORD_FORMAT = "=IHhhhIQQq%ds" % MESSAGE_LEN
+RECORD_LEN = struct.calcsize(RECORD_FORMAT)
+SEQ_FORMAT = "=I"
+
+# Record types
+STATUS = 1
+LOG = 2
+
+# Phases, as om_milestone_type_t numbers them
+TARGET_INSTANTIATION = 5
+SOFTWARE_UPDATE = 7
+POSTINSTALL_TASKS = 8
+FAILED = -1
+
+PHASE_NAMES = {0: "disk discovery", 1: "partition discovery",
+               2: "slice discovery", 3: "upgrade target discovery",
+               4: "instance discovery", TARGET_INSTANTIATION: "target setup",
+               6: "upgrade check", SOFTWARE_UPDATE: "transfer",
+               POSTINSTALL_TASKS: "post install", FAILED: "failed"}
+
+
+# =============================================================================
+class ProgressRingError(Exception):
+# =============================================================================
+    """Exception for rings which can't be read."""
+    pass
+
+
+# =============================================================================
+class ProgressRecord(object):
+# =============================================================================
+    """ One record of the ring.
+
+    Attributes:
+      seq: sequence number, from 1
+      rec_type: STATUS or LOG
+      phase: phase of the installation, FAILED on failure
+      percent: percentage of the phase done, or -1
+      status: error number on failure
+      nbytes: bytes installed in the phase, or 0 if unknown
+      rate: bytes per second in the phase, or 0 if unknown
+      time: time of day when posted, in seconds since the epoch
+      message: text shown to the user, or line of the install log
+    """
+# =============================================================================
+    __slots__ = ("seq", "rec_type", "phase", "percent", "status", "nbytes",
+                 "rate", "time", "message")
+
+    def __init__(self, seq, rec_type, phase, percent, status, nbytes, rate,
+                 rec_time, message):
+        self.seq = seq
+        self.rec_type = rec_type
+        self.phase = phase
+        self.percent = percent
+        self.status = status
+        self.nbytes = nbytes
+        self.rate = rate
+        self.time = rec_time
+        self.message = message
+
+    @classmethod
+    def unpack(cls, data):
+        """ Return the record packed in data. """
+        (seq, rec_type, phase, percent, status, _reserved, nbytes, rate,
+         msec, message) = struct.unpack(RECORD_FORMAT, data)
+        message = message.split(b"\0", 1)[0].decode("utf-8", "replace")
+        return cls(seq, rec_type, phase, percent, status, nbytes, rate,
+                   msec / 1000.0, message)
+
+    def phase_name(self):
+        """ Return the name of the phase. """
+        return PHASE_NAMES.get(self.phase, "phase %d" % self.phase)
+
+    def line(self):
+        """ Return the record as one line of text. """
+        stamp = time.strftime("%H:%M:%S", time.localtime(int(self.time)))
+        if (self.rec_type == LOG):
+            return "%s %s" % (stamp, self.message)
+        if (self.phase == FAILED):
+            return "%s failed (%d) %s" % (stamp, self.status, self.message)
+        out = "%s %s" % (stamp, self.phase_name())
+        if (self.percent >= 0):
+            out += " %d%%" % self.percent
+        if (self.nbytes):
+            out += " %s" % format_size(self.nbytes)
+        if (self.rate):
+            out += " %s/s" % format_size(self.rate)
+        if (self.message):
+            out += " " + self.message
+        return out
+
+    def to_dict(self):
+        """ Return the record as a dictionary, for JSON output. """
+        return {"seq": self.seq,
+                "type": "log" if (self.rec_type == LOG) else "status",
+                "phase": self.phase,
+                "phase_name": self.phase_name() if (self.rec_type == STATUS)
+                else None,
+                "percent": self.percent, "status": self.status,
+                "bytes": self.nbytes, "rate": self.rate, "time": self.time,
+                "message": self.message}
+
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+def format_size(nbytes):
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    """ Return a number of bytes in the largest fitting unit. """
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    size = float(nbytes)
+    for unit in ("B", "KB", "MB", "GB"):
+        if (size < 1024.0):
+            return "%.1f %s" % (size, unit)
+        size /= 1024.0
+    return "%.1f TB" % size
+
+
+# =============================================================================
+class ProgressReader(object):
+# =============================================================================
+    """ Follows a ring.  The first read() returns the records still in
+    the ring, the next ones those posted since.
+    """
+# =============================================================================
+
+    def __init__(self, path=PROGRESS_FILE):
+        """ Map the ring.
+
+        Raises:
+          IOError, OSError: The ring doesn't exist or can't be read
+          ProgressRingError: The file isn't a ring, or is being created
+
+        """
+        self.path = path
+        with open(path, "rb") as ring_file:
+            stat = os.fstat(ring_file.fileno())
+            if (stat.st_size < HEADER_LEN):
+                raise ProgressRingError("%s is not a progress ring" % path)
+            self.map = mmap.mmap(ring_file.fileno(), stat.st_size,
+                                 mmap.MAP_SHARED, mmap.PROT_READ)
+        self.ident = (stat.st_dev, stat.st_ino)
+
+        (magic, self.nrecords, record_size, self.pid, next_seq, _reserved,
+         start) = struct.unpack_from(HEADER_FORMAT, self.map, 0)
+        if ((magic != PROGRESS_MAGIC) or (record_size != RECORD_LEN) or
+            (self.nrecords == 0) or
+            (self.nrecords & (self.nrecords - 1)) or
+            (stat.st_size < HEADER_LEN + self.nrecords * RECORD_LEN)):
+            self.map.close()
+            raise ProgressRingError("%s is not a progress ring" % path)
+        self.start = start / 1000.0
+        self.cursor = max(0, next_seq - self.nrecords)
+
+    def close(self):
+        """ Unmap the ring. """
+        self.map.close()
+
+    def replaced(self):
+        """ Return True if a new installation replaced the ring. """
+        try:
+            stat = os.stat(self.path)
+        except OSError:
+            return False
+        return ((stat.st_dev, stat.st_ino) != self.ident)
+
+    def __next_seq(self):
+        """ Return the number of the next record to be posted. """
+        return struct.unpack_from(SEQ_FORMAT, self.map, NEXT_OFFSET)[0]
+
+    def read(self, max_records=None):
+        """ Read the records posted since the last call.
+
+        Args:
+          max_records: how many records to read at most, None for all
+
+        Returns:
+          (records, lost): list of ProgressRecord in the order posted,
+          and the number of records overwritten before they were read
+
+        """
+        records = []
+        lost = 0
+        while ((max_records is None) or (len(records) < max_records)):
+            next_seq = self.__next_seq()
+            if (next_seq - self.cursor > self.nrecords):
+                # the writers went round the ring
+                lost += next_seq - self.nrecords - self.cursor
+                self.cursor = next_seq - self.nrecords
+            if (self.cursor == next_seq):
+                break
+
+            offset = HEADER_LEN + \
+                (self.cursor & (self.nrecords - 1)) * RECORD_LEN
+            seq = struct.unpack_from(SEQ_FORMAT, self.map, offset)[0]
+            if (seq != self.cursor + 1):
+                # still being written, or being overwritten
+                if (self.__next_seq() - self.cursor <= self.nrecords):
+                    break
+                continue
+            data = self.map[offset:offset + RECORD_LEN]
+            if (struct.unpack_from(SEQ_FORMAT, self.map, offset)[0] != seq):
+                # overwritten while copied
+                continue
+            records.append(ProgressRecord.unpack(data))
+            self.cursor += 1
+        return (records, lost)
+
+
+# =============================================================================
+class ProgressWriter(object):
+# =============================================================================
+    """ Creates a ring and posts records to it, for installers which don't
+    install through liborchestrator.  Only this process may write to the
+    ring.  Records are stored field by field and published by their
+    sequence number last; the platforms the installer runs on keep stores
+    in order.
+    """
+# =============================================================================
+
+    def __init__(self, path=PROGRESS_FILE, nrecords=PROGRESS_RECORDS):
+        """ Create the ring, replacing the one of an earlier installation.
+
+        Raises:
+          IOError, OSError: The ring can't be created
+
+        """
+        size = HEADER_LEN + nrecords * RECORD_LEN
+        try:
+            os.unlink(path)
+        except OSError:
+            pass
+        fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_EXCL, 0o644)
+        try:
+            os.ftruncate(fd, size)
+            self.map = mmap.mmap(fd, size, mmap.MAP_SHARED,
+                                 mmap.PROT_READ | mmap.PROT_WRITE)
+        finally:
+            os.close(fd)
+
+        self.nrecords = nrecords
+        self.next_seq = 0
+        self.lock = threading.Lock()
+        self.rate_phase = None
+        self.rate_start = None
+
+        struct.pack_into(HEADER_FORMAT, self.map, 0, b"\0" * 4, nrecords,
+                         RECORD_LEN, os.getpid(), 0, 0,
+                         int(time.time() * 1000))
+        self.map[0:4] = PROGRESS_MAGIC
+
+    def close(self):
+        """ Unmap the ring.  Readers can still read it. """
+        with self.lock:
+            self.map.close()
+            self.map = None
+
+    def __post(self, rec_type, phase, percent, status, nbytes, rate,
+               message):
+        """ Write one record. """
+        data = message.encode("utf-8", "replace")[:MESSAGE_LEN - 1]
+        with self.lock:
+            if (self.map is None):
+                return
+            seq = self.next_seq
+            self.next_seq += 1
+            offset = HEADER_LEN + (seq & (self.nrecords - 1)) * RECORD_LEN
+            struct.pack_into(SEQ_FORMAT, self.map, offset, 0)
+            struct.pack_into(SEQ_FORMAT, self.map, NEXT_OFFSET,
+                             self.next_seq)
+            record = struct.pack(RECORD_FORMAT, 0, rec_type, phase, percent,
+                                 status, 0, nbytes, rate,
+                                 int(time.time() * 1000), data)
+            self.map[offset + 4:offset + RECORD_LEN] = record[4:]
+            struct.pack_into(SEQ_FORMAT, self.map, offset, seq + 1)
+
+    def post_status(self, phase, percent, message="", nbytes=0, status=0):
+        """ Post the progress of a phase.  The rate of the phase is
+        computed from the bytes installed, if given.
+        """
+        now = time.time()
+        with self.lock:
+            if (phase != self.rate_phase):
+                self.rate_phase = phase
+                self.rate_start = now
+            elapsed = now - self.rate_start
+        rate = 0
+        if (nbytes and elapsed >= 0.1):
+            rate = int(nbytes / elapsed)
+        self.__post(STATUS, phase, int(percent), status, nbytes, rate,
+                    message or "")
+
+    def post_failure(self, status, message=""):
+        """ Post the failure of the installation. """
+        self.__post(STATUS, FAILED, -1, status, 0, 0, message or "")
+
+    def post_log(self, message):
+        """ Post a line of the install log. """
+        self.__post(LOG, self.rate_phase if (self.rate_phase is not None)
+                    else FAILED, -1, 0, 0, 0, message.rstrip("\n"))
+
+
+# =============================================================================
+class ProgressLogHandler(logging.Handler):
+# =============================================================================
+    """ Posts log records to a ring, as lines of the install log. """
+# =============================================================================
+
+    def __init__(self, writer, level=logging.INFO):
+        logging.Handler.__init__(self, level)
+        self.writer = writer
+
+    def emit(self, record):
+        try:
+            self.writer.post_log(self.format(record))
+        except Exception:
+            self.handleError(record)
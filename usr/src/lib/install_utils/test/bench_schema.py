@@ -0,0 +1,141 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+Schema validation benchmark: xmllint against in-process libxmlval.
+
+To run:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python bench_schema.py [-n <validations>] [<manifest.xml> ...]
+
+Without manifests, the distro_const manifests are used.  Each has its
+defaults added (as ManifestServ does before validating) and is then
+validated against DC-manifest.rng.  The average time per validation is
+printed for:
+  xmllint - XML_VALIDATOR run for each validation
+  cold    - libxmlval, compiling the schema each time
+  warm    - libxmlval, reusing the compiled schema
+  cached  - recorded in SCHEMA_CACHE_DIR, so not validated again
+
+'''
+
+import getopt
+import glob
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+import osol_install.DefValProc as DefValProc
+from osol_install.DefValProc import add_defaults, schema_validate, \
+    ManifestProcError
+from osol_install.TreeAcc import TreeAcc
+
+SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..",
+                   "..")
+DEFAULT_MANIFESTS = \
+    sorted(glob.glob(os.path.join(SRC, "cmd/distro_const/*/*.xml")))
+SCHEMA = os.path.join(SRC, "cmd/distro_const/DC-manifest.rng")
+DEFVAL = os.path.join(SRC, "cmd/distro_const/DC-manifest.defval.xml")
+
+
+def measure(manifest, validations, clear_compiled=False):
+    ''' Return (seconds per validation, True if the manifest is valid) '''
+    valid = True
+
+    # Validation errors are written to stderr by libxml2 as well as by
+    # python, so quiet the file descriptor.
+    sys.stderr.flush()
+    saved_stderr = os.dup(2)
+    devnull = os.open(os.devnull, os.O_WRONLY)
+    os.dup2(devnull, 2)
+    try:
+        start = time.time()
+        for i in range(validations):
+            if (clear_compiled):
+                DefValProc.compiled_schemas.clear()
+            try:
+                schema_validate(SCHEMA, manifest)
+            except ManifestProcError:
+                valid = False
+        elapsed = (time.time() - start) / validations
+    finally:
+        sys.stderr.flush()
+        os.dup2(saved_stderr, 2)
+        os.close(saved_stderr)
+        os.close(devnull)
+    return (elapsed, valid)
+
+
+def main():
+    validations = 20
+    (opt_pairs, manifests) = getopt.getopt(sys.argv[1:], "n:")
+    for (opt, optarg) in opt_pairs:
+        if (opt == "-n"):
+            validations = int(optarg)
+    if (not manifests):
+        manifests = DEFAULT_MANIFESTS
+
+    libxmlval = DefValProc.libxmlval
+    if (libxmlval is None):
+        print("libxmlval is not available: only xmllint is measured")
+
+    tmpdir = tempfile.mkdtemp()
+    cache_dir = os.path.join(tmpdir, "cache")
+    defval = TreeAcc(DEFVAL)
+
+    print("%-32s %6s %10s %10s %10s %10s" %
+          ("manifest", "valid", "xmllint ms", "cold ms", "warm ms",
+           "cached ms"))
+    try:
+        for manifest in manifests:
+            tree = TreeAcc(manifest)
+            add_defaults(tree, defval)
+            defaulted = os.path.join(tmpdir, os.path.basename(manifest))
+            tree.save_tree(defaulted)
+
+            DefValProc.SCHEMA_CACHE_DIR = None
+            DefValProc.libxmlval = None
+            (lint_time, valid) = measure(defaulted, validations)
+            times = [lint_time, 0.0, 0.0, 0.0]
+            if (libxmlval is not None):
+                DefValProc.libxmlval = libxmlval
+                times[1] = measure(defaulted, validations, True)[0]
+                times[2] = measure(defaulted, validations)[0]
+                DefValProc.SCHEMA_CACHE_DIR = cache_dir
+                measure(defaulted, 1)
+                times[3] = measure(defaulted, validations)[0]
+            print("%-32s %6s %10.2f %10.2f %10.2f %10.2f" %
+                  ((os.path.basename(manifest)[:32], valid) +
+                   tuple([value * 1000 for value in times])))
+    finally:
+        DefValProc.libxmlval = libxmlval
+        shutil.rmtree(tmpdir)
+
+
+if __name__ == '__main__':
+    main()
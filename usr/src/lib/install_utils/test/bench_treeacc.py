@@ -0,0 +1,106 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+
+'''
+Manifest load benchmark: TreeAcc's CompactTree against minidom.
+
+To run:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python bench_treeacc.py [-n <loads>] [<manifest.xml> ...]
+
+Without manifests, the distro_const manifests and defval manifest are
+loaded.  For each, the average time to build a TreeAcc is printed, along
+with the memory the loaded tree holds (as counted by tracemalloc), for
+both tree representations.
+
+'''
+
+import getopt
+import glob
+import os
+import sys
+import time
+import tracemalloc
+from xml.dom import minidom
+
+from osol_install import CompactTree
+from osol_install.TreeAcc import TreeAcc
+
+SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..",
+                   "..")
+DEFAULT_MANIFESTS = \
+    sorted(glob.glob(os.path.join(SRC, "cmd/distro_const/*/*.xml"))) + \
+    [os.path.join(SRC, "cmd/distro_const/DC-manifest.defval.xml")]
+
+
+def measure(manifest, loads):
+    ''' Return (seconds per load, bytes held by one tree) '''
+    start = time.time()
+    for i in range(loads):
+        TreeAcc(manifest)
+    elapsed = (time.time() - start) / loads
+
+    tracemalloc.start()
+    base = tracemalloc.get_traced_memory()[0]
+    tree = TreeAcc(manifest)
+    held = tracemalloc.get_traced_memory()[0] - base
+    tracemalloc.stop()
+    del tree
+    return (elapsed, held)
+
+
+def main():
+    loads = 20
+    (opt_pairs, manifests) = getopt.getopt(sys.argv[1:], "n:")
+    for (opt, optarg) in opt_pairs:
+        if (opt == "-n"):
+            loads = int(optarg)
+    if (not manifests):
+        manifests = DEFAULT_MANIFESTS
+
+    print("%-32s %10s %10s %10s %10s" %
+          ("manifest", "dom ms", "compact ms", "dom KB", "compact KB"))
+    compact_parse = CompactTree.parse
+    totals = [0.0, 0.0, 0, 0]
+    for manifest in manifests:
+        CompactTree.parse = minidom.parse
+        (dom_time, dom_held) = measure(manifest, loads)
+        CompactTree.parse = compact_parse
+        (compact_time, compact_held) = measure(manifest, loads)
+        print("%-32s %10.2f %10.2f %10d %10d" %
+              (os.path.basename(manifest)[:32], dom_time * 1000,
+               compact_time * 1000, dom_held // 1024, compact_held // 1024))
+        for (i, value) in enumerate((dom_time, compact_time, dom_held,
+                                     compact_held)):
+            totals[i] += value
+    print("%-32s %10.2f %10.2f %10d %10d" %
+          ("total", totals[0] * 1000, totals[1] * 1000, totals[2] // 1024,
+           totals[3] // 1024))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,200 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_defvalproc.py
+
+'''
+
+import os
+import shutil
+import sys
+import tempfile
+import unittest
+
+import osol_install.DefValProc as DefValProc
+from osol_install.DefValProc import add_defaults, validate_content, \
+    schema_validate, DirectivePlan, ManifestProcError
+from osol_install.TreeAcc import TreeAcc
+
+HELPERS = '''
+class dvp_helpers:
+    checked = []
+
+    def two(self, parent):
+        return 2
+
+    def short(self, node):
+        dvp_helpers.checked.append(node.get_path())
+        return len(node.get_value()) < 10
+'''
+
+DEFVAL = '''<?xml version="1.0"?>
+<defval>
+  <helpers>
+    <deflt_setter ref="two" module="dvp_helpers.py" method="two"/>
+    <validator ref="short" module="dvp_helpers.py" method="short"/>
+  </helpers>
+  <default nodepath="users/user/shell" type="attribute" from="value">
+    /bin/sh
+  </default>
+  <default nodepath="users/user/uid" type="element" from="helper">
+    two
+  </default>
+  <default nodepath="opt/x" type="element" from="value"
+      missing_parent="skip">1</default>
+  <default nodepath="users/made/x" type="element" from="value"
+      missing_parent="create">1</default>
+  <validate nodepath="users/user/name">short</validate>
+  <validate nodepath="opt/y" missing="ok_if_no_parent">short</validate>
+  <validate group="short">
+    "users/user/shell"
+    "users/made/x"
+  </validate>
+  <validate exclude="short">
+    "users/user/name"
+    "users/user/shell"
+  </validate>
+</defval>
+'''
+
+MANIFEST = '''<?xml version="1.0"?>
+<mf>
+  <users>
+    <user name="jack"/>
+    <user name="jill" shell="/bin/ksh"><uid>7</uid></user>
+  </users>
+</mf>
+'''
+
+
+def write(dirname, name, text):
+    path = os.path.join(dirname, name)
+    with open(path, "w") as out:
+        out.write(text)
+    return path
+
+
+class DefValTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.dirname = tempfile.mkdtemp()
+        write(self.dirname, "dvp_helpers.py", HELPERS)
+        sys.path.insert(0, self.dirname)
+        import dvp_helpers
+        self.helpers = dvp_helpers.dvp_helpers
+        self.helpers.checked = []
+        self.defval = TreeAcc(write(self.dirname, "defval.xml", DEFVAL))
+        self.tree = TreeAcc(write(self.dirname, "mf.xml", MANIFEST))
+
+    def tearDown(self):
+        sys.path.remove(self.dirname)
+        shutil.rmtree(self.dirname)
+
+    def values(self, nodepath):
+        return [node.get_value() for node in self.tree.find_node(nodepath)]
+
+    def test_defaults(self):
+        ''' defaults are added to each parent lacking them '''
+        add_defaults(self.tree, self.defval)
+        self.assertEqual(self.values("users/user/shell"),
+                         ["/bin/sh", "/bin/ksh"])
+        self.assertEqual(self.values("users/user/uid"), ["2", "7"])
+        self.assertEqual(self.tree.find_node("opt"), [])
+        self.assertEqual(self.values("users/made/x"), ["1"])
+        self.assertEqual(self.tree.changes, 4)
+
+    def test_unchanged(self):
+        ''' a tree needing no defaults is left unchanged '''
+        add_defaults(self.tree, self.defval)
+        changes = self.tree.changes
+        add_defaults(self.tree, self.defval)
+        self.assertEqual(self.tree.changes, changes)
+
+    def test_validate(self):
+        ''' single, group and exclude validation, sharing one plan '''
+        plan = DirectivePlan(self.defval)
+        add_defaults(self.tree, self.defval, plan=plan)
+        validate_content(self.tree, self.defval, plan=plan)
+        checked = self.helpers.checked
+        self.assertEqual(checked.count("users/user/name"), 2)
+        self.assertEqual(checked.count("users/user/shell"), 2)
+        self.assertEqual(checked.count("users/made/x"), 2)
+        self.assertEqual(checked.count("users/user/uid"), 2)
+        self.assertEqual(checked.count("users"), 1)
+
+    def test_invalid(self):
+        ''' a value failing validation is an error '''
+        add_defaults(self.tree, self.defval)
+        self.tree.replace_value("users/user[name=jack]/name", "jack_sprat")
+        self.assertRaises(ManifestProcError, validate_content, self.tree,
+                          self.defval)
+
+
+class SchemaCacheTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.dirname = tempfile.mkdtemp()
+        self.schema = write(self.dirname, "mf.rng", "<grammar/>")
+        self.manifest = write(self.dirname, "mf.xml", MANIFEST)
+        self.saved = (DefValProc.libxmlval, DefValProc.XML_VALIDATOR,
+                      DefValProc.SCHEMA_CACHE_DIR)
+        DefValProc.libxmlval = None
+        DefValProc.SCHEMA_CACHE_DIR = os.path.join(self.dirname, "cache")
+
+    def tearDown(self):
+        (DefValProc.libxmlval, DefValProc.XML_VALIDATOR,
+         DefValProc.SCHEMA_CACHE_DIR) = self.saved
+        shutil.rmtree(self.dirname)
+
+    def test_verdict_reused(self):
+        ''' a validated document isn't validated again until it changes '''
+        DefValProc.XML_VALIDATOR = "/bin/true"
+        schema_validate(self.schema, self.manifest)
+        self.assertEqual(len(os.listdir(DefValProc.SCHEMA_CACHE_DIR)), 1)
+
+        DefValProc.XML_VALIDATOR = "/bin/false"
+        schema_validate(self.schema, self.manifest)
+
+        write(self.dirname, "mf.xml", MANIFEST.replace("jill", "bill"))
+        self.assertRaises(ManifestProcError, schema_validate, self.schema,
+                          self.manifest)
+
+    def test_untrusted_dir(self):
+        ''' records in a directory others can write are ignored '''
+        DefValProc.XML_VALIDATOR = "/bin/true"
+        schema_validate(self.schema, self.manifest)
+        os.chmod(DefValProc.SCHEMA_CACHE_DIR, 0o777)
+        DefValProc.XML_VALIDATOR = "/bin/false"
+        self.assertRaises(ManifestProcError, schema_validate, self.schema,
+                          self.manifest)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,233 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_iotrace.py
+
+The traces/ directory holds "iosnoop -Deg" output recorded from three boots
+of the same image, as captured by the live-io-tracing service.
+
+'''
+
+import os
+import tempfile
+import unittest
+
+from osol_install.iotrace import LayoutOptimizer, parse_iosnoop, \
+                                 read_trace, read_sort_list
+
+TRACE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                         "traces")
+TRACES = ["boot1.iosnoop", "boot2.iosnoop", "boot3.iosnoop"]
+
+
+def load_optimizer(names=TRACES):
+    optimizer = LayoutOptimizer()
+    for name in names:
+        optimizer.add_trace(read_trace(os.path.join(TRACE_DIR, name)))
+    return optimizer
+
+
+class ParseTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.trace = read_trace(os.path.join(TRACE_DIR, "boot1.iosnoop"))
+
+    def test_filtering(self):
+        ''' excluded, non-/usr and directory entries are dropped '''
+        for path in self.trace.order:
+            self.assertTrue(path.startswith("/usr/"))
+            self.assertFalse(path.endswith("/"))
+        self.assertFalse("/usr/lib/libc.so.1" in self.trace.rank)
+
+    def test_none_pathname(self):
+        ''' <none> pathnames fall back to the exec'ed program '''
+        self.assertTrue("/usr/lib/hal/hald" in self.trace.rank)
+        self.assertEqual(self.trace.count["/usr/lib/hal/hald"], 2)
+
+    def test_first_access_order(self):
+        ''' order and counts follow the trace '''
+        self.assertEqual(self.trace.order[0], "/usr/lib/libglib-2.0.so.0")
+        self.assertEqual(self.trace.order[1], "/usr/lib/libgobject-2.0.so.0")
+        self.assertEqual(self.trace.count["/usr/lib/libglib-2.0.so.0"], 2)
+        self.assertEqual(self.trace.nbytes["/usr/lib/libglib-2.0.so.0"],
+                         12288)
+
+    def test_no_exclude(self):
+        ''' an empty exclude pattern keeps everything under the prefix '''
+        with open(os.path.join(TRACE_DIR, "boot1.iosnoop")) as tfile:
+            trace = parse_iosnoop(tfile, exclude=None)
+        self.assertTrue("/usr/lib/libc.so.1" in trace.rank)
+
+    def test_root_skips_directories(self):
+        ''' paths that are directories under the image root are dropped '''
+        root = tempfile.mkdtemp()
+        try:
+            os.makedirs(os.path.join(root, "usr/sbin/nwamcfg"))
+            trace = read_trace(os.path.join(TRACE_DIR, "boot1.iosnoop"),
+                               root=root)
+            self.assertFalse("/usr/sbin/nwamcfg" in trace.rank)
+            self.assertTrue("/usr/bin/rarely_used" in trace.rank)
+        finally:
+            os.rmdir(os.path.join(root, "usr/sbin/nwamcfg"))
+            os.rmdir(os.path.join(root, "usr/sbin"))
+            os.rmdir(os.path.join(root, "usr"))
+            os.rmdir(root)
+
+
+class LayoutTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.optimizer = load_optimizer()
+
+    def test_ranking(self):
+        ''' files read early in every boot come first, one-offs last '''
+        ranked = self.optimizer.ranked()
+        self.assertEqual(ranked[0], "/usr/lib/libglib-2.0.so.0")
+        self.assertEqual(ranked[-1], "/usr/bin/rarely_used")
+
+    def test_groups_cover_all_files(self):
+        ''' every ranked file appears in exactly one group '''
+        layout = self.optimizer.layout()
+        self.assertEqual(sorted(layout), sorted(self.optimizer.ranked()))
+        self.assertEqual(len(layout), len(set(layout)))
+
+    def test_coaccess_grouping(self):
+        ''' consistently co-read files are kept together '''
+        group = self.optimizer.groups()[0]
+        self.assertTrue("/usr/share/hwdata/pci.ids" in group)
+        self.assertTrue("/usr/share/hwdata/usb.ids" in group)
+        self.assertFalse("/usr/bin/rarely_used" in group)
+
+    def test_sort_list(self):
+        ''' weights descend from the base, catch-all entry last '''
+        lines = self.optimizer.sort_list(base_weight=100,
+                                         preamble=["boot\t200\n"])
+        self.assertEqual(lines[0], "boot\t200\n")
+        self.assertEqual(lines[1], "usr/lib/libglib-2.0.so.0\t100\n")
+        self.assertEqual(lines[-1], "usr\t%d\n" % (100 - len(lines) + 2))
+
+    def test_sort_list_roundtrip(self):
+        ''' a written sort list reads back in layout order '''
+        (fd, name) = tempfile.mkstemp()
+        try:
+            with os.fdopen(fd, "w") as sfile:
+                sfile.writelines(self.optimizer.sort_list())
+            order = read_sort_list(name)
+        finally:
+            os.unlink(name)
+        self.assertEqual(order[:-1], self.optimizer.layout())
+
+    def test_seek_reduction(self):
+        ''' the proposed layout needs fewer seeks than an unsorted one '''
+        report = self.optimizer.seek_report()
+        total = [line for line in report.splitlines()
+                 if line.startswith("total")][0].split()
+        self.assertTrue(int(total[3]) < int(total[2]))
+        self.assertTrue("Expected seek reduction" in report)
+
+    def test_baseline_is_layout(self):
+        ''' comparing a layout against itself shows no reduction '''
+        report = self.optimizer.seek_report(self.optimizer.layout())
+        self.assertTrue("reduction: 0.0% of seeks, 0.0% of seek" in report)
+
+
+class ReadaheadTestCase(unittest.TestCase):
+
+    MARKERS = [("services", "/usr/lib/hal/hald"),
+               ("net", "/usr/sbin/nwamcfg")]
+
+    def setUp(self):
+        self.optimizer = load_optimizer()
+
+    def test_single_phase(self):
+        ''' without markers everything is in the boot phase '''
+        phases = self.optimizer.phases()
+        self.assertEqual(len(phases), 1)
+        self.assertEqual(phases[0][0], "boot")
+        self.assertEqual(phases[0][1], self.optimizer.layout())
+
+    def test_phase_markers(self):
+        ''' files go to the earliest phase they were read in '''
+        phases = dict(self.optimizer.phases(self.MARKERS))
+        self.assertTrue("/usr/lib/libglib-2.0.so.0" in phases["boot"])
+        self.assertTrue("/usr/lib/hal/hald" in phases["services"])
+        # pci.ids is read before hald in two of the three boots
+        self.assertTrue("/usr/share/hwdata/pci.ids" in phases["boot"])
+        self.assertTrue("/usr/bin/rarely_used" in phases["net"])
+
+    def test_manifest_format(self):
+        ''' phase lines followed by chunk-aligned extents '''
+        lines = self.optimizer.readahead_manifest(self.MARKERS, chunk=4096)
+        self.assertEqual(lines[0], "phase boot\n")
+        paths = []
+        for line in lines:
+            fields = line.split()
+            if fields[0] == "phase":
+                continue
+            paths.append(fields[0])
+            self.assertEqual(fields[1], "0")
+            self.assertEqual(int(fields[2]) % 4096, 0)
+        self.assertEqual(sorted(paths), sorted(self.optimizer.layout()))
+        self.assertTrue("/usr/lib/libglib-2.0.so.0 0 12288\n" in lines)
+
+    def test_media_order(self):
+        ''' the manifest follows the sort list the image is built with '''
+        layout = self.optimizer.layout()
+        (fd, name) = tempfile.mkstemp()
+        with os.fdopen(fd, "w") as sfile:
+            sfile.write("usr/bin/rarely_used\t300\n")
+            sfile.write("usr/lib/hal/hald\t200\n")
+            sfile.write("usr/not/traced\t100\n")
+            sfile.write("usr\t1\n")
+        try:
+            order = self.optimizer.media_order(read_sort_list(name))
+        finally:
+            os.unlink(name)
+        self.assertEqual(order[:2], ["/usr/bin/rarely_used",
+                                     "/usr/lib/hal/hald"])
+        self.assertEqual(order[2:], sorted(order[2:]))
+        self.assertEqual(sorted(order), sorted(layout))
+
+        lines = self.optimizer.readahead_manifest(chunk=4096, order=order)
+        paths = [line.split()[0] for line in lines[1:]]
+        self.assertEqual(paths, order)
+        self.assertNotEqual(paths, layout)
+
+    def test_unsorted_order(self):
+        ''' an image built without a sort list is in name order '''
+        order = self.optimizer.media_order()
+        self.assertEqual(order, sorted(self.optimizer.layout()))
+        phases = dict(self.optimizer.phases(ReadaheadTestCase.MARKERS,
+                                            order))
+        for paths in phases.values():
+            self.assertEqual(paths, sorted(paths))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,151 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_lsjournal.py
+
+'''
+
+import os
+import struct
+import tempfile
+import unittest
+
+from osol_install.lsjournal import read_journal, render_format, \
+    filter_messages, parse_time, JournalError, JournalMessage, LOG_LEVEL
+
+START = 1262304000      # Jan 01 00:00:00 2010
+
+
+def record(rec_type, data):
+    ''' Return a journal record '''
+    return struct.pack("=Hc", len(data) + 3, rec_type) + data
+
+
+def process(hrtime):
+    ''' Return the record of a process start '''
+    return record(b"H", struct.pack("=qqq", START, 0, hrtime))
+
+
+def fmt(fmt_id, text):
+    ''' Return the record of a format string '''
+    return record(b"F", struct.pack("=I", fmt_id) + text + b"\0")
+
+
+def message(hrtime, fmt_id, level, module, args=b""):
+    ''' Return the record of a message '''
+    return record(b"M", struct.pack("=qIbB", hrtime, fmt_id, level,
+                  len(module)) + module + args)
+
+
+def chunk(pid, records):
+    ''' Return a journal chunk '''
+    data = b"".join(records)
+    return b"LSJ1" + struct.pack("=III", 0x01020304, len(data) + 16,
+                                 pid) + data
+
+
+class RenderTestCase(unittest.TestCase):
+
+    def test_conversions(self):
+        ''' arguments are formatted as printf would '''
+        self.assertEqual(render_format("%d|%5s|%-3d|%%|%x",
+                                       [-2, "ab", 7, 255]),
+                         "-2|   ab|7  |%|ff")
+        self.assertEqual(render_format("%u %lx %hhd", [-1, -1, 255]),
+                         "4294967295 ffffffffffffffff -1")
+        self.assertEqual(render_format("%.2f %*d %p %c", [1.5, 4, 3, 16, 65]),
+                         "1.50    3 0x10 A")
+        self.assertEqual(render_format("%'d%n", [1000]), "1000")
+
+    def test_missing_args(self):
+        ''' conversions without arguments are kept '''
+        self.assertEqual(render_format("a %s b %d", ["x"]), "a x b %d")
+
+
+class JournalTestCase(unittest.TestCase):
+
+    def setUp(self):
+        (fd, self.journal) = tempfile.mkstemp()
+        os.close(fd)
+
+    def tearDown(self):
+        os.unlink(self.journal)
+
+    def write(self, *chunks):
+        with open(self.journal, "wb") as jfile:
+            jfile.write(b"".join(chunks))
+
+    def test_read(self):
+        ''' messages of interleaved processes are decoded '''
+        args = b"i" + struct.pack("=i", 3) + b"s" + struct.pack("=H", 2) + \
+            b"ok"
+        self.write(
+            chunk(10, [process(5000000000), fmt(0, b"%d %s\n"),
+                       message(6000000000, 0, 2, b"TI", args)]),
+            chunk(11, [process(0), fmt(0, b"%s"),
+                       message(500000000, 0, LOG_LEVEL, b"ORCHESTRATOR",
+                               b"s" + struct.pack("=H", 3) + b"hi\n")]),
+            chunk(10, [message(7000000000, 0, 4, b"TI", args)]))
+        msgs = read_journal(self.journal)
+        self.assertEqual([m.pid for m in msgs], [10, 11, 10])
+        self.assertEqual(msgs[0].log_line(),
+                         "<TI_E Jan  1 00:00:01> 3 ok\n")
+        self.assertEqual(msgs[1].log_line(),
+                         "<ORCHESTRATOR Jan  1 00:00:00> hi\n")
+        self.assertEqual(msgs[2].time, START + 2)
+        self.assertEqual(msgs[1].to_dict()["level"], "log")
+
+        self.assertEqual(len(filter_messages(msgs, modules=["TI"])), 2)
+        self.assertEqual(len(filter_messages(msgs, max_level=3)), 2)
+        self.assertEqual(len(filter_messages(msgs, start=START + 1,
+                                             end=START + 2)), 1)
+        self.assertEqual(parse_time("2010-01-01T00:00:01"), START + 1)
+
+    def test_time_stamp(self):
+        ''' days are padded with a blank, as asctime() pads them '''
+        msg = JournalMessage(10, 0, START + 9 * 86400 + 3723, "TI",
+                             LOG_LEVEL, "x", [])
+        self.assertEqual(msg.log_line(), "<TI Jan 10 01:02:03> x")
+        msg.time = START + 4 * 86400
+        self.assertEqual(msg.log_line(), "<TI Jan  5 00:00:00> x")
+        msg.time = None
+        self.assertEqual(msg.log_line(), "<TI --:--:--> x")
+
+    def test_truncated(self):
+        ''' a chunk cut short at the end is ignored, garbage is an error '''
+        whole = chunk(10, [process(0), fmt(0, b"x"),
+                           message(1, 0, LOG_LEVEL, b"A")])
+        self.write(whole, whole[:-4])
+        self.assertEqual(len(read_journal(self.journal)), 1)
+        self.write(whole, b"garbage" * 4)
+        self.assertRaises(JournalError, read_journal, self.journal)
+
+
+if __name__ == '__main__':
+    unittest.main()
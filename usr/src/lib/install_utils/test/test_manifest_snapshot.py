@@ -0,0 +1,284 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_manifest_snapshot.py
+
+'''
+
+import errno
+import os
+import shutil
+import socket
+import tempfile
+import threading
+import unittest
+
+import osol_install.SocketServProtocol as SocketServProtocol
+from osol_install.ManifestRead import ManifestRead
+from osol_install.ManifestSnapshot import ManifestSnapshot, \
+    ManifestSnapshotError, write_snapshot, SNAPSHOT_SUFFIX
+
+
+class SnapshotTestCase(unittest.TestCase):
+
+    NODEPATHS = {"": [""], "pkgs/p": ["x", "y", "z"], "pkgs/e": [""],
+                 "pkgs/n": ["3"]}
+    KEYS = {"a": ["1"], "b": [""]}
+
+    def setUp(self):
+        (fd, self.name) = tempfile.mkstemp(suffix=".snap")
+        os.close(fd)
+        write_snapshot(self.name, "root", self.NODEPATHS, self.KEYS)
+        self.snap = ManifestSnapshot(self.name)
+
+    def tearDown(self):
+        os.unlink(self.name)
+
+    def test_nodepaths(self):
+        ''' plain nodepaths, with or without the root name '''
+        for (path, values) in self.NODEPATHS.items():
+            self.assertEqual(self.snap.lookup(path), values)
+            self.assertEqual(self.snap.lookup(("root/" + path).rstrip("/")),
+                             values)
+        self.assertEqual(self.snap.lookup(" pkgs/p "), ["x", "y", "z"])
+
+    def test_missing(self):
+        ''' plain nodepaths and keys not in the snapshot find nothing '''
+        self.assertEqual(self.snap.lookup("pkgs/nothing"), [])
+        self.assertEqual(self.snap.lookup("nothing", True), [])
+
+    def test_keys(self):
+        ''' keys are separate from nodepaths '''
+        self.assertEqual(self.snap.lookup("a", True), ["1"])
+        self.assertEqual(self.snap.lookup("b", True), [""])
+        self.assertEqual(self.snap.lookup("a"), [])
+
+    def test_not_covered(self):
+        ''' values in brackets and ".." need the server '''
+        self.assertEqual(self.snap.lookup("pkgs[n=3]/p"), None)
+        self.assertEqual(self.snap.lookup("pkgs/p/.."), None)
+
+    def test_bad_file(self):
+        ''' files which aren't snapshots are rejected '''
+        with open(self.name, "wb") as snap_file:
+            snap_file.write(b"not a snapshot")
+        self.assertRaises(ManifestSnapshotError, ManifestSnapshot, self.name)
+
+
+class OwnerTestCase(unittest.TestCase):
+    ''' snapshots exported next to a socket by another process '''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.sock_name = os.path.join(self.tmpdir, "ManifestServ.1")
+        self.name = self.sock_name + SNAPSHOT_SUFFIX
+        self.server = None
+        self.done = None
+
+    def tearDown(self):
+        if (self.done is not None):
+            os.close(self.done)
+            os.waitpid(self.server, 0)
+        shutil.rmtree(self.tmpdir)
+
+    def export(self, keep):
+        ''' write the snapshot from a child, which holds it if keep '''
+        (ready_r, ready_w) = os.pipe()
+        (done_r, done_w) = os.pipe()
+        pid = os.fork()
+        if (pid == 0):
+            os.close(ready_r)
+            os.close(done_w)
+            lock = write_snapshot(self.name, "root", {"pkgs/p": ["x"]}, {},
+                                  keep)
+            os.write(ready_w, b"y")
+            if (keep):
+                os.read(done_r, 1)
+                lock.close()
+            os._exit(0)
+        os.close(ready_w)
+        os.close(done_r)
+        os.read(ready_r, 1)
+        os.close(ready_r)
+        if (keep):
+            self.server = pid
+            self.done = done_w
+        else:
+            os.close(done_w)
+            os.waitpid(pid, 0)
+
+    def serve_v1(self):
+        ''' listen on the socket, closing every link like a version 1
+        server does on the version request '''
+        listen_sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        listen_sock.bind(self.sock_name)
+        listen_sock.listen(2)
+
+        def serve():
+            for i in range(2):
+                (conn, addr) = listen_sock.accept()
+                conn.close()
+            listen_sock.close()
+        thread = threading.Thread(target=serve)
+        thread.start()
+        return thread
+
+    def test_live(self):
+        ''' the snapshot of a running server is used '''
+        self.export(True)
+        self.assertTrue(ManifestSnapshot(self.name).is_live())
+        reader = ManifestRead(self.sock_name)
+        self.assertNotEqual(reader.snapshot, None)
+        self.assertEqual(reader.snapshot.lookup("pkgs/p"), ["x"])
+
+    def test_server_exits(self):
+        ''' the snapshot is stale once its server is gone '''
+        self.export(True)
+        snap = ManifestSnapshot(self.name)
+        os.close(self.done)
+        os.waitpid(self.server, 0)
+        self.done = None
+        self.assertFalse(snap.is_live())
+
+    def test_stale(self):
+        ''' a stale snapshot is ignored in favour of the socket '''
+        self.export(False)
+        self.assertFalse(ManifestSnapshot(self.name).is_live())
+        thread = self.serve_v1()
+        reader = ManifestRead(self.sock_name)
+        self.assertEqual(reader.snapshot, None)
+        self.assertEqual(reader.protocol_version, 1)
+        reader.client_sock.close()
+        reader.client_sock = None
+        thread.join()
+
+    def test_replaced(self):
+        ''' a snapshot replaced after it was opened is stale '''
+        self.export(True)
+        snap = ManifestSnapshot(self.name)
+        os.unlink(self.name)
+        write_snapshot(self.name, "root", {}, {})
+        self.assertFalse(snap.is_live())
+
+    def test_named(self):
+        ''' a snapshot named explicitly is used even when stale '''
+        self.export(False)
+        reader = ManifestRead(self.name)
+        self.assertEqual(reader.snapshot.lookup("pkgs/p"), ["x"])
+
+
+class BatchTestCase(unittest.TestCase):
+    ''' requests sent in version 2 batches '''
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.sock_name = os.path.join(self.tmpdir, "ManifestServ.1")
+        self.sizes = []
+        self.items = []
+        listen_sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        listen_sock.bind(self.sock_name)
+        listen_sock.listen(1)
+        self.thread = threading.Thread(target=self.serve_v2,
+                                       args=(listen_sock,))
+        self.thread.start()
+        self.reader = ManifestRead(self.sock_name)
+
+    def tearDown(self):
+        self.reader.client_sock.send(SocketServProtocol.TERM_LINK.encode())
+        self.reader.client_sock.close()
+        self.reader.client_sock = None
+        self.thread.join()
+        shutil.rmtree(self.tmpdir)
+
+    def serve_v2(self, listen_sock):
+        ''' answer the batches of one link, each request finding its
+        length '''
+        (conn, addr) = listen_sock.accept()
+        listen_sock.close()
+        recv_exact = SocketServProtocol.recv_exact
+        recv_exact(conn, SocketServProtocol.PRE_REQ_SIZE)
+        conn.sendall(SocketServProtocol.PROTOCOL_VERSION.encode())
+        while True:
+            pre_request = recv_exact(conn, 1).decode()
+            if (pre_request != SocketServProtocol.BATCH_REQ):
+                break
+            pre_request += recv_exact(conn,
+                SocketServProtocol.PRE_REQ_SIZE - 1).decode()
+            size = int(pre_request[2:])
+            self.sizes.append(size)
+            requests = recv_exact(conn, size).decode().split(
+                SocketServProtocol.STRING_SEP)[:-1]
+            self.items.extend(requests)
+            reply = "".join(["1" + SocketServProtocol.STRING_SEP +
+                             str(len(request) - 1) +
+                             SocketServProtocol.STRING_SEP
+                             for request in requests])
+            reply = (reply + SocketServProtocol.REQ_COMPLETE).encode()
+            conn.sendall(("%*.*d" % (SocketServProtocol.BATCH_SIZE_LEN,
+                                     SocketServProtocol.BATCH_SIZE_LEN,
+                                     len(reply))).encode() + reply)
+        conn.close()
+
+    def test_one_batch(self):
+        ''' small requests go in one batch '''
+        self.assertEqual(self.reader.get_values_many(["a", "bb"]),
+                         [["1"], ["2"]])
+        self.assertEqual(self.sizes, [7])
+
+    def test_mixed_keys(self):
+        ''' keys and nodepaths share a batch, each flagged on its own '''
+        self.assertEqual(self.reader.get_values_many(["a", "bb", "c"],
+                                                     [True, False, True]),
+                         [["1"], ["2"], ["1"]])
+        self.assertEqual(self.sizes, [10])
+        self.assertEqual(self.items, ["1a", "0bb", "1c"])
+
+    def test_split(self):
+        ''' requests too big for one batch are split over several '''
+        lengths = [300000, 400000, 300000, 5, 600000]
+        requests = ["x" * length for length in lengths]
+        self.assertEqual(self.reader.get_values_many(requests),
+                         [[str(length)] for length in lengths])
+        self.assertEqual(self.sizes, [700004, 900011])
+        for size in self.sizes:
+            self.assertTrue(size <= SocketServProtocol.MAX_REQ_SIZE)
+
+    def test_too_long(self):
+        ''' a request too big for any batch is refused '''
+        try:
+            self.reader.get_values_many(["a", "x" * 1000000])
+            self.fail("no error raised")
+        except socket.error as err:
+            self.assertEqual(err.errno, errno.EMSGSIZE)
+        self.assertEqual(self.sizes, [])
+        self.assertEqual(self.reader.get_values_many(["a"]), [["1"]])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,153 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_progress_ring.py
+
+'''
+
+import logging
+import os
+import struct
+import tempfile
+import unittest
+
+from osol_install.progress_ring import ProgressReader, ProgressWriter, \
+    ProgressLogHandler, ProgressRingError, HEADER_LEN, RECORD_LEN, \
+    STATUS, LOG, SOFTWARE_UPDATE, FAILED
+
+
+class ProgressRingTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.ring = os.path.join(self.tmpdir, "progress")
+
+    def tearDown(self):
+        if os.path.exists(self.ring):
+            os.unlink(self.ring)
+        os.rmdir(self.tmpdir)
+
+    def test_layout(self):
+        ''' header and records are laid out as om_progress.c has them '''
+        self.assertEqual(HEADER_LEN, 64)
+        self.assertEqual(RECORD_LEN, 256)
+        writer = ProgressWriter(self.ring, nrecords=4)
+        writer.post_status(SOFTWARE_UPDATE, 50, "Transferring", 1 << 20)
+        writer.close()
+        with open(self.ring, "rb") as ring_file:
+            data = ring_file.read()
+        self.assertEqual(len(data), HEADER_LEN + 4 * RECORD_LEN)
+        self.assertEqual(data[0:4], b"OMP1")
+        self.assertEqual(struct.unpack_from("=II", data, 4), (4, RECORD_LEN))
+        self.assertEqual(struct.unpack_from("=I", data, 16)[0], 1)
+        (seq, rec_type, phase, percent) = struct.unpack_from("=IHhh", data,
+                                                             HEADER_LEN)
+        self.assertEqual((seq, rec_type, phase, percent),
+                         (1, STATUS, SOFTWARE_UPDATE, 50))
+        self.assertEqual(struct.unpack_from("=Q", data, HEADER_LEN + 16)[0],
+                         1 << 20)
+
+    def test_follow(self):
+        ''' a reader gets each record once, in order '''
+        writer = ProgressWriter(self.ring, nrecords=8)
+        writer.post_status(SOFTWARE_UPDATE, 10, "Transferring")
+        reader = ProgressReader(self.ring)
+        writer.post_log("a line\n")
+        (records, lost) = reader.read()
+        self.assertEqual(lost, 0)
+        self.assertEqual([r.seq for r in records], [1, 2])
+        self.assertEqual(records[0].percent, 10)
+        self.assertEqual(records[1].rec_type, LOG)
+        self.assertEqual(records[1].message, "a line")
+        self.assertEqual(reader.read(), ([], 0))
+
+        writer.post_failure(208, "Target Instantiation failed")
+        (records, lost) = reader.read(max_records=5)
+        self.assertEqual(records[0].phase, FAILED)
+        self.assertEqual(records[0].status, 208)
+        self.assertEqual(records[0].to_dict()["type"], "status")
+        reader.close()
+        writer.close()
+
+    def test_lost(self):
+        ''' records overwritten before they are read are counted '''
+        writer = ProgressWriter(self.ring, nrecords=4)
+        reader = ProgressReader(self.ring)
+        for i in range(10):
+            writer.post_status(SOFTWARE_UPDATE, i)
+        (records, lost) = reader.read()
+        self.assertEqual(lost, 6)
+        self.assertEqual([r.percent for r in records], [6, 7, 8, 9])
+
+        # a reader attaching late starts with what is still in the ring
+        late = ProgressReader(self.ring)
+        self.assertEqual([r.seq for r in late.read()[0]], [7, 8, 9, 10])
+        late.close()
+        reader.close()
+        writer.close()
+
+    def test_replaced(self):
+        ''' a new installation replaces the ring, not the old mapping '''
+        writer = ProgressWriter(self.ring, nrecords=4)
+        writer.post_status(SOFTWARE_UPDATE, 99)
+        reader = ProgressReader(self.ring)
+        self.assertFalse(reader.replaced())
+        writer.close()
+        writer = ProgressWriter(self.ring, nrecords=4)
+        self.assertTrue(reader.replaced())
+        self.assertEqual(reader.read()[0][0].percent, 99)
+        reader.close()
+        writer.close()
+
+    def test_not_a_ring(self):
+        ''' other files are rejected '''
+        with open(self.ring, "wb") as ring_file:
+            ring_file.write(b"x" * 512)
+        self.assertRaises(ProgressRingError, ProgressReader, self.ring)
+
+    def test_log_handler(self):
+        ''' log records are posted as lines of the install log '''
+        writer = ProgressWriter(self.ring, nrecords=4)
+        logger = logging.getLogger("test_progress_ring")
+        logger.propagate = False
+        logger.setLevel(logging.DEBUG)
+        handler = ProgressLogHandler(writer)
+        logger.addHandler(handler)
+        logger.info("transfer started")
+        logger.debug("not posted")
+        logger.removeHandler(handler)
+        reader = ProgressReader(self.ring)
+        records = reader.read()[0]
+        self.assertEqual([r.message for r in records], ["transfer started"])
+        reader.close()
+        writer.close()
+
+
+if __name__ == '__main__':
+    unittest.main()
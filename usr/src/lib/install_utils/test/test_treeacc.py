@@ -0,0 +1,236 @@
+#!/usr/bin/python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+#
+
+'''
+To run these tests:
+
+1) nightly -n developer.sh # build the gate
+2) export PYTHONPATH=${WS}/proto/root_i386/usr/lib/python3.9/vendor-packages
+3) python test_treeacc.py
+
+'''
+
+import os
+import tempfile
+import unittest
+
+from osol_install.ENParser import compile_nodepath
+from osol_install.TreeAcc import TreeAcc, TreeAccNode
+
+MANIFEST = '''<?xml version="1.0"?>
+<distribution name="test">
+  <params>
+    <build_area>/export/build</build_area>
+    <repo>
+      <main authname="opensolaris.org" url="http://pkg.opensolaris.org"/>
+      <mirror url="http://mirror1"/>
+      <mirror url="http://mirror2"/>
+    </repo>
+  </params>
+  <packages>
+    <pkg name="SUNWcs"/>
+    <pkg name="SUNWcsd"/>
+    <pkg name="entire" attrs="incorporation"/>
+  </packages>
+  <output>
+    <finalizer>
+      <script name="pre_boot_archive">
+        <checkpoint name="ba-init"/>
+        <argslist>"a" "b"</argslist>
+      </script>
+      <script name="boot_archive_archive">
+        <checkpoint name="ba-arch"/>
+      </script>
+    </finalizer>
+  </output>
+</distribution>
+'''
+
+
+def values(nodes):
+    return [node.get_value() for node in nodes]
+
+
+class FindTestCase(unittest.TestCase):
+
+    def setUp(self):
+        (fd, self.name) = tempfile.mkstemp(suffix=".xml")
+        with os.fdopen(fd, "w") as mfile:
+            mfile.write(MANIFEST)
+        self.tree = TreeAcc(self.name)
+
+    def tearDown(self):
+        os.unlink(self.name)
+
+    def test_element_value(self):
+        ''' root name is optional, element values are found '''
+        self.assertEqual(values(self.tree.find_node("params/build_area")),
+                         ["/export/build"])
+        self.assertEqual(
+            values(self.tree.find_node("distribution/params/build_area")),
+            ["/export/build"])
+
+    def test_root(self):
+        ''' the root alone, and the root with a matching value '''
+        nodes = self.tree.find_node("distribution")
+        self.assertEqual(len(nodes), 1)
+        self.assertEqual(nodes[0], self.tree.treeroot_ta_node)
+        self.assertEqual(len(self.tree.find_node("distribution[name=test]")),
+                         1)
+        self.assertEqual(self.tree.find_node("distribution[name=x]/params"),
+                         [])
+
+    def test_attributes_in_order(self):
+        ''' attributes of same-named elements, in document order '''
+        self.assertEqual(values(self.tree.find_node("packages/pkg/name")),
+                         ["SUNWcs", "SUNWcsd", "entire"])
+        self.assertEqual(values(self.tree.find_node("params/repo/mirror/url")),
+                         ["http://mirror1", "http://mirror2"])
+        nodes = self.tree.find_node("packages/pkg/attrs")
+        self.assertEqual(len(nodes), 1)
+        self.assertTrue(nodes[0].is_attr())
+        self.assertEqual(nodes[0].get_path(), "packages/pkg/attrs")
+
+    def test_valpath(self):
+        ''' bracketed valpaths select among siblings '''
+        nodes = self.tree.find_node(
+            "output/finalizer/script[checkpoint/name=ba-arch]/name")
+        self.assertEqual(values(nodes), ["boot_archive_archive"])
+        nodes = self.tree.find_node(
+            "output/finalizer/script[name=pre_boot_archive]/argslist")
+        self.assertEqual(values(nodes), ['"a" "b"'])
+        self.assertEqual(self.tree.find_node("packages/pkg[name=none]"), [])
+
+    def test_dots(self):
+        ''' ".." finds each parent once '''
+        nodes = self.tree.find_node("packages/pkg/..")
+        self.assertEqual(len(nodes), 1)
+        self.assertEqual(nodes[0].get_name(), "packages")
+        nodes = self.tree.find_node(
+            "output/finalizer/script/checkpoint[name=ba-init]/../name")
+        self.assertEqual(values(nodes), ["pre_boot_archive"])
+
+    def test_missing(self):
+        ''' paths not in the tree find nothing '''
+        self.assertEqual(self.tree.find_node("params/nothing"), [])
+        self.assertEqual(self.tree.find_node("nothing/build_area"), [])
+
+    def test_mid_tree(self):
+        ''' searches starting from a found node '''
+        repo = self.tree.find_node("params/repo")[0]
+        self.assertEqual(values(self.tree.find_node("mirror/url", repo)),
+                         ["http://mirror1", "http://mirror2"])
+        self.assertEqual(values(self.tree.find_node("../build_area", repo)),
+                         ["/export/build"])
+        main = self.tree.find_node("main", repo)[0]
+        self.assertEqual(values(self.tree.find_node("authname", main)),
+                         ["opensolaris.org"])
+
+    def test_is_leaf(self):
+        ''' only child elements make a node a non-leaf '''
+        self.assertFalse(self.tree.find_node("params")[0].is_leaf())
+        self.assertFalse(self.tree.treeroot_ta_node.is_leaf())
+        # a text child only
+        self.assertTrue(self.tree.find_node("params/build_area")[0].is_leaf())
+        # attributes only
+        self.assertTrue(self.tree.find_node("packages/pkg")[0].is_leaf())
+        self.assertTrue(self.tree.find_node("packages/pkg/name")[0].is_leaf())
+
+    def test_repr(self):
+        ''' nodes of the compact tree can be printed '''
+        self.assertTrue("build_area" in
+                        repr(self.tree.find_node("params/build_area")[0]))
+        self.assertTrue("name" in
+                        repr(self.tree.find_node("packages/pkg/name")[0]))
+        self.assertTrue(repr(self.tree.find_node("params/repo")[0]))
+
+    def test_add_node(self):
+        ''' added elements are found in document order '''
+        pkgs = self.tree.find_node("packages")[0]
+        self.tree.add_node("pkg", None, TreeAccNode.ELEMENT, pkgs, False)
+        self.assertEqual(len(self.tree.find_node("packages/pkg")), 4)
+
+        # A new element under the first of two parents sorts before the
+        # existing one under the second.
+        scripts = self.tree.find_node("output/finalizer/script")
+        self.tree.add_node("checkpoint", None, TreeAccNode.ELEMENT,
+                           scripts[0], False)
+        nodes = self.tree.find_node("output/finalizer/script/checkpoint")
+        self.assertEqual([node.get_element_node().parentNode.getAttribute(
+                         "name") for node in nodes],
+                         ["pre_boot_archive", "pre_boot_archive",
+                          "boot_archive_archive"])
+
+        self.tree.add_node("params/iso_name", "test.iso",
+                           TreeAccNode.ELEMENT)
+        self.assertEqual(values(self.tree.find_node("params/iso_name")),
+                         ["test.iso"])
+
+    def test_replace_value(self):
+        ''' replaced values are seen by later searches '''
+        self.tree.replace_value("packages/pkg[name=entire]/attrs", "none")
+        self.assertEqual(values(self.tree.find_node("packages/pkg/attrs")),
+                         ["none"])
+        self.tree.replace_value("params/build_area", "other")
+        self.assertEqual(values(self.tree.find_node("params/build_area")),
+                         ["other"])
+        self.assertEqual(len(self.tree.find_node("params/build_area=other")),
+                         1)
+
+    def test_save_tree(self):
+        ''' a saved tree loads back the same, with changes '''
+        self.tree.replace_value("params/build_area", "a<b & \"c\"")
+        (fd, saved) = tempfile.mkstemp(suffix=".xml")
+        os.close(fd)
+        try:
+            self.tree.save_tree(saved)
+            with open(saved) as sfile:
+                text = sfile.read()
+            self.assertTrue("a&lt;b &amp; &quot;c&quot;" in text)
+            self.assertTrue("<mirror url=\"http://mirror1\"/>" in text)
+            tree = TreeAcc(saved)
+        finally:
+            os.unlink(saved)
+        self.assertEqual(values(tree.find_node("params/build_area")),
+                         ['a<b & "c"'])
+        self.assertEqual(values(tree.find_node("packages/pkg/name")),
+                         ["SUNWcs", "SUNWcsd", "entire"])
+
+
+class CompileTestCase(unittest.TestCase):
+
+    def test_cached_copy(self):
+        ''' callers may change the token list they are given '''
+        tokens = compile_nodepath("a/b[c=d]/e")
+        self.assertEqual([token.name for token in tokens], ["a", "b", "e"])
+        tokens.insert(0, tokens[0])
+        tokens.pop()
+        again = compile_nodepath("a/b[c=d]/e")
+        self.assertEqual([token.name for token in again], ["a", "b", "e"])
+        self.assertEqual(again[1].valpaths, ["c"])
+        self.assertEqual(again[1].values, ["d"])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -52,7 +52,8 @@ typedef enum {
 typedef enum {
 	LS_DEST_NONE = 0,
 	LS_DEST_CONSOLE = 0x01,
-	LS_DEST_FILE = 0x02
+	LS_DEST_FILE = 0x02,
+	LS_DEST_JOURNAL = 0x04	/* binary journal, see ls_decode(1) */
 } ls_dest_t;
 
 /* debugging levels */
@@ -66,6 +67,15 @@ typedef enum {
 	LS_DBGLVL_LAST	/* serves only as end mark of the list */
 } ls_dbglvl_t;
 
+/*
+ * what to do with a message when the buffer of the log writer
+ * thread is full
+ */
+typedef enum {
+	LS_OVERFLOW_DROP = 0,	/* drop info debug messages, wait otherwise */
+	LS_OVERFLOW_BLOCK	/* wait for room */
+} ls_overflow_t;
+
 /*
  * select either stdout, stderr, or both
  */
@@ -112,6 +122,9 @@ void ls_register_log_method(ls_log_method_t func);
 /* register alternate method performing actual posting of debug message */
 void ls_register_dbg_method(ls_dbg_method_t func);
 
+/* wait until messages are posted by the log writer thread */
+void ls_flush(void);
+
 /* nvlist attributes for customizing logging service */
 
 /* log file */
@@ -126,6 +139,15 @@ void ls_register_dbg_method(ls_dbg_method_t func);
 /* timestamp */
 #define	LS_ATTR_TIMESTAMP	"ls_timestamp"
 
+/* journal file */
+#define	LS_ATTR_JOURNAL		"ls_journal"
+
+/* post messages from a log writer thread (boolean) */
+#define	LS_ATTR_ASYNC		"ls_async"
+
+/* writer thread buffer overflow policy (ls_overflow_t as int16) */
+#define	LS_ATTR_OVERFLOW	"ls_overflow"
+
 /* destination log file path */
 #define	LS_LOGFILE_DST_PATH	"/var/sadm/system/logs/"
 
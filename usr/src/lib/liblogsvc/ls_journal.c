@@ -0,0 +1,780 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Binary message journal.
+ *
+ * Instead of the formatted text, a message is journaled as the id of its
+ * format string and its raw arguments, with module id, level and a
+ * gethrtime(3C) time stamp. Each format string is journaled once per
+ * process. Messages are rendered by the ls_decode tool.
+ *
+ * Records are collected in a buffer and appended to the journal in
+ * chunks, each with a single write(2), so several processes can share
+ * a journal. All integers are in the byte order of the writing
+ * process, given by each chunk.
+ *
+ * chunk:	magic "LSJ1", uint32 0x01020304, uint32 chunk length
+ *		(with this header), uint32 process id, records
+ * record:	uint16 record length (with this header), uint8 type, data
+ *
+ * type 'H' - process start, first record of each process
+ *		int64 time of day (seconds), int64 nanoseconds,
+ *		int64 gethrtime() at the same time
+ * type 'F' - format string
+ *		uint32 format id, string with terminating NUL
+ * type 'M' - message
+ *		int64 gethrtime(), uint32 format id, int8 level (-1 for
+ *		log messages), uint8 module id length, module id,
+ *		arguments in format order, each a tag byte and the value:
+ *		'i' int32, 'l' int64, 'd' double, 'p' uint64,
+ *		's' uint16 length and the bytes
+ *
+ * Width and precision given by '*' are int32 arguments. Strings may be
+ * truncated to fit the record. Messages whose format can't be parsed
+ * are journaled formatted, as the only argument of format "%s".
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ls_journal.h>
+
+/* size of chunk buffer */
+#define	LS_JOURNAL_CHUNK	(32 * 1024)
+
+/* size of chunk header */
+#define	LS_JOURNAL_CHUNK_HDR	16
+
+/* max size of a record */
+#define	LS_JOURNAL_RECMAX	4096
+
+/* size of record header */
+#define	LS_JOURNAL_REC_HDR	3
+
+/* max size of record data */
+#define	LS_JOURNAL_DATAMAX	(LS_JOURNAL_RECMAX - LS_JOURNAL_REC_HDR)
+
+/* number of format table entries (power of 2) */
+#define	LS_JOURNAL_FORMATS	4096
+
+/* format table doesn't take more than 3/4 of entries */
+#define	LS_JOURNAL_FORMATS_MAX	(LS_JOURNAL_FORMATS / 4 * 3)
+
+/* no format id */
+#define	LS_JOURNAL_NO_ID	((uint32_t)-1)
+
+/* format of messages journaled formatted */
+static const char	ls_journal_text_fmt[] = "%s";
+
+/*
+ * Format table entry. Format strings are looked up by address, and
+ * checked by content, as callers may reuse a buffer for formats.
+ */
+typedef struct ls_jformat {
+	const char	*addr;
+	char		*fmt;
+	uint32_t	id;
+} ls_jformat_t;
+
+/* all state below is protected by ls_journal_mutex */
+static pthread_mutex_t	ls_journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* journal file */
+static int		ls_journal_fd = -1;
+
+/* chunk being collected, records start after the chunk header */
+static char		ls_journal_buf[LS_JOURNAL_CHUNK];
+static size_t		ls_journal_len = LS_JOURNAL_CHUNK_HDR;
+
+/* format table */
+static ls_jformat_t	ls_journal_formats[LS_JOURNAL_FORMATS];
+static uint32_t		ls_journal_nformats = 0;
+
+/* process start record was journaled */
+static boolean_t	ls_journal_started = B_FALSE;
+
+/* ------------------------ local functions --------------------------- */
+
+/*
+ * Function:	ls_journal_put
+ * Description:	Appends value to a record being built
+ *
+ * Parameters:	rec - record
+ *		len - length of record so far, updated
+ *		size - size of rec
+ *		val - value
+ *		val_len - size of value
+ *
+ * Return:	0 - value appended
+ *		-1 - no room
+ */
+static int
+ls_journal_put(char *rec, size_t *len, size_t size, const void *val,
+    size_t val_len)
+{
+	if (*len + val_len > size)
+		return (-1);
+
+	(void) memcpy(rec + *len, val, val_len);
+	*len += val_len;
+
+	return (0);
+}
+
+
+/*
+ * Function:	ls_journal_put_arg
+ * Description:	Appends tagged argument to a record being built
+ *
+ * Parameters:	rec - record
+ *		len - length of record so far, updated
+ *		size - size of rec
+ *		tag - argument tag
+ *		val - value
+ *		val_len - size of value
+ *
+ * Return:	0 - argument appended
+ *		-1 - no room
+ */
+static int
+ls_journal_put_arg(char *rec, size_t *len, size_t size, char tag,
+    const void *val, size_t val_len)
+{
+	if (*len + 1 + val_len > size)
+		return (-1);
+
+	(void) ls_journal_put(rec, len, size, &tag, 1);
+	(void) ls_journal_put(rec, len, size, val, val_len);
+
+	return (0);
+}
+
+
+/*
+ * Function:	ls_journal_put_args
+ * Description:	Appends the arguments of a message to a record being
+ *		built, according to its format
+ *
+ * Parameters:	rec - record
+ *		len - length of record so far, updated
+ *		size - size of rec
+ *		fmt - message format
+ *		ap - message arguments
+ *
+ * Return:	0 - arguments appended
+ *		-1 - format not supported, or no room
+ */
+static int
+ls_journal_put_args(char *rec, size_t *len, size_t size, const char *fmt,
+    va_list ap)
+{
+	const char	*p;
+	const char	*str;
+	int		lmod;
+	int32_t		ival;
+	int64_t		lval;
+	uint64_t	pval;
+	double		dval;
+	uint16_t	slen;
+	size_t		n;
+
+	for (p = fmt; *p != '\0'; p++) {
+		if (*p != '%')
+			continue;
+
+		if (*++p == '%')
+			continue;
+
+		/* flags */
+		while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+			p++;
+
+		/* width */
+		if (*p == '*') {
+			ival = va_arg(ap, int);
+			if (ls_journal_put_arg(rec, len, size, LS_JARG_INT,
+			    &ival, sizeof (ival)) != 0)
+				return (-1);
+			p++;
+		} else {
+			while (isdigit(*p))
+				p++;
+		}
+
+		/* precision */
+		if (*p == '.') {
+			if (*++p == '*') {
+				ival = va_arg(ap, int);
+				if (ls_journal_put_arg(rec, len, size,
+				    LS_JARG_INT, &ival, sizeof (ival)) != 0)
+					return (-1);
+				p++;
+			} else {
+				while (isdigit(*p))
+					p++;
+			}
+		}
+
+		/* length modifier: 0 - int, 'l' - long, 'q' - long long */
+		lmod = 0;
+		switch (*p) {
+			case 'h':
+				if (*++p == 'h')
+					p++;
+				break;
+
+			case 'l':
+				if (*++p == 'l') {
+					p++;
+					lmod = 'q';
+				} else
+					lmod = 'l';
+				break;
+
+			case 'j':
+				p++;
+				lmod = 'q';
+				break;
+
+			case 'z':
+			case 't':
+				p++;
+				lmod = 'l';
+				break;
+
+			case 'L':
+				p++;
+				lmod = 'L';
+				break;
+
+			default:
+				break;
+		}
+
+		switch (*p) {
+			case 'd':
+			case 'i':
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+			case 'c':
+				if (lmod == 'q') {
+					lval = va_arg(ap, long long);
+				} else if (lmod == 'l') {
+					lval = va_arg(ap, long);
+				} else {
+					ival = va_arg(ap, int);
+					if (ls_journal_put_arg(rec, len, size,
+					    LS_JARG_INT, &ival,
+					    sizeof (ival)) != 0)
+						return (-1);
+					break;
+				}
+				if (ls_journal_put_arg(rec, len, size,
+				    LS_JARG_LONG, &lval, sizeof (lval)) != 0)
+					return (-1);
+				break;
+
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				if (lmod == 'L')
+					dval = (double)va_arg(ap, long double);
+				else
+					dval = va_arg(ap, double);
+				if (ls_journal_put_arg(rec, len, size,
+				    LS_JARG_DOUBLE, &dval, sizeof (dval)) != 0)
+					return (-1);
+				break;
+
+			case 's':
+				/* wide strings are not supported */
+				if (lmod != 0)
+					return (-1);
+
+				if ((str = va_arg(ap, const char *)) == NULL)
+					str = "(null)";
+
+				/* truncate string to the room left */
+				if (*len + 1 + sizeof (slen) >= size)
+					return (-1);
+				n = strlen(str);
+				if (n > size - *len - 1 - sizeof (slen))
+					n = size - *len - 1 - sizeof (slen);
+				if (n > LS_MESSAGE_MAXLEN)
+					n = LS_MESSAGE_MAXLEN;
+				slen = (uint16_t)n;
+
+				(void) ls_journal_put_arg(rec, len, size,
+				    LS_JARG_STRING, &slen, sizeof (slen));
+				(void) ls_journal_put(rec, len, size, str, n);
+				break;
+
+			case 'p':
+				pval = (uint64_t)(uintptr_t)va_arg(ap, void *);
+				if (ls_journal_put_arg(rec, len, size,
+				    LS_JARG_POINTER, &pval, sizeof (pval)) != 0)
+					return (-1);
+				break;
+
+			case 'n':
+				/* nothing is written */
+				(void) va_arg(ap, void *);
+				break;
+
+			default:
+				return (-1);
+		}
+	}
+
+	return (0);
+}
+
+
+/*
+ * Function:	ls_journal_write_chunk
+ * Description:	Writes collected records to the journal with a single
+ *		write, and starts a new chunk. Called with
+ *		ls_journal_mutex held.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+static void
+ls_journal_write_chunk(void)
+{
+	uint32_t	val;
+	char		*p = ls_journal_buf;
+	ssize_t		ret;
+	size_t		left;
+
+	if (ls_journal_len == LS_JOURNAL_CHUNK_HDR)
+		return;
+
+	(void) memcpy(p, LS_JOURNAL_MAGIC, 4);
+	val = 0x01020304;
+	(void) memcpy(p + 4, &val, 4);
+	val = (uint32_t)ls_journal_len;
+	(void) memcpy(p + 8, &val, 4);
+	val = (uint32_t)getpid();
+	(void) memcpy(p + 12, &val, 4);
+
+	/* O_APPEND file, a short write is only expected on errors */
+	left = ls_journal_len;
+	while (ls_journal_fd != -1 && left > 0) {
+		ret = write(ls_journal_fd, p, left);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		p += ret;
+		left -= ret;
+	}
+
+	ls_journal_len = LS_JOURNAL_CHUNK_HDR;
+}
+
+
+/*
+ * Function:	ls_journal_add_record
+ * Description:	Adds record to the chunk, writing the chunk out first if
+ *		there is no room. Called with ls_journal_mutex held.
+ *
+ * Parameters:	type - record type
+ *		data - record data
+ *		len - length of data
+ *
+ * Return:
+ */
+static void
+ls_journal_add_record(char type, const char *data, size_t len)
+{
+	uint16_t	rec_len = (uint16_t)(LS_JOURNAL_REC_HDR + len);
+
+	assert(rec_len <= LS_JOURNAL_RECMAX);
+
+	if (ls_journal_len + rec_len > sizeof (ls_journal_buf))
+		ls_journal_write_chunk();
+
+	(void) memcpy(ls_journal_buf + ls_journal_len, &rec_len,
+	    sizeof (rec_len));
+	ls_journal_buf[ls_journal_len + 2] = type;
+	(void) memcpy(ls_journal_buf + ls_journal_len + LS_JOURNAL_REC_HDR,
+	    data, len);
+	ls_journal_len += rec_len;
+}
+
+
+/*
+ * Function:	ls_journal_start
+ * Description:	Journals process start record, if not done yet. Called
+ *		with ls_journal_mutex held.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+static void
+ls_journal_start(void)
+{
+	struct timespec	now;
+	int64_t		val[3];
+
+	if (ls_journal_started)
+		return;
+
+	ls_journal_started = B_TRUE;
+
+	(void) clock_gettime(CLOCK_REALTIME, &now);
+	val[0] = now.tv_sec;
+	val[1] = now.tv_nsec;
+	val[2] = gethrtime();
+
+	ls_journal_add_record(LS_JREC_PROCESS, (char *)val, sizeof (val));
+}
+
+
+/*
+ * Function:	ls_journal_format_id
+ * Description:	Looks up id of format string. A new format gets the next
+ *		id, and is journaled. Called with ls_journal_mutex held.
+ *
+ * Parameters:	fmt - format string
+ *
+ * Return:	format id
+ *		LS_JOURNAL_NO_ID - format table is full, or out of memory
+ */
+static uint32_t
+ls_journal_format_id(const char *fmt)
+{
+	ls_jformat_t	*entry;
+	uintptr_t	h;
+	char		rec[LS_JOURNAL_DATAMAX];
+	size_t		len;
+
+	h = ((uintptr_t)fmt >> 3) * 2654435761U;
+	for (;;) {
+		entry = &ls_journal_formats[h & (LS_JOURNAL_FORMATS - 1)];
+
+		if (entry->fmt == NULL)
+			break;
+
+		if (entry->addr == fmt && strcmp(entry->fmt, fmt) == 0)
+			return (entry->id);
+
+		h++;
+	}
+
+	/* new format */
+
+	len = strlen(fmt) + 1;
+	if (ls_journal_nformats >= LS_JOURNAL_FORMATS_MAX ||
+	    sizeof (uint32_t) + len > sizeof (rec) ||
+	    (entry->fmt = strdup(fmt)) == NULL)
+		return (LS_JOURNAL_NO_ID);
+
+	entry->addr = fmt;
+	entry->id = ls_journal_nformats++;
+
+	(void) memcpy(rec, &entry->id, sizeof (uint32_t));
+	(void) memcpy(rec + sizeof (uint32_t), fmt, len);
+	ls_journal_add_record(LS_JREC_FORMAT, rec, sizeof (uint32_t) + len);
+
+	return (entry->id);
+}
+
+
+/*
+ * Function:	ls_journal_put_header
+ * Description:	Builds the part of a message record before the arguments
+ *
+ * Parameters:	rec - record
+ *		len - length of record, set
+ *		id - module identification
+ *		level - message level
+ *
+ * Return:
+ */
+static void
+ls_journal_put_header(char *rec, size_t *len, const char *id, int level)
+{
+	int64_t		tstamp = gethrtime();
+	uint32_t	fmt_id = LS_JOURNAL_NO_ID;
+	int8_t		lvl = (int8_t)level;
+	uint8_t		id_len;
+	size_t		n = strlen(id);
+
+	id_len = (uint8_t)(n > LS_ID_MAXLEN ? LS_ID_MAXLEN : n);
+
+	*len = 0;
+	(void) ls_journal_put(rec, len, LS_JOURNAL_DATAMAX, &tstamp,
+	    sizeof (tstamp));
+
+	/* format id is filled in when known */
+	(void) ls_journal_put(rec, len, LS_JOURNAL_DATAMAX, &fmt_id,
+	    sizeof (fmt_id));
+	(void) ls_journal_put(rec, len, LS_JOURNAL_DATAMAX, &lvl, sizeof (lvl));
+	(void) ls_journal_put(rec, len, LS_JOURNAL_DATAMAX, &id_len,
+	    sizeof (id_len));
+	(void) ls_journal_put(rec, len, LS_JOURNAL_DATAMAX, id, id_len);
+}
+
+
+/*
+ * Function:	ls_journal_add_message
+ * Description:	Completes message record with the format id and adds it
+ *		to the chunk. Messages of error level and above are
+ *		written out right away.
+ *
+ * Parameters:	rec - record
+ *		len - length of record
+ *		fmt - message format
+ *		level - message level
+ *
+ * Return:	0 - message journaled
+ *		-1 - format id couldn't be assigned
+ */
+static int
+ls_journal_add_message(char *rec, size_t len, const char *fmt, int level)
+{
+	uint32_t	fmt_id;
+
+	(void) pthread_mutex_lock(&ls_journal_mutex);
+
+	if (ls_journal_fd == -1) {
+		(void) pthread_mutex_unlock(&ls_journal_mutex);
+		return (0);
+	}
+
+	ls_journal_start();
+
+	if ((fmt_id = ls_journal_format_id(fmt)) == LS_JOURNAL_NO_ID) {
+		(void) pthread_mutex_unlock(&ls_journal_mutex);
+		return (-1);
+	}
+
+	(void) memcpy(rec + sizeof (int64_t), &fmt_id, sizeof (fmt_id));
+	ls_journal_add_record(LS_JREC_MESSAGE, rec, len);
+
+	if (level != LS_JOURNAL_LOG_LEVEL && level <= LS_DBGLVL_ERR)
+		ls_journal_write_chunk();
+
+	(void) pthread_mutex_unlock(&ls_journal_mutex);
+
+	return (0);
+}
+
+
+/*
+ * Function:	ls_journal_atfork_prepare, ls_journal_atfork_parent,
+ *		ls_journal_atfork_child
+ * Description:	Keep the journal consistent across fork(2). The child
+ *		journals as a new process: records collected but not
+ *		written by the parent, and formats it journaled, are
+ *		dropped.
+ */
+static void
+ls_journal_atfork_prepare(void)
+{
+	(void) pthread_mutex_lock(&ls_journal_mutex);
+}
+
+static void
+ls_journal_atfork_parent(void)
+{
+	(void) pthread_mutex_unlock(&ls_journal_mutex);
+}
+
+static void
+ls_journal_atfork_child(void)
+{
+	uint32_t	i;
+
+	ls_journal_len = LS_JOURNAL_CHUNK_HDR;
+	ls_journal_started = B_FALSE;
+
+	for (i = 0; i < LS_JOURNAL_FORMATS; i++) {
+		free(ls_journal_formats[i].fmt);
+		ls_journal_formats[i].fmt = NULL;
+	}
+	ls_journal_nformats = 0;
+
+	(void) pthread_mutex_unlock(&ls_journal_mutex);
+}
+
+/* ----------------------- private functions -------------------------- */
+
+/*
+ * Function:	ls_journal_open
+ * Description:	Opens (creates) journal for appending. Records collected
+ *		for the journal currently open are written to it first.
+ *
+ * Parameters:	name - journal file name
+ *
+ * Return:	LS_E_SUCCESS - journal opened
+ *		LS_E_INVAL - journal couldn't be opened
+ */
+ls_errno_t
+ls_journal_open(const char *name)
+{
+	static boolean_t	fl_init_done = B_FALSE;
+	int			fd;
+
+	if ((fd = open(name, O_WRONLY | O_APPEND | O_CREAT, 0644)) == -1)
+		return (LS_E_INVAL);
+
+	(void) pthread_mutex_lock(&ls_journal_mutex);
+
+	ls_journal_write_chunk();
+	if (ls_journal_fd != -1)
+		(void) close(ls_journal_fd);
+	ls_journal_fd = fd;
+
+	if (!fl_init_done) {
+		fl_init_done = B_TRUE;
+		(void) pthread_atfork(ls_journal_atfork_prepare,
+		    ls_journal_atfork_parent, ls_journal_atfork_child);
+		(void) atexit(ls_journal_flush);
+	}
+
+	(void) pthread_mutex_unlock(&ls_journal_mutex);
+
+	return (LS_E_SUCCESS);
+}
+
+
+/*
+ * Function:	ls_journal_flush
+ * Description:	Writes collected records to the journal
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+void
+ls_journal_flush(void)
+{
+	(void) pthread_mutex_lock(&ls_journal_mutex);
+	ls_journal_write_chunk();
+	(void) pthread_mutex_unlock(&ls_journal_mutex);
+}
+
+
+/*
+ * Function:	ls_journal_write_text
+ * Description:	Journals message which is already formatted
+ *
+ * Parameters:	id - module identification
+ *		level - message level, LS_JOURNAL_LOG_LEVEL for log
+ *			message
+ *		text - message
+ *
+ * Return:
+ */
+void
+ls_journal_write_text(const char *id, int level, const char *text)
+{
+	char		rec[LS_JOURNAL_DATAMAX];
+	size_t		len;
+	uint16_t	slen;
+	size_t		n = strlen(text);
+
+	ls_journal_put_header(rec, &len, id, level);
+
+	if (n > LS_BUF_SIZE)
+		n = LS_BUF_SIZE;
+	slen = (uint16_t)n;
+
+	(void) ls_journal_put_arg(rec, &len, sizeof (rec), LS_JARG_STRING,
+	    &slen, sizeof (slen));
+	(void) ls_journal_put(rec, &len, sizeof (rec), text, n);
+
+	(void) ls_journal_add_message(rec, len, ls_journal_text_fmt, level);
+}
+
+
+/*
+ * Function:	ls_journal_vwrite
+ * Description:	Journals message as format id and arguments. Messages
+ *		without conversions are journaled as text, not to take
+ *		a format id each. Messages which can't be journaled
+ *		that way are formatted and journaled as text.
+ *
+ * Parameters:	id - module identification
+ *		level - message level, LS_JOURNAL_LOG_LEVEL for log
+ *			message
+ *		fmt - message format
+ *		ap - message arguments, not consumed
+ *
+ * Return:
+ */
+void
+ls_journal_vwrite(const char *id, int level, const char *fmt, va_list ap)
+{
+	char		rec[LS_JOURNAL_DATAMAX];
+	char		buf[LS_BUF_SIZE];
+	size_t		len;
+	va_list		cp;
+	int		ret;
+
+	if (strchr(fmt, '%') == NULL) {
+		ls_journal_write_text(id, level, fmt);
+		return;
+	}
+
+	ls_journal_put_header(rec, &len, id, level);
+
+	va_copy(cp, ap);
+	ret = ls_journal_put_args(rec, &len, sizeof (rec), fmt, cp);
+	va_end(cp);
+
+	if (ret == 0 && ls_journal_add_message(rec, len, fmt, level) == 0)
+		return;
+
+	va_copy(cp, ap);
+	(void) vsnprintf(buf, sizeof (buf), fmt, cp);
+	va_end(cp);
+
+	ls_journal_write_text(id, level, buf);
+}
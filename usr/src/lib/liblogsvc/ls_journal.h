@@ -0,0 +1,78 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+#ifndef _LS_JOURNAL_H
+#define	_LS_JOURNAL_H
+
+/*
+ * Private interface of the binary message journal. See ls_journal.c
+ * for the journal format.
+ */
+
+#include <stdarg.h>
+#include <ls_api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* formatted message size */
+#define	LS_BUF_SIZE		(LS_MESSAGE_MAXLEN + LS_ID_MAXLEN + 1)
+
+/* journal magic, starting each chunk */
+#define	LS_JOURNAL_MAGIC	"LSJ1"
+
+/* level recorded for log messages */
+#define	LS_JOURNAL_LOG_LEVEL	-1
+
+/* record types */
+#define	LS_JREC_PROCESS		'H'	/* process start */
+#define	LS_JREC_FORMAT		'F'	/* format string */
+#define	LS_JREC_MESSAGE		'M'	/* message */
+
+/* argument tags */
+#define	LS_JARG_INT		'i'	/* 32 bit integer */
+#define	LS_JARG_LONG		'l'	/* 64 bit integer */
+#define	LS_JARG_DOUBLE		'd'	/* double */
+#define	LS_JARG_STRING		's'	/* 16 bit length, then bytes */
+#define	LS_JARG_POINTER		'p'	/* 64 bit pointer value */
+
+/* open the journal, closing the current one */
+ls_errno_t ls_journal_open(const char *name);
+
+/* write out buffered records */
+void ls_journal_flush(void);
+
+/* record message */
+void ls_journal_vwrite(const char *id, int level, const char *fmt,
+    va_list ap);
+
+/* record message which is already formatted */
+void ls_journal_write_text(const char *id, int level, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LS_JOURNAL_H */
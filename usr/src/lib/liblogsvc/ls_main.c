@@ -27,10 +27,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <assert.h>
+#include <atomic.h>
 #include <dirent.h>
 #include <errno.h>
 #include <libgen.h>
 #include <libnvpair.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -39,6 +41,7 @@
 #include <wait.h>
 
 #include <ls_api.h>
+#include <ls_journal.h>
 
 /* configuration environment variables */
 
@@ -54,6 +57,15 @@
 /* timestamp */
 #define	LS_ENV_TIMESTAMP	"LS_TIMESTAMP"
 
+/* journal filename */
+#define	LS_ENV_JOURNAL		"LS_JOURNAL"
+
+/* asynchronous posting */
+#define	LS_ENV_ASYNC		"LS_ASYNC"
+
+/* what to do when the asynchronous buffer is full */
+#define	LS_ENV_OVERFLOW		"LS_OVERFLOW"
+
 /* default log file name */
 #define	LS_LOGFILE_DEFAULT_NAME	"install_log"
 
@@ -63,6 +75,9 @@
 /* default log file */
 #define	LS_LOGFILE_DEFAULT	LS_LOGFILE_SRC_PATH LS_LOGFILE_DEFAULT_NAME
 
+/* default journal file */
+#define	LS_JOURNAL_DEFAULT	LS_LOGFILE_DEFAULT ".journal"
+
 /* default destination  */
 #define	LS_DEST_DEFAULT		LS_DEST_FILE
 
@@ -77,12 +92,50 @@
 
 /* validate destination */
 #define	ls_destination_valid(d)	\
-	((d >= LS_DEST_NONE) && (d <= LS_DEST_BOTH))
+	((d >= LS_DEST_NONE) && (d <= (LS_DEST_BOTH | LS_DEST_JOURNAL)))
 
 /* validate debug level */
 #define	ls_dbglvl_valid(l)	\
 	(((l) >= LS_DBGLVL_NONE) && ((l) < LS_DBGLVL_LAST))
 
+/* validate overflow policy */
+#define	ls_overflow_valid(o)	\
+	(((o) == LS_OVERFLOW_DROP) || ((o) == LS_OVERFLOW_BLOCK))
+
+/*
+ * Asynchronous posting.  Callers append messages to a ring of
+ * LS_ASYNC_SLOTS slots (a power of 2) without taking any lock, and a
+ * writer thread formats and posts them in batches of up to
+ * LS_ASYNC_BATCH bytes.  The writer sleeps at most LS_ASYNC_IDLE_NS
+ * when there is nothing to post.
+ */
+#define	LS_ASYNC_SLOTS		256
+#define	LS_ASYNC_BATCH		(16 * 1024)
+#define	LS_ASYNC_IDLE_NS	100000000
+
+/*
+ * level of a slot given up by its caller, which posted the message
+ * itself as the writer thread was being stopped
+ */
+#define	LS_ASYNC_SKIP		-2
+
+/* timestamp placeholder */
+#define	LS_NO_TIMESTAMP		"--:--:--"
+
+/*
+ * Ring slot.  seq tells the state of the slot at ring position pos:
+ * pos - slot is free for the message at pos
+ * pos + 1 - message at pos is ready for the writer
+ * (Vyukov's bounded queue, with a single consumer)
+ */
+typedef struct ls_slot {
+	volatile uint32_t	seq;
+	int			level;
+	time_t			tstamp;
+	char			id[LS_ID_MAXLEN + 1];
+	char			msg[LS_BUF_SIZE];
+} ls_slot_t;
+
 /* private function prototypes */
 
 /* default method for posting logging messages */
@@ -112,6 +165,9 @@ static char	*ls_log_filename = LS_LOGFILE_DEFAULT;
 /* log file */
 static FILE	*ls_log_file = NULL;
 
+/* journal file name */
+static char	*ls_journal_filename = LS_JOURNAL_DEFAULT;
+
 /* log destination */
 static ls_dest_t	ls_log_dest = LS_DEST_DEFAULT;
 
@@ -121,6 +177,38 @@ static ls_dbglvl_t	ls_dbglvl = LS_DBGLVL_DEFAULT;
 /* add timestamp to messages */
 static boolean_t	ls_timestamp = B_TRUE;
 
+/* post messages from the writer thread */
+static boolean_t	ls_async = B_FALSE;
+
+/* asynchronous buffer overflow policy */
+static ls_overflow_t	ls_overflow = LS_OVERFLOW_DROP;
+
+/* writer thread is running and takes messages */
+static volatile boolean_t	ls_async_running = B_FALSE;
+
+/* message ring, next position to fill, next position to post */
+static ls_slot_t	*ls_ring = NULL;
+static volatile uint32_t	ls_ring_tail = 0;
+static uint32_t		ls_ring_head = 0;
+
+/* messages dropped since last reported */
+static volatile uint32_t	ls_ring_dropped = 0;
+
+/*
+ * Writer thread state, protected by ls_async_mutex:
+ * ls_ring_posted - all messages before this position are posted
+ * ls_async_idle - writer is waiting for messages on ls_async_wake
+ * ls_async_stopping - writer is to post what is left and exit
+ * ls_async_posted is signaled each time messages are posted.
+ */
+static pthread_t	ls_async_thread;
+static pthread_mutex_t	ls_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	ls_async_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	ls_async_posted = PTHREAD_COND_INITIALIZER;
+static uint32_t		ls_ring_posted = 0;
+static volatile boolean_t	ls_async_idle = B_FALSE;
+static boolean_t	ls_async_stopping = B_FALSE;
+
 /* ------------------------ local functions --------------------------- */
 
 /*
@@ -244,73 +332,70 @@ ls_getenv_num(char *envname)
 
 
 /*
- * Function:	ls_dbg_method_default
- * Description:
- *
- * Parameters:	id - module identification
- *		level - debug message level
- *		msg - debugging message
+ * Function:	ls_format_timestamp
+ * Description:	Formats time stamp in UTC, without weekday and year
+ *		("Mon dd hh:mm:ss")
  *
+ * Parameters:	tstamp - time to format
+ *		buf - buffer for the time stamp
+ *		size - size of buf
  *
- * Return:
+ * Return:	buf, or LS_NO_TIMESTAMP if time can't be formatted
  */
-static void
-ls_dbg_method_default(const char *id, ls_dbglvl_t level, char *msg)
+static char *
+ls_format_timestamp(time_t tstamp, char *buf, int size)
 {
-	FILE 		*post_console;
-	char		buf[LS_MESSAGE_MAXLEN + LS_ID_MAXLEN + 1];
-	static int	fl_init_console_done = 0;
-	time_t		tstamp;
-	char		asc_tstamp[30];
-	struct tm	*tm_tstamp;
-	char		*s = NULL;
-	char		*e = NULL;
+	struct tm	tm_tstamp;
+	char		*s;
+	char		*e;
 
-	if (msg == NULL)
-		return;
+	if (tstamp == (time_t)-1 || gmtime_r(&tstamp, &tm_tstamp) == NULL ||
+	    asctime_r(&tm_tstamp, buf, size) == NULL)
+		return (LS_NO_TIMESTAMP);
 
 	/*
-	 * set variables according to required action (debug or log)
-	 * and format debug or log message appropriately
+	 * drop weekday and year information
 	 */
 
-	/*
-	 * prepare time stamp in UTC format
-	 */
+	if ((s = strchr(buf, ' ')) == NULL)
+		return (LS_NO_TIMESTAMP);
 
-	if (ls_timestamp) {
-		if ((tstamp = time(NULL)) != (time_t)-1 &&
-		    (tm_tstamp = gmtime(&tstamp)) != NULL &&
-		    asctime_r(tm_tstamp, asc_tstamp, sizeof (asc_tstamp)) !=
-		    NULL) {
-			/*
-			 * drop weekday and year information
-			 */
+	s++;
+	e = strrchr(buf, ' ');
+	*e = '\0';
 
-			if ((s = strchr(asc_tstamp, ' ')) != NULL) {
-				s++;
-				e = strrchr(asc_tstamp, ' ');
+	return (s);
+}
 
-				*e = '\0';
-			} else
-				s = "--:--:--";
-		} else
-			s = "--:--:--";
-	}
 
-	if (level == LS_POST_LOG_FLAG) {
-		post_console = ls_log_console;
+/*
+ * Function:	ls_format_message
+ * Description:	Formats message as posted, with module identification,
+ *		debug level and time stamp
+ *
+ * Parameters:	buf - buffer for formatted message
+ *		size - size of buf
+ *		id - module identification
+ *		level - debug message level, or LS_POST_LOG_FLAG for
+ *			log message
+ *		s - time stamp, or NULL if not required
+ *		msg - message
+ *
+ * Return:	length of formatted message
+ */
+static int
+ls_format_message(char *buf, int size, const char *id, int level,
+    const char *s, const char *msg)
+{
+	char		*lvl_str;
+	int		len;
 
-		if (ls_timestamp)
-			(void) snprintf(buf, sizeof (buf), "<%s %s> %s",
-			    id, s, msg);
+	if (level == LS_POST_LOG_FLAG) {
+		if (s != NULL)
+			len = snprintf(buf, size, "<%s %s> %s", id, s, msg);
 		else
-			(void) snprintf(buf, sizeof (buf), "<%s> %s", id, msg);
+			len = snprintf(buf, size, "<%s> %s", id, msg);
 	} else {
-		char		*lvl_str;
-
-		post_console = ls_dbg_console;
-
 		switch (level) {
 			case LS_DBGLVL_EMERG:
 				lvl_str = "!";
@@ -333,14 +418,42 @@ ls_dbg_method_default(const char *id, ls_dbglvl_t level, char *msg)
 				break;
 		}
 
-		if (ls_timestamp) {
-			(void) snprintf(buf, sizeof (buf), "<%s_%s %s> %s", id,
+		if (s != NULL) {
+			len = snprintf(buf, size, "<%s_%s %s> %s", id,
 			    lvl_str, s, msg);
 		} else
-			(void) snprintf(buf, sizeof (buf), "<%s_%s> %s", id,
+			len = snprintf(buf, size, "<%s_%s> %s", id,
 			    lvl_str, msg);
 	}
 
+	if (len < 0)
+		len = 0;
+	else if (len >= size)
+		len = size - 1;
+
+	return (len);
+}
+
+
+/*
+ * Function:	ls_post_message
+ * Description:	Posts formatted message(s) to the console and/or the
+ *		log file, according to the destination
+ *
+ * Parameters:	post_console - console to post to
+ *		buf - formatted message(s)
+ *		len - length of buf
+ *
+ * Return:
+ */
+static void
+ls_post_message(FILE *post_console, const char *buf, size_t len)
+{
+	static int	fl_init_console_done = 0;
+
+	if (len == 0)
+		return;
+
 	/* post to console */
 
 	if ((ls_log_dest & LS_DEST_CONSOLE) != 0) {
@@ -355,7 +468,7 @@ ls_dbg_method_default(const char *id, ls_dbglvl_t level, char *msg)
 			(void) setbuf(ls_dbg_console, NULL);
 		}
 
-		(void) fputs(buf, post_console);
+		(void) fwrite(buf, 1, len, post_console);
 	}
 
 	/* post to file */
@@ -370,8 +483,390 @@ ls_dbg_method_default(const char *id, ls_dbglvl_t level, char *msg)
 		}
 
 		if (ls_log_file != NULL)
-			(void) fputs(buf, ls_log_file);
+			(void) fwrite(buf, 1, len, ls_log_file);
+	}
+}
+
+
+/*
+ * Function:	ls_async_wait_room
+ * Description:	Waits for the writer thread to post messages, when the
+ *		ring is full.
+ *
+ * Parameters:	pos - position the caller found no room at
+ *
+ * Return:
+ */
+static void
+ls_async_wait_room(uint32_t pos)
+{
+	struct timespec	wait;
+
+	(void) pthread_mutex_lock(&ls_async_mutex);
+	if (ls_async_running &&
+	    (int32_t)(ls_ring_posted + LS_ASYNC_SLOTS - pos) <= 0) {
+		(void) pthread_cond_signal(&ls_async_wake);
+
+		/* don't rely on the writer - it may be stopping */
+		wait.tv_sec = 0;
+		wait.tv_nsec = LS_ASYNC_IDLE_NS;
+		(void) pthread_cond_reltimedwait_np(&ls_async_posted,
+		    &ls_async_mutex, &wait);
+	}
+	(void) pthread_mutex_unlock(&ls_async_mutex);
+}
+
+
+/*
+ * Function:	ls_async_append
+ * Description:	Appends message to the ring, for the writer thread to
+ *		post. Doesn't block, unless the ring is full and overflow
+ *		policy requires it.
+ *
+ * Parameters:	id - module identification
+ *		level - debug message level, or LS_POST_LOG_FLAG for
+ *			log message
+ *		msg - message
+ *
+ * Return:	B_TRUE - message appended or dropped
+ *		B_FALSE - writer thread is not running, message is to be
+ *			posted by the caller
+ */
+static boolean_t
+ls_async_append(const char *id, int level, const char *msg)
+{
+	ls_slot_t	*slot;
+	uint32_t	pos;
+	int32_t		diff;
+	time_t		tstamp = ls_timestamp ? time(NULL) : (time_t)-1;
+
+	pos = ls_ring_tail;
+	for (;;) {
+		if (!ls_async_running)
+			return (B_FALSE);
+
+		slot = &ls_ring[pos & (LS_ASYNC_SLOTS - 1)];
+		diff = (int32_t)(slot->seq - pos);
+		membar_consumer();
+
+		if (diff == 0) {
+			/* slot is free - claim it */
+			if (atomic_cas_32(&ls_ring_tail, pos, pos + 1) == pos)
+				break;
+			pos = ls_ring_tail;
+		} else if (diff < 0) {
+			/*
+			 * Ring is full. Only debug messages of the lowest
+			 * level are ever dropped.
+			 */
+			if (ls_overflow == LS_OVERFLOW_DROP &&
+			    level == LS_DBGLVL_INFO) {
+				atomic_inc_32(&ls_ring_dropped);
+				return (B_TRUE);
+			}
+			ls_async_wait_room(pos);
+			pos = ls_ring_tail;
+		} else {
+			/* another thread claimed the slot */
+			pos = ls_ring_tail;
+		}
+	}
+
+	/*
+	 * The writer may have been stopped after the check above, and have
+	 * found the ring empty before the slot was claimed. Give the slot
+	 * up then, so a writer still draining the ring doesn't wait for
+	 * it, and have the caller post the message.
+	 */
+	membar_enter();
+	if (!ls_async_running) {
+		slot->level = LS_ASYNC_SKIP;
+		membar_producer();
+		slot->seq = pos + 1;
+		return (B_FALSE);
+	}
+
+	slot->level = level;
+	slot->tstamp = tstamp;
+	(void) strlcpy(slot->id, id, sizeof (slot->id));
+	(void) strlcpy(slot->msg, msg, sizeof (slot->msg));
+
+	/* publish the message */
+	membar_producer();
+	slot->seq = pos + 1;
+
+	if (ls_async_idle)
+		(void) pthread_cond_signal(&ls_async_wake);
+
+	return (B_TRUE);
+}
+
+
+/*
+ * Function:	ls_async_writer
+ * Description:	Writer thread. Posts messages from the ring in batches,
+ *		until told to stop and the ring is empty.
+ *
+ * Parameters:	arg - not used
+ *
+ * Return:	NULL
+ */
+/* ARGSUSED */
+static void *
+ls_async_writer(void *arg)
+{
+	static char	batch[LS_ASYNC_BATCH];
+	size_t		batch_len = 0;
+	FILE		*batch_console = NULL;
+	FILE		*post_console;
+	ls_slot_t	*slot;
+	time_t		last_tstamp = (time_t)-1;
+	char		asc_tstamp[30];
+	char		*s = LS_NO_TIMESTAMP;
+	char		buf[LS_BUF_SIZE];
+	uint32_t	dropped;
+	int		len;
+	struct timespec	idle;
+
+	for (;;) {
+		for (;;) {
+			slot = &ls_ring[ls_ring_head & (LS_ASYNC_SLOTS - 1)];
+			if (slot->seq != ls_ring_head + 1)
+				break;
+			membar_consumer();
+
+			if (slot->level == LS_ASYNC_SKIP) {
+				membar_exit();
+				slot->seq = ls_ring_head + LS_ASYNC_SLOTS;
+				ls_ring_head++;
+				continue;
+			}
+
+			/* time stamp changes at most once a second */
+			if (ls_timestamp && slot->tstamp != last_tstamp) {
+				last_tstamp = slot->tstamp;
+				s = ls_format_timestamp(last_tstamp,
+				    asc_tstamp, sizeof (asc_tstamp));
+			}
+			len = ls_format_message(buf, sizeof (buf), slot->id,
+			    slot->level, ls_timestamp ? s : NULL, slot->msg);
+			post_console = (slot->level == LS_POST_LOG_FLAG) ?
+			    ls_log_console : ls_dbg_console;
+
+			/* free the slot */
+			membar_exit();
+			slot->seq = ls_ring_head + LS_ASYNC_SLOTS;
+			ls_ring_head++;
+
+			if (post_console != batch_console ||
+			    batch_len + len > sizeof (batch)) {
+				ls_post_message(batch_console, batch,
+				    batch_len);
+				batch_len = 0;
+				batch_console = post_console;
+			}
+			(void) memcpy(batch + batch_len, buf, len);
+			batch_len += len;
+		}
+
+		if ((dropped = atomic_swap_32(&ls_ring_dropped, 0)) != 0) {
+			ls_post_message(batch_console, batch, batch_len);
+			batch_len = 0;
+			batch_console = ls_dbg_console;
+			(void) snprintf(buf, sizeof (buf),
+			    "%u debug messages dropped, log buffer full\n",
+			    dropped);
+			len = ls_format_message(batch, sizeof (batch), "LS",
+			    LS_DBGLVL_WARN, ls_timestamp ? s : NULL, buf);
+			batch_len = len;
+		}
+
+		ls_post_message(batch_console, batch, batch_len);
+		batch_len = 0;
+
+		(void) pthread_mutex_lock(&ls_async_mutex);
+		ls_ring_posted = ls_ring_head;
+		(void) pthread_cond_broadcast(&ls_async_posted);
+
+		if (ls_ring[ls_ring_head & (LS_ASYNC_SLOTS - 1)].seq !=
+		    ls_ring_head + 1) {
+			if (ls_async_stopping && ls_ring_tail == ls_ring_head) {
+				(void) pthread_mutex_unlock(&ls_async_mutex);
+				break;
+			}
+
+			/*
+			 * Nothing to post. Wait for a message, but not for
+			 * long, as appending messages doesn't take the mutex
+			 * and a wakeup may be missed.
+			 */
+			ls_async_idle = B_TRUE;
+			membar_producer();
+			idle.tv_sec = 0;
+			idle.tv_nsec = LS_ASYNC_IDLE_NS;
+			(void) pthread_cond_reltimedwait_np(&ls_async_wake,
+			    &ls_async_mutex, &idle);
+			ls_async_idle = B_FALSE;
+		}
+		(void) pthread_mutex_unlock(&ls_async_mutex);
 	}
+
+	return (NULL);
+}
+
+
+/*
+ * Function:	ls_async_start
+ * Description:	Allocates the ring and starts the writer thread. Messages
+ *		are posted synchronously if it fails.
+ *
+ * Parameters:	-
+ *
+ * Return:	LS_E_SUCCESS - writer thread started, or already running
+ *		LS_E_NOMEM - memory allocation failed
+ *		LS_E_INVAL - thread couldn't be created
+ */
+static ls_errno_t
+ls_async_start(void)
+{
+	uint32_t	i;
+
+	if (ls_async_running)
+		return (LS_E_SUCCESS);
+
+	if (ls_ring == NULL) {
+		ls_ring = calloc(LS_ASYNC_SLOTS, sizeof (ls_slot_t));
+		if (ls_ring == NULL)
+			return (LS_E_NOMEM);
+	}
+
+	ls_ring_tail = ls_ring_head = ls_ring_posted = 0;
+	for (i = 0; i < LS_ASYNC_SLOTS; i++)
+		ls_ring[i].seq = i;
+	ls_async_stopping = B_FALSE;
+
+	if (pthread_create(&ls_async_thread, NULL, ls_async_writer,
+	    NULL) != 0)
+		return (LS_E_INVAL);
+
+	membar_producer();
+	ls_async_running = B_TRUE;
+
+	return (LS_E_SUCCESS);
+}
+
+
+/*
+ * Function:	ls_async_stop
+ * Description:	Stops the writer thread, once it posted all messages.
+ *		Registered with atexit(3C), so messages are not lost
+ *		at exit. Later messages are posted synchronously.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+static void
+ls_async_stop(void)
+{
+	if (!ls_async_running)
+		return;
+
+	/* pairs with membar_enter() in ls_async_append() */
+	ls_async_running = B_FALSE;
+	membar_enter();
+
+	(void) pthread_mutex_lock(&ls_async_mutex);
+	ls_async_stopping = B_TRUE;
+	(void) pthread_cond_signal(&ls_async_wake);
+	(void) pthread_mutex_unlock(&ls_async_mutex);
+
+	(void) pthread_join(ls_async_thread, NULL);
+}
+
+
+/*
+ * Function:	ls_async_fork_prepare
+ * Description:	pthread_atfork(3C) handlers. The mutex is held across
+ *		fork(2), so the child gets it in a known state.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+static void
+ls_async_fork_prepare(void)
+{
+	(void) pthread_mutex_lock(&ls_async_mutex);
+}
+
+static void
+ls_async_fork_parent(void)
+{
+	(void) pthread_mutex_unlock(&ls_async_mutex);
+}
+
+/*
+ * Function:	ls_async_fork_child
+ * Description:	The writer thread isn't duplicated by fork(2). Messages
+ *		of the child are posted synchronously, and those left in
+ *		the ring are the parent's to post.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+static void
+ls_async_fork_child(void)
+{
+	ls_async_running = B_FALSE;
+	ls_async_stopping = B_FALSE;
+	ls_async_idle = B_FALSE;
+	(void) pthread_mutex_unlock(&ls_async_mutex);
+}
+
+
+/*
+ * Function:	ls_dbg_method_default
+ * Description:
+ *
+ * Parameters:	id - module identification
+ *		level - debug message level
+ *		msg - debugging message
+ *
+ *
+ * Return:
+ */
+static void
+ls_dbg_method_default(const char *id, ls_dbglvl_t level, char *msg)
+{
+	char		buf[LS_BUF_SIZE];
+	char		asc_tstamp[30];
+	char		*s = NULL;
+	int		len;
+
+	if (msg == NULL)
+		return;
+
+	/*
+	 * hand the message over to the writer thread, if running
+	 */
+
+	if (ls_async_running && ls_async_append(id, level, msg))
+		return;
+
+	/*
+	 * prepare time stamp in UTC format
+	 */
+
+	if (ls_timestamp)
+		s = ls_format_timestamp(time(NULL), asc_tstamp,
+		    sizeof (asc_tstamp));
+
+	len = ls_format_message(buf, sizeof (buf), id, level, s, msg);
+
+	ls_post_message(level == LS_POST_LOG_FLAG ?
+	    ls_log_console : ls_dbg_console, buf, len);
 }
 
 
@@ -413,7 +908,8 @@ ls_init(nvlist_t *params)
 {
 	char		*str;
 	int16_t		dest, lvl;
-	boolean_t	stamp;
+	boolean_t	stamp, async;
+	int		overflow;
 	ls_dbglvl_t	ls_env_dbglvl;
 	char		*ls_env_dbglvl_str;
 
@@ -434,6 +930,15 @@ ls_init(nvlist_t *params)
 				return (LS_E_NOMEM);
 		}
 
+		/* journal file */
+
+		if (nvlist_lookup_string(params, LS_ATTR_JOURNAL, &str) == 0) {
+			ls_journal_filename = strdup(str);
+
+			if (ls_journal_filename == NULL)
+				return (LS_E_NOMEM);
+		}
+
 		/* destination */
 
 		if ((nvlist_lookup_int16(params, LS_ATTR_DEST, &dest) == 0) &&
@@ -451,6 +956,16 @@ ls_init(nvlist_t *params)
 		if ((nvlist_lookup_int16(params, LS_ATTR_DBG_LVL, &lvl) == 0) &&
 		    ls_dbglvl_valid(lvl))
 			ls_dbglvl = lvl;
+
+		/* asynchronous posting */
+
+		if (nvlist_lookup_boolean_value(params, LS_ATTR_ASYNC,
+		    &async) == 0)
+			ls_async = async;
+
+		if ((nvlist_lookup_int16(params, LS_ATTR_OVERFLOW,
+		    &lvl) == 0) && ls_overflow_valid(lvl))
+			ls_overflow = lvl;
 	}
 
 	/* environment variables */
@@ -472,11 +987,32 @@ ls_init(nvlist_t *params)
 		ls_log_dest = LS_DEST_DEFAULT;
 	}
 
+	/* set journal file, and open it if journal is a destination */
+
+	if ((str = ls_getenv_string(LS_ENV_JOURNAL)) != NULL)
+		ls_journal_filename = str;
+
+	if ((ls_log_dest & LS_DEST_JOURNAL) != 0 &&
+	    ls_journal_open(ls_journal_filename) != LS_E_SUCCESS) {
+		ls_log_dest &= ~LS_DEST_JOURNAL;
+		ls_debug_print(LS_DBGLVL_WARN, "Couldn't open journal %s\n",
+		    ls_journal_filename);
+	}
+
 	/* time stamp */
 
 	if ((stamp = ls_getenv_num(LS_ENV_TIMESTAMP)) != LS_E_INVAL)
 		ls_timestamp = stamp == 0 ? B_FALSE : B_TRUE;
 
+	/* asynchronous posting and overflow policy */
+
+	if ((async = ls_getenv_num(LS_ENV_ASYNC)) != LS_E_INVAL)
+		ls_async = async == 0 ? B_FALSE : B_TRUE;
+
+	overflow = ls_getenv_num(LS_ENV_OVERFLOW);
+	if (ls_overflow_valid(overflow))
+		ls_overflow = (ls_overflow_t)overflow;
+
 	/* set debug level */
 
 	/* if environment variable supplied and valid, set debugging level */
@@ -491,10 +1027,63 @@ ls_init(nvlist_t *params)
 		}
 	}
 
+	/*
+	 * start the writer thread. If it can't be started, messages
+	 * are posted synchronously.
+	 */
+
+	if (ls_async) {
+		static boolean_t	fl_atexit_done = B_FALSE;
+
+		if (ls_async_start() != LS_E_SUCCESS) {
+			ls_debug_print(LS_DBGLVL_WARN,
+			    "Couldn't start log writer thread, "
+			    "posting messages synchronously\n");
+		} else if (!fl_atexit_done) {
+			fl_atexit_done = B_TRUE;
+			(void) atexit(ls_async_stop);
+			(void) pthread_atfork(ls_async_fork_prepare,
+			    ls_async_fork_parent, ls_async_fork_child);
+		}
+	} else
+		ls_async_stop();
+
 	return (LS_E_SUCCESS);
 }
 
 
+/*
+ * Function:	ls_flush
+ * Description:	Writes out journaled messages, and waits until all
+ *		messages appended so far are posted to the console and
+ *		the log file.
+ *
+ * Parameters:	-
+ *
+ * Return:
+ */
+void
+ls_flush(void)
+{
+	uint32_t	target;
+
+	if ((ls_log_dest & LS_DEST_JOURNAL) != 0)
+		ls_journal_flush();
+
+	if (!ls_async_running)
+		return;
+
+	target = ls_ring_tail;
+
+	(void) pthread_mutex_lock(&ls_async_mutex);
+	while (ls_async_running && (int32_t)(ls_ring_posted - target) < 0) {
+		(void) pthread_cond_signal(&ls_async_wake);
+		(void) pthread_cond_wait(&ls_async_posted, &ls_async_mutex);
+	}
+	(void) pthread_mutex_unlock(&ls_async_mutex);
+}
+
+
 /*
  * Function:	ls_transfer
  * Description:	Transfers log file to the
@@ -519,6 +1108,12 @@ ls_transfer(char *src_mountpoint, char *dst_mountpoint)
 	if ((src_mountpoint == NULL) || (dst_mountpoint == NULL))
 		return (LS_E_LOG_TRANSFER_FAILED);
 
+	/*
+	 * make sure all messages so far are in the log file
+	 */
+
+	ls_flush();
+
 	/*
 	 * Check whether the target directory exists. If not create it
 	 */
@@ -574,6 +1169,24 @@ ls_transfer(char *src_mountpoint, char *dst_mountpoint)
 		return (LS_E_LOG_TRANSFER_FAILED);
 	}
 
+	/*
+	 * copy journal as well, if there is one
+	 */
+
+	if ((ls_log_dest & LS_DEST_JOURNAL) != 0 &&
+	    (fname = strrchr(ls_journal_filename, '/')) != NULL) {
+		fname++;
+
+		(void) snprintf(cmd, sizeof (cmd),
+		    "/bin/cp %s%s %s%s%s", src_mountpoint,
+		    ls_journal_filename, dst_mountpoint, LS_LOGFILE_DST_PATH,
+		    fname);
+
+		if (ls_system(cmd) != 0)
+			ls_debug_print(LS_DBGLVL_WARN,
+			    "Transfer of journal failed\n");
+	}
+
 	return (LS_E_SUCCESS);
 }
 
@@ -671,11 +1284,21 @@ void
 ls_write_log_message(const char *id, const char *fmt, ...)
 {
 	va_list	ap;
-	char	buf[LS_MESSAGE_MAXLEN + LS_ID_MAXLEN + 1];
+	char	buf[LS_BUF_SIZE];
 
 	va_start(ap, fmt);
-	(void) vsnprintf(buf, sizeof (buf), fmt, ap);
-	ls_log_method(id, buf);
+
+	if ((ls_log_dest & LS_DEST_JOURNAL) != 0)
+		ls_journal_vwrite(id, LS_JOURNAL_LOG_LEVEL, fmt, ap);
+
+	/* journal alone doesn't need the message formatted */
+
+	if ((ls_log_dest & LS_DEST_BOTH) != 0 ||
+	    ls_log_method != ls_log_method_default) {
+		(void) vsnprintf(buf, sizeof (buf), fmt, ap);
+		ls_log_method(id, buf);
+	}
+
 	va_end(ap);
 }
 
@@ -697,14 +1320,24 @@ void
 ls_write_dbg_message(const char *id, ls_dbglvl_t level, const char *fmt, ...)
 {
 	va_list	ap;
-	char	buf[LS_MESSAGE_MAXLEN + LS_ID_MAXLEN + 1];
+	char	buf[LS_BUF_SIZE];
 
 	/* only post message, if current debugging level allows it */
 
 	if (level <= ls_get_dbg_level()) {
 		va_start(ap, fmt);
-		(void) vsnprintf(buf, sizeof (buf), fmt, ap);
-		ls_dbg_method(id, level, buf);
+
+		if ((ls_log_dest & LS_DEST_JOURNAL) != 0)
+			ls_journal_vwrite(id, level, fmt, ap);
+
+		/* journal alone doesn't need the message formatted */
+
+		if ((ls_log_dest & LS_DEST_BOTH) != 0 ||
+		    ls_dbg_method != ls_dbg_method_default) {
+			(void) vsnprintf(buf, sizeof (buf), fmt, ap);
+			ls_dbg_method(id, level, buf);
+		}
+
 		va_end(ap);
 	}
 }
@@ -722,6 +1355,8 @@ ls_write_dbg_message(const char *id, ls_dbglvl_t level, const char *fmt, ...)
 void
 ls_log_std(ls_stdouterr_t stdouterr, const char *id, char *buf)
 {
+	if ((ls_log_dest & LS_DEST_JOURNAL) != 0)
+		ls_journal_write_text(id, LS_JOURNAL_LOG_LEVEL, buf);
 	ls_log_method(id, buf);
 	if (stdouterr == LS_STDOUT || stdouterr == LS_STDOUTERR)
 		(void) fputs(buf, stdout);
@@ -0,0 +1,406 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Target discovery events.
+ *
+ * Once enabled, the discovery thread posts an event as soon as the data of
+ * a disk, its partitions, its slices or a Solaris instance is known, and a
+ * last one when discovery is done.  Each event carries its own copy of the
+ * data, so a consumer can render a disk without waiting for the others and
+ * without calling back into the orchestrator.
+ *
+ * Events go through a ring of OM_EVENT_SLOTS slots (a power of 2), which is
+ * written and read without taking any lock: a slot at position pos is free
+ * while its sequence number is pos and holds an event once it is pos + 1.
+ * Consumers take events in batches with om_get_discovery_events(), either
+ * from their own loop or when the descriptor returned by
+ * om_enable_discovery_events() becomes readable.  One byte is written to it
+ * per wake up, not per event.  When the ring is full the discovery thread
+ * waits for room, at most OM_EVENT_WAIT_NS at a time.
+ */
+
+#include <atomic.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	OM_EVENT_SLOTS		512
+#define	OM_EVENT_WAIT_NS	100000000
+
+typedef struct om_event_slot {
+	volatile uint32_t	seq;
+	om_discovery_event_t	event;
+} om_event_slot_t;
+
+static om_event_slot_t	*ev_ring = NULL;
+static volatile uint32_t	ev_head = 0;
+static volatile uint32_t	ev_tail = 0;
+
+/*
+ * ev_armed is set by a consumer before it looks at the ring. The first
+ * producer to clear it writes to the pipe.
+ */
+static volatile uint32_t	ev_armed = 1;
+static int		ev_pipe[2] = { -1, -1 };
+
+/*
+ * ev_waiters counts producers waiting on ev_drained for a slot,
+ * protected by ev_mutex.
+ */
+static pthread_mutex_t	ev_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	ev_drained = PTHREAD_COND_INITIALIZER;
+static volatile int	ev_waiters = 0;
+
+/*
+ * om_enable_discovery_events
+ * Makes target discovery post events for the caller. To be called before
+ * om_initiate_target_discovery(), whose callback may then be NULL.
+ * Input:	None
+ * Output:	int *fd - descriptor which becomes readable when events
+ *		are pending. It is non-blocking and owned by the orchestrator.
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE - the error is set to OM_NO_SPACE or OM_TOO_MANY_FD
+ */
+int
+om_enable_discovery_events(int *fd)
+{
+	om_event_slot_t	*ring;
+	uint32_t	i;
+
+	if (fd == NULL) {
+		om_set_error(OM_BAD_INPUT);
+		return (OM_FAILURE);
+	}
+
+	(void) pthread_mutex_lock(&ev_mutex);
+	if (ev_ring == NULL) {
+		ring = calloc(OM_EVENT_SLOTS, sizeof (om_event_slot_t));
+		if (ring == NULL) {
+			(void) pthread_mutex_unlock(&ev_mutex);
+			om_set_error(OM_NO_SPACE);
+			return (OM_FAILURE);
+		}
+		if (pipe(ev_pipe) != 0) {
+			(void) pthread_mutex_unlock(&ev_mutex);
+			free(ring);
+			om_set_error(OM_TOO_MANY_FD);
+			return (OM_FAILURE);
+		}
+		for (i = 0; i < 2; i++) {
+			(void) fcntl(ev_pipe[i], F_SETFL, O_NONBLOCK);
+			(void) fcntl(ev_pipe[i], F_SETFD, FD_CLOEXEC);
+		}
+		for (i = 0; i < OM_EVENT_SLOTS; i++)
+			ring[i].seq = i;
+
+		/* slots must be seen initialized before the ring */
+		membar_producer();
+		ev_ring = ring;
+	}
+	*fd = ev_pipe[0];
+	(void) pthread_mutex_unlock(&ev_mutex);
+
+	return (OM_SUCCESS);
+}
+
+/*
+ * om_get_discovery_events
+ * Takes the pending discovery events, up to max of them. Doesn't block.
+ * Input:	om_discovery_event_t *events - array of max events
+ *		int max - how many events to take at most
+ * Output:	om_discovery_event_t *events - the events taken, in the
+ *		order they were posted. Each is to be released with
+ *		om_free_discovery_event().
+ * Return:	number of events taken, 0 if none is pending
+ *		OM_FAILURE - events are not enabled or bad input
+ */
+int
+om_get_discovery_events(om_discovery_event_t *events, int max)
+{
+	om_event_slot_t	*slot;
+	uint32_t	pos;
+	char		buf[64];
+	int		n = 0;
+
+	if (ev_ring == NULL || events == NULL || max <= 0) {
+		om_set_error(OM_BAD_INPUT);
+		return (OM_FAILURE);
+	}
+
+	/*
+	 * Empty the pipe and rearm it before looking at the ring, so that
+	 * an event posted from now on is either taken below or wakes the
+	 * consumer up again.
+	 */
+	while (read(ev_pipe[0], buf, sizeof (buf)) > 0)
+		;
+	ev_armed = 1;
+	membar_enter();
+
+	while (n < max) {
+		pos = ev_head;
+		slot = &ev_ring[pos & (OM_EVENT_SLOTS - 1)];
+		if (slot->seq != pos + 1)
+			break;
+		membar_consumer();
+
+		/* another consumer may have taken the event */
+		if (atomic_cas_32(&ev_head, pos, pos + 1) != pos)
+			continue;
+
+		events[n++] = slot->event;
+
+		/* free the slot */
+		membar_exit();
+		slot->seq = pos + OM_EVENT_SLOTS;
+	}
+
+	/* there may be more - keep the descriptor readable */
+	if (n == max && atomic_swap_32(&ev_armed, 0) != 0)
+		(void) write(ev_pipe[1], "", 1);
+
+	/*
+	 * The freed slots must be seen before ev_waiters is read, or a
+	 * producer which found the ring full and registered meanwhile
+	 * would sleep out its whole wait.  Pairs with membar_enter() in
+	 * wait_room().
+	 */
+	membar_enter();
+	if (n > 0 && ev_waiters > 0) {
+		(void) pthread_mutex_lock(&ev_mutex);
+		(void) pthread_cond_broadcast(&ev_drained);
+		(void) pthread_mutex_unlock(&ev_mutex);
+	}
+
+	return (n);
+}
+
+/*
+ * om_free_discovery_event
+ * Releases the data carried by an event returned by
+ * om_get_discovery_events().
+ * Input:	om_discovery_event_t *event
+ * Output:	None
+ * Return:	None
+ */
+void
+om_free_discovery_event(om_discovery_event_t *event)
+{
+	if (event == NULL) {
+		return;
+	}
+
+	free(event->disk_name);
+	local_free_disk_info(event->dinfo, B_TRUE);
+	local_free_part_info(event->dparts);
+	local_free_slice_info(event->dslices);
+	local_free_upgrade_info(event->instance);
+	event->disk_name = NULL;
+	event->dinfo = NULL;
+	event->dparts = NULL;
+	event->dslices = NULL;
+	event->instance = NULL;
+}
+
+/*
+ * wait_room
+ * Waits for a consumer to take events out of the full ring.
+ * Input:	uint32_t pos - position the producer is to write at
+ * Output:	None
+ * Return:	None
+ */
+static void
+wait_room(uint32_t pos)
+{
+	om_event_slot_t	*slot;
+	struct timespec	wait;
+
+	(void) pthread_mutex_lock(&ev_mutex);
+	ev_waiters++;
+	membar_enter();
+
+	slot = &ev_ring[pos & (OM_EVENT_SLOTS - 1)];
+	if ((int32_t)(slot->seq - pos) < 0) {
+		wait.tv_sec = 0;
+		wait.tv_nsec = OM_EVENT_WAIT_NS;
+		(void) pthread_cond_reltimedwait_np(&ev_drained, &ev_mutex,
+		    &wait);
+	}
+
+	ev_waiters--;
+	(void) pthread_mutex_unlock(&ev_mutex);
+}
+
+/*
+ * post_event
+ * Puts an event in the ring, waiting for room if it is full, and wakes
+ * the consumer up.
+ * Input:	om_discovery_event_t *event - event to post, owning its data
+ * Output:	None
+ * Return:	None
+ */
+static void
+post_event(om_discovery_event_t *event)
+{
+	om_event_slot_t	*slot;
+	uint32_t	pos;
+	int32_t		diff;
+
+	pos = ev_tail;
+	for (;;) {
+		slot = &ev_ring[pos & (OM_EVENT_SLOTS - 1)];
+		diff = (int32_t)(slot->seq - pos);
+		membar_consumer();
+
+		if (diff == 0) {
+			/* slot is free - claim it */
+			if (atomic_cas_32(&ev_tail, pos, pos + 1) == pos)
+				break;
+		} else if (diff < 0) {
+			/* ring is full */
+			wait_room(pos);
+		}
+		pos = ev_tail;
+	}
+
+	slot->event = *event;
+
+	/* publish the event */
+	membar_producer();
+	slot->seq = pos + 1;
+
+	membar_enter();
+	if (atomic_swap_32(&ev_armed, 0) != 0)
+		(void) write(ev_pipe[1], "", 1);
+}
+
+/*
+ * om_post_disk_event
+ * Posts an event about the data of a disk, if events are enabled.
+ * Input:	om_discovery_event_type_t type - OM_DISK_FOUND_EVENT,
+ *		OM_PARTITIONS_READY_EVENT or OM_SLICES_READY_EVENT
+ *		int disk_index - index of the disk in the discovery order
+ *		int num_disks - number of disks of the discovery phase
+ *		disk_target_t *dt - the disk, whose data of the given type
+ *		is copied
+ * Output:	None
+ * Return:	None
+ */
+void
+om_post_disk_event(om_discovery_event_type_t type, int disk_index,
+    int num_disks, disk_target_t *dt)
+{
+	om_discovery_event_t	event;
+	disk_info_t		di;
+
+	if (ev_ring == NULL || dt == NULL) {
+		return;
+	}
+
+	(void) memset(&event, 0, sizeof (event));
+	event.type = type;
+	event.disk_index = disk_index;
+	event.num_disks = num_disks;
+	event.disk_name = strdup(dt->dinfo.disk_name);
+
+	switch (type) {
+	case OM_DISK_FOUND_EVENT:
+		/* copy this disk only, not the ones linked to it */
+		di = dt->dinfo;
+		di.next = NULL;
+		event.dinfo = om_duplicate_disk_info(0, &di);
+		break;
+	case OM_PARTITIONS_READY_EVENT:
+		if (dt->dparts != NULL)
+			event.dparts = om_duplicate_disk_partition_info(0,
+			    dt->dparts);
+		break;
+	case OM_SLICES_READY_EVENT:
+		if (dt->dslices != NULL)
+			event.dslices = om_duplicate_slice_info(0,
+			    dt->dslices);
+		break;
+	default:
+		break;
+	}
+
+	post_event(&event);
+}
+
+/*
+ * om_post_instance_event
+ * Posts an event about a Solaris instance, if events are enabled.
+ * Input:	upgrade_info_t *ui - the instance, which is copied
+ * Output:	None
+ * Return:	None
+ */
+void
+om_post_instance_event(upgrade_info_t *ui)
+{
+	om_discovery_event_t	event;
+
+	if (ev_ring == NULL || ui == NULL) {
+		return;
+	}
+
+	(void) memset(&event, 0, sizeof (event));
+	event.type = OM_INSTANCE_FOUND_EVENT;
+	event.disk_index = -1;
+	event.instance = copy_one_upgrade_target(ui);
+
+	post_event(&event);
+}
+
+/*
+ * om_post_discovery_done
+ * Posts the last event of target discovery, if events are enabled.
+ * The om_get_*() functions can be used once it is received.
+ * Input:	int num_disks - number of disks discovered
+ *		int16_t status - OM_SUCCESS or OM_NO_DISKS_FOUND
+ * Output:	None
+ * Return:	None
+ */
+void
+om_post_discovery_done(int num_disks, int16_t status)
+{
+	om_discovery_event_t	event;
+
+	if (ev_ring == NULL) {
+		return;
+	}
+
+	(void) memset(&event, 0, sizeof (event));
+	event.type = OM_DISCOVERY_DONE_EVENT;
+	event.disk_index = -1;
+	event.num_disks = num_disks;
+	event.status = status;
+
+	post_event(&event);
+}
@@ -36,53 +36,23 @@
 #include <libfdisk.h>
 #endif
 
-/*
- * fdisk(1m) rsect - must be space before logical partition
- */
-#define	LOGICAL_PARTITION_PAD (63)
-
-/*
- * shorthand method for finding end of ith partition
- */
-#define	PARTITION_END(i) \
-	(sorted_parts[(i)].partition_offset_sec + \
-	sorted_parts[(i)].partition_size_sec)
-
-struct free_region {
-	uint64_t free_offset;
-	uint64_t free_size;
-};
-
 boolean_t	whole_disk = B_FALSE; /* assume existing partition */
 
 static void mark_for_deletion_by_index(int);
 static void delete_all_logical_partitions(void);
 
 /* free space management */
-static struct free_region free_space_table[OM_NUMPART + 1];
-static int n_fragments = 0;
-static struct {
-	int		partition_id;
-	uint64_t	partition_offset_sec;
-	uint64_t	partition_size_sec;
-} sorted_parts[OM_NUMPART];
-static int n_sorted_parts = 0;
-/*
- * sorted_parts and n_sorted_parts are used only for a temporary sort of the
- * partitions according to starting offset when building the free space table
- */
-static struct free_region *find_unused_region_of_size(uint64_t, boolean_t);
-static void insertion_sort_partition_info(partition_info_t *);
-static void sort_used_regions(boolean_t);
-static boolean_t build_free_space_table(boolean_t);
-static void append_free_space_table(uint64_t, uint64_t);
-static struct free_region *find_largest_free_region(boolean_t);
-static struct free_region *find_free_region_best_fit(uint64_t, boolean_t);
+static om_space_t *primary_space = NULL;
+static om_space_t *logical_space = NULL;
+
+static boolean_t find_unused_region_of_size(uint64_t, boolean_t,
+    om_extent_t *);
+static om_space_t *update_free_space(boolean_t);
 
 /* logging */
 static void log_partition_map(void);
-static void log_used_regions(void);
-static void log_free_space_table(void);
+static void log_used_regions(om_space_t *);
+static void log_free_space_table(om_space_t *);
 
 static partition_info_t *get_extended_partition_info(disk_parts_t *);
 
@@ -1454,23 +1424,22 @@ om_create_partition(uint8_t partition_type, uint64_t partition_offset_sec,
 	}
 	/* if no starting offset, select location */
 	if (partition_offset_sec == (uint64_t)-1LL) {
-		struct free_region *pfree_region;
+		om_extent_t free_region;
 
 		om_debug_print(OM_DBGLVL_INFO,
 		    "finding unused region of size=%s\n",
 		    part_size_or_max(partition_size_sec));
-		pfree_region = find_unused_region_of_size(partition_size_sec,
-		    is_log_part);
-		if (pfree_region == NULL) {
+		if (!find_unused_region_of_size(partition_size_sec,
+		    is_log_part, &free_region)) {
 			om_debug_print(OM_DBGLVL_ERR,
 			    "failure to find unused region of size %s\n",
 			    part_size_or_max(partition_size_sec));
 			om_set_error(OM_ALREADY_EXISTS);
 			return (B_FALSE);
 		}
-		pinfo->partition_offset_sec = pfree_region->free_offset;
+		pinfo->partition_offset_sec = free_region.offset;
 		if (partition_size_sec == OM_MAX_SIZE)
-			partition_size_sec = pfree_region->free_size;
+			partition_size_sec = free_region.size;
 	} else {
 		/* if size set to OM_MAX_SIZE in manifest, take entire disk */
 		if (partition_size_sec == OM_MAX_SIZE)
@@ -1554,7 +1523,7 @@ om_create_partition(uint8_t partition_type, uint64_t partition_offset_sec,
 		    partition_type);
 		return (B_FALSE);
 	}
-	if (!build_free_space_table(is_log_part)) /* checks for overlap */
+	if (update_free_space(is_log_part) == NULL) /* checks for overlap */
 		return (B_FALSE);
 
 	pinfo->partition_type = partition_type;
@@ -2188,105 +2157,58 @@ om_set_fdisk_target_attrs(nvlist_t *list, char *diskname)
 /*
  * find best fit among blocks of unused space that has at least partition_size
  *	sectors unallocated
- * if partition_size is 0, return largest free region
+ * if partition_size is 0, find largest free region
+ * returns B_TRUE and offset + size of region, or B_FALSE if none found
  */
-static struct free_region *
-find_unused_region_of_size(uint64_t partition_size, boolean_t is_log_part)
+static boolean_t
+find_unused_region_of_size(uint64_t partition_size, boolean_t is_log_part,
+    om_extent_t *region)
 {
+	om_space_t *sp;
+
 	assert(committed_disk_target != NULL);
 
-	if (!build_free_space_table(is_log_part))
-		return (NULL);
+	if ((sp = update_free_space(is_log_part)) == NULL)
+		return (B_FALSE);
 	/*
 	 * if partition size unspecified (signaled when zero)
 	 * find largest free space
 	 * otherwise find best fit for specified size
+	 * logical partitions require 63 sectors before each one, which are
+	 * left out of the region returned
 	 */
-	return (partition_size == OM_MAX_SIZE ?
-	    find_largest_free_region(is_log_part) :
-	    find_free_region_best_fit(partition_size, is_log_part));
-}
-
-/*
- * do a sorted insertion of used space in partition
- */
-static void
-insertion_sort_partition_info(partition_info_t *psinfo)
-{
-	int isl;
-
-	for (isl = 0; isl < n_sorted_parts; isl++)
-		if (sorted_parts[isl].partition_offset_sec >
-		    psinfo->partition_offset_sec)
-			break;
-	/* safe push downward */
-	(void) memmove(&sorted_parts[isl + 1], &sorted_parts[isl],
-	    (n_sorted_parts - isl) * sizeof (sorted_parts[0]));
-	/* move in new partition info entry */
-	sorted_parts[isl].partition_id = psinfo->partition_id;
-	sorted_parts[isl].partition_offset_sec = psinfo->partition_offset_sec;
-	sorted_parts[isl].partition_size_sec = psinfo->partition_size_sec;
-	n_sorted_parts++;
-}
-
-/*
- * make table of used partition space taken from disk target
- */
-static void
-sort_used_regions(boolean_t is_log_part)
-{
-	partition_info_t *psinfo;
-	int isl;
-
-	n_sorted_parts = 0;
-	for (psinfo = &committed_disk_target->dparts->pinfo[0],
-	    isl = 0; isl < OM_NUMPART; isl++, psinfo++) {
-		if (psinfo->partition_size == 0)
-			continue;
-		/*
-		 * if logical partition is to be created,
-		 *	do not include non-logical partitions in table
-		 */
-		if (is_log_part && !IS_LOG_PAR(psinfo->partition_id))
-			continue;
-		/*
-		 * if primary partition is to be created,
-		 *	do not include logical partitions in table
-		 */
-		if (!is_log_part && IS_LOG_PAR(psinfo->partition_id))
-			continue;
-		insertion_sort_partition_info(psinfo);
-	}
+	return (om_space_find(sp, partition_size,
+	    is_log_part ? LOGICAL_PARTITION_PAD : 0, 1, region));
 }
 
 /*
- * populate a table with entries for each region of free space in the
- *	target disk partition table
- * returns B_FALSE if any problems
+ * bring free space for the primary or the logical partitions up to date
+ *	with the target disk partition table
+ * only partitions changed since the last update are moved in the free space
+ *	tree, so this is cheap enough to call before every query
+ * returns NULL if any problems
  *	-overlapping in the partitions was detected
  *	-disk size unknown
- * returns B_TRUE if no problems were detected
- * side effects:
- *	sets n_fragments: number of free space fragments
- *	calls append_free_space_table() to add free regions
+ *	-out of memory
+ * returns the free space if no problems were detected
  */
-static boolean_t
-build_free_space_table(boolean_t is_log_part)
+static om_space_t *
+update_free_space(boolean_t is_log_part)
 {
-	int isl;
-	uint64_t free_size;
+	om_space_t **spp;
+	partition_info_t *psinfo;
+	partition_info_t *extpinfo;
 	uint64_t max_size_sec;
 	uint64_t starting_sec = 0;
-	partition_info_t *extpinfo;
+	int isl;
 
-	bzero(&sorted_parts, sizeof (sorted_parts));
 	if (is_log_part) {
 		extpinfo = get_extended_partition_info(NULL);
 		if (extpinfo == NULL) {
 			om_debug_print(OM_DBGLVL_ERR,
 			    "system error: failed to find "
 			    "extended partition definition\n");
-			return (B_FALSE);
+			return (NULL);
 		}
 		starting_sec = extpinfo->partition_offset_sec;
 		max_size_sec = extpinfo->partition_size_sec;
@@ -2308,171 +2230,85 @@ build_free_space_table(boolean_t is_log_part)
 			    "but the target disk size (%s) is unknown. "
 			    "Cannot continue installation.\n",
 			    committed_disk_target->dinfo.disk_name);
-			return (B_FALSE);
+			return (NULL);
 		}
 		max_size_sec = disk_size_sec;
 	}
 
-	/* sort partition table by starting offset */
-	sort_used_regions(is_log_part);
-	n_fragments = 0; /* reset number of free regions */
-
-	/* if no partitions used, set entire partition as being free */
-	if (n_sorted_parts == 0) {
-		append_free_space_table(starting_sec, max_size_sec);
-		return (B_TRUE);
-	}
-	/* check for space before first partition */
-	if (is_log_part) {
-		if (sorted_parts[0].partition_offset_sec > starting_sec +
-		    LOGICAL_PARTITION_PAD)
-			append_free_space_table(starting_sec,
-			    sorted_parts[0].partition_offset_sec);
-	} else if (sorted_parts[0].partition_offset_sec > starting_sec) {
-		append_free_space_table(starting_sec,
-		    sorted_parts[0].partition_offset_sec);
-	}
-	for (isl = 0; isl < n_sorted_parts - 1; isl++) {
-		/* does end of current partition overlap start of next one? */
-		if (PARTITION_END(isl) >
-		    sorted_parts[isl + 1].partition_offset_sec) {
-			om_debug_print(OM_DBGLVL_ERR, "User is requesting "
-			    "overlapping partitions, which is illegal.\n");
-			return (B_FALSE);
-		}
-		/* compute space between partitions */
-		free_size = sorted_parts[isl + 1].partition_offset_sec -
-		    PARTITION_END(isl);
-		if (free_size > 0)
-			append_free_space_table(PARTITION_END(isl), free_size);
-	}
-	/* check for any free space between last partition and end of disk */
-	free_size = max_size_sec - PARTITION_END(n_sorted_parts - 1);
-	if (free_size > 0)
-		append_free_space_table(
-		    PARTITION_END(n_sorted_parts - 1), free_size);
-	return (B_TRUE);
-}
-
-/*
- * append offset and length of a block of free space
- */
-static void
-append_free_space_table(uint64_t free_offset, uint64_t free_size)
-{
-	/* should never exceed table size */
-	if (n_fragments >=
-	    sizeof (free_space_table) / sizeof (free_space_table[0]))
-		return;
-
-	free_space_table[n_fragments].free_offset = free_offset;
-	free_space_table[n_fragments].free_size = free_size;
-	om_debug_print(OM_DBGLVL_INFO,
-	    "free space table %d offset %lld size %lld\n",
-	    n_fragments, free_offset, free_size);
-	n_fragments++;
-}
-
-/*
- * find largest contiguous space not in other partitions in free space table
- * must have previous call to build_free_space_table()
- * return size + offset of region or NULL if none found
- */
-static struct free_region *
-find_largest_free_region(boolean_t is_log_part)
-{
-	struct free_region *pregion;
-	struct free_region *largest_region = NULL;
-	int ireg;
-
-	for (pregion = free_space_table, ireg = 0;
-	    ireg < n_fragments; ireg++, pregion++) {
-		if (largest_region == NULL ||
-		    pregion->free_size > largest_region->free_size)
-			largest_region = pregion;
-	}
-	if (largest_region != NULL && is_log_part) {
-		largest_region->free_offset += LOGICAL_PARTITION_PAD;
-		largest_region->free_size -= LOGICAL_PARTITION_PAD;
+	spp = (is_log_part ? &logical_space : &primary_space);
+	if (*spp == NULL && (*spp = om_space_create(OM_NUMPART)) == NULL) {
+		om_set_error(OM_NO_SPACE);
+		return (NULL);
 	}
-	return (largest_region);
-}
+	om_space_set_bounds(*spp, starting_sec, starting_sec + max_size_sec);
 
-/*
- * find contiguous space that fits requested size most closely
- * must have previous call to build_free_space_table()
- * return size + offset of region or NULL if none found
- */
-static struct free_region *
-find_free_region_best_fit(uint64_t partition_size, boolean_t is_log_part)
-{
-	struct free_region *pregion;
-	struct free_region *best_fit = NULL;
-	int ireg;
-
-	/*
-	 * logical partitions require 63 sectors before each one
-	 * request size 63 sectors
-	 */
-	if (is_log_part)
-		partition_size += LOGICAL_PARTITION_PAD;
-	for (pregion = free_space_table, ireg = 0;
-	    ireg < n_fragments; ireg++, pregion++) {
-		if (best_fit == NULL) { /* find first fit */
-			if (pregion->free_size >= partition_size)
-				best_fit = pregion;
-			continue;
-		}
-		/* check if better fit */
-		if (pregion->free_size > partition_size &&
-		    pregion->free_size < best_fit->free_size)
-			best_fit = pregion;
-	}
-	/*
-	 * since logical partitions require padding,
-	 * return the actual size of the block minus the padding
-	 */
-	if (best_fit != NULL && is_log_part) {
-		best_fit->free_offset += LOGICAL_PARTITION_PAD;
-		best_fit->free_size -= LOGICAL_PARTITION_PAD;
+	for (psinfo = &committed_disk_target->dparts->pinfo[0],
+	    isl = 0; isl < OM_NUMPART; isl++, psinfo++) {
+		/*
+		 * if logical partition is to be created,
+		 *	do not include non-logical partitions in table
+		 * if primary partition is to be created,
+		 *	do not include logical partitions in table
+		 */
+		if (psinfo->partition_size == 0 ||
+		    (is_log_part ? !IS_LOG_PAR(psinfo->partition_id) :
+		    IS_LOG_PAR(psinfo->partition_id)))
+			(void) om_space_set(*spp, isl, 0, 0);
+		else
+			(void) om_space_set(*spp, isl,
+			    psinfo->partition_offset_sec,
+			    psinfo->partition_size_sec);
+	}
+	log_used_regions(*spp);
+	if (!om_space_valid(*spp)) {
+		om_debug_print(OM_DBGLVL_ERR, "User is requesting "
+		    "overlapping partitions, which is illegal.\n");
+		return (NULL);
 	}
-	return (best_fit);
+	log_free_space_table(*spp);
+	return (*spp);
 }
 
 /*
- * dump from sorted non-exempt slice table
+ * dump partitions in use, sorted by offset
  */
 static void
-log_used_regions()
+log_used_regions(om_space_t *sp)
 {
+	partition_info_t *pinfo = committed_disk_target->dparts->pinfo;
+	om_extent_t used[OM_NUMPART];
+	int n_used;
 	int isl;
 
+	n_used = om_space_extents(sp, B_TRUE, used, OM_NUMPART);
 	om_debug_print(OM_DBGLVL_INFO, "Sorted partitions table:\n");
-	if (n_sorted_parts == 0) {
+	if (n_used == 0) {
 		om_debug_print(OM_DBGLVL_INFO,
 		    "\tno partitions in sorted table\n");
 		return;
 	}
 	om_debug_print(OM_DBGLVL_INFO,
 	    "\tpartition\toffset\tsize\toffset+size\n");
-	for (isl = 0; isl < n_sorted_parts; isl++) {
+	for (isl = 0; isl < n_used; isl++) {
 		om_debug_print(OM_DBGLVL_INFO, "\t%d\t%lld\t%lld\t%lld\n",
-		    sorted_parts[isl].partition_id,
-		    sorted_parts[isl].partition_offset_sec,
-		    sorted_parts[isl].partition_size_sec,
-		    sorted_parts[isl].partition_offset_sec +
-		    sorted_parts[isl].partition_size_sec);
+		    pinfo[used[isl].id].partition_id,
+		    used[isl].offset, used[isl].size,
+		    used[isl].offset + used[isl].size);
 	}
 }
 
 /*
- * dump free space entries from table
+ * dump free space regions
  */
 static void
-log_free_space_table()
+log_free_space_table(om_space_t *sp)
 {
+	om_extent_t free_space[OM_NUMPART + 1];
+	int n_fragments;
 	int i;
 
+	n_fragments = om_space_extents(sp, B_FALSE, free_space,
+	    OM_NUMPART + 1);
 	om_debug_print(OM_DBGLVL_INFO,
 	    "Free partition space fragments - count %d\n",
 	    n_fragments);
@@ -2483,10 +2319,8 @@ log_free_space_table()
 	om_debug_print(OM_DBGLVL_INFO, "\toffset\tsize\tnoffset+size\n");
 	for (i = 0; i < n_fragments; i++)
 		om_debug_print(OM_DBGLVL_INFO, "\t%lld\t%lld\t%lld\n",
-		    free_space_table[i].free_offset,
-		    free_space_table[i].free_size,
-		    free_space_table[i].free_offset +
-		    free_space_table[i].free_size);
+		    free_space[i].offset, free_space[i].size,
+		    free_space[i].offset + free_space[i].size);
 }
 
 /*
@@ -0,0 +1,477 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Install layout planning.
+ *
+ * om_plan_install_layouts() looks at every place on the discovered disks
+ * Solaris could be installed to - an entire disk, an existing Solaris
+ * partition, or the largest unused region for a new primary or logical
+ * partition - and returns those big enough as proposals, best first.
+ * Each proposal carries the swap and dump the install would create in it
+ * and the space expected to be left free, so a caller can offer a good
+ * default without trying layouts one by one through the partition
+ * editing functions.
+ *
+ * Proposals are ranked by, in order:
+ *	- holding the recommended size
+ *	- not overwriting existing data
+ *	- being on the boot disk
+ *	- expected free space
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	IS_SOLARIS_PARTITION(p) \
+	((p)->partition_type == SUNIXOS2 || \
+	((p)->partition_type == SUNIXOS && \
+	(p)->content_type != OM_CTYPE_LINUXSWAP))
+
+#ifdef	__sparc
+#define	fdisk_is_dos_extended(p) (B_FALSE)
+#else
+#include <libfdisk.h>
+#endif
+
+/*
+ * proposal, with what it is ranked by
+ */
+typedef struct {
+	om_layout_t	*layout;
+	boolean_t	recommended;	/* holds the recommended size */
+	boolean_t	boot_disk;	/* is on the boot disk */
+} candidate_t;
+
+/*
+ * proposals collected while planning
+ */
+typedef struct {
+	om_layout_request_t	*request;
+	uint64_t		min_size;
+	uint64_t		recommended_size;
+	uint64_t		software_size;
+	candidate_t		*cands;
+	int			count;
+	int			alloc;
+} plan_t;
+
+static boolean_t is_excluded_disk(om_layout_request_t *, char *);
+static int plan_disk(plan_t *, disk_info_t *);
+static int plan_free_space(plan_t *, disk_info_t *, disk_parts_t *,
+    boolean_t);
+static int add_layout(plan_t *, disk_info_t *, om_layout_type_t, uint8_t,
+    uint64_t, uint64_t, boolean_t);
+static void free_candidates(plan_t *);
+static int compare_candidates(const void *, const void *);
+
+/*
+ * om_plan_install_layouts
+ * This function proposes install layouts on the discovered disks.
+ * Input:	om_handle_t handle - The handle returned by
+ *		om_initiate_target_discovery()
+ *		disk_info_t *disks - disks to consider, as returned by
+ *		om_get_disk_info()
+ *		om_layout_request_t *request - sizes needed and preserve
+ *		constraints, NULL for defaults
+ * Output:	int *total - number of proposals returned
+ * Return:	om_layout_t * - linked list of proposals, best first. The
+ *		space will be allocated here and should be freed with
+ *		om_free_install_layouts().
+ *		NULL - if no layout can hold the install, or on error.
+ */
+/*ARGSUSED*/
+om_layout_t *
+om_plan_install_layouts(om_handle_t handle, disk_info_t *disks,
+    om_layout_request_t *request, int *total)
+{
+	om_layout_request_t	defaults;
+	om_layout_t		*head = NULL;
+	om_layout_t		**tail = &head;
+	om_layout_t		*lp;
+	plan_t			plan;
+	disk_info_t		*di;
+	int			i;
+
+	*total = 0;
+
+	if (!disk_discovery_done) {
+		om_set_error(OM_DISCOVERY_NEEDED);
+		return (NULL);
+	}
+	if (disks == NULL) {
+		om_set_error(OM_NO_DISKS_FOUND);
+		return (NULL);
+	}
+	if (request == NULL) {
+		bzero(&defaults, sizeof (defaults));
+		request = &defaults;
+	}
+
+	bzero(&plan, sizeof (plan));
+	plan.request = request;
+	plan.min_size = (request->min_size != 0 ? request->min_size :
+	    om_get_min_size(NULL, NULL));
+	plan.recommended_size = (request->recommended_size != 0 ?
+	    request->recommended_size : om_get_recommended_size(NULL, NULL));
+	/* installed software, without the swap the minimum accounts for */
+	plan.software_size = om_get_min_size(NULL, NULL) -
+	    calc_required_swap_size();
+
+	for (di = disks; di != NULL; di = di->next) {
+		if (di->disk_name == NULL ||
+		    is_excluded_disk(request, di->disk_name))
+			continue;
+		if (plan_disk(&plan, di) != OM_SUCCESS) {
+			free_candidates(&plan);
+			om_set_error(OM_NO_SPACE);
+			return (NULL);
+		}
+	}
+
+	if (plan.count == 0) {
+		om_debug_print(OM_DBGLVL_WARN, "No install layout of at least "
+		    "%llu MiB found\n", plan.min_size);
+		free_candidates(&plan);
+		om_set_error(OM_SIZE_IS_SMALL);
+		return (NULL);
+	}
+
+	qsort(plan.cands, plan.count, sizeof (candidate_t),
+	    compare_candidates);
+
+	for (i = 0; i < plan.count; i++) {
+		lp = plan.cands[i].layout;
+		if (request->max_layouts > 0 && i >= request->max_layouts)
+			break;
+		plan.cands[i].layout = NULL;
+		lp->rank = i + 1;
+		*tail = lp;
+		tail = &lp->next;
+		(*total)++;
+		om_debug_print(OM_DBGLVL_INFO, "Install layout %d: %s type %d "
+		    "partition %d offset %llu size %llu MiB, swap %llu MiB, "
+		    "dump %llu MiB, free %llu MiB%s\n", lp->rank,
+		    lp->disk_name, lp->layout_type, lp->partition_id,
+		    lp->offset_sec, lp->size, lp->swap_size, lp->dump_size,
+		    lp->free_size, lp->destructive ? ", overwrites data" : "");
+	}
+
+	free_candidates(&plan);
+	return (head);
+}
+
+/*
+ * om_free_install_layouts
+ * This function will free up the proposals returned by
+ * om_plan_install_layouts().
+ * Input:	om_handle_t handle - The handle returned by
+ *		om_initiate_target_discovery()
+ *		om_layout_t *layouts - The proposals to be freed
+ * Output:	None
+ * Return:	None
+ */
+/*ARGSUSED*/
+void
+om_free_install_layouts(om_handle_t handle, om_layout_t *layouts)
+{
+	om_layout_t	*next;
+
+	for (; layouts != NULL; layouts = next) {
+		next = layouts->next;
+		free(layouts->disk_name);
+		free(layouts);
+	}
+}
+
+/*
+ * is_excluded_disk
+ * Return:	B_TRUE if the request excludes the disk from planning
+ */
+static boolean_t
+is_excluded_disk(om_layout_request_t *request, char *disk_name)
+{
+	char	**dp;
+
+	if (request->exclude_disks == NULL)
+		return (B_FALSE);
+	for (dp = request->exclude_disks; *dp != NULL; dp++)
+		if (streq(*dp, disk_name))
+			return (B_TRUE);
+	return (B_FALSE);
+}
+
+/*
+ * plan_disk
+ * Propose the layouts one disk allows
+ * Return:	OM_SUCCESS, OM_FAILURE if out of memory
+ */
+static int
+plan_disk(plan_t *plan, disk_info_t *di)
+{
+	om_preserve_t		preserve = plan->request->preserve;
+	disk_parts_t		*dp = NULL;
+	partition_info_t	*pinfo;
+	uint64_t		disk_size_sec;
+	boolean_t		used = B_FALSE;
+	boolean_t		other_os = B_FALSE;
+	int			i;
+
+	disk_size_sec = di->disk_size_sec;
+	if (disk_size_sec == 0) /* sometimes sectors field is blank */
+		disk_size_sec = (uint64_t)di->disk_size * BLOCKS_TO_MB;
+	if (disk_size_sec == 0)
+		return (OM_SUCCESS);
+
+	/*
+	 * without an fdisk partition table - on SPARC, or with a GPT label -
+	 * the entire disk is the only choice, and it holds data unless the
+	 * disk is unlabeled
+	 */
+	if (is_system_sparc() || di->label == OM_LABEL_GPT) {
+		used = (di->label != OM_LABEL_UNKNOWN);
+		if (used && (preserve == OM_PRESERVE_ALL ||
+		    (preserve == OM_PRESERVE_OTHER_OS &&
+		    di->label == OM_LABEL_GPT)))
+			return (OM_SUCCESS);
+		return (add_layout(plan, di, OM_LAYOUT_WHOLE_DISK,
+		    is_system_sparc() ? 0 : 1, 0, disk_size_sec, used));
+	}
+
+	/*
+	 * without its partition table, whether the disk holds data isn't
+	 * known, so nothing is proposed on it
+	 */
+	if ((dp = find_partitions_by_disk(di->disk_name)) == NULL) {
+		om_debug_print(OM_DBGLVL_WARN, "No partition information "
+		    "for disk %s, not planned\n", di->disk_name);
+		return (OM_SUCCESS);
+	}
+
+	for (i = 0, pinfo = dp->pinfo; i < OM_NUMPART; i++, pinfo++) {
+		if (!is_used_partition(pinfo) ||
+		    pinfo->partition_size_sec == 0)
+			continue;
+		used = B_TRUE;
+		if (!IS_SOLARIS_PARTITION(pinfo) &&
+		    !fdisk_is_dos_extended(pinfo->partition_type))
+			other_os = B_TRUE;
+	}
+
+	/* an empty disk is used entirely, overwriting nothing */
+	if (!used)
+		return (add_layout(plan, di, OM_LAYOUT_WHOLE_DISK, 1, 0,
+		    disk_size_sec, B_FALSE));
+
+	if (preserve == OM_PRESERVE_NONE ||
+	    (preserve == OM_PRESERVE_OTHER_OS && !other_os)) {
+		if (add_layout(plan, di, OM_LAYOUT_WHOLE_DISK, 1, 0,
+		    disk_size_sec, B_TRUE) != OM_SUCCESS)
+			return (OM_FAILURE);
+	}
+
+	if (preserve != OM_PRESERVE_ALL) {
+		for (i = 0, pinfo = dp->pinfo; i < OM_NUMPART; i++, pinfo++) {
+			if (!is_used_partition(pinfo) ||
+			    pinfo->partition_size_sec == 0 ||
+			    !IS_SOLARIS_PARTITION(pinfo))
+				continue;
+			if (add_layout(plan, di, OM_LAYOUT_SOLARIS_PARTITION,
+			    pinfo->partition_id, pinfo->partition_offset_sec,
+			    pinfo->partition_size_sec, B_TRUE) != OM_SUCCESS)
+				return (OM_FAILURE);
+		}
+	}
+
+	if (plan_free_space(plan, di, dp, B_FALSE) != OM_SUCCESS ||
+	    plan_free_space(plan, di, dp, B_TRUE) != OM_SUCCESS)
+		return (OM_FAILURE);
+	return (OM_SUCCESS);
+}
+
+/*
+ * plan_free_space
+ * Propose a new primary or logical partition in the largest unused
+ * region of a disk, if a partition number is left for it
+ * Return:	OM_SUCCESS, OM_FAILURE if out of memory
+ */
+static int
+plan_free_space(plan_t *plan, disk_info_t *di, disk_parts_t *dp,
+    boolean_t is_log_part)
+{
+	partition_info_t	*pinfo;
+	partition_info_t	*extpinfo = NULL;
+	om_space_t		*sp;
+	om_extent_t		region;
+	uint64_t		start = 0;
+	uint64_t		end;
+	uint8_t			free_id = 0;
+	int			i;
+	int			ret;
+
+	end = di->disk_size_sec;
+	if (end == 0)
+		end = (uint64_t)di->disk_size * BLOCKS_TO_MB;
+
+	for (i = 0, pinfo = dp->pinfo; i < OM_NUMPART; i++, pinfo++) {
+		if (is_used_partition(pinfo) &&
+		    fdisk_is_dos_extended(pinfo->partition_type))
+			extpinfo = pinfo;
+		/* unused entries are indexed by partition number */
+		if (free_id == 0 && !is_used_partition(pinfo) &&
+		    (is_log_part ? IS_LOG_PAR(i + 1) : !IS_LOG_PAR(i + 1)))
+			free_id = i + 1;
+	}
+	if (free_id == 0)
+		return (OM_SUCCESS);
+	if (is_log_part) {
+		if (extpinfo == NULL)
+			return (OM_SUCCESS);
+		start = extpinfo->partition_offset_sec;
+		end = start + extpinfo->partition_size_sec;
+	}
+
+	if ((sp = om_space_create(OM_NUMPART)) == NULL)
+		return (OM_FAILURE);
+	om_space_set_bounds(sp, start, end);
+	for (i = 0, pinfo = dp->pinfo; i < OM_NUMPART; i++, pinfo++) {
+		if (!is_used_partition(pinfo) ||
+		    (is_log_part ? !IS_LOG_PAR(pinfo->partition_id) :
+		    IS_LOG_PAR(pinfo->partition_id)))
+			continue;
+		(void) om_space_set(sp, i, pinfo->partition_offset_sec,
+		    pinfo->partition_size_sec);
+	}
+	/* overlapping partitions are left to the partition editor */
+	ret = OM_SUCCESS;
+	if (om_space_valid(sp) && om_space_find(sp, OM_MAX_SIZE,
+	    is_log_part ? LOGICAL_PARTITION_PAD : 0, 1, &region))
+		ret = add_layout(plan, di, OM_LAYOUT_FREE_SPACE, free_id,
+		    region.offset, region.size, B_FALSE);
+	om_space_destroy(sp);
+	return (ret);
+}
+
+/*
+ * add_layout
+ * Add a proposal if the install fits, with the swap, dump and free space
+ * expected
+ * Return:	OM_SUCCESS, OM_FAILURE if out of memory
+ */
+static int
+add_layout(plan_t *plan, disk_info_t *di, om_layout_type_t layout_type,
+    uint8_t partition_id, uint64_t offset_sec, uint64_t size_sec,
+    boolean_t destructive)
+{
+	om_layout_t	*lp;
+	candidate_t	*cands;
+	uint64_t	size = size_sec / BLOCKS_TO_MB;
+	uint64_t	swap_size, dump_size;
+	uint64_t	needed;
+
+	if (size < plan->min_size ||
+	    estimate_swap_dump_size(size, plan->recommended_size, &swap_size,
+	    &dump_size) != OM_SUCCESS)
+		return (OM_SUCCESS);
+
+	if (plan->count == plan->alloc) {
+		cands = realloc(plan->cands,
+		    (plan->alloc + 16) * sizeof (candidate_t));
+		if (cands == NULL)
+			return (OM_FAILURE);
+		plan->cands = cands;
+		plan->alloc += 16;
+	}
+
+	if ((lp = calloc(1, sizeof (om_layout_t))) == NULL)
+		return (OM_FAILURE);
+	if ((lp->disk_name = strdup(di->disk_name)) == NULL) {
+		free(lp);
+		return (OM_FAILURE);
+	}
+	lp->layout_type = layout_type;
+	lp->partition_id = partition_id;
+	lp->logical = IS_LOG_PAR(partition_id);
+	lp->offset_sec = offset_sec;
+	lp->size_sec = size_sec;
+	lp->size = size;
+	lp->swap_size = swap_size;
+	lp->dump_size = dump_size;
+	needed = plan->software_size + swap_size + dump_size;
+	lp->free_size = (size > needed ? size - needed : 0);
+	lp->destructive = destructive;
+
+	plan->cands[plan->count].layout = lp;
+	plan->cands[plan->count].recommended =
+	    (size >= plan->recommended_size);
+	plan->cands[plan->count].boot_disk = di->boot_disk;
+	plan->count++;
+	return (OM_SUCCESS);
+}
+
+/*
+ * free_candidates
+ * Free the proposals not handed out and the candidate array
+ */
+static void
+free_candidates(plan_t *plan)
+{
+	int	i;
+
+	for (i = 0; i < plan->count; i++)
+		if (plan->cands[i].layout != NULL)
+			om_free_install_layouts(0, plan->cands[i].layout);
+	free(plan->cands);
+}
+
+/*
+ * compare_candidates
+ * qsort() comparison putting the best proposal first
+ */
+static int
+compare_candidates(const void *p1, const void *p2)
+{
+	const candidate_t	*c1 = p1;
+	const candidate_t	*c2 = p2;
+	om_layout_t		*l1 = c1->layout;
+	om_layout_t		*l2 = c2->layout;
+	int			rc;
+
+	if (c1->recommended != c2->recommended)
+		return (c1->recommended ? -1 : 1);
+	if (l1->destructive != l2->destructive)
+		return (l1->destructive ? 1 : -1);
+	if (c1->boot_disk != c2->boot_disk)
+		return (c1->boot_disk ? -1 : 1);
+	if (l1->free_size != l2->free_size)
+		return (l1->free_size > l2->free_size ? -1 : 1);
+	if ((rc = strcmp(l1->disk_name, l2->disk_name)) != 0)
+		return (rc);
+	return (l1->offset_sec < l2->offset_sec ? -1 :
+	    l1->offset_sec > l2->offset_sec);
+}
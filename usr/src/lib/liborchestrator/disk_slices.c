@@ -37,13 +37,6 @@
  * is slice reserved for special purposes and not used for user data
  */
 #define	RESERVED_SLICE(s) ((s) == 2 || (s) == 8 || (s) == 9)
-#define	SLICE_END(i) \
-	(sorted_slices[(i)].slice_offset + sorted_slices[(i)].slice_size)
-
-struct free_region {
-	uint64_t free_offset;
-	uint64_t free_size;
-};
 
 /* track slice edits */
 static struct {
@@ -62,10 +55,7 @@ static boolean_t invalidate_slice_info = B_FALSE;
 static boolean_t swap_slice_1_failure = B_FALSE;
 
 /* free space management */
-static slice_info_t sorted_slices[NDKMAP];
-static int n_sorted_slices = 0;
-static struct free_region free_space_table[NDKMAP];
-static int n_fragments = 0;
+static om_space_t *slice_space = NULL;
 
 static boolean_t are_slices_preserved(void);
 static boolean_t is_slice_already_in_table(int);
@@ -73,17 +63,12 @@ static int get_install_slice_or_0(void);
 static boolean_t are_any_slices_in_table(void);
 static boolean_t remove_slice_from_table(uint8_t);
 static slice_info_t *map_slice_id_to_slice_info(uint8_t);
-static struct free_region *find_unused_region_of_size(uint64_t);
-static boolean_t build_free_space_table(void);
-static struct free_region *find_free_region_best_fit(uint64_t);
-static struct free_region *find_largest_free_region(void);
-static void insertion_sort_slice_info(slice_info_t *);
-static void sort_used_regions(void);
+static boolean_t find_unused_region_of_size(uint64_t, om_extent_t *);
+static boolean_t update_free_space(void);
 static void log_slice_map(void);
 static void log_free_space_table(void);
 static void log_used_regions(void);
 static uint64_t find_solaris_partition_size(void);
-static boolean_t append_free_space_table(uint64_t, uint64_t);
 static void clear_slice_info_if_invalidated(void);
 static void create_swap_slice_if_necessary(void);
 
@@ -416,7 +401,7 @@ om_create_slice(uint8_t slice_id, uint64_t slice_size,
 {
 	slice_info_t *psinfo;
 	int isl;
-	struct free_region *pfree_region;
+	om_extent_t free_region;
 
 	assert(committed_disk_target != NULL);
 	assert(committed_disk_target->dslices != NULL);
@@ -485,8 +470,7 @@ om_create_slice(uint8_t slice_id, uint64_t slice_size,
 		om_set_error(OM_ALREADY_EXISTS);
 		return (B_FALSE);
 	}
-	pfree_region = find_unused_region_of_size(slice_size);
-	if (pfree_region == NULL) {
+	if (!find_unused_region_of_size(slice_size, &free_region)) {
 		om_debug_print(OM_DBGLVL_ERR,
 		    "failure to find unused region of size %s\n",
 		    part_size_or_max(slice_size));
@@ -497,14 +481,14 @@ om_create_slice(uint8_t slice_id, uint64_t slice_size,
 	 * if any customizations detected indicating entire partition is not
 	 *	used for slice 0, mark partition for specific slice edits
 	 */
-	if (slice_size != OM_MAX_SIZE || pfree_region->free_offset != 0)
+	if (slice_size != OM_MAX_SIZE || free_region.offset != 0)
 		use_whole_partition_for_slice_0 = B_FALSE;
 
 	/* if requested slice size is zero, use entire free region */
 	if (slice_size == OM_MAX_SIZE)
-		slice_size = pfree_region->free_size;
+		slice_size = free_region.size;
 	om_debug_print(OM_DBGLVL_INFO, "new slice %d offset=%lld size=%lld\n",
-	    slice_id, pfree_region->free_offset, slice_size);
+	    slice_id, free_region.offset, slice_size);
 	psinfo->slice_id = slice_id;
 	/*
 	 * set VTOC partition tag appropriately
@@ -521,7 +505,7 @@ om_create_slice(uint8_t slice_id, uint64_t slice_size,
 			break;
 	}
 	psinfo->flags = 0;
-	psinfo->slice_offset = pfree_region->free_offset;
+	psinfo->slice_offset = free_region.offset;
 	psinfo->slice_size = slice_size;
 	slice_edit_list[slice_id].create = B_TRUE;
 	slice_edit_list[slice_id].create_size = slice_size;
@@ -579,8 +563,7 @@ om_finalize_vtoc_for_TI(uint8_t install_slice_id)
 	assert(committed_disk_target->dslices != NULL);
 
 	/* log free space table according to debugging level */
-	build_free_space_table();
-	log_free_space_table();
+	(void) update_free_space();
 
 	/* if preserved slices, remove all other slices */
 	/* must also preserve newly-created slices */
@@ -658,13 +641,12 @@ om_finalize_vtoc_for_TI(uint8_t install_slice_id)
 
 	/* log final tables of slices and free space for debugging */
 	log_slice_map();
-	if (!build_free_space_table()) {
+	if (!update_free_space()) {
 		om_debug_print(OM_DBGLVL_ERR, "Aborting VTOC editing "
 		    "due to overlapping slices\n");
 		om_set_error(OM_SLICES_OVERLAP);
 		return (B_FALSE);
 	}
-	log_free_space_table();
 
 	if (orch_part_slice_dryrun) {
 		printf("Exiting dryrun\n");
@@ -1072,182 +1054,64 @@ map_slice_id_to_slice_info(uint8_t slice_id)
 /*
  * find best fit among blocks of unused space that has at least slice_size
  *	sectors unallocated
- * if slice_size is 0, return largest free region
+ * if slice_size is 0, find largest free region
+ * Will accept match if region is up to 1 cylinder smaller than requested
+ *	due to Target Instantiation rounding - facilitates AI manifest reuse
+ *	with slice_on_existing=overwrite option
+ * returns B_TRUE and offset + size of region, or B_FALSE if none found
  */
-static struct free_region *
-find_unused_region_of_size(uint64_t slice_size)
+static boolean_t
+find_unused_region_of_size(uint64_t slice_size, om_extent_t *region)
 {
-	struct free_region *pfree_region;
-
 	assert(committed_disk_target != NULL);
 
-	build_free_space_table();
-	log_free_space_table();
-	if (slice_size == OM_MAX_SIZE) {
-		if ((pfree_region = find_largest_free_region()) == NULL)
-			return (NULL);
-	} else {
-		if ((pfree_region = find_free_region_best_fit(slice_size))
-		    == NULL)
-			return (NULL);
-	}
-	return (pfree_region);
-}
-
-/*
- * do a sorted insertion of used space in partition
- */
-static void
-insertion_sort_slice_info(slice_info_t *psinfo)
-{
-	int isl;
-
-	for (isl = 0; isl < n_sorted_slices; isl++)
-		if (sorted_slices[isl].slice_offset > psinfo->slice_offset)
-			break;
-	/* safe push downward */
-	memmove(&sorted_slices[isl + 1], &sorted_slices[isl],
-	    (n_sorted_slices - isl) * sizeof (slice_info_t));
-	/* move in new slice info entry */
-	memcpy(&sorted_slices[isl], psinfo, sizeof (slice_info_t));
-	n_sorted_slices++;
+	(void) update_free_space();
+	if (slice_space == NULL)
+		return (B_FALSE);
+	/*
+	 * search for the best fit for a region 1 cylinder less than requested
+	 */
+	if (slice_size > committed_disk_target->dinfo.disk_cyl_size)
+		slice_size -= committed_disk_target->dinfo.disk_cyl_size;
+	return (om_space_find(slice_space, slice_size, 0, 1, region));
 }
 
 /*
- * make table of used partition space taken from disk target
+ * bring free space up to date with the target disk slice table
+ * only slices changed since the last update are moved in the free space
+ *	tree, so this is cheap enough to call before every query
+ * returns B_FALSE if any overlapping in the slices was detected or out of
+ * memory, B_TRUE if no problems were detected
  */
-static void
-sort_used_regions()
+static boolean_t
+update_free_space()
 {
 	slice_info_t *psinfo;
 	int isl;
 
-	n_sorted_slices = 0;
+	if (slice_space == NULL &&
+	    (slice_space = om_space_create(NDKMAP)) == NULL) {
+		om_set_error(OM_NO_SPACE);
+		return (B_FALSE);
+	}
+	om_space_set_bounds(slice_space, 0, find_solaris_partition_size());
+
 	for (psinfo = &committed_disk_target->dslices->sinfo[0],
 	    isl = 0; isl < NDKMAP; isl++, psinfo++) {
 		if (RESERVED_SLICE(psinfo->slice_id) || psinfo->slice_size == 0)
-			continue;
-		insertion_sort_slice_info(psinfo);
+			(void) om_space_set(slice_space, isl, 0, 0);
+		else
+			(void) om_space_set(slice_space, isl,
+			    psinfo->slice_offset, psinfo->slice_size);
 	}
 	log_used_regions();
-}
-
-/*
- * populate a table with entries for each region of free space in the
- * target disk partition table
- * returns B_FALSE if any overlapping in the slices was detected,
- * B_TRUE if no problems were detected
- * side effects:
- *	sets n_fragments: number of free space fragments
- *	calls append_free_space_table() to add free regions
- */
-static boolean_t
-build_free_space_table()
-{
-	int isl;
-	uint64_t free_size;
-	uint64_t partition_size_sec = find_solaris_partition_size();
-
-	sort_used_regions(); /* sort slice table by starting offset */
-	n_fragments = 0; /* reset number of free regions */
-
-	/* if no slices used, set entire partition as being free */
-	if (n_sorted_slices == 0) {
-		append_free_space_table(0, partition_size_sec);
-		return (B_TRUE);
-	}
-	/* check for space before first slice */
-	if (sorted_slices[0].slice_offset != 0)
-		append_free_space_table(0, sorted_slices[0].slice_offset);
-	for (isl = 0; isl < n_sorted_slices - 1; isl++) {
-		/* does end of current slice overlap start of next slice? */
-		if (SLICE_END(isl) > sorted_slices[isl + 1].slice_offset) {
-			om_debug_print(OM_DBGLVL_ERR, "User is requesting "
-			    "overlapping slices, which is illegal.\n");
-			return (B_FALSE);
-		}
-		/* compute space between slices */
-		free_size =
-		    sorted_slices[isl + 1].slice_offset - SLICE_END(isl);
-		if (free_size > 0)
-			append_free_space_table(SLICE_END(isl), free_size);
-	}
-	/* check for any free space between last slice and end of partition */
-	free_size = partition_size_sec - SLICE_END(n_sorted_slices - 1);
-	if (free_size > 0)
-		append_free_space_table(
-		    SLICE_END(n_sorted_slices - 1), free_size);
-	return (B_TRUE);
-}
-
-/*
- * append offset and length of a block of free space
- */
-static boolean_t
-append_free_space_table(uint64_t free_offset, uint64_t free_size)
-{
-	if (n_fragments >= NDKMAP)
+	if (!om_space_valid(slice_space)) {
+		om_debug_print(OM_DBGLVL_ERR, "User is requesting "
+		    "overlapping slices, which is illegal.\n");
 		return (B_FALSE);
-	free_space_table[n_fragments].free_offset = free_offset;
-	free_space_table[n_fragments].free_size = free_size;
-	n_fragments++;
-	return (B_TRUE);
-}
-/*
- * find largest contiguous space not in other slices in free space table
- * must have previous call to build_free_space_table()
- * return size + offset of region or NULL if none found
- */
-static struct free_region *
-find_largest_free_region()
-{
-	struct free_region *pregion;
-	struct free_region *largest_region = NULL;
-	int ireg;
-
-	for (pregion = free_space_table, ireg = 0;
-	    ireg < n_fragments; ireg++, pregion++) {
-		if (largest_region == NULL ||
-		    pregion->free_size > largest_region->free_size)
-			largest_region = pregion;
 	}
-	return (largest_region);
-}
-
-/*
- * Find contiguous space that fits most closely requested size
- * Must have previous call to build_free_space_table()
- * Returns size + offset of region or NULL if none found
- * Will accept match if region is up to 1 cylinder smaller than requested
- *	due to Target Instantiation rounding - facilitates AI manifest reuse
- *	with slice_on_existing=overwrite option
- */
-static struct free_region *
-find_free_region_best_fit(uint64_t slice_size)
-{
-	struct free_region *pregion;
-	struct free_region *best_fit = NULL;
-	int ireg;
-
-	/*
-	 * search for the best fit for a region 1 cylinder less than requested
-	 */
-	if (committed_disk_target != NULL &&
-	    slice_size > committed_disk_target->dinfo.disk_cyl_size)
-		slice_size -= committed_disk_target->dinfo.disk_cyl_size;
-	for (pregion = free_space_table, ireg = 0;
-	    ireg < n_fragments; ireg++, pregion++) {
-		if (best_fit == NULL) { /* find first fit */
-			if (pregion->free_size >= slice_size)
-				best_fit = pregion;
-			continue;
-		}
-		/* check if better fit */
-		if (pregion->free_size > slice_size &&
-		    pregion->free_size < best_fit->free_size)
-			best_fit = pregion;
-	}
-	return (best_fit);
+	log_free_space_table();
+	return (B_TRUE);
 }
 
 /*
@@ -1354,38 +1218,44 @@ log_slice_map()
 }
 
 /*
- * dump from sorted non-reserved slice table
+ * dump non-reserved slices in use, sorted by offset
  */
 static void
 log_used_regions()
 {
+	slice_info_t *sinfo = committed_disk_target->dslices->sinfo;
+	om_extent_t used[NDKMAP];
+	int n_used;
 	int isl;
 
+	n_used = om_space_extents(slice_space, B_TRUE, used, NDKMAP);
 	om_debug_print(OM_DBGLVL_INFO, "Sorted slices table:\n");
-	if (n_sorted_slices == 0) {
+	if (n_used == 0) {
 		om_debug_print(OM_DBGLVL_INFO, "\tno slices in sorted table\n");
 		return;
 	}
 	om_debug_print(OM_DBGLVL_INFO,
 	    "\tslice      offset        size offset+size\n");
-	for (isl = 0; isl < n_sorted_slices; isl++) {
+	for (isl = 0; isl < n_used; isl++) {
 		om_debug_print(OM_DBGLVL_INFO, "\t%5d %11lld %11lld %11lld\n",
-		    sorted_slices[isl].slice_id,
-		    sorted_slices[isl].slice_offset,
-		    sorted_slices[isl].slice_size,
-		    sorted_slices[isl].slice_offset +
-		    sorted_slices[isl].slice_size);
+		    sinfo[used[isl].id].slice_id,
+		    used[isl].offset, used[isl].size,
+		    used[isl].offset + used[isl].size);
 	}
 }
 
 /*
- * dump free space entries from table
+ * dump free space regions
  */
 static void
 log_free_space_table()
 {
+	om_extent_t free_space[NDKMAP + 1];
+	int n_fragments;
 	int i;
 
+	n_fragments = om_space_extents(slice_space, B_FALSE, free_space,
+	    NDKMAP + 1);
 	om_debug_print(OM_DBGLVL_INFO, "Free space fragments - count %d:\n",
 	    n_fragments);
 	if (n_fragments == 0) {
@@ -1397,10 +1267,8 @@ log_free_space_table()
 	    "\t     offset        size offset+size\n");
 	for (i = 0; i < n_fragments; i++)
 		om_debug_print(OM_DBGLVL_INFO, "\t%11lld %11lld %11lld\n",
-		    free_space_table[i].free_offset,
-		    free_space_table[i].free_size,
-		    free_space_table[i].free_offset +
-		    free_space_table[i].free_size);
+		    free_space[i].offset, free_space[i].size,
+		    free_space[i].offset + free_space[i].size);
 }
 
 /*
@@ -0,0 +1,522 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Free space management shared by the partition and slice editors.
+ *
+ * An om_space_t tracks the extents used by the entries of one table
+ * (primary partitions, logical partitions or slices) within the bounds of
+ * the disk, extended partition or Solaris partition holding them.  Entries
+ * are identified by their index in the table.
+ *
+ * Used extents are kept in a treap ordered by offset.  Every node also
+ * records the first offset and last end sector of its subtree and the
+ * largest gap between the extents in it, so best fit and largest region
+ * queries skip subtrees which can't hold a better region.  Entries are
+ * updated one at a time by om_space_set(), which leaves the tree alone
+ * when an entry hasn't changed; the editors can thus hand over their
+ * whole table before each query and only pay for what was edited.
+ *
+ * An entry which overlaps one already in the tree is not inserted but
+ * kept aside as a conflict, and is retried whenever an extent leaves the
+ * tree.  The space is valid only while there are no conflicts.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/param.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	SPACE_UNUSED	0	/* entry uses no space */
+#define	SPACE_USED	1	/* extent is in the tree */
+#define	SPACE_CONFLICT	2	/* extent overlaps one in the tree */
+
+struct space_node {
+	struct space_node	*left;
+	struct space_node	*right;
+	uint64_t		offset;	/* extent is [offset, end) */
+	uint64_t		end;
+	uint64_t		lo;	/* first offset in subtree */
+	uint64_t		hi;	/* last end in subtree */
+	uint64_t		gap;	/* largest gap inside subtree */
+	uint32_t		prio;
+	int			state;
+};
+
+struct om_space {
+	uint64_t		start;	/* bounds are [start, end) */
+	uint64_t		end;
+	int			nids;
+	int			nconflicts;
+	struct space_node	*root;
+	struct space_node	*nodes;	/* one per entry */
+};
+
+/*
+ * state of a free space search
+ */
+struct space_query {
+	uint64_t	size;	/* requested size, 0 for largest region */
+	uint64_t	pad;	/* sectors to leave before the region */
+	uint64_t	align;	/* alignment of the region offset */
+	boolean_t	found;
+	uint64_t	offset;	/* best region found */
+	uint64_t	avail;
+};
+
+static void space_update(struct space_node *);
+static void space_split(struct space_node *, uint64_t, struct space_node **,
+    struct space_node **);
+static struct space_node *space_merge(struct space_node *,
+    struct space_node *);
+static boolean_t space_link(om_space_t *, struct space_node *);
+static void space_unlink(om_space_t *, struct space_node *);
+static void space_retry_conflicts(om_space_t *);
+static boolean_t space_prune(struct space_query *, uint64_t);
+static void space_consider(om_space_t *, struct space_query *, uint64_t,
+    uint64_t);
+static void space_search(om_space_t *, struct space_node *, uint64_t *,
+    struct space_query *);
+static int space_walk(om_space_t *, struct space_node *, uint64_t *,
+    boolean_t, om_extent_t *, int, int);
+
+/*
+ * om_space_create
+ * Create free space tracking for a table of nids entries, with empty
+ * bounds.
+ * Input:	int nids - number of entries in the table
+ * Output:	None
+ * Return:	om_space_t *, NULL if out of memory
+ */
+om_space_t *
+om_space_create(int nids)
+{
+	om_space_t	*sp;
+	int		i;
+
+	sp = calloc(1, sizeof (om_space_t));
+	if (sp == NULL)
+		return (NULL);
+	sp->nodes = calloc(nids, sizeof (struct space_node));
+	if (sp->nodes == NULL) {
+		free(sp);
+		return (NULL);
+	}
+	sp->nids = nids;
+	/*
+	 * fixed pseudo-random priorities keep the treap balanced
+	 * whatever order the extents come in
+	 */
+	for (i = 0; i < nids; i++)
+		sp->nodes[i].prio = (uint32_t)(i + 1) * 2654435761U;
+	return (sp);
+}
+
+/*
+ * om_space_destroy
+ * Free free space tracking created by om_space_create()
+ * Input:	om_space_t *sp
+ * Output:	None
+ * Return:	None
+ */
+void
+om_space_destroy(om_space_t *sp)
+{
+	if (sp == NULL)
+		return;
+	free(sp->nodes);
+	free(sp);
+}
+
+/*
+ * om_space_set_bounds
+ * Set the range of sectors entries are allocated from
+ * Input:	om_space_t *sp
+ *		uint64_t start - first sector
+ *		uint64_t end - sector following the last one
+ * Output:	None
+ * Return:	None
+ */
+void
+om_space_set_bounds(om_space_t *sp, uint64_t start, uint64_t end)
+{
+	sp->start = start;
+	sp->end = end;
+}
+
+/*
+ * om_space_set
+ * Record the extent used by an entry, replacing what was recorded before.
+ * An entry of size 0 uses no space.
+ * Input:	om_space_t *sp
+ *		int id - index of the entry in its table
+ *		uint64_t offset, size - extent used by the entry
+ * Output:	None
+ * Return:	B_TRUE if the entry uses no space or its extent is free of
+ *		overlap, B_FALSE if it overlaps another entry
+ */
+boolean_t
+om_space_set(om_space_t *sp, int id, uint64_t offset, uint64_t size)
+{
+	struct space_node *n;
+
+	assert(id >= 0 && id < sp->nids);
+	n = &sp->nodes[id];
+	if (size == 0) {
+		if (n->state != SPACE_UNUSED)
+			space_unlink(sp, n);
+		return (B_TRUE);
+	}
+	/* nothing to do if the entry is unchanged */
+	if (n->state != SPACE_UNUSED &&
+	    n->offset == offset && n->end == offset + size)
+		return (n->state == SPACE_USED);
+	if (n->state != SPACE_UNUSED)
+		space_unlink(sp, n);
+	n->offset = offset;
+	n->end = offset + size;
+	return (space_link(sp, n));
+}
+
+/*
+ * om_space_valid
+ * Input:	om_space_t *sp
+ * Output:	None
+ * Return:	B_TRUE if no entries overlap, B_FALSE otherwise
+ */
+boolean_t
+om_space_valid(om_space_t *sp)
+{
+	return (sp->nconflicts == 0);
+}
+
+/*
+ * om_space_find
+ * Find a free region for a new entry.  If size is given, the smallest
+ * region which can hold it is returned, otherwise the largest region.
+ * Among equal regions the one with the lowest offset is taken.
+ * Input:	om_space_t *sp
+ *		uint64_t size - sectors needed, 0 for the largest region
+ *		uint64_t pad - sectors to leave free before the region
+ *		uint64_t align - alignment of the region offset, 0 or 1 for
+ *			none
+ * Output:	om_extent_t *ext - offset of the region, after padding and
+ *			alignment, and the sectors available from there
+ * Return:	B_TRUE if a region was found, B_FALSE otherwise
+ */
+boolean_t
+om_space_find(om_space_t *sp, uint64_t size, uint64_t pad, uint64_t align,
+    om_extent_t *ext)
+{
+	struct space_query	q;
+	uint64_t		prev_end = sp->start;
+
+	bzero(&q, sizeof (q));
+	q.size = size;
+	q.pad = pad;
+	q.align = (align == 0 ? 1 : align);
+	space_search(sp, sp->root, &prev_end, &q);
+	space_consider(sp, &q, prev_end, sp->end);
+	if (!q.found)
+		return (B_FALSE);
+	ext->offset = q.offset;
+	ext->size = q.avail;
+	ext->id = -1;
+	return (B_TRUE);
+}
+
+/*
+ * om_space_extents
+ * List the used extents or free regions within the bounds in order of
+ * offset, for logging
+ * Input:	om_space_t *sp
+ *		boolean_t used - B_TRUE for used extents, B_FALSE for free
+ *		int max - size of ext[]
+ * Output:	om_extent_t ext[] - extents, with id set to the entry using
+ *			the extent or -1 for free regions
+ * Return:	number of extents listed
+ */
+int
+om_space_extents(om_space_t *sp, boolean_t used, om_extent_t ext[], int max)
+{
+	uint64_t	prev_end = sp->start;
+	int		count;
+
+	count = space_walk(sp, sp->root, &prev_end, used, ext, max, 0);
+	if (!used && prev_end < sp->end && count < max) {
+		ext[count].offset = prev_end;
+		ext[count].size = sp->end - prev_end;
+		ext[count].id = -1;
+		count++;
+	}
+	return (count);
+}
+
+/*
+ * space_update
+ * Recompute the subtree summary of a node from its children
+ */
+static void
+space_update(struct space_node *n)
+{
+	uint64_t gap = 0;
+
+	n->lo = n->offset;
+	n->hi = n->end;
+	if (n->left != NULL) {
+		n->lo = n->left->lo;
+		gap = MAX(n->left->gap, n->offset - n->left->hi);
+	}
+	if (n->right != NULL) {
+		n->hi = n->right->hi;
+		gap = MAX(gap, n->right->gap);
+		gap = MAX(gap, n->right->lo - n->end);
+	}
+	n->gap = gap;
+}
+
+/*
+ * space_split
+ * Split a subtree into extents starting before key and the others
+ */
+static void
+space_split(struct space_node *t, uint64_t key, struct space_node **l,
+    struct space_node **r)
+{
+	if (t == NULL) {
+		*l = *r = NULL;
+		return;
+	}
+	if (t->offset < key) {
+		space_split(t->right, key, &t->right, r);
+		*l = t;
+	} else {
+		space_split(t->left, key, l, &t->left);
+		*r = t;
+	}
+	space_update(t);
+}
+
+/*
+ * space_merge
+ * Join two subtrees, all extents of l preceding those of r
+ */
+static struct space_node *
+space_merge(struct space_node *l, struct space_node *r)
+{
+	if (l == NULL)
+		return (r);
+	if (r == NULL)
+		return (l);
+	if (l->prio > r->prio) {
+		l->right = space_merge(l->right, r);
+		space_update(l);
+		return (l);
+	}
+	r->left = space_merge(l, r->left);
+	space_update(r);
+	return (r);
+}
+
+/*
+ * space_link
+ * Insert the extent of a node into the tree, or mark it as a conflict if
+ * it overlaps an extent already there
+ * Return:	B_TRUE if inserted, B_FALSE if in conflict
+ */
+static boolean_t
+space_link(om_space_t *sp, struct space_node *n)
+{
+	struct space_node *l, *r;
+
+	space_split(sp->root, n->offset, &l, &r);
+	if ((l != NULL && l->hi > n->offset) ||
+	    (r != NULL && r->lo < n->end)) {
+		sp->root = space_merge(l, r);
+		n->state = SPACE_CONFLICT;
+		sp->nconflicts++;
+		return (B_FALSE);
+	}
+	n->left = n->right = NULL;
+	space_update(n);
+	sp->root = space_merge(space_merge(l, n), r);
+	n->state = SPACE_USED;
+	return (B_TRUE);
+}
+
+/*
+ * space_unlink
+ * Remove the extent of a node from the tree or from the conflicts
+ */
+static void
+space_unlink(om_space_t *sp, struct space_node *n)
+{
+	struct space_node *l, *m, *r;
+
+	if (n->state == SPACE_CONFLICT) {
+		sp->nconflicts--;
+		n->state = SPACE_UNUSED;
+		return;
+	}
+	/* extents in the tree don't overlap, so offsets are unique */
+	space_split(sp->root, n->offset, &l, &r);
+	space_split(r, n->offset + 1, &m, &r);
+	assert(m == n);
+	sp->root = space_merge(l, r);
+	n->state = SPACE_UNUSED;
+	if (sp->nconflicts > 0)
+		space_retry_conflicts(sp);
+}
+
+/*
+ * space_retry_conflicts
+ * An extent left the tree - insert conflicting extents which now fit
+ */
+static void
+space_retry_conflicts(om_space_t *sp)
+{
+	struct space_node *n;
+	int i;
+
+	for (i = 0, n = sp->nodes; i < sp->nids; i++, n++) {
+		if (n->state != SPACE_CONFLICT)
+			continue;
+		sp->nconflicts--;
+		(void) space_link(sp, n);
+	}
+}
+
+/*
+ * space_prune
+ * Return:	B_TRUE if no gap of the given size can improve on the region
+ *		found so far
+ */
+static boolean_t
+space_prune(struct space_query *q, uint64_t gap)
+{
+	if (gap <= q->pad)
+		return (B_TRUE);
+	gap -= q->pad;
+	if (q->size != 0) {
+		/* best fit: too small, or can't beat an exact fit */
+		return (gap < q->size ||
+		    (q->found && q->avail == q->size));
+	}
+	/* largest: earlier regions win ties */
+	return (q->found && gap <= q->avail);
+}
+
+/*
+ * space_consider
+ * Check the free region [start, end) against the best one found so far
+ */
+static void
+space_consider(om_space_t *sp, struct space_query *q, uint64_t start,
+    uint64_t end)
+{
+	uint64_t offset, avail;
+
+	start = MAX(start, sp->start);
+	end = MIN(end, sp->end);
+	if (end <= start || end - start <= q->pad)
+		return;
+	offset = start + q->pad;
+	if (offset % q->align != 0)
+		offset += q->align - offset % q->align;
+	if (offset >= end)
+		return;
+	avail = end - offset;
+	if (q->size != 0) {
+		if (avail < q->size || (q->found && avail >= q->avail))
+			return;
+	} else if (q->found && avail <= q->avail) {
+		return;
+	}
+	q->found = B_TRUE;
+	q->offset = offset;
+	q->avail = avail;
+}
+
+/*
+ * space_search
+ * Visit the free regions up to the end of a subtree in order of offset.
+ * prev_end is the end of the extent preceding the subtree on entry, and
+ * the last end in the subtree on return.
+ */
+static void
+space_search(om_space_t *sp, struct space_node *n, uint64_t *prev_end,
+    struct space_query *q)
+{
+	uint64_t before;
+
+	if (n == NULL)
+		return;
+	before = (n->lo > *prev_end ? n->lo - *prev_end : 0);
+	if (space_prune(q, MAX(before, n->gap))) {
+		*prev_end = n->hi;
+		return;
+	}
+	space_search(sp, n->left, prev_end, q);
+	space_consider(sp, q, *prev_end, n->offset);
+	*prev_end = n->end;
+	space_search(sp, n->right, prev_end, q);
+}
+
+/*
+ * space_walk
+ * Append the used extents or the free regions preceding them in a
+ * subtree to ext[], clipping free regions to the bounds
+ */
+static int
+space_walk(om_space_t *sp, struct space_node *n, uint64_t *prev_end,
+    boolean_t used, om_extent_t ext[], int max, int count)
+{
+	uint64_t start, end;
+
+	if (n == NULL)
+		return (count);
+	count = space_walk(sp, n->left, prev_end, used, ext, max, count);
+	if (used) {
+		if (count < max) {
+			ext[count].offset = n->offset;
+			ext[count].size = n->end - n->offset;
+			ext[count].id = (int)(n - sp->nodes);
+			count++;
+		}
+	} else {
+		start = MAX(*prev_end, sp->start);
+		end = MIN(n->offset, sp->end);
+		if (end > start && count < max) {
+			ext[count].offset = start;
+			ext[count].size = end - start;
+			ext[count].id = -1;
+			count++;
+		}
+	}
+	*prev_end = MAX(*prev_end, n->end);
+	return (space_walk(sp, n->right, prev_end, used, ext, max, count));
+}
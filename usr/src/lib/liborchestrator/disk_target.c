@@ -186,6 +186,9 @@ handle_disk_discovery(void *args)
 	 */
 	disk_discovery_done = B_TRUE;
 	td_discovery_release();
+
+	om_post_discovery_done(num_disks,
+	    num_disks > 0 ? OM_SUCCESS : OM_NO_DISKS_FOUND);
 	pthread_exit((void *)&status);
 	/* LINTED [no return statement] */
 }
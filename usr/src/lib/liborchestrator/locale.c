@@ -45,6 +45,7 @@
 #include <stdlib.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <dirent.h>
 #include <ctype.h>
@@ -62,6 +63,32 @@
 #define	INSTALL_NLS_PATH	"/usr/lib/install/data/lib/locale"
 #define	NLS_PATH		"/usr/lib/locale"
 
+/*
+ * Listing of the two locale directories above, written by distro_const
+ * when the image is built. Each line holds a tag and a locale name.
+ */
+#define	LOCALE_CATALOG		"/usr/lib/install/data/locale_catalog"
+#define	CATALOG_HEADER		"#locale catalog 1\n"
+#define	CATALOG_INSTALL		'I'	/* in INSTALL_NLS_PATH */
+#define	CATALOG_SUPPORTED	'S'	/* in NLS_PATH */
+#define	CATALOG_VALID		'V'	/* in NLS_PATH, and a valid locale */
+
+#define	CATALOG_HASH_SIZE	1024
+#define	LANG_HASH_SIZE		64
+
+/* slot of a two letter language or country code */
+#define	CODE_SLOTS		(26 * 26)
+
+typedef struct ll_hash_ent {
+	char			*key;
+	void			*data;
+	struct ll_hash_ent	*next;
+} ll_hash_ent_t;
+
+typedef struct ll_hash {
+	int		size;
+	ll_hash_ent_t	**buckets;
+} ll_hash_t;
 
 /* Static variables used to store language/locale system information */
 
@@ -77,6 +104,26 @@ static	int		install_initialized = 0;
 static	int		install_lang_total = 0;
 static	int		supported_lang_total = 0;
 
+/*
+ * The locale catalog is mapped privately and split into strings in place,
+ * the lists below point into the mapping.
+ */
+static struct {
+	boolean_t	tried;
+	char		*map;
+	size_t		size;
+	char		*install[MAX_NUM_LANG];
+	int		ninstall;
+	char		*supported[MAX_NUM_LANG];
+	int		nsupported;
+	ll_hash_t	*valid;
+} catalog;
+
+/* index + 1 of the entries of the code tables, by code slot */
+static	boolean_t	code_index_built = B_FALSE;
+static	short		lang_code_index[CODE_SLOTS];
+static	short		country_code_index[CODE_SLOTS];
+
 struct	chinese_values {
 	char 	*lang;
 	char	*lang_name;
@@ -96,16 +143,23 @@ static int 	add_lang_to_list(char ***list, char *locale, int *k, int j);
 static void 	add_locale_entry_to_lang(lang_info_t *lp, char *locale,
     char *region, boolean_t is_default);
 static int	build_language_list(char *path, char **, int *);
+static int	catalog_language_list(char *path, char **, int *);
+static boolean_t load_catalog(void);
 static void	build_install_ll_list(char *nlspath, char **list,
     int lang_total, lang_info_t **return_list, int *ll_total);
 static void	build_ll_list(char **list, int lang_total,
 		    lang_info_t **, int *total);
 static	char	*copy_up_to(char *start, char *t);
+static int	code_slot(char *code, boolean_t any_case);
+static void	build_code_index(void);
+static int	find_lang_code(char *locale);
+static int	find_country_code(char *region);
 static int	create_lang_entry(char *lang, char *locale, char *region,
-    lang_info_t **, boolean_t locale_app_locale, boolean_t locale_in_installer_lang);
+    lang_info_t **, ll_hash_t *index, boolean_t locale_app_locale,
+    boolean_t locale_in_installer_lang);
 static void	end_of_comp(char **t, char **start);
 static char 	**get_actual_languages(char **list, int *);
-static lang_info_t *get_lang_entry(char *, lang_info_t *search_list);
+static lang_info_t *get_lang_entry(char *, ll_hash_t *index);
 static char 	*get_locale_component(char **t, char **start);
 static char 	*get_locale_description(char *lang, char *region);
 static int 	handle_chinese_language(char *region, char **lang);
@@ -113,6 +167,10 @@ static boolean_t is_locale_in_installer_lang(char *locale_name);
 static boolean_t is_locale_app_locale(char *locale_name);
 static boolean_t is_valid_locale(char *locale);
 static int 	list_cmp(const void *p1, const void *p2);
+static ll_hash_t *ll_hash_create(int size);
+static void	ll_hash_destroy(ll_hash_t *hash);
+static int	ll_hash_add(ll_hash_t *hash, char *key, void *data);
+static void	*ll_hash_find(ll_hash_t *hash, char *key);
 static int 	lang_init(char *path, char **list, int *total, int *init_var);
 static int 	save_system_default_locale(char *locale);
 static void 	set_lang(char *locale);
@@ -609,7 +667,14 @@ lang_init(char *path, char **list, int *total, int *init_var)
 {
 	int	ret;
 
-	ret = build_language_list(path, list, total);
+	/*
+	 * The catalog written when the image was built spares reading
+	 * the directory.
+	 */
+	if (catalog_language_list(path, list, total) == OM_SUCCESS)
+		ret = OM_SUCCESS;
+	else
+		ret = build_language_list(path, list, total);
 	if (!ret) {
 		*init_var = 1;
 	}
@@ -630,6 +695,8 @@ lang_init(char *path, char **list, int *total, int *init_var)
  * Parameters
  *		lang - language to add
  *		locale - locale which uses lang
+ *		index - index of the list by language code, the new
+ *			node is added to it
  *
  * Return
  *		none
@@ -637,9 +704,11 @@ lang_init(char *path, char **list, int *total, int *init_var)
  */
 static int
 create_lang_entry(char *lang, char *locale, char *region,
-    lang_info_t **return_list, boolean_t locale_app_locale, boolean_t locale_in_installer_lang)
+    lang_info_t **return_list, ll_hash_t *index, boolean_t locale_app_locale,
+    boolean_t locale_in_installer_lang)
 {
 	lang_info_t	*tmp, *last, *new;
+	char		*english;
 	locale_info_t	*lp = NULL;
 	char		**trans_lang = NULL;
 	char		*sub = NULL;
@@ -714,12 +783,16 @@ create_lang_entry(char *lang, char *locale, char *region,
 		new->locale_info->def_locale = locale_app_locale;
 		new->n_locales++;
 	}
+	if (ll_hash_add(index, new->lang, new) != OM_SUCCESS) {
+		om_set_error(OM_NO_SPACE);
+		goto error;
+	}
 	if (list != NULL) {
+		english = dgettext(TEXT_DOMAIN, "English");
 		for (tmp = list, last = NULL; tmp != NULL;
 		    last = tmp, tmp = tmp->next) {
 			/* Everything is after English */
-			if (strcmp(tmp->lang, dgettext(TEXT_DOMAIN,
-			    "English")) == 0) {
+			if (strcmp(tmp->lang, english) == 0) {
 				break;
 			}
 			if (strcmp(tmp->lang, lang) > 0) {
@@ -759,18 +832,16 @@ error:
  *
  * Parameters
  *		lang - language to search for
+ *		index - index of the lang/locale list by language code
  *
  * Return
  *		a pointer to the correct lang/locale node or NULL
  *
  */
 static lang_info_t *
-get_lang_entry(char *lang_name, lang_info_t *search_list)
+get_lang_entry(char *lang_name, ll_hash_t *index)
 {
-	lang_info_t 	*list = NULL;
-	char		*sub = NULL;
 	char		*code = NULL;
-	boolean_t	found = B_FALSE;
 
 	if (lang_name == NULL)
 		return (NULL);
@@ -778,25 +849,9 @@ get_lang_entry(char *lang_name, lang_info_t *search_list)
 	 * Chinese language names are stored differently.
 	 */
 
-	sub = substitute_language(lang_name, &code);
+	(void) substitute_language(lang_name, &code);
 
-	for (list = search_list; list != NULL; list = list->next) {
-		if (code) {
-			if (strcmp(list->lang, code) == 0) {
-				found = B_TRUE;
-				break;
-			}
-		} else {
-			if (strcmp(list->lang, lang_name) == 0) {
-				found = B_TRUE;
-				break;
-			}
-		}
-	}
-
-	if (!found)
-		return (NULL);
-	return (list);
+	return (ll_hash_find(index, code != NULL ? code : lang_name));
 }
 
 /*
@@ -882,6 +937,7 @@ build_install_ll_list(char *nlspath, char **install_list, int lang_total,
 	boolean_t	is_default = B_FALSE;
 	char		*start = NULL, *t = NULL, *lang = NULL;
 	char		*region = NULL, *encoding = NULL;
+	ll_hash_t	*index;
 
 	*return_list = NULL;
 
@@ -890,6 +946,11 @@ build_install_ll_list(char *nlspath, char **install_list, int lang_total,
 		return;
 	}
 
+	if ((index = ll_hash_create(LANG_HASH_SIZE)) == NULL) {
+		om_set_error(OM_NO_SPACE);
+		return;
+	}
+
 	(void) memset(trans, 0, sizeof (trans));
 	/*
 	 * For the installer application supported languages we only
@@ -938,11 +999,12 @@ build_install_ll_list(char *nlspath, char **install_list, int lang_total,
 			}
 		}
 
-		if ((lp = get_lang_entry(lang, *return_list)) != NULL) {
+		if ((lp = get_lang_entry(lang, index)) != NULL) {
 			continue;
 		} else {
 			ret = create_lang_entry(install_list[i],
-			    install_list[i], region, return_list, is_default, is_default);
+			    install_list[i], region, return_list, index,
+			    is_default, is_default);
 			if (!ret)
 				num_entries++;
 		}
@@ -1045,10 +1107,12 @@ build_install_ll_list(char *nlspath, char **install_list, int lang_total,
 	translate_lang_names(return_list);
 	*ll_total = num_entries;
 	(void) fclose(fp);
+	ll_hash_destroy(index);
 	return;
 
 error:
 	(void) fclose(fp);
+	ll_hash_destroy(index);
 	om_free_lang_info(*return_list);
 	*return_list = NULL;
 	*ll_total = 0;
@@ -1072,9 +1136,15 @@ build_ll_list(char **list, int lang_total, lang_info_t **return_list,
 	char		*t = NULL;
 	boolean_t	locale_app_locale = B_FALSE;
 	boolean_t	locale_in_installer_lang = B_FALSE;
+	ll_hash_t	*index;
 
 	*total = 0;
 
+	if ((index = ll_hash_create(LANG_HASH_SIZE)) == NULL) {
+		om_set_error(OM_NO_SPACE);
+		return;
+	}
+
 	/*
 	 * lang_list passed in is a sorted list of the data found in
 	 * the locale directory. Take this sorted list,
@@ -1174,12 +1244,13 @@ build_ll_list(char **list, int lang_total, lang_info_t **return_list,
 			    lang == NULL ? "#" : lang,
 			    region == NULL ? "#" : region);
 
-			if ((lp = get_lang_entry(lang, *return_list)) != NULL) {
+			if ((lp = get_lang_entry(lang, index)) != NULL) {
 				add_locale_entry_to_lang(lp, locale, region,
 				    locale_app_locale);
 			} else {
 				ret = create_lang_entry(lang, locale, region,
-				    return_list, locale_app_locale, locale_in_installer_lang);
+				    return_list, index, locale_app_locale,
+				    locale_in_installer_lang);
 				if (!ret) {
 					num_langs++;
 					om_debug_print(OM_DBGLVL_INFO,
@@ -1197,8 +1268,10 @@ build_ll_list(char **list, int lang_total, lang_info_t **return_list,
 		locale = NULL;
 	}
 	*total = num_langs;
+	ll_hash_destroy(index);
 	return;
 error:
+	ll_hash_destroy(index);
 	om_free_lang_info(*return_list);
 	*return_list = NULL;
 	free(region);
@@ -1263,6 +1336,318 @@ error:
 	(void) closedir(locale_dir);
 	return (OM_FAILURE);
 }
+/*
+ * load_catalog:
+ *
+ *	Map the locale catalog written by distro_const, if any, and
+ *	split it into the lists of the locale directories. The catalog
+ *	is not used if one of the directories changed after it was
+ *	written.
+ *
+ *	Returns B_TRUE if the catalog can be used.
+ */
+static boolean_t
+load_catalog(void)
+{
+	struct stat	cat_stat, dir_stat;
+	char		*line, *end, *name;
+	size_t		hdr_len = strlen(CATALOG_HEADER);
+	int		fd;
+
+	if (catalog.tried)
+		return (catalog.map != NULL);
+	catalog.tried = B_TRUE;
+
+	if (stat(LOCALE_CATALOG, &cat_stat) != 0 ||
+	    cat_stat.st_size <= hdr_len)
+		return (B_FALSE);
+	if ((stat(NLS_PATH, &dir_stat) == 0 &&
+	    dir_stat.st_mtime > cat_stat.st_mtime) ||
+	    (stat(INSTALL_NLS_PATH, &dir_stat) == 0 &&
+	    dir_stat.st_mtime > cat_stat.st_mtime)) {
+		om_debug_print(OM_DBGLVL_WARN, "%s is out of date, "
+		    "reading locale directories\n", LOCALE_CATALOG);
+		return (B_FALSE);
+	}
+
+	if ((fd = open(LOCALE_CATALOG, O_RDONLY)) == -1)
+		return (B_FALSE);
+	catalog.size = cat_stat.st_size;
+	catalog.map = mmap(NULL, catalog.size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+	if (catalog.map == MAP_FAILED) {
+		catalog.map = NULL;
+		return (B_FALSE);
+	}
+
+	if (strncmp(catalog.map, CATALOG_HEADER, hdr_len) != 0 ||
+	    catalog.map[catalog.size - 1] != '\n') {
+		om_debug_print(OM_DBGLVL_WARN, "%s is not a locale catalog\n",
+		    LOCALE_CATALOG);
+		goto error;
+	}
+	if ((catalog.valid = ll_hash_create(CATALOG_HASH_SIZE)) == NULL)
+		goto error;
+
+	for (line = catalog.map + hdr_len; line < catalog.map + catalog.size;
+	    line = end + 1) {
+		end = memchr(line, '\n', catalog.map + catalog.size - line);
+		*end = '\0';
+		if (end - line < 3 || line[1] != '\t')
+			continue;
+		name = line + 2;
+
+		switch (line[0]) {
+		case CATALOG_INSTALL:
+			if (catalog.ninstall < MAX_NUM_LANG - 1)
+				catalog.install[catalog.ninstall++] = name;
+			break;
+		case CATALOG_VALID:
+			if (ll_hash_add(catalog.valid, name, name) !=
+			    OM_SUCCESS)
+				goto error;
+			/* FALLTHROUGH */
+		case CATALOG_SUPPORTED:
+			if (catalog.nsupported < MAX_NUM_LANG - 1)
+				catalog.supported[catalog.nsupported++] = name;
+			break;
+		}
+	}
+
+	om_debug_print(OM_DBGLVL_INFO, "Using %s: %d install languages, "
+	    "%d locales\n", LOCALE_CATALOG, catalog.ninstall,
+	    catalog.nsupported);
+	return (B_TRUE);
+
+error:
+	ll_hash_destroy(catalog.valid);
+	catalog.valid = NULL;
+	catalog.ninstall = 0;
+	catalog.nsupported = 0;
+	(void) munmap(catalog.map, catalog.size);
+	catalog.map = NULL;
+	return (B_FALSE);
+}
+
+/*
+ * catalog_language_list:
+ *
+ *	Same as build_language_list(), from the locale catalog. The
+ *	list points into the catalog.
+ */
+static int
+catalog_language_list(char *path, char **list, int *total)
+{
+	char	**names;
+	int	i, n;
+
+	if (!load_catalog())
+		return (OM_FAILURE);
+
+	if (strcmp(path, NLS_PATH) == 0) {
+		names = catalog.supported;
+		n = catalog.nsupported;
+	} else if (strcmp(path, INSTALL_NLS_PATH) == 0) {
+		names = catalog.install;
+		n = catalog.ninstall;
+	} else {
+		return (OM_FAILURE);
+	}
+
+	/*
+	 * Directory wasn't on the image when the catalog was written.
+	 */
+	if (n == 0)
+		return (OM_FAILURE);
+
+	for (i = 0; i < n; i++)
+		list[i] = names[i];
+	list[n] = NULL;
+	*total = n;
+	return (OM_SUCCESS);
+}
+
+/*
+ * ll_hash_create:
+ *
+ *	Create a hash table of strings. The keys are not copied and
+ *	must outlive the table.
+ */
+static ll_hash_t *
+ll_hash_create(int size)
+{
+	ll_hash_t	*hash;
+
+	if ((hash = malloc(sizeof (ll_hash_t))) == NULL)
+		return (NULL);
+	hash->size = size;
+	hash->buckets = calloc(size, sizeof (ll_hash_ent_t *));
+	if (hash->buckets == NULL) {
+		free(hash);
+		return (NULL);
+	}
+	return (hash);
+}
+
+static void
+ll_hash_destroy(ll_hash_t *hash)
+{
+	ll_hash_ent_t	*ent, *next;
+	int		i;
+
+	if (hash == NULL)
+		return;
+	for (i = 0; i < hash->size; i++) {
+		for (ent = hash->buckets[i]; ent != NULL; ent = next) {
+			next = ent->next;
+			free(ent);
+		}
+	}
+	free(hash->buckets);
+	free(hash);
+}
+
+static uint_t
+ll_hash_bucket(ll_hash_t *hash, char *key)
+{
+	uint_t	h = 0;
+
+	while (*key != '\0')
+		h = h * 31 + (uchar_t)*key++;
+	return (h % hash->size);
+}
+
+static int
+ll_hash_add(ll_hash_t *hash, char *key, void *data)
+{
+	ll_hash_ent_t	*ent;
+	uint_t		b = ll_hash_bucket(hash, key);
+
+	if ((ent = malloc(sizeof (ll_hash_ent_t))) == NULL)
+		return (OM_FAILURE);
+	ent->key = key;
+	ent->data = data;
+	ent->next = hash->buckets[b];
+	hash->buckets[b] = ent;
+	return (OM_SUCCESS);
+}
+
+static void *
+ll_hash_find(ll_hash_t *hash, char *key)
+{
+	ll_hash_ent_t	*ent;
+
+	for (ent = hash->buckets[ll_hash_bucket(hash, key)]; ent != NULL;
+	    ent = ent->next) {
+		if (strcmp(ent->key, key) == 0)
+			return (ent->data);
+	}
+	return (NULL);
+}
+
+/*
+ * code_slot:
+ *
+ *	Slot of the two letter code starting the string, or -1 if it
+ *	doesn't start with two letters. Only lower case letters are
+ *	accepted unless any_case is set.
+ */
+static int
+code_slot(char *code, boolean_t any_case)
+{
+	int	c0 = (uchar_t)code[0], c1;
+
+	if (c0 == '\0')
+		return (-1);
+	c1 = (uchar_t)code[1];
+	if (any_case) {
+		c0 = tolower(c0);
+		c1 = tolower(c1);
+	}
+	if (!islower(c0) || !islower(c1))
+		return (-1);
+	return ((c0 - 'a') * 26 + (c1 - 'a'));
+}
+
+/*
+ * build_code_index:
+ *
+ *	Index the language and country code tables by code slot. The
+ *	first entry of a code wins, as it did for a scan of the table.
+ */
+static void
+build_code_index(void)
+{
+	int	i, slot;
+
+	if (code_index_built)
+		return;
+
+	for (i = 0; i < sizeof (orchestrator_lang_list) /
+	    sizeof (orchestrator_lang_list[0]); i++) {
+		slot = code_slot(orchestrator_lang_list[i].lang_code, B_FALSE);
+		if (slot >= 0 && orchestrator_lang_list[i].lang_code[2] ==
+		    '\0' && lang_code_index[slot] == 0)
+			lang_code_index[slot] = i + 1;
+	}
+	for (i = 0; i < sizeof (orchestrator_country_list) /
+	    sizeof (orchestrator_country_list[0]); i++) {
+		slot = code_slot(orchestrator_country_list[i].country_code,
+		    B_TRUE);
+		if (slot >= 0 && country_code_index[slot] == 0)
+			country_code_index[slot] = i + 1;
+	}
+	code_index_built = B_TRUE;
+}
+
+/*
+ * find_lang_code:
+ *
+ *	Find the entry of orchestrator_lang_list[] whose code matches the
+ *	first two characters of the locale.
+ *
+ *	Returns the index of the entry, or -1 if none.
+ */
+static int
+find_lang_code(char *locale)
+{
+	int	i, slot;
+
+	build_code_index();
+
+	if ((slot = code_slot(locale, B_FALSE)) >= 0)
+		return (lang_code_index[slot] - 1);
+
+	/* codes which aren't two lower case letters, like "C" */
+	for (i = 0; i < sizeof (orchestrator_lang_list) /
+	    sizeof (orchestrator_lang_list[0]); i++) {
+		if (strncmp(locale, orchestrator_lang_list[i].lang_code,
+		    2) == 0)
+			return (i);
+	}
+	return (-1);
+}
+
+/*
+ * find_country_code:
+ *
+ *	Find the entry of orchestrator_country_list[] whose code matches
+ *	the first two characters of the region, ignoring case.
+ *
+ *	Returns the index of the entry, or -1 if none.
+ */
+static int
+find_country_code(char *region)
+{
+	int	slot;
+
+	build_code_index();
+
+	if ((slot = code_slot(region, B_TRUE)) >= 0)
+		return (country_code_index[slot] - 1);
+	return (-1);
+}
 /*
  * This function reads a locales locale_map file to get the settings
  * that should be used for localization.
@@ -1487,8 +1872,6 @@ translate_description(char *lang, char *region)
 {
 	char 		*trans_desc = NULL;
 	int		len = 0, i;
-	int		szcountry = sizeof (orchestrator_country_list) /
-	    sizeof (orchestrator_country_list[0]);
 
 	char		*tmp_ctrystring = NULL;
 
@@ -1496,17 +1879,12 @@ translate_description(char *lang, char *region)
 		return (NULL);
 	}
 
-	for (i = 0; i < szcountry; i++) {
-		/*
-		 * Translate the country code for this locale.
-		 */
-		if (strncasecmp(region,
-		    orchestrator_country_list[i].country_code, 2) == 0) {
-			tmp_ctrystring =
-			    dgettext(TEXT_DOMAIN,
-			    orchestrator_country_list[i].country_name);
-			break;
-		}
+	/*
+	 * Translate the country code for this locale.
+	 */
+	if ((i = find_country_code(region)) >= 0) {
+		tmp_ctrystring = dgettext(TEXT_DOMAIN,
+		    orchestrator_country_list[i].country_name);
 	}
 	if (tmp_ctrystring) {
 		len = strlen(lang) + strlen(tmp_ctrystring) + 4;
@@ -1524,9 +1902,8 @@ get_actual_languages(char **list, int *total)
 {
 	char	**lp;
 	char	**lang_listp = NULL;
-	size_t	sz;
 	int	ret = 0;
-	int	i, j, k = 0;
+	int	i, j = -1, k = 0;
 
 
 	*total = 0;
@@ -1534,28 +1911,20 @@ get_actual_languages(char **list, int *total)
 	if (list == NULL || *list == NULL)
 		return (NULL);
 
-	sz = sizeof (orchestrator_lang_list)/sizeof (orchestrator_lang_list[0]);
-
 	lp = list;
 	for (i = 0; lp[i] != NULL; i++) {
-		for (j = 0; j < sz; j++) {
-			if (strncmp(lp[i],
-			    (char *)orchestrator_lang_list[j].lang_code,
-			    2) == 0) {
-				ret = add_lang_to_list(&lang_listp,
-				    lp[i], &k, j);
-				if (ret) {
-					om_free_lang_names(lang_listp);
-					return (NULL);
-				}
-				break;
+		if ((j = find_lang_code(lp[i])) >= 0) {
+			ret = add_lang_to_list(&lang_listp, lp[i], &k, j);
+			if (ret) {
+				om_free_lang_names(lang_listp);
+				return (NULL);
 			}
 		}
 	}
 	/*
 	 * No lang translation found. Return existing list.
 	 */
-	if (j == sz) {
+	if (j < 0) {
 		return (lang_listp);
 	}
 	*total = k;
@@ -1593,8 +1962,8 @@ add_lang_to_list(char ***list, char *locale, int *k, int j)
 		/*
 		 * Search for existence of this language in the list already
 		 */
-		for (i = 0; tmp_list[i] != NULL && tmp_list[i][0] != '\0' &&
-		    i < *k; i++) {
+		for (i = 0; i < *k && tmp_list[i] != NULL &&
+		    tmp_list[i][0] != '\0'; i++) {
 			if (strcmp(tmp, tmp_list[i]) == 0) {
 				free(tmp);
 				return (OM_SUCCESS);
@@ -1626,6 +1995,9 @@ is_valid_locale(char *locale)
 	if (strstr(locale, UTF) == NULL)
 		return (B_FALSE);
 
+	if (load_catalog())
+		return (ll_hash_find(catalog.valid, locale) != NULL);
+
 	(void) snprintf(path, sizeof (path), "%s/%s/LC_COLLATE/LCL_DATA",
 	    NLS_PATH, locale);
 	if ((stat(path, &stat_buf) == 0) &&
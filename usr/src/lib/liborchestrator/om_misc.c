@@ -260,6 +260,7 @@ om_log_print(char *fmt, ...)
 	/*LINTED*/
 	(void) vsprintf(buf, fmt, ap);
 	(void) ls_write_log_message("OM", buf);
+	om_progress_log(buf);
 	va_end(ap);
 }
 
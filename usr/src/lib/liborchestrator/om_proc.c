@@ -25,21 +25,27 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <dirent.h>
-#include <procfs.h>
 #include <limits.h>
 #include <errno.h>
 #include <ctype.h>
+#ifdef __linux__
+#define	PRFNSZ	16
+#else
+#include <procfs.h>
+#endif
 
 #include "orchestrator_private.h"
 
 #define	MAX_PID_LEN 16
 #define	PROCDIR "/proc"	/* standard /proc directory */
+#define	LOCKDIR "/var/run"	/* where the lock files are created */
 
 /*
  * Messages
@@ -47,10 +53,37 @@
 #define	PROC_INFO_ERR "Failed to access process information %s\n"
 #define	PROC_INFO_ERR_ERRNO "Failed to access process information %s\n%s\n"
 #define	PROC_DIR_ERR  "Failed to open /proc directory %s\n%s\n"
+#define	LOCK_ERR "Failed to use lock file %s, checking each process\n%s\n"
+#define	LOCK_STALE "Lock file %s is not held by the process recorded in it\n"
 #define	ALREADY_RUNNING "Program %s is already running at PID %d\n"
 
-static	om_proc_return_t	get_cur_prog_name(char *, pid_t);
-static	om_proc_return_t	check_each_proc(char *, pid_t);
+/*
+ * What is known of a process. start is its start time, in the unit the
+ * platform reports it in; with the PID it tells the process apart from a
+ * later one which got the same PID.
+ */
+typedef struct om_proc_info {
+	pid_t		pid;
+	char		fname[PRFNSZ];
+	uint64_t	start;
+} om_proc_info_t;
+
+/*
+ * The directories can be changed by om_set_proc_dirs(), so that a test
+ * program can use a fake /proc.
+ */
+static const char	*proc_dir = PROCDIR;
+static const char	*lock_dir = LOCKDIR;
+
+/*
+ * Descriptor of the lock file while this process holds the lock. It is
+ * kept open, the lock being released when the process exits.
+ */
+static int		lock_fd = -1;
+
+static	om_proc_return_t	read_proc_info(const char *, om_proc_info_t *);
+static	om_proc_return_t	check_lock(om_proc_info_t *);
+static	om_proc_return_t	check_each_proc(om_proc_info_t *);
 
 /*
  * om_process_running()
@@ -58,6 +91,12 @@ static	om_proc_return_t	check_each_proc(char *, pid_t);
  * it checks if another process is running a program with the same
  * name as the current program.
  *
+ * The first process to call it takes an advisory lock on a file named
+ * after the program, recording its PID and start time, so that the
+ * others only have to look at the lock and at the process recorded in
+ * it. Each process is checked only if the lock can't be used or doesn't
+ * tell.
+ *
  * Input: None
  *
  * Output: None
@@ -78,67 +117,170 @@ static	om_proc_return_t	check_each_proc(char *, pid_t);
 om_proc_return_t
 om_process_running()
 {
-	pid_t		cpid; /* current PID */
-	char		cpr_fname[PRFNSZ];
-	char		*cpr_fname_p;
+	om_proc_info_t	self;
+	char		pid_name[MAX_PID_LEN];
+	om_proc_return_t	ret;
 
-	cpr_fname_p = cpr_fname;
+	/* this process already holds the lock */
+	if (lock_fd != -1) {
+		return (OM_PROC_NOT_RUNNING);
+	}
 
 	/*
 	 * Retrieve the fname from /proc/<current pid>
 	 */
-	memset((char *)cpr_fname_p, '\000', sizeof (cpr_fname));
-	cpid = getpid();
-	if (get_cur_prog_name(cpr_fname_p, cpid) != OM_PROC_SUCCESS) {
-		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR);
+	(void) snprintf(pid_name, sizeof (pid_name), "%d", (int)getpid());
+	if (read_proc_info(pid_name, &self) != OM_PROC_SUCCESS) {
+		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR, pid_name);
 		return (OM_PROC_INFO_ERR);
 	}
 
-	return (check_each_proc(cpr_fname_p, cpid));
+	ret = check_lock(&self);
+	if (ret != OM_PROC_INFO_ERR) {
+		return (ret);
+	}
+
+	return (check_each_proc(&self));
 
 } /* END om_process_running() */
 
 /*
- * get_cur_prog_name()
+ * om_set_proc_dirs()
+ * Makes om_process_running() look at another /proc directory and create
+ * its lock files in another directory, for the test program. Releases
+ * the lock if this process holds it.
+ *
+ * Input:
+ *	procdir: /proc directory, NULL for the default
+ *	lockdir: directory of the lock files, NULL for the default
  *
- * Gather the fname from the /proc/X/psinfo file for the current
- * process.
+ * Output: None
+ *
+ * Returns: None
+ */
+void
+om_set_proc_dirs(const char *procdir, const char *lockdir)
+{
+	proc_dir = (procdir != NULL) ? procdir : PROCDIR;
+	lock_dir = (lockdir != NULL) ? lockdir : LOCKDIR;
+
+	if (lock_fd != -1) {
+		(void) close(lock_fd);
+		lock_fd = -1;
+	}
+}
+
+#ifdef __linux__
+/*
+ * read_proc_info()
+ *
+ * Gather the PID, command name and start time of a process from its
+ * /proc/X/stat file: "pid (comm) state ..." where the start time is the
+ * 22nd field. comm may contain blanks and parentheses, so it ends at the
+ * last ')'.
  *
  * Input:
- *	return_fname: where to return program name (fname)
- *	cpid: PID to return information about
+ *	pid_name: name of the process directory in /proc
  *
  * Output:
- *	return_fname: The matching PID program name (fname)
+ *	info: the process information
  *
  * Returns:
  *
  *  OM_PROC_SUCCESS
- *	Successfully obtained program name running at PID: cpid.
+ *	Successfully obtained the process information.
+ *  OM_PROC_NOT_RUNNING
+ *	There is no such process.
  *  OM_PROC_INFO_ERR
- *      Failed to access process information for a specific process.
+ *      Failed to access the process information.
  */
 static om_proc_return_t
-get_cur_prog_name(char *return_fname, pid_t cpid)
+read_proc_info(const char *pid_name, om_proc_info_t *info)
 {
 	char		pname[PATH_MAX];
-	int		procfd;		/* filedescriptor for /proc/x/psinfo */
-	psinfo_t	info;		/* process information from /proc */
-	int		saverr;
+	char		buf[1024];
+	char		*comm, *end, *field;
+	int		procfd;
+	ssize_t		len;
+	int		i;
 
-	snprintf(pname, sizeof (pname), "%s/%d/psinfo", PROCDIR, cpid);
+	(void) snprintf(pname, sizeof (pname), "%s/%s/stat", proc_dir,
+	    pid_name);
 	if ((procfd = open(pname, O_RDONLY)) == -1) {
-		saverr = errno;
-		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR_ERRNO, pname,
-		    strerror(saverr));
+		return (OM_PROC_NOT_RUNNING);
+	}
+	len = read(procfd, buf, sizeof (buf) - 1);
+	(void) close(procfd);
+	if (len <= 0) {
+		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR, pname);
+		return (OM_PROC_INFO_ERR);
+	}
+	buf[len] = '\0';
+
+	if ((comm = strchr(buf, '(')) == NULL ||
+	    (end = strrchr(comm, ')')) == NULL) {
+		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR, pname);
+		return (OM_PROC_INFO_ERR);
+	}
+	*end = '\0';
+	info->pid = (pid_t)atoi(buf);
+	(void) strlcpy(info->fname, comm + 1, sizeof (info->fname));
+
+	/* skip the state and the 18 fields after it */
+	field = end + 1;
+	for (i = 0; i < 19 && field != NULL; i++) {
+		field = strchr(field + 1, ' ');
+	}
+	if (field == NULL) {
+		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR, pname);
 		return (OM_PROC_INFO_ERR);
 	}
+	info->start = strtoull(field + 1, NULL, 10);
+
+	return (OM_PROC_SUCCESS);
+
+} /* END read_proc_info() */
+#else
+/*
+ * read_proc_info()
+ *
+ * Gather the PID, fname and start time of a process from its
+ * /proc/X/psinfo file.
+ *
+ * Input:
+ *	pid_name: name of the process directory in /proc
+ *
+ * Output:
+ *	info: the process information
+ *
+ * Returns:
+ *
+ *  OM_PROC_SUCCESS
+ *	Successfully obtained the process information.
+ *  OM_PROC_NOT_RUNNING
+ *	There is no such process.
+ *  OM_PROC_INFO_ERR
+ *      Failed to access the process information.
+ */
+static om_proc_return_t
+read_proc_info(const char *pid_name, om_proc_info_t *info)
+{
+	char		pname[PATH_MAX];
+	int		procfd;		/* filedescriptor for /proc/x/psinfo */
+	psinfo_t	psinfo;		/* process information from /proc */
+	int		saverr;
 
+	(void) snprintf(pname, sizeof (pname), "%s/%s/psinfo", proc_dir,
+	    pid_name);
+	if ((procfd = open(pname, O_RDONLY)) == -1) {
+		/* Process exited or could be junk in /proc */
+		return (OM_PROC_NOT_RUNNING);
+	}
 
 	/*
 	 * Get the info structure for the process and close quickly.
 	 */
-	if (read(procfd, (char *)&info, sizeof (info)) < 0) {
+	if (read(procfd, (char *)&psinfo, sizeof (psinfo)) < 0) {
 		saverr = errno;
 		(void) close(procfd);
 		om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR_ERRNO,
@@ -147,22 +289,122 @@ get_cur_prog_name(char *return_fname, pid_t cpid)
 	} /* END if () */
 	(void) close(procfd);
 
-	strncpy(return_fname, info.pr_fname, strlen(info.pr_fname)+1);
+	info->pid = (pid_t)psinfo.pr_pid;
+	(void) strlcpy(info->fname, psinfo.pr_fname, sizeof (info->fname));
+	info->start = (uint64_t)psinfo.pr_start.tv_sec * NANOSEC +
+	    psinfo.pr_start.tv_nsec;
 
 	return (OM_PROC_SUCCESS);
 
-} /* END get_cur_prog_name() */
+} /* END read_proc_info() */
+#endif	/* __linux__ */
+
+/*
+ * check_lock()
+ *
+ * Take the lock of the current program, or make sure that the process
+ * holding it is still the one recorded in the lock file: a process
+ * running the program, with the recorded start time.
+ *
+ * Input:
+ *	self: the current process
+ *
+ * Output: None
+ *
+ * Returns:
+ *
+ *  OM_PROC_NOT_RUNNING
+ *	The current process took the lock.
+ *  OM_PROC_ALREADY_RUNNING
+ *	The process recorded in the lock file holds it.
+ *  OM_PROC_INFO_ERR
+ *      The lock can't be used, or is held by a process which is not
+ *	recorded in the lock file: each process is to be checked.
+ */
+static om_proc_return_t
+check_lock(om_proc_info_t *self)
+{
+	char		lname[PATH_MAX];
+	char		pid_name[MAX_PID_LEN];
+	char		buf[64];
+	struct flock	lock;
+	om_proc_info_t	holder;
+	long		pid;
+	u_longlong_t	start;
+	ssize_t		len;
+	int		fd;
+	int		saverr;
+
+	(void) snprintf(lname, sizeof (lname), "%s/%s.lock", lock_dir,
+	    self->fname);
+	if ((fd = open(lname, O_RDWR | O_CREAT, 0644)) == -1) {
+		saverr = errno;
+		om_debug_print(OM_DBGLVL_WARN, LOCK_ERR, lname,
+		    strerror(saverr));
+		return (OM_PROC_INFO_ERR);
+	}
+	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	(void) memset(&lock, 0, sizeof (lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	if (fcntl(fd, F_SETLK, &lock) == 0) {
+		len = snprintf(buf, sizeof (buf), "%d %llu\n", (int)self->pid,
+		    (u_longlong_t)self->start);
+		if (ftruncate(fd, 0) != 0 || pwrite(fd, buf, len, 0) != len) {
+			saverr = errno;
+			om_debug_print(OM_DBGLVL_WARN, LOCK_ERR, lname,
+			    strerror(saverr));
+		}
+		lock_fd = fd;
+		return (OM_PROC_NOT_RUNNING);
+	}
+	saverr = errno;
+	if (saverr != EAGAIN && saverr != EACCES) {
+		(void) close(fd);
+		om_debug_print(OM_DBGLVL_WARN, LOCK_ERR, lname,
+		    strerror(saverr));
+		return (OM_PROC_INFO_ERR);
+	}
+
+	/*
+	 * Another process holds the lock. It may not have recorded itself
+	 * yet, or may not be running the program any more, so the process
+	 * recorded has to be the same as when it took the lock.
+	 */
+	len = pread(fd, buf, sizeof (buf) - 1, 0);
+	(void) close(fd);
+	if (len > 0) {
+		buf[len] = '\0';
+		if (sscanf(buf, "%ld %llu", &pid, &start) == 2 && pid > 0) {
+			(void) snprintf(pid_name, sizeof (pid_name), "%ld",
+			    pid);
+			if (read_proc_info(pid_name, &holder) ==
+			    OM_PROC_SUCCESS && holder.start == start &&
+			    strncmp(holder.fname, self->fname,
+			    sizeof (holder.fname)) == 0) {
+				om_debug_print(OM_DBGLVL_WARN,
+				    ALREADY_RUNNING, self->fname,
+				    (int)holder.pid);
+				return (OM_PROC_ALREADY_RUNNING);
+			}
+		}
+	}
+
+	om_debug_print(OM_DBGLVL_WARN, LOCK_STALE, lname);
+	return (OM_PROC_INFO_ERR);
+
+} /* END check_lock() */
 
 /*
  * check_each_proc()
  *
  * Gather the fname from the /proc/X/psinfo file for each process
  * listed in the /prod directory check for a match to the supplied
- * input arguments, cpr_fname and cpid.
+ * input argument, self.
  *
  * Input:
- *	cpr_fname: The current program name (fname)
- *	cpid: The current PID.
+ *	self: the current process
  *
  * Output: None
  *
@@ -180,58 +422,46 @@ get_cur_prog_name(char *return_fname, pid_t cpid)
  *      Failed to access process information for a specific process.
  */
 static om_proc_return_t
-check_each_proc(
-	char	*cpr_fname,
-	pid_t	cpid)
+check_each_proc(om_proc_info_t *self)
 {
 	DIR		*dirp;
 	struct dirent	*dentp;
-	char		pname[PATH_MAX];
-	int		procfd; /* filedescriptor for /proc/nnnnn/psinfo */
-	psinfo_t 	info;  /* process information from /proc */
+	om_proc_info_t	info;  /* process information from /proc */
+	om_proc_return_t	ret;
 	int		saverr;
 
-	if ((dirp = opendir(PROCDIR)) == NULL) {
+	if ((dirp = opendir(proc_dir)) == NULL) {
 		saverr = errno;
-		om_debug_print(OM_DBGLVL_WARN, PROC_DIR_ERR, PROCDIR,
+		om_debug_print(OM_DBGLVL_WARN, PROC_DIR_ERR, proc_dir,
 		    strerror(saverr));
 		return (OM_PROC_DIR_ERR);
 	}
 
 	/* for each active process --- */
-	while (dentp = readdir(dirp)) {
-		if (dentp->d_name[0] == '.') {   /* skip . and .. */
+	while ((dentp = readdir(dirp)) != NULL) {
+		/* skip . and .. and anything else than a PID */
+		if (!isdigit((unsigned char)dentp->d_name[0])) {
 			continue;
 		}
 
-		snprintf(pname, sizeof (pname), "%s/%s/psinfo", PROCDIR,
-		    dentp->d_name);
-		if ((procfd = open(pname, O_RDONLY)) == -1) {
+		ret = read_proc_info(dentp->d_name, &info);
+		if (ret == OM_PROC_NOT_RUNNING) {
 			/* Process exited or could be junk in /proc */
 			continue;
 		}
-
-		/*
-		 * Get the info structure for the process and close quickly.
-		 */
-		if (read(procfd, (char *)&info, sizeof (info)) < 0) {
-			saverr = errno;
-			(void) close(procfd);
+		if (ret != OM_PROC_SUCCESS) {
 			(void) closedir(dirp);
-			om_debug_print(OM_DBGLVL_WARN, PROC_INFO_ERR_ERRNO,
-			    pname, strerror(saverr));
-			return (OM_PROC_INFO_ERR);
-		} /* END if () */
-		(void) close(procfd);
+			return (ret);
+		}
 
-		if (strncmp(info.pr_fname,
-		    cpr_fname,
-		    sizeof (info.pr_fname)) == 0) {
-			if (cpid != (pid_t)info.pr_pid) {
+		if (strncmp(info.fname,
+		    self->fname,
+		    sizeof (info.fname)) == 0) {
+			if (self->pid != info.pid) {
 				(void) closedir(dirp);
 				om_debug_print(OM_DBGLVL_WARN,
-				    ALREADY_RUNNING, cpr_fname,
-				    info.pr_pid);
+				    ALREADY_RUNNING, self->fname,
+				    (int)info.pid);
 				return (OM_PROC_ALREADY_RUNNING);
 
 			}
@@ -0,0 +1,430 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Install progress ring.
+ *
+ * While installing, the orchestrator posts the progress of each phase and
+ * the lines of its log as fixed size records to a ring in a shared file,
+ * OM_PROGRESS_FILE.  Installers and monitors map the file and follow the
+ * ring with om_progress_attach() and om_progress_read(), so they get
+ * phase, percentage, bytes and rate without parsing any text, and never
+ * slow the installation down.  osol_install.progress_ring reads and writes
+ * the same ring from Python.
+ *
+ * The file is a header followed by OM_PROGRESS_RECORDS records (a power
+ * of 2).  Record n (from 0) goes to slot n % OM_PROGRESS_RECORDS: a writer
+ * claims n by incrementing the next field of the header, clears the seq
+ * field of the slot, fills it in and sets seq to n + 1.  Readers keep the
+ * number of the next record they want; a record whose seq changes while
+ * it is copied, or which is older than the last OM_PROGRESS_RECORDS ones,
+ * has been overwritten and is reported lost.  The magic is written last,
+ * so a ring being created is not attached to.
+ */
+
+#include <atomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	OM_PROGRESS_MAGIC	"OMP1"
+#define	OM_PROGRESS_RECORDS	1024
+
+typedef struct om_progress_header {
+	char			magic[4];	/* OM_PROGRESS_MAGIC */
+	uint32_t		nrecords;	/* a power of 2 */
+	uint32_t		record_size;
+	int32_t			pid;		/* installer process */
+	volatile uint32_t	next;		/* number of the next record */
+	uint32_t		reserved;
+	int64_t			start;		/* time of day created, in ms */
+	char			pad[32];
+} om_progress_header_t;
+
+struct om_progress {
+	om_progress_header_t	*header;
+	om_progress_record_t	*records;
+	size_t			size;
+	uint32_t		cursor;		/* number of the next record */
+};
+
+/*
+ * Ring written by this process, and what the rate of the current phase
+ * is computed from, protected by wlock.
+ */
+static om_progress_t	*wring = NULL;
+static pthread_mutex_t	wlock = PTHREAD_MUTEX_INITIALIZER;
+static om_milestone_type_t	rate_phase = OM_INVALID_MILESTONE;
+static hrtime_t		rate_start;
+
+/*
+ * now_ms
+ * Returns the time of day in milliseconds.
+ */
+static int64_t
+now_ms(void)
+{
+	struct timeval	tv;
+
+	(void) gettimeofday(&tv, NULL);
+	return ((int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+/*
+ * om_progress_start
+ * Creates the progress ring of an installation, replacing the one of an
+ * earlier installation. Readers still attached to that one keep it.
+ * Input:	None
+ * Output:	None
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE - the installation goes on without a ring
+ */
+int
+om_progress_start(void)
+{
+	om_progress_header_t	*header;
+	om_progress_t		*ring;
+	size_t			size;
+	int			fd;
+
+	(void) pthread_mutex_lock(&wlock);
+	if (wring != NULL) {
+		(void) pthread_mutex_unlock(&wlock);
+		return (OM_SUCCESS);
+	}
+
+	size = sizeof (om_progress_header_t) +
+	    OM_PROGRESS_RECORDS * sizeof (om_progress_record_t);
+
+	(void) unlink(OM_PROGRESS_FILE);
+	fd = open(OM_PROGRESS_FILE, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 || ftruncate(fd, size) != 0) {
+		om_debug_print(OM_DBGLVL_WARN, "Couldn't create %s: %s\n",
+		    OM_PROGRESS_FILE, strerror(errno));
+		if (fd >= 0)
+			(void) close(fd);
+		(void) pthread_mutex_unlock(&wlock);
+		return (OM_FAILURE);
+	}
+
+	header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (header == MAP_FAILED ||
+	    (ring = calloc(1, sizeof (om_progress_t))) == NULL) {
+		om_debug_print(OM_DBGLVL_WARN, "Couldn't map %s\n",
+		    OM_PROGRESS_FILE);
+		if (header != MAP_FAILED)
+			(void) munmap((caddr_t)header, size);
+		(void) pthread_mutex_unlock(&wlock);
+		return (OM_FAILURE);
+	}
+
+	header->nrecords = OM_PROGRESS_RECORDS;
+	header->record_size = sizeof (om_progress_record_t);
+	header->pid = (int32_t)getpid();
+	header->start = now_ms();
+	membar_producer();
+	(void) memcpy(header->magic, OM_PROGRESS_MAGIC, sizeof (header->magic));
+
+	ring->header = header;
+	ring->records = (om_progress_record_t *)(header + 1);
+	ring->size = size;
+	rate_phase = OM_INVALID_MILESTONE;
+
+	membar_producer();
+	wring = ring;
+	(void) pthread_mutex_unlock(&wlock);
+
+	return (OM_SUCCESS);
+}
+
+/*
+ * post_record
+ * Writes a record to the ring of this process.
+ * Input:	om_progress_record_t *rec - the record, seq and time are set
+ * Output:	None
+ * Return:	None
+ */
+static void
+post_record(om_progress_record_t *rec)
+{
+	om_progress_record_t	*slot;
+	uint32_t		n;
+
+	n = atomic_inc_32_nv(&wring->header->next) - 1;
+	slot = &wring->records[n & (OM_PROGRESS_RECORDS - 1)];
+
+	/* readers copying the old record see it change */
+	((volatile om_progress_record_t *)slot)->seq = 0;
+	membar_producer();
+
+	rec->seq = 0;
+	rec->time = now_ms();
+	(void) memcpy(slot, rec, sizeof (om_progress_record_t));
+
+	/* publish the record */
+	membar_producer();
+	((volatile om_progress_record_t *)slot)->seq = n + 1;
+}
+
+/*
+ * om_progress_status
+ * Posts the progress of an installation phase, if the ring was created.
+ * Input:	om_milestone_type_t phase - phase, OM_INVALID_MILESTONE if
+ *		the installation failed
+ *		int16_t percent - percentage of the phase done, -1 if unknown
+ *		int16_t status - error number if the installation failed
+ *		uint64_t bytes - bytes installed so far in the phase, 0 if
+ *		unknown. The rate of the phase is computed from them.
+ *		const char *message - text shown to the user, or NULL
+ * Output:	None
+ * Return:	None
+ */
+void
+om_progress_status(om_milestone_type_t phase, int16_t percent,
+    int16_t status, uint64_t bytes, const char *message)
+{
+	om_progress_record_t	rec;
+	hrtime_t		now, elapsed;
+
+	if (wring == NULL) {
+		return;
+	}
+
+	(void) memset(&rec, 0, sizeof (rec));
+	rec.type = OM_PROGRESS_STATUS;
+	rec.phase = (int16_t)phase;
+	rec.percent = percent;
+	rec.status = status;
+	rec.bytes = bytes;
+	if (message != NULL)
+		(void) strlcpy(rec.message, message, sizeof (rec.message));
+
+	now = gethrtime();
+	(void) pthread_mutex_lock(&wlock);
+	if (phase != rate_phase) {
+		rate_phase = phase;
+		rate_start = now;
+	}
+	elapsed = now - rate_start;
+	(void) pthread_mutex_unlock(&wlock);
+	if (bytes > 0 && elapsed >= NANOSEC / 10)
+		rec.rate = bytes * 1000 / (uint64_t)(elapsed / MICROSEC);
+
+	post_record(&rec);
+}
+
+/*
+ * om_progress_log
+ * Posts a line of the install log, if the ring was created.
+ * Input:	const char *message - the line, whose new line is dropped
+ * Output:	None
+ * Return:	None
+ */
+void
+om_progress_log(const char *message)
+{
+	om_progress_record_t	rec;
+	size_t			len;
+
+	if (wring == NULL) {
+		return;
+	}
+
+	(void) memset(&rec, 0, sizeof (rec));
+	rec.type = OM_PROGRESS_LOG;
+	rec.phase = rate_phase;
+	rec.percent = -1;
+	(void) strlcpy(rec.message, message, sizeof (rec.message));
+	len = strlen(rec.message);
+	if (len > 0 && rec.message[len - 1] == '\n')
+		rec.message[len - 1] = '\0';
+
+	post_record(&rec);
+}
+
+/*
+ * om_progress_attach
+ * Maps the progress ring of the installation for reading. The first
+ * om_progress_read() returns the records still in the ring.
+ * Input:	char *path - the ring, NULL for OM_PROGRESS_FILE
+ * Output:	None
+ * Return:	!= NULL - handle of the ring
+ *		NULL - no installation has created a ring yet, or it can't
+ *		be read. The error is set to OM_NO_PROGRESS_FILE,
+ *		OM_BAD_INPUT or OM_NO_SPACE.
+ */
+om_progress_t *
+om_progress_attach(char *path)
+{
+	om_progress_header_t	*header;
+	om_progress_t		*ring;
+	struct stat		st;
+	uint32_t		next;
+	int			fd;
+
+	if (path == NULL)
+		path = OM_PROGRESS_FILE;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		om_set_error(OM_NO_PROGRESS_FILE);
+		return (NULL);
+	}
+	if (fstat(fd, &st) != 0 ||
+	    (size_t)st.st_size < sizeof (om_progress_header_t)) {
+		(void) close(fd);
+		om_set_error(OM_NO_PROGRESS_FILE);
+		return (NULL);
+	}
+	header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (header == MAP_FAILED) {
+		om_set_error(OM_NO_PROGRESS_FILE);
+		return (NULL);
+	}
+
+	if (memcmp(header->magic, OM_PROGRESS_MAGIC,
+	    sizeof (header->magic)) != 0 ||
+	    header->record_size != sizeof (om_progress_record_t) ||
+	    header->nrecords == 0 ||
+	    (header->nrecords & (header->nrecords - 1)) != 0 ||
+	    (size_t)st.st_size < sizeof (om_progress_header_t) +
+	    (size_t)header->nrecords * sizeof (om_progress_record_t)) {
+		(void) munmap((caddr_t)header, st.st_size);
+		om_set_error(OM_BAD_INPUT);
+		return (NULL);
+	}
+	membar_consumer();
+
+	if ((ring = calloc(1, sizeof (om_progress_t))) == NULL) {
+		(void) munmap((caddr_t)header, st.st_size);
+		om_set_error(OM_NO_SPACE);
+		return (NULL);
+	}
+	ring->header = header;
+	ring->records = (om_progress_record_t *)(header + 1);
+	ring->size = st.st_size;
+
+	next = header->next;
+	ring->cursor = (next > header->nrecords) ? next - header->nrecords : 0;
+
+	return (ring);
+}
+
+/*
+ * om_progress_read
+ * Copies the records posted since the last call, up to max of them.
+ * Doesn't block.
+ * Input:	om_progress_t *progress - returned by om_progress_attach()
+ *		om_progress_record_t *records - array of max records
+ *		int max - how many records to copy at most
+ * Output:	om_progress_record_t *records - the records, in the order
+ *		they were posted
+ *		uint32_t *lost - if not NULL, number of records overwritten
+ *		before they could be read
+ * Return:	number of records copied, 0 if none was posted
+ *		OM_FAILURE - bad input
+ */
+int
+om_progress_read(om_progress_t *progress, om_progress_record_t *records,
+    int max, uint32_t *lost)
+{
+	om_progress_record_t	*slot;
+	uint32_t		next, seq, nrecords;
+	int			n = 0;
+
+	if (progress == NULL || records == NULL || max <= 0) {
+		om_set_error(OM_BAD_INPUT);
+		return (OM_FAILURE);
+	}
+	if (lost != NULL)
+		*lost = 0;
+
+	nrecords = progress->header->nrecords;
+	while (n < max) {
+		next = progress->header->next;
+		membar_consumer();
+
+		if (next - progress->cursor > nrecords) {
+			/* the writers went round the ring */
+			if (lost != NULL)
+				*lost += next - nrecords - progress->cursor;
+			progress->cursor = next - nrecords;
+		}
+		if (progress->cursor == next)
+			break;
+
+		slot = &progress->records[progress->cursor & (nrecords - 1)];
+		seq = ((volatile om_progress_record_t *)slot)->seq;
+		membar_consumer();
+		if (seq != progress->cursor + 1) {
+			/*
+			 * Either the record is still being written, or it
+			 * is being overwritten, which the next round tells.
+			 */
+			if (progress->header->next - progress->cursor <=
+			    nrecords)
+				break;
+			continue;
+		}
+
+		(void) memcpy(&records[n], slot, sizeof (om_progress_record_t));
+		membar_consumer();
+		if (((volatile om_progress_record_t *)slot)->seq != seq) {
+			/* overwritten while copied */
+			continue;
+		}
+		records[n++].seq = seq;
+		progress->cursor++;
+	}
+
+	return (n);
+}
+
+/*
+ * om_progress_detach
+ * Unmaps a progress ring.
+ * Input:	om_progress_t *progress - returned by om_progress_attach()
+ * Output:	None
+ * Return:	None
+ */
+void
+om_progress_detach(om_progress_t *progress)
+{
+	if (progress == NULL) {
+		return;
+	}
+
+	(void) munmap((caddr_t)progress->header, progress->size);
+	free(progress);
+}
@@ -0,0 +1,179 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * this is a stress test program for the target discovery event ring, for
+ * development use only
+ *
+ * Several producer threads post events as fast as they can, while the
+ * main thread takes them in small batches, waking up on the descriptor
+ * of the ring only, and now and then stops taking them long enough for
+ * the ring to fill up.  Every event must arrive exactly once and in the
+ * order its producer posted it, and the consumer must never wait for the
+ * descriptor while events are pending.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	PRODUCERS	4
+#define	EVENTS		20000
+#define	BATCH		7
+#define	STALL_EVERY	500
+#define	STALL_US	20000
+#define	WAKEUP_MS	5000
+
+static int	failures = 0;
+
+/*
+ * producer() - post EVENTS events, numbered in disk_index, for the
+ *	producer numbered in num_disks
+ */
+static void *
+producer(void *arg)
+{
+	disk_target_t	dt;
+	char		name[32];
+	int		id = (int)(uintptr_t)arg;
+	int		i;
+
+	(void) memset(&dt, 0, sizeof (dt));
+	dt.dinfo.disk_name = name;
+	for (i = 0; i < EVENTS; i++) {
+		(void) snprintf(name, sizeof (name), "c%dt%dd0", id, i);
+		om_post_disk_event(OM_PARTITIONS_READY_EVENT, i, id, &dt);
+	}
+	return (NULL);
+}
+
+static void
+check(const char *what, boolean_t ok)
+{
+	if (ok) {
+		(void) printf("ok\t%s\n", what);
+	} else {
+		(void) printf("FAILED\t%s\n", what);
+		failures++;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	om_discovery_event_t	events[BATCH];
+	pthread_t		threads[PRODUCERS];
+	int			next[PRODUCERS];
+	char			name[32];
+	struct pollfd		pfd;
+	hrtime_t		start;
+	boolean_t		in_order = B_TRUE;
+	boolean_t		named = B_TRUE;
+	boolean_t		woken = B_TRUE;
+	boolean_t		timed_out;
+	int			fd;
+	int			total = 0;
+	int			taken;
+	int			batches = 0;
+	int			id, i, n;
+
+	if (om_enable_discovery_events(&fd) != OM_SUCCESS) {
+		(void) printf("FAILED\tevents couldn't be enabled\n");
+		return (1);
+	}
+
+	start = gethrtime();
+	for (id = 0; id < PRODUCERS; id++) {
+		next[id] = 0;
+		if (pthread_create(&threads[id], NULL, producer,
+		    (void *)(uintptr_t)id) != 0) {
+			perror("pthread_create");
+			return (1);
+		}
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (total < PRODUCERS * EVENTS) {
+		pfd.revents = 0;
+		timed_out = (poll(&pfd, 1, WAKEUP_MS) == 0);
+
+		/* take everything pending, as a consumer is to */
+		taken = 0;
+		while ((n = om_get_discovery_events(events, BATCH)) > 0) {
+			for (i = 0; i < n; i++) {
+				id = events[i].num_disks;
+				if (id < 0 || id >= PRODUCERS ||
+				    events[i].disk_index != next[id]) {
+					in_order = B_FALSE;
+				} else {
+					(void) snprintf(name, sizeof (name),
+					    "c%dt%dd0", id, next[id]);
+					if (events[i].disk_name == NULL ||
+					    strcmp(events[i].disk_name,
+					    name) != 0)
+						named = B_FALSE;
+					next[id]++;
+				}
+				om_free_discovery_event(&events[i]);
+			}
+			total += n;
+			taken += n;
+
+			/* let the ring fill up and the producers wait */
+			if (++batches % STALL_EVERY == 0)
+				(void) usleep(STALL_US);
+		}
+		if (n < 0) {
+			(void) printf("FAILED\tevents couldn't be taken\n");
+			return (1);
+		}
+
+		/* events were pending, but the descriptor wasn't readable */
+		if (timed_out && taken > 0)
+			woken = B_FALSE;
+	}
+
+	for (id = 0; id < PRODUCERS; id++)
+		(void) pthread_join(threads[id], NULL);
+
+	check("descriptor readable while events are pending", woken);
+	check("events of each producer in order, none lost", in_order);
+	check("events carry their data", named);
+	check("every event taken",
+	    total == PRODUCERS * EVENTS &&
+	    om_get_discovery_events(events, BATCH) == 0);
+
+	(void) printf("%d events of %d producers in %lld ms\n", total,
+	    PRODUCERS, (long long)((gethrtime() - start) / (NANOSEC / 1000)));
+	(void) printf("%d failures\n", failures);
+	return (failures == 0 ? 0 : 1);
+}
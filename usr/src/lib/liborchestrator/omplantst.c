@@ -0,0 +1,398 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * this is a test program for om_plan_install_layouts(), for development
+ * use only
+ *
+ * Target discovery is played by lists of disks and fdisk partitions made
+ * up here and put in place of the discovered ones.  The proposals for
+ * each are checked against what the preserve constraints allow, where new
+ * primary and logical partitions go and which partition numbers they get,
+ * and the order the proposals are ranked in.  Sizes are given in the
+ * request, so the results don't depend on the image or the memory of the
+ * system the program runs on.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	MB		((uint64_t)BLOCKS_TO_MB)
+#define	MIN_SIZE	1000
+#define	RECOMMENDED	8000
+
+static int	failures = 0;
+
+static void
+check(const char *what, boolean_t ok)
+{
+	if (ok) {
+		(void) printf("ok\t%s\n", what);
+	} else {
+		(void) printf("FAILED\t%s\n", what);
+		failures++;
+	}
+}
+
+/*
+ * free_disks() - free the made up disks
+ */
+static void
+free_disks(void)
+{
+	disk_target_t	*dt, *next;
+
+	for (dt = system_disks; dt != NULL; dt = next) {
+		next = dt->next;
+		free(dt->dinfo.disk_name);
+		if (dt->dparts != NULL) {
+			free(dt->dparts->disk_name);
+			free(dt->dparts);
+		}
+		free(dt);
+	}
+	system_disks = NULL;
+}
+
+/*
+ * add_disk() - make up a disk, after the others
+ */
+static disk_target_t *
+add_disk(const char *name, uint64_t size_mb, om_disklabel_type_t label,
+    boolean_t boot)
+{
+	disk_target_t	*dt, *last;
+	int		i;
+
+	if ((dt = calloc(1, sizeof (disk_target_t))) == NULL ||
+	    (dt->dparts = calloc(1, sizeof (disk_parts_t))) == NULL) {
+		(void) fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	dt->dinfo.disk_name = strdup(name);
+	dt->dinfo.disk_size = size_mb;
+	dt->dinfo.disk_size_sec = size_mb * MB;
+	dt->dinfo.label = label;
+	dt->dinfo.boot_disk = boot;
+	dt->dparts->disk_name = strdup(name);
+	for (i = 0; i < OM_NUMPART; i++)
+		dt->dparts->pinfo[i].partition_id = i + 1;
+
+	if (system_disks == NULL) {
+		system_disks = dt;
+		return (dt);
+	}
+	for (last = system_disks; last->next != NULL; last = last->next)
+		;
+	last->next = dt;
+	/* the disks are handed to the planner as one list */
+	last->dinfo.next = &dt->dinfo;
+	return (dt);
+}
+
+/*
+ * add_part() - make up partition number id of a disk
+ */
+static void
+add_part(disk_target_t *dt, int id, uint8_t type, uint64_t offset_sec,
+    uint64_t size_sec)
+{
+	partition_info_t	*pinfo = &dt->dparts->pinfo[id - 1];
+
+	pinfo->partition_type = type;
+	pinfo->content_type = (type == SUNIXOS2 ? OM_CTYPE_SOLARIS :
+	    OM_CTYPE_UNKNOWN);
+	pinfo->partition_offset_sec = offset_sec;
+	pinfo->partition_size_sec = size_sec;
+	pinfo->partition_offset = offset_sec / MB;
+	pinfo->partition_size = size_sec / MB;
+}
+
+/*
+ * plan() - plan the install on the made up disks
+ */
+static om_layout_t *
+plan(om_preserve_t preserve, char **exclude, int max, int *total)
+{
+	om_layout_request_t	request;
+
+	(void) memset(&request, 0, sizeof (request));
+	request.min_size = MIN_SIZE;
+	request.recommended_size = RECOMMENDED;
+	request.preserve = preserve;
+	request.exclude_disks = exclude;
+	request.max_layouts = max;
+	return (om_plan_install_layouts(0, &system_disks->dinfo, &request,
+	    total));
+}
+
+/*
+ * find() - the proposal of a kind for a partition of a disk
+ */
+static om_layout_t *
+find(om_layout_t *layouts, const char *disk, om_layout_type_t type,
+    int id)
+{
+	for (; layouts != NULL; layouts = layouts->next)
+		if (strcmp(layouts->disk_name, disk) == 0 &&
+		    layouts->layout_type == type &&
+		    layouts->partition_id == id)
+			return (layouts);
+	return (NULL);
+}
+
+/*
+ * A Solaris partition, a partition of another OS and unused space.
+ */
+static void
+test_preserve(void)
+{
+	disk_target_t	*dt;
+	om_layout_t	*layouts, *lp;
+	int		total;
+
+	dt = add_disk("c1t0d0", 30000, OM_LABEL_FDISK, B_FALSE);
+	add_part(dt, 1, SUNIXOS2, MB, 10000 * MB);
+	add_part(dt, 2, FDISK_IFS, 10001 * MB, 10000 * MB);
+
+	layouts = plan(OM_PRESERVE_NONE, NULL, 0, &total);
+	check("preserve none: three proposals", total == 3);
+	lp = find(layouts, "c1t0d0", OM_LAYOUT_WHOLE_DISK, 1);
+	check("preserve none: entire disk, overwriting data",
+	    lp != NULL && lp->destructive && lp->offset_sec == 0 &&
+	    lp->size_sec == 30000 * MB);
+	lp = find(layouts, "c1t0d0", OM_LAYOUT_SOLARIS_PARTITION, 1);
+	check("preserve none: Solaris partition, overwriting data",
+	    lp != NULL && lp->destructive && lp->offset_sec == MB &&
+	    lp->size_sec == 10000 * MB);
+	lp = find(layouts, "c1t0d0", OM_LAYOUT_FREE_SPACE, 3);
+	check("preserve none: new primary partition in unused space",
+	    lp != NULL && !lp->destructive && !lp->logical &&
+	    lp->offset_sec == 20001 * MB && lp->size_sec == 9999 * MB);
+	om_free_install_layouts(0, layouts);
+
+	layouts = plan(OM_PRESERVE_OTHER_OS, NULL, 0, &total);
+	check("preserve other OS: entire disk not proposed",
+	    total == 2 &&
+	    find(layouts, "c1t0d0", OM_LAYOUT_WHOLE_DISK, 1) == NULL &&
+	    find(layouts, "c1t0d0", OM_LAYOUT_SOLARIS_PARTITION, 1) != NULL &&
+	    find(layouts, "c1t0d0", OM_LAYOUT_FREE_SPACE, 3) != NULL);
+	om_free_install_layouts(0, layouts);
+
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("preserve all: only unused space proposed",
+	    total == 1 && find(layouts, "c1t0d0", OM_LAYOUT_FREE_SPACE, 3) !=
+	    NULL);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+
+	/* the entire disk may go when it holds Solaris only */
+	dt = add_disk("c2t0d0", 20000, OM_LABEL_FDISK, B_FALSE);
+	add_part(dt, 1, SUNIXOS2, MB, 10000 * MB);
+	layouts = plan(OM_PRESERVE_OTHER_OS, NULL, 0, &total);
+	lp = find(layouts, "c2t0d0", OM_LAYOUT_WHOLE_DISK, 1);
+	check("preserve other OS: entire disk holding only Solaris",
+	    lp != NULL && lp->destructive);
+	om_free_install_layouts(0, layouts);
+
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("preserve all: no Solaris partition overwritten",
+	    find(layouts, "c2t0d0", OM_LAYOUT_SOLARIS_PARTITION, 1) ==
+	    NULL && find(layouts, "c2t0d0", OM_LAYOUT_WHOLE_DISK, 1) == NULL);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+
+	/* a GPT disk can only be used entirely */
+	(void) add_disk("c3t0d0", 20000, OM_LABEL_GPT, B_FALSE);
+	layouts = plan(OM_PRESERVE_OTHER_OS, NULL, 0, &total);
+	check("preserve other OS: GPT disk not proposed", layouts == NULL &&
+	    total == 0 && om_get_error() == OM_SIZE_IS_SMALL);
+	layouts = plan(OM_PRESERVE_NONE, NULL, 0, &total);
+	lp = find(layouts, "c3t0d0", OM_LAYOUT_WHOLE_DISK, 1);
+	check("preserve none: entire GPT disk, overwriting data",
+	    total == 1 && lp != NULL && lp->destructive);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+
+	/* a disk whose partitions weren't discovered may hold anything */
+	dt = add_disk("c7t0d0", 20000, OM_LABEL_FDISK, B_FALSE);
+	free(dt->dparts->disk_name);
+	free(dt->dparts);
+	dt->dparts = NULL;
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("no partition information: disk not proposed",
+	    layouts == NULL && total == 0);
+	free_disks();
+}
+
+/*
+ * New partitions in an extended partition and after it.
+ */
+static void
+test_free_space(void)
+{
+	disk_target_t	*dt;
+	om_layout_t	*layouts, *lp;
+	int		total;
+
+	dt = add_disk("c4t0d0", 30000, OM_LABEL_FDISK, B_FALSE);
+	add_part(dt, 1, EXTDOS, MB, 20000 * MB);
+	add_part(dt, 3, FDISK_LINUX, 25001 * MB, 4999 * MB);
+	add_part(dt, 5, FDISK_LINUX, MB + LOGICAL_PARTITION_PAD, 5000 * MB);
+
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("preserve all: a primary and a logical partition proposed",
+	    total == 2);
+
+	/* the lowest unused primary number, not the next one */
+	lp = find(layouts, "c4t0d0", OM_LAYOUT_FREE_SPACE, 2);
+	check("new primary partition takes number 2, after the extended one",
+	    lp != NULL && !lp->logical && lp->offset_sec == 20001 * MB &&
+	    lp->size_sec == 5000 * MB);
+
+	/* logical partitions are preceded by a pad */
+	lp = find(layouts, "c4t0d0", OM_LAYOUT_FREE_SPACE, 6);
+	check("new logical partition takes number 6, after the pad",
+	    lp != NULL && lp->logical &&
+	    lp->offset_sec == MB + 2 * LOGICAL_PARTITION_PAD + 5000 * MB &&
+	    lp->offset_sec + lp->size_sec == 20001 * MB);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+
+	/* without an extended partition there is no logical one */
+	dt = add_disk("c5t0d0", 30000, OM_LABEL_FDISK, B_FALSE);
+	add_part(dt, 1, FDISK_LINUX, MB, 20000 * MB);
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("no extended partition: only a primary partition proposed",
+	    total == 1 && find(layouts, "c5t0d0", OM_LAYOUT_FREE_SPACE, 2) !=
+	    NULL);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+
+	/* all primary numbers taken */
+	dt = add_disk("c6t0d0", 30000, OM_LABEL_FDISK, B_FALSE);
+	add_part(dt, 1, FDISK_LINUX, MB, 1000 * MB);
+	add_part(dt, 2, FDISK_LINUX, 1001 * MB, 1000 * MB);
+	add_part(dt, 3, FDISK_LINUX, 2001 * MB, 1000 * MB);
+	add_part(dt, 4, FDISK_LINUX, 3001 * MB, 1000 * MB);
+	layouts = plan(OM_PRESERVE_ALL, NULL, 0, &total);
+	check("no primary number left: nothing proposed", layouts == NULL &&
+	    total == 0);
+	free_disks();
+}
+
+/*
+ * Proposals ranked best first.
+ */
+static void
+test_ranking(void)
+{
+	static char	*exclude[] = { "c11t0d0", NULL };
+	disk_target_t	*dt;
+	om_layout_t	*layouts, *lp;
+	const char	*order[6];
+	int		total, n;
+	boolean_t	ranked = B_TRUE;
+
+	(void) add_disk("c10t0d0", 20000, OM_LABEL_FDISK, B_FALSE);
+	(void) add_disk("c11t0d0", 20000, OM_LABEL_FDISK, B_TRUE);
+	(void) add_disk("c12t0d0", 5000, OM_LABEL_FDISK, B_TRUE);
+	(void) add_disk("c13t0d0", 40000, OM_LABEL_FDISK, B_FALSE);
+	dt = add_disk("c14t0d0", 20000, OM_LABEL_FDISK, B_TRUE);
+	add_part(dt, 1, SUNIXOS2, 0, 20000 * MB);
+	(void) add_disk("c19t0d0", 20000, OM_LABEL_FDISK, B_FALSE);
+
+	/*
+	 * recommended size first, then not overwriting data, then the boot
+	 * disk, then more free space, then by name
+	 */
+	order[0] = "c11t0d0";
+	order[1] = "c13t0d0";
+	order[2] = "c10t0d0";
+	order[3] = "c19t0d0";
+	order[4] = "c14t0d0";
+	order[5] = "c14t0d0";
+
+	layouts = plan(OM_PRESERVE_NONE, NULL, 0, &total);
+	for (lp = layouts, n = 0; lp != NULL; lp = lp->next, n++) {
+		if (lp->rank != n + 1 ||
+		    (n < 6 && strcmp(lp->disk_name, order[n]) != 0) ||
+		    (n == 6 && strcmp(lp->disk_name, "c12t0d0") != 0)) {
+			(void) printf("\tproposal %d: %s\n", lp->rank,
+			    lp->disk_name);
+			ranked = B_FALSE;
+		}
+	}
+	check("proposals ranked best first", ranked && n == 7 && total == 7);
+	check("smaller than recommended but big enough: proposed last",
+	    n == 7 && find(layouts, "c12t0d0", OM_LAYOUT_WHOLE_DISK, 1) !=
+	    NULL);
+	om_free_install_layouts(0, layouts);
+
+	layouts = plan(OM_PRESERVE_NONE, NULL, 2, &total);
+	check("max_layouts keeps the best ones",
+	    total == 2 && layouts != NULL &&
+	    strcmp(layouts->disk_name, "c11t0d0") == 0 &&
+	    layouts->next != NULL && layouts->next->next == NULL &&
+	    strcmp(layouts->next->disk_name, "c13t0d0") == 0);
+	om_free_install_layouts(0, layouts);
+
+	layouts = plan(OM_PRESERVE_NONE, exclude, 0, &total);
+	check("excluded disk not proposed",
+	    total == 6 && layouts != NULL &&
+	    strcmp(layouts->disk_name, "c13t0d0") == 0 &&
+	    find(layouts, "c11t0d0", OM_LAYOUT_WHOLE_DISK, 1) == NULL);
+	om_free_install_layouts(0, layouts);
+	free_disks();
+}
+
+int
+main(int argc, char **argv)
+{
+	disk_target_t	*saved_disks = system_disks;
+	boolean_t	saved_done = disk_discovery_done;
+
+	if (is_system_sparc()) {
+		(void) printf("ok\tskipped, fdisk partitions are x86 only\n");
+		(void) printf("0 failures\n");
+		return (0);
+	}
+
+	system_disks = NULL;
+	disk_discovery_done = B_TRUE;
+
+	test_preserve();
+	test_free_space();
+	test_ranking();
+
+	system_disks = saved_disks;
+	disk_discovery_done = saved_done;
+
+	(void) printf("%d failures\n", failures);
+	return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,273 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * this is a test program for om_process_running(), for development use
+ * only
+ *
+ * It runs against a fake /proc directory made in a temporary directory,
+ * with entries in the format of the platform, and checks both the lock
+ * file and the scan of every process.  Another instance of the program is
+ * played by a child process, which takes the lock and records itself as
+ * a process of the fake /proc.
+ */
+
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifndef __linux__
+#include <procfs.h>
+#endif
+
+#include "orchestrator_private.h"
+
+#define	PROGRAM		"gui-install"
+
+static char	tmpdir[] = "/tmp/omproctst.XXXXXX";
+static char	procdir[PATH_MAX];
+static char	lockdir[PATH_MAX];
+static int	failures = 0;
+
+static const char *proc_return_names[] = {
+	"OM_PROC_SUCCESS",
+	"OM_PROC_INFO_ERR",
+	"OM_PROC_DIR_ERR",
+	"OM_PROC_ALREADY_RUNNING",
+	"OM_PROC_NOT_RUNNING"
+};
+
+/*
+ * fake_proc() - make the /proc entry of a process
+ */
+static void
+fake_proc(pid_t pid, const char *fname, uint64_t start)
+{
+	char		path[PATH_MAX];
+	int		fd;
+#ifdef __linux__
+	char		buf[256];
+	int		len;
+#else
+	psinfo_t	info;
+#endif
+
+	(void) snprintf(path, sizeof (path), "%s/%d", procdir, (int)pid);
+	(void) mkdir(path, 0755);
+#ifdef __linux__
+	(void) strlcat(path, "/stat", sizeof (path));
+	len = snprintf(buf, sizeof (buf), "%d (%s) S 1 %d %d 0 -1 4194560 "
+	    "0 0 0 0 0 0 0 0 20 0 1 0 %llu 1000 100\n", (int)pid, fname,
+	    (int)pid, (int)pid, (u_longlong_t)start);
+#else
+	(void) strlcat(path, "/psinfo", sizeof (path));
+	(void) memset(&info, 0, sizeof (info));
+	info.pr_pid = pid;
+	(void) strlcpy(info.pr_fname, fname, sizeof (info.pr_fname));
+	info.pr_start.tv_sec = start;
+#endif
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		perror(path);
+		exit(1);
+	}
+#ifdef __linux__
+	(void) write(fd, buf, len);
+#else
+	(void) write(fd, &info, sizeof (info));
+#endif
+	(void) close(fd);
+}
+
+/*
+ * bad_proc() - make a /proc entry which can't be read
+ */
+static void
+bad_proc(pid_t pid)
+{
+	char	path[PATH_MAX];
+
+	(void) snprintf(path, sizeof (path), "%s/%d", procdir, (int)pid);
+	(void) mkdir(path, 0755);
+#ifdef __linux__
+	(void) strlcat(path, "/stat", sizeof (path));
+#else
+	(void) strlcat(path, "/psinfo", sizeof (path));
+#endif
+	(void) mkdir(path, 0755);
+}
+
+static int
+remove_entry(const char *path, const struct stat *sb, int type,
+    struct FTW *ftw)
+{
+	return (remove(path));
+}
+
+/*
+ * remove_proc() - remove the /proc entry of a process
+ */
+static void
+remove_proc(pid_t pid)
+{
+	char	path[PATH_MAX];
+
+	(void) snprintf(path, sizeof (path), "%s/%d", procdir, (int)pid);
+	(void) nftw(path, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+static void
+check(const char *what, om_proc_return_t expected)
+{
+	om_proc_return_t	ret;
+
+	ret = om_process_running();
+	if (ret == expected) {
+		(void) printf("ok\t%s\n", what);
+	} else {
+		(void) printf("FAILED\t%s: %s instead of %s\n", what,
+		    proc_return_names[ret], proc_return_names[expected]);
+		failures++;
+	}
+}
+
+/*
+ * check_lock_file() - the lock file records the given process
+ */
+static void
+check_lock_file(const char *what, pid_t pid, uint64_t start)
+{
+	char		path[PATH_MAX];
+	char		buf[64];
+	char		expected[64];
+	FILE		*fp;
+
+	(void) snprintf(path, sizeof (path), "%s/%s.lock", lockdir, PROGRAM);
+	(void) snprintf(expected, sizeof (expected), "%d %llu\n", (int)pid,
+	    (u_longlong_t)start);
+	buf[0] = '\0';
+	if ((fp = fopen(path, "r")) != NULL) {
+		(void) fgets(buf, sizeof (buf), fp);
+		(void) fclose(fp);
+	}
+	if (strcmp(buf, expected) == 0) {
+		(void) printf("ok\t%s\n", what);
+	} else {
+		(void) printf("FAILED\t%s: lock file has \"%s\"\n", what, buf);
+		failures++;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	pid_t	self = getpid();
+	pid_t	child;
+	int	ready[2], done[2];
+	char	c;
+	int	status;
+
+	if (mkdtemp(tmpdir) == NULL) {
+		perror(tmpdir);
+		return (1);
+	}
+	(void) snprintf(procdir, sizeof (procdir), "%s/proc", tmpdir);
+	(void) snprintf(lockdir, sizeof (lockdir), "%s/run", tmpdir);
+	(void) mkdir(procdir, 0755);
+
+	/* no lock directory - each process is checked */
+	om_set_proc_dirs(procdir, lockdir);
+	check("current process not in /proc", OM_PROC_INFO_ERR);
+	fake_proc(self, PROGRAM, 1000);
+	fake_proc(self + 1, "bash", 1001);
+	check("scan, not running", OM_PROC_NOT_RUNNING);
+	fake_proc(self + 2, PROGRAM, 1002);
+	check("scan, running", OM_PROC_ALREADY_RUNNING);
+	remove_proc(self + 2);
+
+	/* the lock is taken and kept */
+	(void) mkdir(lockdir, 0755);
+	check("lock taken", OM_PROC_NOT_RUNNING);
+	check_lock_file("lock file records the current process", self, 1000);
+	check("lock already held", OM_PROC_NOT_RUNNING);
+	om_set_proc_dirs(procdir, lockdir);
+
+	/* another instance holds the lock */
+	if (pipe(ready) != 0 || pipe(done) != 0) {
+		perror("pipe");
+		return (1);
+	}
+	(void) fflush(stdout);
+	if ((child = fork()) == -1) {
+		perror("fork");
+		return (1);
+	}
+	if (child == 0) {
+		(void) close(done[1]);
+		fake_proc(getpid(), PROGRAM, 2000);
+		c = (om_process_running() == OM_PROC_NOT_RUNNING) ? 'y' : 'n';
+		(void) write(ready[1], &c, 1);
+		(void) read(done[0], &c, 1);
+		_exit(0);
+	}
+	(void) close(done[0]);
+	if (read(ready[0], &c, 1) != 1 || c != 'y') {
+		(void) printf("FAILED\tchild could not take the lock\n");
+		failures++;
+	}
+
+	/* an unreadable entry would fail the scan */
+	bad_proc(self + 3);
+	check("lock held by another instance", OM_PROC_ALREADY_RUNNING);
+	remove_proc(self + 3);
+
+	/* the holder doesn't run the program any more */
+	fake_proc(child, "sh", 2000);
+	check("lock held by another program", OM_PROC_NOT_RUNNING);
+
+	/* the PID was reused: the scan finds the instance */
+	fake_proc(child, PROGRAM, 3000);
+	fake_proc(self + 4, PROGRAM, 1004);
+	check("lock held by a reused PID", OM_PROC_ALREADY_RUNNING);
+	remove_proc(self + 4);
+
+	/* the instance exits, leaving its record behind */
+	(void) close(done[1]);
+	(void) waitpid(child, &status, 0);
+	fake_proc(child, PROGRAM, 2000);
+	check("stale lock file", OM_PROC_NOT_RUNNING);
+	check_lock_file("lock file records the new holder", self, 1000);
+
+	om_set_proc_dirs(NULL, NULL);
+	(void) nftw(tmpdir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+
+	(void) printf("%d failures\n", failures);
+	return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,321 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * this is a test program for the free space management shared by the
+ * partition and slice editors of the orchestrator, for development use
+ * only
+ *
+ * A table of entries is edited at random - entries are created in free
+ * space found by om_space_find(), deleted, resized, moved over others and
+ * the bounds changed - and handed to om_space_set() after every edit, as
+ * the editors do.  The free space is then checked against the free space
+ * table the editors built from scratch before every query, sorting the
+ * table and scanning the gaps between entries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "orchestrator_private.h"
+
+#define	NIDS		OM_NUMPART
+#define	MAX_SECTOR	4000
+#define	MAX_SIZE	400
+
+static struct {
+	uint64_t	offset;
+	uint64_t	size;
+} table[NIDS];
+static uint64_t	bounds_start, bounds_end;
+
+static om_extent_t	sorted[NIDS];
+static int		n_sorted;
+static om_extent_t	free_space_table[NIDS + 1];
+static int		n_fragments;
+
+static uint64_t	aligns[] = { 0, 1, 2, 16, 63 };
+
+/*
+ * ref_build_free_space_table() - sort the table by offset and make the
+ *	table of free regions within the bounds
+ *
+ * Returns:
+ *	B_FALSE if entries overlap, B_TRUE otherwise
+ */
+static boolean_t
+ref_build_free_space_table(void)
+{
+	uint64_t	prev_end = bounds_start;
+	uint64_t	start, end;
+	int		i, j;
+
+	n_sorted = 0;
+	for (i = 0; i < NIDS; i++) {
+		if (table[i].size == 0)
+			continue;
+		for (j = n_sorted; j > 0 &&
+		    sorted[j - 1].offset > table[i].offset; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j].offset = table[i].offset;
+		sorted[j].size = table[i].size;
+		sorted[j].id = i;
+		n_sorted++;
+	}
+	for (i = 0; i + 1 < n_sorted; i++)
+		if (sorted[i].offset + sorted[i].size > sorted[i + 1].offset)
+			return (B_FALSE);
+
+	n_fragments = 0;
+	for (i = 0; i <= n_sorted; i++) {
+		start = MAX(prev_end, bounds_start);
+		end = (i < n_sorted ? sorted[i].offset : bounds_end);
+		end = MIN(end, bounds_end);
+		if (end > start) {
+			free_space_table[n_fragments].offset = start;
+			free_space_table[n_fragments].size = end - start;
+			free_space_table[n_fragments].id = -1;
+			n_fragments++;
+		}
+		if (i < n_sorted)
+			prev_end = MAX(prev_end,
+			    sorted[i].offset + sorted[i].size);
+	}
+	return (B_TRUE);
+}
+
+/*
+ * ref_find() - scan the free space table for the largest region, or the
+ *	smallest one holding size sectors, after padding and alignment
+ *
+ * Returns:
+ *	B_TRUE and the region found, or B_FALSE if none
+ */
+static boolean_t
+ref_find(uint64_t size, uint64_t pad, uint64_t align, om_extent_t *ext)
+{
+	boolean_t	found = B_FALSE;
+	uint64_t	offset, end;
+	int		i;
+
+	if (align == 0)
+		align = 1;
+	for (i = 0; i < n_fragments; i++) {
+		end = free_space_table[i].offset + free_space_table[i].size;
+		offset = free_space_table[i].offset + pad;
+		offset = (offset + align - 1) / align * align;
+		if (offset >= end)
+			continue;
+		if (size != 0 && end - offset < size)
+			continue;
+		if (found && (size != 0 ? end - offset >= ext->size :
+		    end - offset <= ext->size))
+			continue;
+		found = B_TRUE;
+		ext->offset = offset;
+		ext->size = end - offset;
+	}
+	return (found);
+}
+
+static boolean_t
+same_extents(om_extent_t *e1, om_extent_t *e2, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (e1[i].offset != e2[i].offset ||
+		    e1[i].size != e2[i].size || e1[i].id != e2[i].id)
+			return (B_FALSE);
+	return (B_TRUE);
+}
+
+static uint64_t
+random_size(void)
+{
+	return (1 + lrand48() % MAX_SIZE);
+}
+
+/*
+ * edit() - make one random edit to the table
+ */
+static void
+edit(om_space_t *sp)
+{
+	static int	moved = -1;
+	static uint64_t	moved_offset, moved_size;
+	om_extent_t	region;
+	int		id = lrand48() % NIDS;
+
+	/* overlaps are usually fixed by moving the entry back */
+	if (!om_space_valid(sp) && moved >= 0 && lrand48() % 2) {
+		table[moved].offset = moved_offset;
+		table[moved].size = moved_size;
+		moved = -1;
+		return;
+	}
+
+	switch (lrand48() % 16) {
+	case 0: case 1: case 2: case 3: case 4: case 5:
+		/* create in free space, as om_create_partition() does */
+		if (table[id].size != 0)
+			break;
+		if (!om_space_find(sp, lrand48() % 2 ? random_size() : 0,
+		    lrand48() % 2 ? 63 : 0, 1, &region))
+			break;
+		table[id].offset = region.offset;
+		table[id].size = 1 + lrand48() % region.size;
+		break;
+	case 6: case 7: case 8: case 9:
+		table[id].size = 0;
+		break;
+	case 10: case 11: case 12: case 13:
+		/* resize or move, which may well overlap */
+		if (table[id].size == 0)
+			break;
+		moved = id;
+		moved_offset = table[id].offset;
+		moved_size = table[id].size;
+		if (lrand48() % 2)
+			table[id].offset = lrand48() % MAX_SECTOR;
+		table[id].size = random_size();
+		break;
+	case 14: case 15:
+		bounds_start = lrand48() % (MAX_SECTOR / 4);
+		bounds_end = bounds_start + lrand48() % MAX_SECTOR;
+		om_space_set_bounds(sp, bounds_start, bounds_end);
+		break;
+	}
+}
+
+/*
+ * check() - compare the free space with the reference
+ *
+ * Returns:
+ *	number of differences found
+ */
+static int
+check(om_space_t *sp, int round)
+{
+	om_extent_t	ext[NIDS + 1];
+	om_extent_t	got, want;
+	boolean_t	got_found, want_found;
+	uint64_t	size, pad, align;
+	int		n, i;
+	int		failures = 0;
+
+	if (om_space_valid(sp) != ref_build_free_space_table()) {
+		(void) printf("round %d: valid %d, reference %d\n", round,
+		    om_space_valid(sp), !om_space_valid(sp));
+		return (1);
+	}
+	if (!om_space_valid(sp))
+		return (0);
+
+	n = om_space_extents(sp, B_TRUE, ext, NIDS);
+	if (n != n_sorted || !same_extents(ext, sorted, n)) {
+		(void) printf("round %d: used extents differ\n", round);
+		failures++;
+	}
+	n = om_space_extents(sp, B_FALSE, ext, NIDS + 1);
+	if (n != n_fragments || !same_extents(ext, free_space_table, n)) {
+		(void) printf("round %d: free regions differ\n", round);
+		failures++;
+	}
+
+	for (i = 0; i < 20; i++) {
+		size = (i % 4 == 0 ? 0 : random_size());
+		pad = (lrand48() % 2 ? 63 : 0);
+		align = aligns[lrand48() % (sizeof (aligns) /
+		    sizeof (aligns[0]))];
+		got_found = om_space_find(sp, size, pad, align, &got);
+		want_found = ref_find(size, pad, align, &want);
+		if (got_found != want_found || (got_found &&
+		    (got.offset != want.offset || got.size != want.size))) {
+			(void) printf("round %d: find size %lld pad %lld "
+			    "align %lld: got %d %lld/%lld, want %d %lld/%lld\n",
+			    round, size, pad, align,
+			    got_found, got_found ? got.offset : 0,
+			    got_found ? got.size : 0,
+			    want_found, want_found ? want.offset : 0,
+			    want_found ? want.size : 0);
+			failures++;
+		}
+	}
+	return (failures);
+}
+
+static void
+usage(void)
+{
+	(void) fprintf(stderr, "Usage: omspacetst [-n rounds] [-s seed]\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	om_space_t	*sp;
+	long		seed = (long)getpid();
+	int		rounds = 100000;
+	int		c, i, round;
+	int		failures = 0;
+
+	while ((c = getopt(argc, argv, "n:s:")) != EOF) {
+		switch (c) {
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atol(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	(void) printf("seed %ld\n", seed);
+	srand48(seed);
+
+	if ((sp = om_space_create(NIDS)) == NULL) {
+		(void) fprintf(stderr, "out of memory\n");
+		return (1);
+	}
+	bounds_start = 0;
+	bounds_end = MAX_SECTOR;
+	om_space_set_bounds(sp, bounds_start, bounds_end);
+
+	for (round = 0; round < rounds && failures < 10; round++) {
+		edit(sp);
+		for (i = 0; i < NIDS; i++)
+			(void) om_space_set(sp, i, table[i].offset,
+			    table[i].size);
+		failures += check(sp, round);
+	}
+	om_space_destroy(sp);
+
+	(void) printf("%d rounds, %d failures\n", round, failures);
+	return (failures == 0 ? 0 : 1);
+}
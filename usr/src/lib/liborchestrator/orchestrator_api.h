@@ -300,6 +300,98 @@ typedef struct om_failure {
 	char	*reason;	/* why the failure happened */
 } om_failure_t;
 
+/*
+ * install layout planning - see om_plan_install_layouts()
+ */
+typedef enum {
+	OM_PRESERVE_NONE = 0,	/* any partition may be overwritten */
+	OM_PRESERVE_OTHER_OS,	/* only Solaris partitions may be overwritten */
+	OM_PRESERVE_ALL		/* only unused disk space may be used */
+} om_preserve_t;
+
+typedef enum {
+	OM_LAYOUT_WHOLE_DISK = 1,	/* Solaris partition on entire disk */
+	OM_LAYOUT_SOLARIS_PARTITION,	/* reuse existing Solaris partition */
+	OM_LAYOUT_FREE_SPACE		/* new partition in unused space */
+} om_layout_type_t;
+
+typedef struct om_layout_request {
+	uint64_t	min_size;	/* MB, 0 for om_get_min_size() */
+	uint64_t	recommended_size;
+			/* MB, 0 for om_get_recommended_size() */
+	om_preserve_t	preserve;	/* what may be overwritten */
+	char		**exclude_disks; /* NULL terminated list, or NULL */
+	int		max_layouts;	/* 0 to return all proposals */
+} om_layout_request_t;
+
+typedef struct om_layout {
+	int			rank;		/* 1 for the best proposal */
+	char			*disk_name;
+	om_layout_type_t	layout_type;
+	uint8_t			partition_id;
+				/* fdisk partition number, 0 on SPARC */
+	boolean_t		logical;	/* logical partition */
+	uint64_t		offset_sec;	/* offset in sectors */
+	uint64_t		size_sec;	/* size in sectors */
+	uint64_t		size;		/* size in MB */
+	uint64_t		swap_size;	/* expected swap in MB */
+	uint64_t		dump_size;	/* expected dump in MB */
+	uint64_t		free_size;
+				/* expected free space after install in MB */
+	boolean_t		destructive;	/* existing data is lost */
+	struct om_layout	*next;
+} om_layout_t;
+
+/*
+ * target discovery events - see om_enable_discovery_events()
+ */
+typedef enum {
+	OM_DISK_FOUND_EVENT = 1,	/* dinfo is set */
+	OM_PARTITIONS_READY_EVENT,	/* dparts is set, NULL if none */
+	OM_SLICES_READY_EVENT,		/* dslices is set, NULL if none */
+	OM_INSTANCE_FOUND_EVENT,	/* instance is set */
+	OM_DISCOVERY_DONE_EVENT		/* status is set */
+} om_discovery_event_type_t;
+
+typedef struct om_discovery_event {
+	om_discovery_event_type_t type;
+	int		disk_index;	/* 0 based, -1 if not about a disk */
+	int		num_disks;	/* number of disks of the phase */
+	char		*disk_name;
+	disk_info_t	*dinfo;
+	disk_parts_t	*dparts;
+	disk_slices_t	*dslices;
+	upgrade_info_t	*instance;
+	int16_t		status;		/* OM_SUCCESS or OM_NO_DISKS_FOUND */
+} om_discovery_event_t;
+
+/*
+ * install progress ring - see om_progress_attach()
+ */
+#define	OM_PROGRESS_FILE	"/tmp/install_progress"
+#define	OM_PROGRESS_MSGLEN	216
+
+typedef enum {
+	OM_PROGRESS_STATUS = 1,	/* progress of an installation phase */
+	OM_PROGRESS_LOG		/* line of the install log */
+} om_progress_type_t;
+
+typedef struct om_progress_record {
+	uint32_t	seq;		/* sequence number, from 1 */
+	uint16_t	type;		/* om_progress_type_t */
+	int16_t		phase;		/* om_milestone_type_t, */
+					/* OM_INVALID_MILESTONE on failure */
+	int16_t		percent;	/* of the phase, -1 if unknown */
+	int16_t		status;		/* error number on failure */
+	uint32_t	reserved;
+	uint64_t	bytes;		/* bytes installed, 0 if unknown */
+	uint64_t	rate;		/* bytes per second in the phase */
+	int64_t		time;		/* time of day in milliseconds */
+	char		message[OM_PROGRESS_MSGLEN];
+} om_progress_record_t;
+
+typedef struct om_progress om_progress_t;
+
 
 #define	OM_PREINSTALL	1
 
@@ -454,6 +546,17 @@ typedef struct om_failure {
 om_handle_t	om_initiate_target_discovery(om_callback_t td_cb);
 void		om_free_target_data(om_handle_t handle);
 
+/* disk_events.c */
+int		om_enable_discovery_events(int *fd);
+int		om_get_discovery_events(om_discovery_event_t *events, int max);
+void		om_free_discovery_event(om_discovery_event_t *event);
+
+/* om_progress.c */
+om_progress_t	*om_progress_attach(char *path);
+int		om_progress_read(om_progress_t *progress,
+		    om_progress_record_t *records, int max, uint32_t *lost);
+void		om_progress_detach(om_progress_t *progress);
+
 /* disk_info.c */
 disk_info_t	*om_get_disk_info(om_handle_t handle, int *total);
 void		om_free_disk_info(om_handle_t handle, disk_info_t *dinfo);
@@ -501,6 +604,13 @@ boolean_t	om_preserve_slice(uint8_t);
 disk_slices_t   *om_init_slice_info(const char *);
 boolean_t	om_finalize_vtoc_for_TI(uint8_t);
 
+/* disk_plan.c */
+om_layout_t	*om_plan_install_layouts(om_handle_t handle,
+		    disk_info_t *disks, om_layout_request_t *request,
+		    int *total);
+void		om_free_install_layouts(om_handle_t handle,
+		    om_layout_t *layouts);
+
 /* upgrade_target.c */
 upgrade_info_t	*om_get_upgrade_targets(om_handle_t handle, uint16_t *found);
 upgrade_info_t  *om_get_upgrade_targets_by_disk(om_handle_t handle,
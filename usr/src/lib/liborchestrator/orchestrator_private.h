@@ -186,6 +186,11 @@ extern "C" {
  */
 #define	IS_LOG_PAR(num) ((num) > FD_NUMPART)
 
+/*
+ * fdisk(1m) rsect - must be space before logical partition
+ */
+#define	LOGICAL_PARTITION_PAD (63)
+
 int read_locale_file(FILE *fp, char *lang, char *lc_collate,
     char *lc_ctype, char *lc_messages, char *lc_monetary,
     char *lc_numeric, char *lc_time);
@@ -247,6 +252,17 @@ typedef struct {
 	char		*compress_type;
 } image_info_t;
 
+/*
+ * free space of a partition or slice table - see disk_space.c
+ */
+typedef struct om_space om_space_t;
+
+typedef struct {
+	uint64_t	offset;
+	uint64_t	size;
+	int		id;	/* index of entry using extent, -1 if free */
+} om_extent_t;
+
 /*
  * Global variables
  */
@@ -275,6 +291,11 @@ void	om_debug_print(ls_dbglvl_t dbg_lvl, char *fmt, ...);
 void	om_log_print(char *fmt, ...);
 void	om_log_std(ls_stdouterr_t stdouterr, const char *fmt, ...);
 
+/*
+ * om_proc.c
+ */
+void	om_set_proc_dirs(const char *procdir, const char *lockdir);
+
 /*
  * disk_target.c
  */
@@ -283,6 +304,14 @@ int	allocate_target_disk_info(const disk_info_t *);
 void	free_target_disk_info(void);
 char	*part_size_or_max(uint64_t partition_size);
 
+/*
+ * disk_events.c
+ */
+void	om_post_disk_event(om_discovery_event_type_t type, int disk_index,
+	    int num_disks, disk_target_t *dt);
+void	om_post_instance_event(upgrade_info_t *ui);
+void	om_post_discovery_done(int num_disks, int16_t status);
+
 /*
  * disk_parts.c
  */
@@ -294,6 +323,21 @@ boolean_t is_used_partition(partition_info_t *);
  */
 int	om_set_vtoc_target_attrs(nvlist_t *, char *);
 
+/*
+ * disk_space.c
+ */
+om_space_t	*om_space_create(int nids);
+void		om_space_destroy(om_space_t *sp);
+void		om_space_set_bounds(om_space_t *sp, uint64_t start,
+		    uint64_t end);
+boolean_t	om_space_set(om_space_t *sp, int id, uint64_t offset,
+		    uint64_t size);
+boolean_t	om_space_valid(om_space_t *sp);
+boolean_t	om_space_find(om_space_t *sp, uint64_t size, uint64_t pad,
+		    uint64_t align, om_extent_t *ext);
+int		om_space_extents(om_space_t *sp, boolean_t used,
+		    om_extent_t ext[], int max);
+
 /*
  * disk_util.c
  */
@@ -308,6 +352,14 @@ disk_target_t	*find_disk_by_name(char *diskname);
 disk_parts_t	*find_partitions_by_disk(char *diskname);
 disk_slices_t	*find_slices_by_disk(char *diskname);
 
+/*
+ * om_progress.c
+ */
+int	om_progress_start(void);
+void	om_progress_status(om_milestone_type_t phase, int16_t percent,
+	    int16_t status, uint64_t bytes, const char *message);
+void	om_progress_log(const char *message);
+
 /*
  * perform_slim_install.c
  */
@@ -316,9 +368,10 @@ int set_root_password(char *passwd);
 int set_user_name_password(char *user, char *login, char *passwd);
 int set_password_common(char *user, char *login, char *e_passwd);
 int set_hostname_nodename(char *hostname);
-int16_t get_the_percentage(char *str);
 om_install_type_t get_user_install_type(char *file);
 uint64_t calc_required_swap_size(void);
+int estimate_swap_dump_size(uint64_t install_size, uint64_t recommended_size,
+    uint64_t *swap_size, uint64_t *dump_size);
 
 /*
  * system_util.c
@@ -352,6 +405,16 @@ om_upgrade_message_t convert_td_value_to_om_upgrade_message(uint32_t *value);
  */
 upgrade_info_t *copy_one_upgrade_target(upgrade_info_t *ui);
 
+/*
+ * zfs_props.c
+ */
+boolean_t	om_zfs_pool_exists(char *pool);
+char		*om_zfs_get_property(char *dataset, char *property);
+int		om_zfs_get_numeric_property(char *dataset, char *property,
+    uint64_t *value);
+void		om_zfs_invalidate(char *pool);
+void		om_zfs_cache_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -122,6 +122,8 @@ static void	remove_component(char *path);
 static int	trav_link(char **path);
 static void	notify_error_status(int status);
 static void	notify_install_complete();
+static void	report_progress(om_callback_info_t *cb_data,
+    uintptr_t app_data);
 static int	call_transfer_module(
     nvlist_t		**transfer_attr,
     uint_t		transfer_attr_num,
@@ -144,11 +146,12 @@ static void	activate_be(char *be_name);
 static void	handle_TM_callback(const int percent, const char *message);
 static int	prepare_zfs_root_pool_attrs(nvlist_t **attrs, char *disk_name,
     uint8_t slice_id);
-static int	prepare_zfs_volume_attrs(nvlist_t **attrs,
-    uint64_t available_disk_space, boolean_t create_min_swap_only);
+static int	calc_swap_dump_sizes(uint64_t pool_space,
+    boolean_t swap_and_dump, uint64_t *swap_size, uint64_t *dump_size);
+static int	prepare_zfs_volume_attrs(nvlist_t **attrs, uint64_t swap_size,
+    uint64_t dump_size);
 static int	prepare_be_attrs(nvlist_t **attrs);
 static int	obtain_image_info(image_info_t *info);
-static char	*get_dataset_property(char *dataset_name, char *property);
 static uint64_t	get_available_disk_space(void);
 static uint64_t get_recommended_size_for_software(void);
 static uint32_t	get_mem_size(void);
@@ -251,7 +254,6 @@ om_perform_install(nvlist_t *uchoices, om_callback_t cb)
 	uint8_t		type;
 	char		*ti_test = getenv("TI_SLIM_TEST");
 	char		*nv_string;
-	int		ret = 0;
 
 	if (uchoices == NULL) {
 		om_set_error(OM_BAD_INPUT);
@@ -475,6 +477,7 @@ om_perform_install(nvlist_t *uchoices, om_callback_t cb)
 	if (cb) {
 		om_cb = cb;
 	}
+	(void) om_progress_start();
 	if (nvlist_alloc(&target_attrs, TI_TARGET_NVLIST_TYPE, 0) != 0) {
 		om_log_print("Could not create target list.\n");
 		return (OM_NO_SPACE);
@@ -500,8 +503,7 @@ om_perform_install(nvlist_t *uchoices, om_callback_t cb)
 	 * Log warning message and exit.
 	 */
 
-	ret = td_safe_system("/usr/sbin/zpool list " ROOTPOOL_NAME, B_TRUE);
-	if ((ret == -1) || WEXITSTATUS(ret) != 0) {
+	if (!om_zfs_pool_exists(ROOTPOOL_NAME)) {
 		om_debug_print(OM_DBGLVL_INFO, "Root pool " ROOTPOOL_NAME
 		    " doesn't exist\n");
 	} else {
@@ -514,7 +516,7 @@ om_perform_install(nvlist_t *uchoices, om_callback_t cb)
 		 * it can be safely removed and installation can proceed.
 		 */
 
-		rpool_property = get_dataset_property(ROOT_DATASET_NAME,
+		rpool_property = om_zfs_get_property(ROOT_DATASET_NAME,
 		    TI_RPOOL_PROPERTY_STATE);
 
 		om_debug_print(OM_DBGLVL_INFO, "%s %s: %s\n",
@@ -533,9 +535,11 @@ om_perform_install(nvlist_t *uchoices, om_callback_t cb)
 			om_log_print("Root pool " ROOTPOOL_NAME " exists,"
 			    " we can't proceed with the installation\n");
 
+			free(rpool_property);
 			om_set_error(OM_ZFS_ROOT_POOL_EXISTS);
 			return (OM_FAILURE);
 		}
+		free(rpool_property);
 
 		om_log_print("Root pool " ROOTPOOL_NAME " doesn't "
 		    "contain valid Solaris instance, it will be "
@@ -1137,7 +1141,8 @@ do_ti(void *args)
 	char			*disk_name;
 	nvlist_t		*ti_ex_attrs = NULL;
 	uint64_t		available_disk_space;
-	uint64_t		recommended_size;
+	uint64_t		swap_size;
+	uint64_t		dump_size;
 	uint8_t			install_slice_id;
 
 	ti_args = (struct ti_callback *)
@@ -1175,6 +1180,7 @@ do_ti(void *args)
 	cb_data.callback_type = OM_INSTALL_TYPE;
 	cb_data.curr_milestone = OM_TARGET_INSTANTIATION;
 	cb_data.percentage_done = 0;
+	cb_data.message = NULL;
 #ifndef	__sparc
 	/*
 	 * create fdisk target
@@ -1190,7 +1196,7 @@ do_ti(void *args)
 	}
 #endif
 	cb_data.percentage_done = 20;
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 	/*
 	 * create VTOC target
@@ -1230,7 +1236,7 @@ do_ti(void *args)
 	}
 
 	cb_data.percentage_done = 40;
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 	/*
 	 * Create ZFS root pool.
@@ -1257,6 +1263,12 @@ do_ti(void *args)
 	nvlist_free(ti_ex_attrs);
 	ti_ex_attrs = NULL;
 
+	/*
+	 * The cache still holds the pool as it was before it was released
+	 * and created; the space available in the new pool is read below.
+	 */
+	om_zfs_invalidate(ROOTPOOL_NAME);
+
 	if (ti_status != TI_E_SUCCESS) {
 		om_log_print("Could not create ZFS root pool target\n");
 		om_set_error(OM_CANT_CREATE_ZPOOL);
@@ -1265,7 +1277,7 @@ do_ti(void *args)
 	}
 
 	cb_data.percentage_done = 60;
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 	/*
 	 * Create swap & dump on ZFS volumes
@@ -1273,25 +1285,14 @@ do_ti(void *args)
 
 	available_disk_space = get_available_disk_space();
 
-	/*
-	 * Calculate actual disk space, which can be utilized for
-	 * swap and dump. If zero, only minimum swap and dump
-	 * will be created
-	 */
-
-	recommended_size = get_recommended_size_for_software();
-
-	if (available_disk_space < recommended_size) {
-		available_disk_space = 0;
-	} else {
-		available_disk_space -= recommended_size;
+	/* create_swap_and_dump is set in disk_parts.c or disk_slices.c */
+	if (calc_swap_dump_sizes(available_disk_space, create_swap_and_dump,
+	    &swap_size, &dump_size) != OM_SUCCESS) {
+		om_log_print("Could not prepare ZFS volume attribute set\n");
+		status = -1;
+		goto ti_error;
 	}
 
-	om_debug_print(OM_DBGLVL_INFO,
-	    "Available disk space for swap/dump: %llu MiB\n",
-	    available_disk_space);
-
-	/* create_swap_and_dump is set in disk_parts.c or disk_slices.c */
 	/* Basic check to ensure there is space on actual partition/slice */
 	/* for software and some left over for swap/dump */
 	if (create_swap_and_dump) {
@@ -1335,7 +1336,7 @@ do_ti(void *args)
 			}
 
 			if (prepare_zfs_volume_attrs(&ti_ex_attrs,
-			    available_disk_space, B_FALSE) != OM_SUCCESS) {
+			    swap_size, dump_size) != OM_SUCCESS) {
 				om_log_print(
 				    "Could not prepare ZFS volume attribute "
 				    "set\n");
@@ -1373,8 +1374,8 @@ do_ti(void *args)
 		    "the installer will create default size ZFS "
 		    "volume for swap\n");
 
-		if (prepare_zfs_volume_attrs(&ti_ex_attrs, available_disk_space,
-		    B_TRUE) != OM_SUCCESS) {
+		if (prepare_zfs_volume_attrs(&ti_ex_attrs, swap_size,
+		    dump_size) != OM_SUCCESS) {
 			om_log_print("Could not prepare ZFS volume attribute "
 			    "set\n");
 
@@ -1414,7 +1415,7 @@ do_ti(void *args)
 	}
 
 	cb_data.percentage_done = 80;
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 	/*
 	 * Create BE
@@ -1441,10 +1442,12 @@ do_ti(void *args)
 	}
 
 	cb_data.percentage_done = 99;
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 ti_error:
 
+	om_zfs_cache_stats();
+
 	cb_data.num_milestones = 3;
 	cb_data.callback_type = OM_INSTALL_TYPE;
 
@@ -1457,7 +1460,7 @@ ti_error:
 		cb_data.percentage_done = 100;
 	}
 
-	om_cb(&cb_data, app_data);
+	report_progress(&cb_data, app_data);
 
 	if (om_breakpoint == OM_breakpoint_after_TI) {
 		om_log_std(LS_STDERR,
@@ -1802,51 +1805,44 @@ handle_TM_callback(const int percent, const char *message)
 	cb_data.callback_type = OM_INSTALL_TYPE;
 	cb_data.percentage_done = percent;
 	cb_data.message = message;
-	om_cb(&cb_data, 0);
+	report_progress(&cb_data, 0);
 }
 
-
 /*
- * Parsing function to get the percentage value from the string.
- * The string will be like "percent=11"
- * The output is an integer from 0 - 100
+ * report_progress
+ * This function posts the progress of the installation to the progress
+ * ring, then passes it to the callback of the caller
+ * Input:	cb_data - progress as the callback expects it
+ *		app_data - passed to the callback
+ * Output:	None
+ * Return:	None
  */
-int16_t
-get_the_percentage(char *str)
+static void
+report_progress(om_callback_info_t *cb_data, uintptr_t app_data)
 {
-	char	*ptr, *ptr1;
-	int16_t	percent;
-
-	/*
-	 * Look for percent="N"
-	 */
-	ptr = strstr(str, "percent=");
-	if (ptr == NULL) {
-		return (-1);
-	}
-	/*
-	 * Find where the number is starting
-	 */
-	while (isdigit(*ptr) == 0) {
-		ptr++;
-	}
-	ptr1 = strchr(ptr, '"');
-	if (ptr1 == NULL) {
-		return (-1);
-	}
-	*ptr1 = '\0';
-
-	errno = 0;
-	percent = (int16_t)strtol(ptr, (char **)NULL, 10);
-	if (errno != 0) {
-		/*
-		 * Log the information
-		 */
-		return (-1);
+	int16_t		percent = cb_data->percentage_done;
+	int16_t		status = 0;
+	uint64_t	bytes = 0;
+
+	if (cb_data->curr_milestone == OM_INVALID_MILESTONE) {
+		/* the percentage is overloaded with the error */
+		status = percent;
+		percent = -1;
+	} else if (cb_data->curr_milestone == OM_SOFTWARE_UPDATE &&
+	    percent > 0) {
+		/* estimated from the size of the installed image */
+		bytes = (uint64_t)(image_info.image_size *
+		    image_info.compress_ratio * ONEMB) / 100 * percent;
+	}
+	om_progress_status(cb_data->curr_milestone, percent, status, bytes,
+	    cb_data->message);
+
+	if (om_cb != NULL) {
+		om_cb(cb_data, app_data);
 	}
-	return (percent);
 }
 
+
 /*ARGSUSED*/
 uint64_t
 om_get_min_size(char *media, char *distro)
@@ -2017,7 +2013,7 @@ notify_error_status(int status)
 	cb_data.callback_type = OM_INSTALL_TYPE;
 	cb_data.percentage_done = status; /* overload value on error */
 	cb_data.message = NULL;
-	om_cb(&cb_data, 0);
+	report_progress(&cb_data, 0);
 }
 
 /*
@@ -2033,7 +2029,7 @@ notify_install_complete()
 	cb_data.callback_type = OM_INSTALL_TYPE;
 	cb_data.percentage_done = 100;
 	cb_data.message = NULL;
-	om_cb(&cb_data, 0);
+	report_progress(&cb_data, 0);
 }
 
 /*
@@ -2420,18 +2416,126 @@ calculate_available_swap_dump_space(uint64_t available_disk_space,
 	return (OM_SUCCESS);
 }
 
+/*
+ * calc_swap_dump_sizes
+ * Decides the sizes of the swap and dump ZFS volumes created in the root
+ * pool.  This is the sizing policy of the install, shared by do_ti() and
+ * by the layout planner through estimate_swap_dump_size():
+ *	- if the install partition or slice holds the recommended size, swap
+ *	  and dump are created, except where a size of zero is requested.
+ *	  If swap is on a slice, only dump is created on a volume.
+ *	- otherwise, if physical memory requires swap and it isn't on a
+ *	  slice, a swap volume of the minimum size is created
+ *	- otherwise neither is created
+ *
+ * Input:	pool_space - space available in the root pool in MiB
+ *		swap_and_dump - B_TRUE if the install partition or slice
+ *			holds the recommended size
+ * Output:	swap_size, dump_size - volume sizes in MiB, 0 if not created
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE - requested swap or dump would not fit
+ */
+static int
+calc_swap_dump_sizes(uint64_t pool_space, boolean_t swap_and_dump,
+    uint64_t *swap_size, uint64_t *dump_size)
+{
+	uint64_t	required_swap_size = calc_required_swap_size();
+	uint64_t	available_disk_space;
+	uint64_t	recommended_size;
+	uint32_t	available_swap_space = 0;
+	uint32_t	available_dump_space = 0;
+	boolean_t	create_swap;
+	boolean_t	create_dump;
+
+	*swap_size = 0;
+	*dump_size = 0;
+
+	if (swap_and_dump) {
+		create_swap = (!create_swap_slice && requested_swap_size != 0);
+		create_dump = (requested_dump_size != 0);
+	} else {
+		create_swap = (!create_swap_slice && required_swap_size != 0);
+		create_dump = B_FALSE;
+	}
+	if (!create_swap && !create_dump)
+		return (OM_SUCCESS);
+
+	/*
+	 * Calculate actual disk space, which can be utilized for
+	 * swap and dump. If zero, only minimum swap and dump
+	 * will be created
+	 */
+
+	recommended_size = get_recommended_size_for_software();
+	available_disk_space = (pool_space > recommended_size ?
+	    pool_space - recommended_size : 0);
+
+	om_debug_print(OM_DBGLVL_INFO,
+	    "Available disk space for swap/dump: %llu MiB\n",
+	    available_disk_space);
+
+	if (calculate_available_swap_dump_space(available_disk_space,
+	    &available_swap_space, &available_dump_space) != OM_SUCCESS)
+		return (OM_FAILURE);
+
+	if (!swap_and_dump) {
+		/* Do not check for requested swap size in this scenario */
+		*swap_size = limit_min_max(required_swap_size, MIN_SWAP_SIZE,
+		    MAX_SWAP_SIZE);
+		return (OM_SUCCESS);
+	}
+	if (create_swap)
+		*swap_size = calc_swap_size(available_swap_space);
+	if (create_dump)
+		*dump_size = calc_dump_size(available_dump_space);
+	return (OM_SUCCESS);
+}
+
+/*
+ * estimate_swap_dump_size
+ * Estimates the sizes of swap and dump the installer would create in an
+ * install partition or slice of given size, with the policy of
+ * calc_swap_dump_sizes().  A swap slice is taken from the install
+ * partition, so the root pool only gets what is left of it.
+ *
+ * Input:	install_size - size of the install partition or slice in MiB
+ *		recommended_size - size in MiB from which on swap and dump
+ *			are created
+ * Output:	swap_size - estimated size of swap in MiB, slice or volume,
+ *			0 if not created
+ *		dump_size - estimated size of dump in MiB, 0 if not created
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE - requested swap or dump would not fit
+ */
+int
+estimate_swap_dump_size(uint64_t install_size, uint64_t recommended_size,
+    uint64_t *swap_size, uint64_t *dump_size)
+{
+	uint64_t	swap_slice_size = calc_required_swap_size();
+	uint64_t	pool_size;
+
+	if (!create_swap_slice)
+		swap_slice_size = 0;
+	pool_size = (install_size > swap_slice_size ?
+	    install_size - swap_slice_size : 0);
+
+	if (calc_swap_dump_sizes(pool_size,
+	    install_size + OVERHEAD_MB >= recommended_size,
+	    swap_size, dump_size) != OM_SUCCESS)
+		return (OM_FAILURE);
+	*swap_size += swap_slice_size;
+	return (OM_SUCCESS);
+}
+
 /*
  * prepare_zfs_volume_attrs
  * Creates nvlist set of attributes describing ZFS volumes to be created.
- * If a slice has already been created for the swap device, create a zvol
- * only for the dump device.  Else if the flag to create only the minimum
- * sized swap device is passed in, create a zvol only for the swap device.
- * Otherwise, create zvols for both swap and dump.
+ * A zvol is created for swap and for dump, if their sizes as calculated
+ * by calc_swap_dump_sizes() aren't zero.
  *
  * Input:	nvlist_t **attrs - attributes describing the target
- *		available_disk_space - space which can be dedicated to
- *			swap and dump.
- *		create_min_swap_only - only swap with minimum size is created
+ *		swap_size - size of the swap zvol in MiB, 0 for none
+ *		dump_size - size of the dump zvol in MiB, 0 for none
  *
  * Output:
  * Return:	OM_SUCCESS
@@ -2439,75 +2543,30 @@ calculate_available_swap_dump_space(uint64_t available_disk_space,
  * Notes:
  */
 static int
-prepare_zfs_volume_attrs(nvlist_t **attrs, uint64_t available_disk_space,
-    boolean_t create_min_swap_only)
+prepare_zfs_volume_attrs(nvlist_t **attrs, uint64_t swap_size,
+    uint64_t dump_size)
 {
 	uint16_t	vol_num = 0;
 	char		*vol_names[2] = { 0 };
 	uint16_t	vol_types[2] = { 0 };
 	uint32_t	vol_sizes[2] = { 0 };
-	uint32_t	available_swap_space = 0;
-	uint32_t	available_dump_space = 0;
-
-	if (calculate_available_swap_dump_space(available_disk_space,
-	    &available_swap_space, &available_dump_space) != OM_SUCCESS) {
 
-		return (OM_FAILURE);
+	if (swap_size != 0) {
+		om_debug_print(OM_DBGLVL_INFO,
+		    "Setting up SWAP zvol\n");
+		vol_names[vol_num] = TI_ZFS_VOL_NAME_SWAP;
+		vol_types[vol_num] = TI_ZFS_VOL_TYPE_SWAP;
+		vol_sizes[vol_num] = (uint32_t)swap_size;
+		vol_num++;
 	}
 
-	if (create_swap_slice) {
-		/*
-		 * A slice for swap has already been created, create
-		 * a zvol only for the dump device.
-		 */
-		if (requested_dump_size != 0) {
-			om_debug_print(OM_DBGLVL_INFO,
-			    "Setting up DUMP zvol\n");
-			vol_num = 1;
-			vol_names[0] = TI_ZFS_VOL_NAME_DUMP;
-			vol_types[0] = TI_ZFS_VOL_TYPE_DUMP;
-			vol_sizes[0] = calc_dump_size(available_dump_space);
-		}
-	} else if (create_min_swap_only) {
-		/*
-		 * Create a zvol only for swap with the minimum swap size.
-		 */
-		/* Do not check for requested swap size in this scenario */
+	if (dump_size != 0) {
 		om_debug_print(OM_DBGLVL_INFO,
-		    "Setting up required swap zvol\n");
-		vol_num = 1;
-		vol_names[0] = TI_ZFS_VOL_NAME_SWAP;
-		vol_types[0] = TI_ZFS_VOL_TYPE_SWAP;
-		vol_sizes[0] = limit_min_max(calc_required_swap_size(),
-		    MIN_SWAP_SIZE, MAX_SWAP_SIZE);
-	} else {
-		/*
-		 * Create zvols for both swap and dump.
-		 * If requested size of zero do not create.
-		 */
-		vol_num = 0;
-
-		/* Check of requested swap is zero */
-		if (requested_swap_size != 0) {
-			om_debug_print(OM_DBGLVL_INFO,
-			    "Setting up SWAP zvol\n");
-			vol_names[vol_num] = TI_ZFS_VOL_NAME_SWAP;
-			vol_types[vol_num] = TI_ZFS_VOL_TYPE_SWAP;
-			vol_sizes[vol_num] =
-			    calc_swap_size(available_swap_space);
-			vol_num++;
-		}
-
-		/* Check of requested dump is zero */
-		if (requested_dump_size != 0) {
-			om_debug_print(OM_DBGLVL_INFO,
-			    "Setting up DUMP zvol\n");
-			vol_names[vol_num] = TI_ZFS_VOL_NAME_DUMP;
-			vol_types[vol_num] = TI_ZFS_VOL_TYPE_DUMP;
-			vol_sizes[vol_num] =
-			    calc_dump_size(available_dump_space);
-			vol_num++;
-		}
+		    "Setting up DUMP zvol\n");
+		vol_names[vol_num] = TI_ZFS_VOL_NAME_DUMP;
+		vol_types[vol_num] = TI_ZFS_VOL_TYPE_DUMP;
+		vol_sizes[vol_num] = (uint32_t)dump_size;
+		vol_num++;
 	}
 
 	if (vol_num == 0) {
@@ -2798,66 +2857,6 @@ obtain_image_info(image_info_t *info)
 }
 
 
-/*
- * get_dataset_property
- *
- * Obtains value of dataset property
- * Return:	== NULL - couldn't obtain property
- *		!= NULL - pointer to property value
- * Notes:
- */
-
-static char *
-get_dataset_property(char *dataset_name, char *property)
-{
-	FILE	*p;
-	char	cmd[MAXPATHLEN];
-	char	*strbuf;
-	int	ret;
-
-	strbuf = malloc(MAXPATHLEN);
-
-	if (strbuf == NULL) {
-		om_log_print("Out of memory\n");
-		return (NULL);
-	}
-
-	(void) snprintf(cmd, sizeof (cmd),
-	    "/usr/sbin/zfs get -H -o value %s %s", property, dataset_name);
-
-	om_log_print("%s\n", cmd);
-
-	if ((p = popen(cmd, "r")) == NULL) {
-		om_log_print("Couldn't obtain dataset property\n");
-
-		free(strbuf);
-		return (NULL);
-	}
-
-	if (fgets(strbuf, MAXPATHLEN, p) == NULL) {
-		om_log_print("Couldn't obtain dataset property\n");
-
-		free(strbuf);
-		(void) pclose(p);
-		return (NULL);
-	}
-
-	ret = WEXITSTATUS(pclose(p));
-
-	if (ret != 0) {
-		om_log_print("Command failed with error %d\n", ret);
-		free(strbuf);
-		return (NULL);
-	}
-
-	/* strip new line */
-	if (strbuf[strlen(strbuf) - 1] == '\n')
-		strbuf[strlen(strbuf) - 1] = '\0';
-
-	return (strbuf);
-}
-
-
 /*
  * get_available_disk_space
  *
@@ -2872,63 +2871,19 @@ get_dataset_property(char *dataset_name, char *property)
 static uint64_t
 get_available_disk_space(void)
 {
-	FILE		*p;
-	char		cmd[MAXPATHLEN];
-	char		*strbuf;
-	int		ret;
 	uint64_t	avail_space;
 
-	strbuf = malloc(MAXPATHLEN);
-
-	if (strbuf == NULL) {
-		om_log_print("Out of memory\n");
-		return (0);
-	}
-
-	(void) snprintf(cmd, sizeof (cmd),
-	    "/usr/sbin/zfs get -Hp -o value available " ROOTPOOL_NAME);
-
-	om_log_print("%s\n", cmd);
-
-	if ((p = popen(cmd, "r")) == NULL) {
-		om_log_print("Couldn't obtain available space\n");
-
-		free(strbuf);
-		return (0);
-	}
-
-	if (fgets(strbuf, MAXPATHLEN, p) == NULL) {
+	if (om_zfs_get_numeric_property(ROOT_DATASET_NAME, "available",
+	    &avail_space) != OM_SUCCESS) {
 		om_log_print("Couldn't obtain available space\n");
-
-		free(strbuf);
-		(void) pclose(p);
-		return (0);
-	}
-
-	ret = WEXITSTATUS(pclose(p));
-
-	if (ret != 0) {
-		om_log_print("Command failed with error %d\n", ret);
-		free(strbuf);
 		return (0);
 	}
 
-	/* strip new line */
-	if (strbuf[strlen(strbuf) - 1] == '\n')
-		strbuf[strlen(strbuf) - 1] = '\0';
-
 	om_debug_print(OM_DBGLVL_INFO,
-	    ROOTPOOL_NAME " pool: %s bytes are available\n", strbuf);
+	    ROOTPOOL_NAME " pool: %llu bytes are available\n", avail_space);
 
 	/* convert to MiB */
-	errno = 0;
-	avail_space = strtoll(strbuf, NULL, 10) / ONE_MB_TO_BYTE;
-	if (errno != 0) {
-		om_log_print("Couldn't obtain available space, strtoll() "
-		"failed with error %d\n", errno);
-		free(strbuf);
-		return (0);
-	}
+	avail_space /= ONE_MB_TO_BYTE;
 
 	om_debug_print(OM_DBGLVL_INFO,
 	    ROOTPOOL_NAME " pool: %llu MiB are available\n", avail_space);
@@ -140,6 +140,7 @@ get_td_disk_info_discover(int *ndisks, om_callback_t cb)
 			tmpdt->next = dt;
 			tmpdt = tmpdt->next;
 		}
+		om_post_disk_event(OM_DISK_FOUND_EVENT, i - bad - 1, num, dt);
 		/*
 		 * Issue a callback, if the callback function is given
 		 */
@@ -180,12 +181,16 @@ get_td_disk_parts_discover(disk_target_t *disks, om_callback_t cb)
 	om_callback_info_t	cb_data;
 	uintptr_t		app_data = 0;
 	disk_target_t		*dt;
-	int			i;
+	int			i, ndisks;
 
 	if (disks == NULL) {
 		return;
 	}
 
+	for (dt = disks, ndisks = 0; dt != NULL; dt = dt->next) {
+		ndisks++;
+	}
+
 	/*
 	 * Initialize the fixed values for disk parition discover callback
 	 */
@@ -200,6 +205,8 @@ get_td_disk_parts_discover(disk_target_t *disks, om_callback_t cb)
 		 * Now get the partitions for this disk
 		 */
 		dt->dparts = enumerate_partitions(dt->dinfo.disk_name);
+		om_post_disk_event(OM_PARTITIONS_READY_EVENT, i - 1, ndisks,
+		    dt);
 		/*
 		 * Issue a callback, if the callback function is given
 		 */
@@ -233,12 +240,16 @@ get_td_disk_slices_discover(disk_target_t *disks, om_callback_t cb)
 	om_callback_info_t	cb_data;
 	uintptr_t		app_data = 0;
 	disk_target_t		*dt;
-	int			i;
+	int			i, ndisks;
 
 	if (disks == NULL) {
 		return;
 	}
 
+	for (dt = disks, ndisks = 0; dt != NULL; dt = dt->next) {
+		ndisks++;
+	}
+
 	/*
 	 * Initialize the fixed values for disk parition discover callback
 	 */
@@ -253,6 +264,7 @@ get_td_disk_slices_discover(disk_target_t *disks, om_callback_t cb)
 		 * Now get the partitions for this disk
 		 */
 		dt->dslices = enumerate_slices(dt->dinfo.disk_name);
+		om_post_disk_event(OM_SLICES_READY_EVENT, i - 1, ndisks, dt);
 		/*
 		 * Issue a callback, if the callback function is given
 		 */
@@ -334,6 +346,7 @@ get_td_solaris_instances(om_callback_t cb)
 			tmput->next = ut;
 			tmput = tmput->next;
 		}
+		om_post_instance_event(ut);
 		/*
 		 * Issue a callback, if the callback function is given
 		 */
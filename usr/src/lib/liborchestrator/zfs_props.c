@@ -0,0 +1,358 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * Cache of the ZFS properties the orchestrator looks at.
+ *
+ * A lookup in a dataset which isn't cached runs a single "zfs get all" for
+ * it and keeps every property it prints.  If zfs reports that the dataset
+ * doesn't exist, that is kept too, so the root dataset of a pool also
+ * answers whether the pool exists.  Further lookups in the dataset are
+ * answered from the cache until om_zfs_invalidate() is called, which the
+ * orchestrator does after a change to the pool which a later lookup has
+ * to see.
+ *
+ * Values are kept as "zfs get -p" prints them, so numeric properties are
+ * exact.  Unset user properties aren't printed by "zfs get all", so they
+ * aren't found.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "orchestrator_private.h"
+
+#define	ZFS_CMD			"/usr/sbin/zfs"
+#define	ZFS_NO_DATASET		"dataset does not exist"
+
+typedef struct zfs_prop {
+	char			*property;
+	char			*value;
+	struct zfs_prop		*next;
+} zfs_prop_t;
+
+static struct {
+	pthread_mutex_t	lock;
+	char		*dataset;	/* dataset the entries belong to */
+	boolean_t	loaded;
+	boolean_t	exists;
+	zfs_prop_t	*entries;
+	uint64_t	hits;
+	uint64_t	misses;
+	uint64_t	queries;
+	uint64_t	invalidations;
+} zcache = {
+	PTHREAD_MUTEX_INITIALIZER,
+	NULL, B_FALSE, B_FALSE, NULL,
+	0, 0, 0, 0
+};
+
+/*
+ * free_entries
+ * Drops the cached entries. Called with the cache locked.
+ * Input:	None
+ * Output:	None
+ * Return:	None
+ */
+static void
+free_entries(void)
+{
+	zfs_prop_t	*ent, *next;
+
+	for (ent = zcache.entries; ent != NULL; ent = next) {
+		next = ent->next;
+		free(ent->property);
+		free(ent->value);
+		free(ent);
+	}
+	zcache.entries = NULL;
+	zcache.loaded = B_FALSE;
+	zcache.exists = B_FALSE;
+}
+
+/*
+ * add_entry
+ * Adds one line of "zfs get -H -o property,value" output to the cache.
+ * Called with the cache locked.
+ * Input:	char *line - line read from the command, new line stripped
+ * Output:	None
+ * Return:	B_TRUE on success, B_FALSE if the line is malformed or
+ *		out of memory
+ */
+static boolean_t
+add_entry(char *line)
+{
+	zfs_prop_t	*ent;
+	char		*value;
+
+	if ((value = strchr(line, '\t')) == NULL)
+		return (B_FALSE);
+	*value++ = '\0';
+
+	if ((ent = calloc(1, sizeof (zfs_prop_t))) == NULL)
+		return (B_FALSE);
+	ent->property = strdup(line);
+	ent->value = strdup(value);
+	if (ent->property == NULL || ent->value == NULL) {
+		free(ent->property);
+		free(ent->value);
+		free(ent);
+		return (B_FALSE);
+	}
+	ent->next = zcache.entries;
+	zcache.entries = ent;
+	return (B_TRUE);
+}
+
+/*
+ * load_dataset
+ * Fetches all the properties of a dataset with one "zfs get" command.
+ * Its error messages are read as well, to tell a dataset which doesn't
+ * exist from one whose properties couldn't be read. Called with the
+ * cache locked.
+ * Input:	char *dataset - name of the dataset
+ * Output:	None
+ * Return:	OM_SUCCESS if the dataset doesn't exist or its properties
+ *		were fetched
+ *		OM_FAILURE if they couldn't be
+ */
+static int
+load_dataset(char *dataset)
+{
+	FILE		*p;
+	char		cmd[MAXPATHLEN];
+	char		line[MAXPATHLEN];
+	size_t		len;
+	boolean_t	missing = B_FALSE;
+	int		ret;
+
+	free_entries();
+	if (zcache.dataset == NULL || strcmp(zcache.dataset, dataset) != 0) {
+		free(zcache.dataset);
+		if ((zcache.dataset = strdup(dataset)) == NULL) {
+			om_log_print("Out of memory\n");
+			return (OM_FAILURE);
+		}
+	}
+
+	(void) snprintf(cmd, sizeof (cmd),
+	    "LC_ALL=C " ZFS_CMD " get -Hp -o property,value all %s 2>&1",
+	    dataset);
+
+	om_log_print("%s\n", cmd);
+	zcache.queries++;
+
+	if ((p = popen(cmd, "r")) == NULL) {
+		om_log_print("Couldn't obtain ZFS properties of %s\n",
+		    dataset);
+		return (OM_FAILURE);
+	}
+
+	while (fgets(line, sizeof (line), p) != NULL) {
+		len = strlen(line);
+		if (len > 0 && line[len - 1] == '\n')
+			line[len - 1] = '\0';
+		if (strchr(line, '\t') == NULL) {
+			/* an error message */
+			om_debug_print(OM_DBGLVL_INFO, "%s\n", line);
+			if (strstr(line, ZFS_NO_DATASET) != NULL)
+				missing = B_TRUE;
+		} else if (!add_entry(line)) {
+			om_debug_print(OM_DBGLVL_WARN,
+			    "Couldn't cache ZFS property line: %s\n", line);
+		}
+	}
+
+	ret = pclose(p);
+
+	if (missing) {
+		free_entries();
+		zcache.loaded = B_TRUE;
+		om_debug_print(OM_DBGLVL_INFO, "ZFS dataset %s doesn't exist\n",
+		    dataset);
+		return (OM_SUCCESS);
+	}
+
+	if (ret == -1 || WEXITSTATUS(ret) != 0) {
+		free_entries();
+		om_log_print("Couldn't obtain ZFS properties of %s\n",
+		    dataset);
+		return (OM_FAILURE);
+	}
+
+	zcache.loaded = B_TRUE;
+	zcache.exists = B_TRUE;
+	om_debug_print(OM_DBGLVL_INFO, "ZFS dataset %s properties cached\n",
+	    dataset);
+	return (OM_SUCCESS);
+}
+
+/*
+ * lookup_dataset
+ * Makes sure the properties of the dataset are in the cache, loading
+ * them if needed. Called with the cache locked.
+ * Input:	char *dataset - name of the dataset
+ * Output:	None
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE
+ */
+static int
+lookup_dataset(char *dataset)
+{
+	if (zcache.loaded && strcmp(zcache.dataset, dataset) == 0) {
+		zcache.hits++;
+		return (OM_SUCCESS);
+	}
+	zcache.misses++;
+	return (load_dataset(dataset));
+}
+
+/*
+ * om_zfs_pool_exists
+ * Checks whether a ZFS pool exists, by looking up its root dataset.
+ * Input:	char *pool - name of the pool
+ * Output:	None
+ * Return:	B_TRUE if the pool exists
+ *		B_FALSE if it doesn't or the check couldn't be made
+ */
+boolean_t
+om_zfs_pool_exists(char *pool)
+{
+	boolean_t	exists;
+
+	(void) pthread_mutex_lock(&zcache.lock);
+	exists = lookup_dataset(pool) == OM_SUCCESS && zcache.exists;
+	(void) pthread_mutex_unlock(&zcache.lock);
+
+	return (exists);
+}
+
+/*
+ * om_zfs_get_property
+ * Obtains the value of a dataset property.
+ * Input:	char *dataset - name of the dataset
+ *		char *property - name of the property
+ * Output:	None
+ * Return:	== NULL - couldn't obtain property
+ *		!= NULL - value of the property, to be freed by the caller
+ */
+char *
+om_zfs_get_property(char *dataset, char *property)
+{
+	zfs_prop_t	*ent;
+	char		*value = NULL;
+
+	(void) pthread_mutex_lock(&zcache.lock);
+
+	if (lookup_dataset(dataset) == OM_SUCCESS) {
+		for (ent = zcache.entries; ent != NULL; ent = ent->next) {
+			if (strcmp(ent->property, property) == 0) {
+				value = strdup(ent->value);
+				break;
+			}
+		}
+	}
+
+	(void) pthread_mutex_unlock(&zcache.lock);
+
+	if (value == NULL)
+		om_log_print("Couldn't obtain %s property of %s\n", property,
+		    dataset);
+	return (value);
+}
+
+/*
+ * om_zfs_get_numeric_property
+ * Obtains the value of a numeric dataset property, like "available".
+ * Input:	char *dataset - name of the dataset
+ *		char *property - name of the property
+ * Output:	uint64_t *value - value of the property
+ * Return:	OM_SUCCESS
+ *		OM_FAILURE
+ */
+int
+om_zfs_get_numeric_property(char *dataset, char *property, uint64_t *value)
+{
+	char	*strbuf, *end;
+
+	if ((strbuf = om_zfs_get_property(dataset, property)) == NULL)
+		return (OM_FAILURE);
+
+	errno = 0;
+	*value = strtoull(strbuf, &end, 10);
+	if (errno != 0 || end == strbuf || *end != '\0') {
+		om_log_print("Couldn't convert %s property of %s: %s\n",
+		    property, dataset, strbuf);
+		free(strbuf);
+		return (OM_FAILURE);
+	}
+	free(strbuf);
+	return (OM_SUCCESS);
+}
+
+/*
+ * om_zfs_invalidate
+ * Drops what is cached for a pool and its datasets, after the
+ * orchestrator created, released or changed it.
+ * Input:	char *pool - name of the pool
+ * Output:	None
+ * Return:	None
+ */
+void
+om_zfs_invalidate(char *pool)
+{
+	size_t	len = strlen(pool);
+
+	(void) pthread_mutex_lock(&zcache.lock);
+	if (zcache.loaded && strncmp(zcache.dataset, pool, len) == 0 &&
+	    (zcache.dataset[len] == '\0' || zcache.dataset[len] == '/')) {
+		free_entries();
+		zcache.invalidations++;
+	}
+	(void) pthread_mutex_unlock(&zcache.lock);
+}
+
+/*
+ * om_zfs_cache_stats
+ * Logs how well the ZFS property cache did.
+ * Input:	None
+ * Output:	None
+ * Return:	None
+ */
+void
+om_zfs_cache_stats(void)
+{
+	(void) pthread_mutex_lock(&zcache.lock);
+	om_debug_print(OM_DBGLVL_INFO, "ZFS property cache: %llu hits, "
+	    "%llu misses, %llu zfs commands, %llu invalidations\n",
+	    (u_longlong_t)zcache.hits, (u_longlong_t)zcache.misses,
+	    (u_longlong_t)zcache.queries, (u_longlong_t)zcache.invalidations);
+	(void) pthread_mutex_unlock(&zcache.lock);
+}
@@ -99,6 +99,8 @@ int	td_safe_system(char *, boolean_t);
 int	td_map_node_to_devlink(char *, char *, int);
 int	td_map_old_device_to_new(char *, char *, int);
 int	td_map_to_effective_dev(char *, char *, int);
+void	td_devmap_release(void);
+void	td_devmap_stats(uint64_t *, uint64_t *);
 void	td_SetExemptSwapfile(char *sf);
 
 /* td_be.c */
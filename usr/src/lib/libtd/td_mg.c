@@ -46,7 +46,9 @@
 #include <time.h>
 #include <ustat.h>
 #include <sys/wait.h>
+#include <sys/fs/ufs_fs.h>
 #include <libintl.h>
+#include <pthread.h>
 
 #include <instzones_api.h>
 
@@ -70,13 +72,44 @@
 
 /* template temporary directory names for mkdtemp() */
 #define	TEMPLATEROOT	"/tmp/td_rootXXXXXX"
-#define	TEMPLATEVAR	TEMPLATEROOT "/var"
+
+/* threads probing root slices, default and limit for TD_PROBE_THREADS */
+#define	OS_PROBE_THREADS	8
+#define	OS_PROBE_THREADS_MAX	64
+
+/* what the superblock of a slice tells about mounting it */
+typedef enum {
+	UFS_PROBE_CLEAN,	/* UFS, can be mounted without fsck */
+	UFS_PROBE_NOT_UFS,	/* not UFS */
+	UFS_PROBE_UNKNOWN	/* fsck -m must tell */
+} ufs_probe_t;
+
+/* root slice candidate for an OS instance */
+struct os_probe {
+	char *slicenm;			/* slice name, ctds */
+	nvlist_t *nvl;			/* slice attributes */
+	uint32_t partition_tag;		/* VTOC partition tag */
+	boolean_t rootmounted;		/* mounted before discovery */
+	boolean_t varmounted;		/* with separate var mounted */
+	char rootmntpnt[MAXPATHLEN];	/* mount point, "" if not mounted */
+	const char *method;		/* how it was probed */
+	hrtime_t probetime;		/* time probing and mounting took */
+};
+
+/* root slice candidates shared by os probe threads */
+struct os_probe_pool {
+	struct os_probe *probes;	/* candidates */
+	int nprobes;			/* count of candidates */
+	int next;			/* next candidate to probe */
+	pthread_mutex_t lock;		/* protects next */
+};
 
 /* object instances */
 struct td_obj {
 	ddm_handle_t handle;		/* disk module handle */
 	nvlist_t *attrib;		/* attribute list for disk */
 	boolean_t discovery_done;	/* discovery performed for object */
+	td_vkey_t *vkey;		/* parsed OS version, for sorting */
 };
 
 /* class for TD objects */
@@ -149,6 +182,11 @@ static void disks_discover_all_attrs(void);
 static void sort_objs(td_object_type_t);
 static int td_fsck_mount(char *, char *, boolean_t, char *, char *, char *,
     nvlist_t **);
+static ufs_probe_t probe_ufs_superblock(const char *);
+static void probe_root_slice(struct os_probe *);
+static void *os_probe_thread(void *);
+static void probe_root_slices(struct os_probe *, int);
+static void release_probe(struct os_probe *);
 static nvlist_t *dup_attr_set_errno(struct td_obj *);
 static void free_td_obj_list(td_object_type_t);
 static nvlist_t **td_discover_object_by_disk(td_object_type_t,
@@ -239,6 +277,7 @@ td_discover(td_object_type_t otype, int *number_found)
 			ptdobj->handle = *pddm;
 			ptdobj->attrib = NULL;
 			ptdobj->discovery_done = B_FALSE;
+			ptdobj->vkey = NULL;
 		}
 		/* mark end of array */
 		ptdobj->handle = 0;
@@ -280,6 +319,7 @@ td_discover(td_object_type_t otype, int *number_found)
 			ptdobj->handle = *pddm;
 			ptdobj->attrib = NULL;
 			ptdobj->discovery_done = B_FALSE;
+			ptdobj->vkey = NULL;
 		}
 		/* mark end of array */
 		ptdobj->handle = 0;
@@ -316,6 +356,7 @@ td_discover(td_object_type_t otype, int *number_found)
 			ptdobj->handle = *pddm;
 			ptdobj->attrib = NULL;
 			ptdobj->discovery_done = B_FALSE;
+			ptdobj->vkey = NULL;
 		}
 		/* mark end of array */
 		ptdobj->handle = 0;
@@ -707,6 +748,7 @@ td_get_errno(void)
  * interface to TD user
  *   released resources:
  *     - memory allocated for caching of discovery data
+ *     - device name mappings cached by td_util.c
  */
 td_errno_t
 td_discovery_release(void)
@@ -719,6 +761,8 @@ td_discovery_release(void)
 	free_td_obj_list(TD_OT_PARTITION);
 	free_td_obj_list(TD_OT_SLICE);
 	free_td_obj_list(TD_OT_OS);
+	/* forget device name mappings */
+	td_devmap_release();
 	if (TLI)
 		td_debug_print(LS_DBGLVL_INFO, "td_discovery_release ends \n");
 	return (TD_E_SUCCESS);
@@ -893,6 +937,14 @@ td_errno_t
 add_td_discovered_obj(td_object_type_t objtype, nvlist_t *onvl)
 {
 	struct td_obj *pobja = objlist[objtype].objarr;
+	td_vkey_t *vkey = NULL;
+	char *version;
+
+	/* parse the OS version once, for sorting */
+	if (objtype == TD_OT_OS &&
+	    nvlist_lookup_string(onvl, TD_OS_ATTR_VERSION, &version) == 0 &&
+	    (vkey = malloc(sizeof (*vkey))) != NULL)
+		(void) td_prod_vkey(version, vkey);
 
 	pobja =
 	    realloc(pobja, sizeof (*pobja) * (objlist[objtype].objcnt + 2));
@@ -900,6 +952,7 @@ add_td_discovered_obj(td_object_type_t objtype, nvlist_t *onvl)
 	if (pobja == NULL) {
 		td_debug_print(LS_DBGLVL_ERR,
 		    "nvlist td_obj allocation failure\n");
+		free(vkey);
 		return (TD_E_MEMORY);
 	}
 	objlist[objtype].objarr = pobja;
@@ -907,6 +960,7 @@ add_td_discovered_obj(td_object_type_t objtype, nvlist_t *onvl)
 	pobja->attrib = onvl;
 	pobja->handle = (ddm_handle_t)onvl;
 	pobja->discovery_done = B_TRUE;
+	pobja->vkey = vkey;
 	if (TLI)
 		td_debug_print(LS_DBGLVL_INFO, "added to td_obj list!!!\n");
 	objlist[objtype].objcnt++;
@@ -914,6 +968,7 @@ add_td_discovered_obj(td_object_type_t objtype, nvlist_t *onvl)
 	pobja->attrib = NULL;
 	pobja->handle = 0L;
 	pobja->discovery_done = B_FALSE;
+	pobja->vkey = NULL;
 	return (TD_E_SUCCESS);
 }
 /*
@@ -1234,10 +1289,199 @@ td_is_fstyp(const char *slicenm, char *fs)
 	return (is_fstyp);
 }
 
+/*
+ * probe_ufs_superblock
+ * Read the primary superblock of a slice to decide whether it holds a
+ * UFS file system which can be mounted without fsck - the check
+ * 'fsck -m' does, without starting fsck.
+ *
+ * Input:
+ *	slicenm - disk slice in ctds format
+ *
+ * Return:	UFS_PROBE_CLEAN		clean, stable or logging UFS
+ *		UFS_PROBE_NOT_UFS	no UFS superblock
+ *		UFS_PROBE_UNKNOWN	superblock not readable, or needs
+ *					checking - run fsck -m to know
+ */
+static ufs_probe_t
+probe_ufs_superblock(const char *slicenm)
+{
+	int		sblock[SBSIZE/sizeof (int)];
+	struct fs	*fsp = (struct fs *)sblock;
+	char		devpath[MAXPATHLEN];
+	int		fd;
+
+	(void) snprintf(devpath, sizeof (devpath), "/dev/rdsk/%s", slicenm);
+	if ((fd = open(devpath, O_RDONLY | O_NDELAY)) < 0)
+		return (UFS_PROBE_UNKNOWN);
+
+	if (pread(fd, fsp, sizeof (sblock), SBOFF) != sizeof (sblock)) {
+		(void) close(fd);
+		return (UFS_PROBE_UNKNOWN);
+	}
+	(void) close(fd);
+
+	if (fsp->fs_magic != FS_MAGIC && fsp->fs_magic != MTB_UFS_MAGIC)
+		return (UFS_PROBE_NOT_UFS);
+
+	if ((fsp->fs_clean == FSCLEAN || fsp->fs_clean == FSSTABLE ||
+	    fsp->fs_clean == FSLOG) &&
+	    fsp->fs_state + (long)fsp->fs_time == FSOKAY)
+		return (UFS_PROBE_CLEAN);
+
+	return (UFS_PROBE_UNKNOWN);
+}
+
+/*
+ * probe_root_slice
+ * Mount a root slice candidate read-only on a temporary mount point of
+ * its own. A clean file system is mounted at once; fsck -m is run only
+ * when its superblock doesn't tell. Called from os probe threads.
+ *
+ * probe	- candidate; rootmntpnt is set to the mount point if the
+ *		slice was mounted, else left empty
+ */
+static void
+probe_root_slice(struct os_probe *probe)
+{
+	char templateroot[] = TEMPLATEROOT; /* for mkdtemp() */
+	hrtime_t start = gethrtime();
+	int ret = MNTRC_NO_MOUNT;
+
+	if (mkdtemp(templateroot) == NULL) {
+		td_debug_print(LS_DBGLVL_ERR,
+		    "cannot create mount point for %s errno=%d\n",
+		    probe->slicenm, errno);
+		probe->method = "no mount point";
+		return;
+	}
+
+	switch (probe_ufs_superblock(probe->slicenm)) {
+	case UFS_PROBE_CLEAN:
+		probe->method = "superblock";
+		ret = td_fsck_mount(templateroot, probe->slicenm, B_FALSE,
+		    NULL, "-r", "ufs", NULL);
+		break;
+	case UFS_PROBE_NOT_UFS:
+		probe->method = "not ufs";
+		break;
+	case UFS_PROBE_UNKNOWN:
+		/*
+		 * Check to see what type of filesystem the
+		 * device contains. The fsck and mount code only
+		 * applies to ufs filesystems
+		 */
+		probe->method = "fsck";
+		if (td_is_fstyp(probe->slicenm, "ufs"))
+			ret = td_fsck_mount(templateroot, probe->slicenm,
+			    B_TRUE, NULL, "-r", "ufs", NULL);
+		break;
+	}
+
+	if (ret == MNTRC_MOUNT_SUCCEEDS)
+		(void) strlcpy(probe->rootmntpnt, templateroot,
+		    sizeof (probe->rootmntpnt));
+	else
+		(void) rmdir(templateroot);
+	probe->probetime = gethrtime() - start;
+}
+
+/*
+ * os_probe_thread
+ * Probe root slice candidates taken from the pool until none is left
+ */
+static void *
+os_probe_thread(void *arg)
+{
+	struct os_probe_pool *pool = arg;
+	int i;
+
+	for (;;) {
+		(void) pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		(void) pthread_mutex_unlock(&pool->lock);
+		if (i >= pool->nprobes)
+			break;
+		if (!pool->probes[i].rootmounted)
+			probe_root_slice(&pool->probes[i]);
+	}
+	return (NULL);
+}
+
+/*
+ * probe_root_slices
+ * Probe all root slice candidates not mounted yet. Slices are probed
+ * by up to TD_PROBE_THREADS (default OS_PROBE_THREADS) threads, so
+ * fsck and mount of slices on different disks overlap. With
+ * TD_PROBE_THREADS=1 slices are probed one after the other.
+ */
+static void
+probe_root_slices(struct os_probe *probes, int nprobes)
+{
+	struct os_probe_pool pool;
+	pthread_t tids[OS_PROBE_THREADS_MAX];
+	int nthreads = OS_PROBE_THREADS;
+	int nunmounted = 0;
+	int started;
+	char *envp;
+	int i;
+
+	for (i = 0; i < nprobes; i++)
+		if (!probes[i].rootmounted)
+			nunmounted++;
+
+	if ((envp = getenv("TD_PROBE_THREADS")) != NULL)
+		nthreads = atoi(envp);
+	if (nthreads > OS_PROBE_THREADS_MAX)
+		nthreads = OS_PROBE_THREADS_MAX;
+	if (nthreads > nunmounted)
+		nthreads = nunmounted;
+
+	pool.probes = probes;
+	pool.nprobes = nprobes;
+	pool.next = 0;
+	(void) pthread_mutex_init(&pool.lock, NULL);
+
+	for (started = 0; started < nthreads - 1; started++) {
+		if (pthread_create(&tids[started], NULL, os_probe_thread,
+		    &pool) != 0) {
+			td_debug_print(LS_DBGLVL_WARN,
+			    "cannot start os probe thread errno=%d\n", errno);
+			break;
+		}
+	}
+	/* this thread helps too - and probes all if no thread started */
+	(void) os_probe_thread(&pool);
+	while (started > 0)
+		(void) pthread_join(tids[--started], NULL);
+	(void) pthread_mutex_destroy(&pool.lock);
+}
+
+/*
+ * release_probe
+ * unmount root of a probed slice and remove its temporary mount point
+ */
+static void
+release_probe(struct os_probe *probe)
+{
+	if (probe->rootmounted || probe->rootmntpnt[0] == '\0')
+		return;
+	if (umount2(probe->rootmntpnt, MS_FORCE) == 0)
+		(void) rmdir(probe->rootmntpnt);
+	else
+		td_debug_print(LS_DBGLVL_WARN, "cannot unmount %s errno=%d\n",
+		    probe->rootmntpnt, errno);
+	probe->rootmntpnt[0] = '\0';
+}
+
 /*
  * return an nvlist of information interesting to someone wanting Solaris
  * instances
  * - slice name
+ *
+ * Root slice candidates are first collected, then the ones not mounted
+ * are probed and mounted in parallel by probe_root_slices(), and finally
+ * each mounted root is examined in turn.
  */
 static td_errno_t
 os_discover(void)
@@ -1245,12 +1489,14 @@ os_discover(void)
 	ddm_handle_t *cslice;
 	FILE *mnttabfp; /* running system mnttab file pointer */
 	char *tmprootmntpnt = NULL;
-	char tmpvarmntpnt[] = TEMPLATEVAR;
 	char templateroot[] = TEMPLATEROOT; /* for mkdtemp() */
 	td_errno_t tderr = TD_E_SUCCESS; /* return status */
 	char *orootdir = strdup(td_get_rootdir());
 	char build_id[80];
 	FILE *localvfstabfp;
+	struct os_probe *probes = NULL;
+	int nprobes = 0;
+	int i;
 
 	/* set current swap file and device as exempt from later removal */
 	if ((localvfstabfp = fopen(VFSTAB, "r")) != NULL) {
@@ -1290,23 +1536,11 @@ os_discover(void)
 	/* seeking partition tag is root */
 	for (cslice = PDDMSLICES; *cslice != 0; cslice++) {
 		struct mnttab mpref, mnttab;
-		struct vfstab vref, vfstab;
+		struct os_probe *probe;
 		uint32_t partition_tag;
 		char *slicenm; /* name of slice */
 		char slicemp[MAXPATHLEN];
-		char *varslice = NULL; /* assume no separate var */
-		char vfstabname[MAXPATHLEN];
-		boolean_t varmounted = B_FALSE;
-		FILE *vfstabfp = NULL;
-		boolean_t rootmounted;
-		nvlist_t *nvl, *onvl, *svmnvl = NULL;
-		char release[32] = "";
-		char minor[32] = "";
-		char **znvl;
-		struct td_upgrade_fail_reasons fr;
-		int new_var_sadm;
-		int ret;
-		char *pclustertoc, *pcluster;
+		nvlist_t *nvl;
 
 		nvl = ddm_get_slice_attributes(*cslice);
 		if (nvl == NULL)
@@ -1334,22 +1568,25 @@ os_discover(void)
 			continue;
 		}
 
-		bzero(&fr, sizeof (fr)); /* clear upgrade fail reason codes */
-
-		/* is root slice mounted */
-		if (tmprootmntpnt == NULL) /* mount point for root */
-			tmprootmntpnt = mkdtemp(templateroot);
-		bzero(&mpref, sizeof (struct mnttab));
-		td_set_rootdir(tmprootmntpnt);
-		rootmounted = B_FALSE; /* assume not */
+		probe = realloc(probes, (nprobes + 1) * sizeof (*probes));
+		if (probe == NULL) {
+			td_debug_print(LS_DBGLVL_ERR,
+			    "os probe allocation failure\n");
+			tderr = TD_E_MEMORY;
+			break;
+		}
+		probes = probe;
+		probe = &probes[nprobes];
+		bzero(probe, sizeof (*probe));
+		probe->slicenm = slicenm;
+		probe->nvl = nvl;
+		probe->partition_tag = partition_tag;
 
 		/* get mount point from mnttab given slice name */
+		bzero(&mpref, sizeof (struct mnttab));
 		(void) snprintf(slicemp, sizeof (slicemp),
 		    "/dev/dsk/%s", slicenm);
 		mpref.mnt_special = slicemp;
-		if (TLI)
-			td_debug_print(LS_DBGLVL_INFO,
-			    "mounting %s %s \n", slicemp, tmprootmntpnt);
 		/* if slice already mounted */
 		resetmnttab(mnttabfp);
 		if (getmntany(mnttabfp, &mnttab, &mpref) == 0) {
@@ -1357,7 +1594,6 @@ os_discover(void)
 				td_debug_print(LS_DBGLVL_INFO,
 				    "slice %s busy, assumed mounted\n",
 				    slicenm);
-			rootmounted = B_TRUE;
 			/* assume already mounted - find mount point */
 			if (strcmp(mnttab.mnt_fstype, MNTTYPE_UFS) != 0) {
 				if (TLI)
@@ -1366,11 +1602,9 @@ os_discover(void)
 					    slicemp, mnttab.mnt_fstype);
 				continue;
 			}
-			td_set_rootdir(mnttab.mnt_mountp);
-			if (TLI)
-				td_debug_print(LS_DBGLVL_INFO,
-				    "getmntany rootdir=%s\n",
-				    td_get_rootdir());
+			probe->rootmounted = B_TRUE;
+			(void) strlcpy(probe->rootmntpnt, mnttab.mnt_mountp,
+			    sizeof (probe->rootmntpnt));
 			/* look for separate var in mnttab for the slice */
 			bzero(&mpref, sizeof (struct mnttab));
 			mpref.mnt_mountp = "/var";
@@ -1379,44 +1613,69 @@ os_discover(void)
 				if (TLI)
 					td_debug_print(LS_DBGLVL_INFO,
 					    "separate var already mounted\n");
-				varmounted = B_TRUE;
-			} else { /* var not mounted - find mntpnt in vfstab */
-				(void) strncpy(tmpvarmntpnt, tmprootmntpnt,
-				    sizeof (TEMPLATEVAR));
-				(void) strlcat(tmpvarmntpnt, "/var",
-				    sizeof (TEMPLATEVAR));
+				probe->varmounted = B_TRUE;
 			}
-			(void) strcpy(vfstabname, td_get_rootdir());
-			(void) strcat(vfstabname, VFSTAB);
-		} else {
-			/*
-			 * Check to see what type of filesystem the
-			 * device contains. The fsck and mount code only
-			 * applies to ufs filesystems
-			 */
+		}
+		nprobes++;
+	}
 
-			if (!td_is_fstyp(slicenm, "ufs"))
-				continue;
+	/* probe and mount the candidates not mounted yet, in parallel */
+	if (tderr == TD_E_SUCCESS)
+		probe_root_slices(probes, nprobes);
 
-			/* perform fsck and mount */
-			ret = td_fsck_mount(tmprootmntpnt, slicenm, B_TRUE,
-			    NULL, "-r", "ufs", &svmnvl);
-			if (ret != MNTRC_MOUNT_SUCCEEDS) {
-				continue;
-			}
+	for (i = 0; tderr == TD_E_SUCCESS && i < nprobes; i++) {
+		struct os_probe *probe = &probes[i];
+		struct vfstab vref, vfstab;
+		uint32_t partition_tag = probe->partition_tag;
+		char *slicenm = probe->slicenm; /* name of slice */
+		char *varslice = NULL; /* assume no separate var */
+		char tmpvarmntpnt[MAXPATHLEN];
+		char vfstabname[MAXPATHLEN];
+		FILE *vfstabfp = NULL;
+		nvlist_t *nvl = probe->nvl, *onvl;
+		char release[32] = "";
+		char minor[32] = "";
+		char **znvl;
+		struct td_upgrade_fail_reasons fr;
+		int new_var_sadm;
+		int ret;
+		char *pclustertoc, *pcluster;
+		hrtime_t start;
+
+		if (probe->rootmntpnt[0] == '\0') {
+			td_debug_print(LS_DBGLVL_INFO,
+			    "slice %s not mounted (%s) in %lld ms\n", slicenm,
+			    probe->method,
+			    probe->probetime / (NANOSEC / MILLISEC));
+			continue;
+		}
+		start = gethrtime();
 
-			/* read vfstab from mounted slice */
-			(void) strncpy(tmpvarmntpnt, tmprootmntpnt,
-			    sizeof (TEMPLATEVAR));
-			(void) strlcat(tmpvarmntpnt, "/var",
-			    sizeof (TEMPLATEVAR));
-			/* use vfstab from mounted root slice */
-			(void) snprintf(vfstabname, sizeof (vfstabname),
-			    "%s%s", tmprootmntpnt, VFSTAB);
+		bzero(&fr, sizeof (fr)); /* clear upgrade fail reason codes */
+		td_set_rootdir(probe->rootmntpnt);
+		if (probe->rootmounted) {
+			if (TLI)
+				td_debug_print(LS_DBGLVL_INFO,
+				    "getmntany rootdir=%s\n",
+				    td_get_rootdir());
+			/* a separate var is mounted on a temporary point */
+			if (tmprootmntpnt == NULL) /* mount point for var */
+				tmprootmntpnt = mkdtemp(templateroot);
+			if (tmprootmntpnt != NULL)
+				(void) snprintf(tmpvarmntpnt,
+				    sizeof (tmpvarmntpnt), "%s/var",
+				    tmprootmntpnt);
+			else	/* never fall back on the live /var */
+				tmpvarmntpnt[0] = '\0';
+		} else {
+			(void) snprintf(tmpvarmntpnt, sizeof (tmpvarmntpnt),
+			    "%s/var", probe->rootmntpnt);
 		}
+		/* use vfstab from mounted root slice */
+		(void) snprintf(vfstabname, sizeof (vfstabname),
+		    "%s%s", td_get_rootdir(), VFSTAB);
 		if (TLI)
 			td_debug_cat_file(LS_DBGLVL_INFO, vfstabname);
-
 		/* open vfstab on root */
 		vfstabfp = fopen(vfstabname, "r");
 		if (vfstabfp == NULL) {
@@ -1430,7 +1689,7 @@ os_discover(void)
 			if (partition_tag != V_ROOT)
 				goto umount;
 		}
-		if (!varmounted && vfstabfp != NULL) {
+		if (!probe->varmounted && vfstabfp != NULL) {
 			char *varfsck = NULL;
 
 			if (TLI)
@@ -1443,6 +1702,16 @@ os_discover(void)
 				varslice = vfstab.vfs_special;
 				varfsck = vfstab.vfs_fsckdev;
 			}
+			/* a separate var needs a temporary mount point */
+			if (varslice != NULL && tmpvarmntpnt[0] == '\0') {
+				td_debug_print(LS_DBGLVL_WARN,
+				    "No temporary mount point for var %s\n",
+				    varslice);
+				varslice = NULL;
+				if (partition_tag != V_ROOT)
+					goto umount;
+				fr.var_not_mountable = 1;
+			}
 			/* if var on separate volume, attempt to mnt, dismnt */
 			if (varslice != NULL) {
 				/* cNtNdN version of slice name */
@@ -1697,21 +1966,23 @@ umount:		/* if we goto to this label, no Solaris instance */
 			(void) fclose(vfstabfp);
 		if (TLI)
 			td_debug_print(LS_DBGLVL_INFO,
-			    "umount current root %s\n", rootmounted ?
+			    "umount current root %s\n", probe->rootmounted ?
 			    "YES": "NO");
 		/* unmount var if on separate slice */
 		if (varslice != NULL)
 			(void) umount2(tmpvarmntpnt, MS_FORCE);
-		/* unmount current root, var at temporary mount points */
-		if (!rootmounted && umount2(tmprootmntpnt, MS_FORCE) != 0) {
-			/* unmount failed - use new temp mount point */
-			(void) strncpy(templateroot, TEMPLATEROOT,
-			    sizeof (templateroot));
-			tmprootmntpnt = NULL;
-		}
-		if (tderr != TD_E_SUCCESS)
-			break;
+		/* unmount current root at temporary mount point */
+		release_probe(probe);
+		td_debug_print(LS_DBGLVL_INFO,
+		    "slice %s mounted (%s) in %lld ms, examined in %lld ms\n",
+		    slicenm, probe->rootmounted ? "already" : probe->method,
+		    probe->probetime / (NANOSEC / MILLISEC),
+		    (gethrtime() - start) / (NANOSEC / MILLISEC));
 	} /* next slice */
+	/* unmount the roots not examined after an error */
+	for (; i < nprobes; i++)
+		release_probe(&probes[i]);
+	free(probes);
 	td_be_list(); /* discover all Snap Boot Environments */
 	if (tderr == TD_E_SUCCESS)
 		sort_objs(TD_OT_OS);
@@ -2073,9 +2344,11 @@ free_td_obj_list(td_object_type_t ot)
 
 	if (pobl->objarr != NULL) {
 		/* release attribute data */
-		for (pobj = pobl->objarr; pobj->handle != 0; pobj++)
+		for (pobj = pobl->objarr; pobj->handle != 0; pobj++) {
 			if (pobj->attrib != NULL)
 				nvlist_free(pobj->attrib);
+			free(pobj->vkey);
+		}
 		/* release object instance list */
 		free(pobl->objarr);
 		pobl->objarr = NULL;
@@ -2241,6 +2514,10 @@ disk_random_slice(nvlist_t *pattrib)
 	return (search_disks_for_slices(pslicepar));
 }
 
+/*
+ * OS instances are sorted by version, then by slice name.  Instances
+ * without a version come last.
+ */
 static int
 compare_os_objs(const void *p1, const void *p2)
 {
@@ -2248,6 +2525,14 @@ compare_os_objs(const void *p1, const void *p2)
 	struct td_obj *o1 = (struct td_obj *)p1;
 	struct td_obj *o2 = (struct td_obj *)p2;
 	char *pd1 = NULL, *pd2 = NULL;
+	int ret;
+
+	if (o1->vkey == NULL || o2->vkey == NULL) {
+		if (o1->vkey != o2->vkey)
+			return (o1->vkey == NULL ? 1 : -1);
+	} else if ((ret = td_prod_vkey_order(o1->vkey, o2->vkey)) != 0) {
+		return (ret);
+	}
 
 	if (o1->attrib != NULL)
 		nvlist_lookup_string(o1->attrib, TD_OS_ATTR_SLICE_NAME, &pd1);
@@ -25,8 +25,10 @@
 
 #include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <libintl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,6 +36,8 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/mntent.h>
+#include <sys/mnttab.h>
+#include <sys/mount.h>
 #include <sys/wait.h>
 #include <sys/swap.h>
 
@@ -57,14 +61,40 @@ struct mountentry {
 	int	op_type;	/* MOUNT_DEV, SWAP_DEV */
 	int	errcode;
 	char	*mntdev;
+	char	*fsckdev;	/* device to check before mounting, or NULL */
 	char	*emnt;
 	char	*mntpnt;
 	char	*fstype;
 	char	*options;
+	struct mountentry *parent;	/* entry mounted above in a tree */
+	int	pending;	/* children not unmounted yet */
 };
 
 static struct mountentry *retry_list = NULL;
 
+/*
+ * File systems mounted or unmounted together by run_mount_tree(). The
+ * mount points form a tree; entries in separate subtrees are handled in
+ * parallel.
+ */
+#define	MOUNT_THREADS	8	/* most threads handling a tree */
+#define	MOUNT_TREE_DOWN	0	/* mount: parents before children */
+#define	MOUNT_TREE_UP	1	/* unmount: children before parents */
+
+struct mounttree {
+	struct mountentry **entries;	/* all entries */
+	int	nentries;
+	struct mountentry **ready;	/* stack of entries ready to handle */
+	int	nready;
+	int	remaining;		/* entries not handled yet */
+	int	order;			/* MOUNT_TREE_DOWN or MOUNT_TREE_UP */
+	int	(*op)(struct mountentry *);
+	int	status;			/* first error returned by op */
+	struct mountentry *failed;	/* entry op failed for */
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+};
+
 struct stringlist {
 	struct stringlist *next;
 	int   command_type;	/* MOUNT_DEV, SWAP_DEV */
@@ -73,12 +103,18 @@ struct stringlist {
 
 /* Local Globals */
 
-static struct stringlist *umount_head = NULL;
+static struct mountentry *mounted_list = NULL;
 static struct stringlist *unswap_head = NULL;
 
+/* protects mounted_list and retry_list while mounting in parallel */
+static pthread_mutex_t mount_lock = PTHREAD_MUTEX_INITIALIZER;
+
 #define	NO_RETRY	0
 #define	DO_RETRIES	1
 
+/* mount_filesys(): mount failed, file system queued to the retry list */
+#define	MOUNT_QUEUED	(-1)
+
 static char	*rootmntdev;
 static char	*rootrawdev;
 static char	rootpartition[2];
@@ -95,11 +131,23 @@ char		*td_get_failed_mntdev(void);
 /* private prototypes */
 
 static void	save_for_umount(char *, struct stringlist **, int);
+static void	save_mounted(char *, char *);
 static int	add_swap_dev(char *);
 static void	free_retry_list(void);
 static void	free_mountentry(struct mountentry *);
+static void	free_mount_list(struct mountentry *);
 static void	save_for_swap_retry(char *, char *);
 static void	save_for_mnt_retry(char *, char *, char *, char *);
+static void	queue_mount(struct mountentry **, char *, char *, char *,
+		    char *, char *);
+static int	mount_filesys(char *, char *, char *, char *, char *, int);
+static int	mount_fs(char *, char *, char *, char *, int);
+static int	mount_tree_entry(struct mountentry *);
+static int	umount_tree_entry(struct mountentry *);
+static int	run_mount_tree(struct mountentry *, int,
+		    int (*)(struct mountentry *), struct mountentry **);
+static void	*mount_tree_thread(void *);
+static boolean_t mount_below(const char *, const char *, boolean_t);
 
 /* ******************************************************************** */
 /*			PUBLIC SUPPORT FUNCTIONS			*/
@@ -200,13 +248,13 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 	char	*mntdev = NULL;
 	char	*fsckdev, *mntpnt;
 	char	*fstype, *fsckpass, *automnt, *mntopts;
-	char	pathbuf[MAXPATHLEN];
 	int	status;
 	char	*cp, *str1;
 	char	emnt[MAXPATHLEN], efsckd[50];
 	char	options[MAXPATHLEN];
 	int	all_have_failed;
 	struct mountentry	*mntp, **mntpp;
+	struct mountentry	*mounts = NULL;	/* file systems to mount */
 
 	free_retry_list();
 
@@ -259,6 +307,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 		    mntopts == NULL) {
 			(void) fclose(fp);
 			free(mntdev);
+			free_mount_list(mounts);
 			if (TLW)
 				td_debug_print(LS_DBGLVL_WARN,
 				    "Error parsing vfstab\n");
@@ -277,6 +326,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 						    mntdev);
 					(void) fclose(fp);
 					free(mntdev);
+					free_mount_list(mounts);
 					return (ERR_MOUNT_FAIL);
 				} else {
 					if (*td_get_rootdir() == '\0')
@@ -306,6 +356,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 
 						(void) fclose(fp);
 						free(mntdev);
+						free_mount_list(mounts);
 						return (ERR_MOUNT_FAIL);
 					}
 				}
@@ -313,6 +364,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 			if ((status = add_swap_dev(emnt)) != 0) {
 				(void) fclose(fp);
 				free(mntdev);
+				free_mount_list(mounts);
 				return (status);
 			}
 			err_mount_dev[0] = '\0';
@@ -368,6 +420,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 					    mntdev);
 				(void) fclose(fp);
 				free(mntdev);
+				free_mount_list(mounts);
 				return (ERR_MOUNT_FAIL);
 			}
 
@@ -379,12 +432,8 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 				(void) strncat(emnt, ":boot", sizeof (emnt) - 1);
 			}
 
-			if ((status = td_mount_filesys(emnt, NULL,
-			    mntpnt, fstype, mntopts, DO_RETRIES, NULL)) != 0) {
-				(void) fclose(fp);
-				free(mntdev);
-				return (status);
-			}
+			queue_mount(&mounts, emnt, NULL, mntpnt,
+			    fstype, mntopts);
 		}
 
 		/* skip non-auto-mounted devices */
@@ -406,6 +455,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 					    mntdev);
 				(void) fclose(fp);
 				free(mntdev);
+				free_mount_list(mounts);
 				return (ERR_MOUNT_FAIL);
 			}
 			if (td_map_to_effective_dev(fsckdev,
@@ -417,23 +467,16 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 					    fsckdev);
 				(void) fclose(fp);
 				free(mntdev);
+				free_mount_list(mounts);
 				return (ERR_MOUNT_FAIL);
 			}
-			if ((status = td_mount_filesys(emnt, efsckd, mntpnt,
-			    fstype, mntopts, DO_RETRIES, NULL)) != 0) {
-				(void) fclose(fp);
-				free(mntdev);
-				return (status);
-			}
+			queue_mount(&mounts, emnt, efsckd, mntpnt,
+			    fstype, mntopts);
 
 		/* mount VXFS volumes */
 		} else if (streq(fstype, "vxfs")) {
-			if ((status = td_mount_filesys(mntdev, fsckdev, mntpnt,
-			    fstype, mntopts, DO_RETRIES, NULL)) != 0) {
-				(void) fclose(fp);
-				free(mntdev);
-				return (status);
-			}
+			queue_mount(&mounts, mntdev, fsckdev, mntpnt,
+			    fstype, mntopts);
 		}
 	}
 	if (mntdev)
@@ -443,6 +486,19 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 
 	(void) fclose(fp);
 
+	/*
+	 * Mount the file systems, several at a time. A file system is
+	 * mounted once the one holding its mount point is. Those failing
+	 * to mount are queued to the retry list.
+	 */
+	if ((status = run_mount_tree(mounts, MOUNT_TREE_DOWN,
+	    mount_tree_entry, &mntp)) != 0) {
+		(void) strcpy(err_mount_dev, mntp->mntdev);
+		free_mount_list(mounts);
+		return (status);
+	}
+	free_mount_list(mounts);
+
 	/*
 	 *  Process retry list.  Continue to process it until all operations
 	 *  on list have been tried and have failed.
@@ -482,15 +538,12 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 					mntpp = &(mntp->next);
 			} else {   /* it's a mount request */
 				(void) strcpy(err_mount_dev, mntp->mntdev);
-				(void) snprintf(pathbuf, MAXPATHLEN,
-				    "/sbin/mount -F %s %s %s %s",
-				    mntp->fstype, mntp->options, mntp->mntdev,
-				    mntp->mntpnt);
-				if ((status = td_safe_system(pathbuf,
-				    B_TRUE)) == 0) {
+				if ((status = mount_fs(mntp->mntdev,
+				    mntp->mntpnt, mntp->fstype, mntp->options,
+				    0)) == 0) {
 					err_mount_dev[0] = 0;
-					save_for_umount(mntp->mntdev,
-					    &umount_head, MOUNT_DEV);
+					save_mounted(mntp->mntdev,
+					    mntp->mntpnt);
 					all_have_failed = 0;
 
 					/* unlink and retry entry */
@@ -498,7 +551,7 @@ td_mount_and_add_swap_from_vfstab(char *vfstab_path)
 					free_mountentry(mntp);
 					mntp = NULL;
 				} else {
-					mntp->errcode = WEXITSTATUS(status);
+					mntp->errcode = status;
 					mntpp = &(mntp->next);
 				}
 			}
@@ -541,23 +594,12 @@ int
 td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 	char *fstype, char *mntopts, int retry, nvlist_t **attr)
 {
-	char			options[MAXPATHLEN];
-	char			fsckoptions[30];
-	char			cmd[MAXPATHLEN];
 	char			basemount[MAXPATHLEN];
 	int			status;
-	int			cmdstatus;
 	int			isslasha = 0;
 
 	(void) strcpy(err_mount_dev, mntdev);
 
-	if (strcmp(mntopts, "-") == 0)
-		options[0] = '\0';
-	else {
-		(void) strcpy(options, "-o ");
-		(void) strcat(options, mntopts);
-	}
-
 	if (*td_get_rootdir() == '\0') {
 		(void) strcpy(basemount, mntpnt);
 	} else {
@@ -569,6 +611,61 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 
 	}
 
+	status = mount_filesys(mntdev, fsckdev, basemount, fstype, mntopts,
+	    retry);
+	if (status == MOUNT_QUEUED) {
+		err_mount_dev[0] = 0;
+		return (0);
+	}
+	if (status != 0)
+		return (status);
+
+	/*
+	 * We are dealing with / here so mount it rw
+	 */
+	if (isslasha) {
+		if ((status = mount_fs(mntdev, basemount, fstype, "rw",
+		    MS_REMOUNT)) != 0) {
+			td_debug_print(LS_DBGLVL_WARN,
+			    "Failure remounting %s on %s, "
+			    "error = %d\n",
+			    mntdev, basemount, status);
+
+			return (ERR_MOUNT_FAIL);
+		}
+		free(rootmntdev);
+		rootmntdev = strdup(mntdev);
+	}
+	err_mount_dev[0] = 0;
+	return (0);
+}
+
+/*
+ * mount_filesys()
+ *	Check a file system with fsck -m, and mount it. Safe to call from
+ *	several threads at once.
+ * Parameters:
+ *	mntdev	- device to mount
+ *	fsckdev	- device to check, NULL not to check
+ *	basemount - mount point, with the root directory
+ *	fstype	- file system type
+ *	mntopts	- mount options, "-" for none
+ *	retry	- DO_RETRIES to queue the file system to the retry list
+ *		  if mounting fails, else NO_RETRY
+ * Return:
+ *	0 on success, MOUNT_QUEUED when queued for retry, else ERR_* code
+ * Status:
+ *	private
+ */
+static int
+mount_filesys(char *mntdev, char *fsckdev, char *basemount, char *fstype,
+    char *mntopts, int retry)
+{
+	char			fsckoptions[30];
+	char			cmd[MAXPATHLEN];
+	int			status;
+	int			cmdstatus;
+
 	/*
 	 * fsck -m checks to see if file system
 	 * needs checking.
@@ -603,23 +700,19 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 		    "before mount, cmdstatus=%d\n", cmdstatus);
 
 	if (cmdstatus == 0) {
-		(void) snprintf(cmd, MAXPATHLEN,
-		    "/sbin/mount -F %s %s %s %s",
-		    fstype, options, mntdev, basemount);
-		if ((status = td_safe_system(cmd, B_TRUE)) != 0) {
+		if ((status = mount_fs(mntdev, basemount, fstype, mntopts,
+		    0)) != 0) {
 			if (retry == NO_RETRY) {
 				if (TLW)
 					td_debug_print(LS_DBGLVL_WARN,
-					    "Failure mounting %s, "
-					    "error=%d <%s>\n",
-					    basemount, WEXITSTATUS(status),
-					    cmd);
+					    "Failure mounting %s on %s, "
+					    "error=%d\n",
+					    mntdev, basemount, status);
 				return (ERR_MOUNT_FAIL);
 			} else {
-				save_for_mnt_retry(basemount, fstype, options,
+				save_for_mnt_retry(basemount, fstype, mntopts,
 				    mntdev);
-				err_mount_dev[0] = 0;
-				return (0);
+				return (MOUNT_QUEUED);
 			}
 		}
 	} else if (cmdstatus == 32 || cmdstatus == 33 || cmdstatus == 34) {
@@ -689,7 +782,7 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 			if (TLW)
 				td_debug_print(LS_DBGLVL_WARN,
 				    "The %s file system (%s) is being "
-				    "checked.\n", mntpnt, fstype);
+				    "checked.\n", basemount, fstype);
 			(void) snprintf(cmd, MAXPATHLEN,
 			    "/usr/sbin/fsck -F %s %s %s",
 			    fstype, fsckoptions, fsckdev);
@@ -700,7 +793,7 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 					/* CSTYLE */
 					td_debug_print(LS_DBGLVL_WARN,
 					    "ERROR: unable to repair the "
-					    "%s file system.\n", mntpnt);
+					    "%s file system.\n", basemount);
 					/* CSTYLE */
 					td_debug_print(LS_DBGLVL_WARN,
 					    "Run fsck manually "
@@ -710,22 +803,19 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 				return (ERR_MUST_MANUAL_FSCK);
 			}
 		}
-		(void) snprintf(cmd, MAXPATHLEN,
-		    "/sbin/mount -F %s %s %s %s",
-		    fstype, options, mntdev, basemount);
-		if ((status = td_safe_system(cmd, B_TRUE)) != 0) {
+		if ((status = mount_fs(mntdev, basemount, fstype, mntopts,
+		    0)) != 0) {
 			if (retry == NO_RETRY) {
 				if (TLW)
 					td_debug_print(LS_DBGLVL_WARN,
 					    "Failure mounting %s, "
 					    "error = %d\n",
-					    basemount, WEXITSTATUS(status));
+					    basemount, status);
 				return (ERR_MOUNT_FAIL);
 			} else {
-				save_for_mnt_retry(basemount, fstype, options,
+				save_for_mnt_retry(basemount, fstype, mntopts,
 				    mntdev);
-				err_mount_dev[0] = 0;
-				return (0);
+				return (MOUNT_QUEUED);
 			}
 		}
 	} else {
@@ -737,33 +827,15 @@ td_mount_filesys(char *mntdev, char *fsckdev, char *mntpnt,
 		return (ERR_FSCK_FAILURE);
 	}
 
-	/*
-	 * We are dealing with / here so mount it rw
-	 */
-	if (isslasha) {
-		(void) snprintf(cmd, MAXPATHLEN,
-		    "/sbin/mount -o remount,rw %s %s",
-		    mntdev, basemount);
-		if ((status = td_safe_system(cmd, B_TRUE)) != 0) {
-			td_debug_print(LS_DBGLVL_WARN,
-			    "Failure remounting %s on %s, "
-			    "error = %d\n",
-			    mntdev, basemount, WEXITSTATUS(status));
-
-			return (ERR_MOUNT_FAIL);
-		}
-		free(rootmntdev);
-		rootmntdev = strdup(mntdev);
-	}
-	err_mount_dev[0] = 0;
-	save_for_umount(mntdev, &umount_head, MOUNT_DEV);
+	save_mounted(mntdev, basemount);
 	return (0);
 }
 
 /*
  * td_umount_all()
  * Description:
- *	Attempt to unmount all mounted filesystems.
+ *	Attempt to unmount all mounted filesystems. File systems are
+ *	unmounted after the ones mounted below them, several at a time.
  * Parameters:
  *	none
  * Return:
@@ -776,6 +848,7 @@ int
 td_umount_all(void)
 {
 	struct stringlist	*p, *op;
+	struct mountentry	*mntp;
 	char			cmd[MAXPATHLEN];
 	int			err = 0;
 
@@ -786,25 +859,16 @@ td_umount_all(void)
 		return (FAILURE);
 	}
 
-	p = umount_head;
-	while (p) {
-		if (p->command_type == MOUNT_DEV) {
-			(void) snprintf(cmd, MAXPATHLEN,
-			    "/sbin/umount %s", p->stringptr);
-			/*
-			 * Keep track of failures
-			 */
-			if (td_safe_system(cmd, B_TRUE) != 0) {
-				err++;
-				td_debug_print(LS_DBGLVL_ERR,
-				    "umount of %s failed", p->stringptr);
-			}
-		}
-		op = p;
-		p = p->next;
-		free(op);
-	}
-	umount_head = NULL;
+	(void) run_mount_tree(mounted_list, MOUNT_TREE_UP, umount_tree_entry,
+	    NULL);
+	/*
+	 * Keep track of failures
+	 */
+	for (mntp = mounted_list; mntp != NULL; mntp = mntp->next)
+		if (mntp->errcode != 0)
+			err++;
+	free_mount_list(mounted_list);
+	mounted_list = NULL;
 
 	p = unswap_head;
 	while (p) {
@@ -1010,6 +1074,33 @@ add_swap_dev(char *mntdev)
 	return (0);
 }
 
+/*
+ * save_mounted()
+ *	Remember a mounted file system for td_umount_all()
+ * Parameters:
+ *	mntdev	- device mounted
+ *	mntpnt	- where
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+save_mounted(char *mntdev, char *mntpnt)
+{
+	struct mountentry	*m;
+
+	m = calloc(1, sizeof (struct mountentry));
+	m->op_type = MOUNT_DEV;
+	m->mntdev = strdup(mntdev);
+	m->mntpnt = strdup(mntpnt);
+
+	(void) pthread_mutex_lock(&mount_lock);
+	m->next = mounted_list;
+	mounted_list = m;
+	(void) pthread_mutex_unlock(&mount_lock);
+}
+
 static void
 save_for_swap_retry(char *emnt, char *mntdev)
 {
@@ -1046,6 +1137,7 @@ save_for_mnt_retry(char *basemount, char *fstype, char *options, char *mntdev)
 	m->next = NULL;
 
 	/* queue it to the retry list */
+	(void) pthread_mutex_lock(&mount_lock);
 	if (retry_list == NULL)
 		retry_list = m;
 	else {
@@ -1054,6 +1146,7 @@ save_for_mnt_retry(char *basemount, char *fstype, char *options, char *mntdev)
 			p = p->next;
 		p->next = m;
 	}
+	(void) pthread_mutex_unlock(&mount_lock);
 }
 
 static void
@@ -1075,6 +1168,8 @@ free_mountentry(struct mountentry *mntp)
 {
 	if (mntp->mntdev)
 		free(mntp->mntdev);
+	if (mntp->fsckdev)
+		free(mntp->fsckdev);
 	if (mntp->emnt)
 		free(mntp->emnt);
 	if (mntp->mntpnt)
@@ -1086,6 +1181,355 @@ free_mountentry(struct mountentry *mntp)
 	free(mntp);
 }
 
+static void
+free_mount_list(struct mountentry *list)
+{
+	struct mountentry *next;
+
+	while (list != NULL) {
+		next = list->next;
+		free_mountentry(list);
+		list = next;
+	}
+}
+
+/*
+ * queue_mount()
+ *	Add a file system from vfstab to the list of file systems to mount
+ * Parameters:
+ *	head	- list, in vfstab order
+ *	mntdev	- device to mount
+ *	fsckdev	- device to check, NULL not to check
+ *	mntpnt	- mount point, relative to the root directory
+ *	fstype	- file system type
+ *	mntopts	- mount options, "-" for none
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+queue_mount(struct mountentry **head, char *mntdev, char *fsckdev,
+    char *mntpnt, char *fstype, char *mntopts)
+{
+	struct mountentry	*m, **pp;
+	char			basemount[MAXPATHLEN];
+
+	(void) snprintf(basemount, sizeof (basemount), "%s%s",
+	    td_get_rootdir(), mntpnt);
+
+	if ((m = calloc(1, sizeof (struct mountentry))) == NULL) {
+		td_debug_print(LS_DBGLVL_ERR,
+		    "no memory to mount %s\n", basemount);
+		return;
+	}
+	m->op_type = MOUNT_DEV;
+	m->mntdev = strdup(mntdev);
+	m->fsckdev = (fsckdev != NULL) ? strdup(fsckdev) : NULL;
+	m->mntpnt = strdup(basemount);
+	m->fstype = strdup(fstype);
+	m->options = strdup(mntopts);
+
+	for (pp = head; *pp != NULL; pp = &(*pp)->next)
+		;
+	*pp = m;
+}
+
+/*
+ * mount_fs()
+ *	Mount a file system. UFS and PCFS, whose options the kernel
+ *	parses, are mounted with mount(2); others with mount(1M).
+ * Parameters:
+ *	mntdev	- device to mount
+ *	mntpnt	- mount point
+ *	fstype	- file system type
+ *	mntopts	- mount options, "-" for none
+ *	mflag	- MS_REMOUNT to change the options of a mounted file
+ *		  system, else 0
+ * Return:
+ *	0 on success, else errno of mount(2) or exit status of mount(1M)
+ * Status:
+ *	private
+ */
+static int
+mount_fs(char *mntdev, char *mntpnt, char *fstype, char *mntopts, int mflag)
+{
+	char		optbuf[MAX_MNTOPT_STR];
+	char		cmd[MAXPATHLEN];
+	struct mnttab	mnt;
+	int		status;
+
+	if (strcmp(mntopts, "-") == 0)
+		optbuf[0] = '\0';
+	else
+		(void) strlcpy(optbuf, mntopts, sizeof (optbuf));
+
+	if (!streq(fstype, "ufs") && !streq(fstype, "pcfs")) {
+		(void) snprintf(cmd, sizeof (cmd),
+		    "/sbin/mount -F %s %s%s %s %s", fstype,
+		    optbuf[0] != '\0' ? "-o " : "", optbuf, mntdev, mntpnt);
+		if ((status = td_safe_system(cmd, B_TRUE)) == 0)
+			return (0);
+		if (status == -1 || WEXITSTATUS(status) == 0)
+			return (ERR_MOUNT_FAIL);
+		return (WEXITSTATUS(status));
+	}
+
+	bzero(&mnt, sizeof (mnt));
+	mnt.mnt_mntopts = optbuf;
+	if (hasmntopt(&mnt, MNTOPT_RO) != NULL)
+		mflag |= MS_RDONLY;
+
+	td_debug_print(LS_DBGLVL_INFO, "td mount: -F %s -o %s %s %s\n",
+	    fstype, optbuf, mntdev, mntpnt);
+	if (mount(mntdev, mntpnt, mflag | MS_OPTIONSTR, fstype, NULL, 0,
+	    optbuf, sizeof (optbuf)) != 0)
+		return (errno);
+	return (0);
+}
+
+/*
+ * mount_tree_entry()
+ *	run_mount_tree() operation mounting a file system from vfstab.
+ *	A file system whose parent failed to mount has no mount point yet,
+ *	so it goes to the retry list at once.
+ * Parameters:
+ *	mntp	- file system; errcode is set if it was not mounted
+ * Return:
+ *	0, or ERR_* code of an error which ends the mounting
+ * Status:
+ *	private
+ */
+static int
+mount_tree_entry(struct mountentry *mntp)
+{
+	int	status;
+
+	if (mntp->parent != NULL && mntp->parent->errcode != 0) {
+		save_for_mnt_retry(mntp->mntpnt, mntp->fstype, mntp->options,
+		    mntp->mntdev);
+		mntp->errcode = ERR_MOUNT_FAIL;
+		return (0);
+	}
+
+	status = mount_filesys(mntp->mntdev, mntp->fsckdev, mntp->mntpnt,
+	    mntp->fstype, mntp->options, DO_RETRIES);
+	if (status == MOUNT_QUEUED) {
+		mntp->errcode = ERR_MOUNT_FAIL;
+		return (0);
+	}
+	mntp->errcode = status;
+	return (status);
+}
+
+/*
+ * umount_tree_entry()
+ *	run_mount_tree() operation unmounting a file system
+ * Parameters:
+ *	mntp	- file system; errcode is set if it was not unmounted
+ * Return:
+ *	0, to go on with the others
+ * Status:
+ *	private
+ */
+static int
+umount_tree_entry(struct mountentry *mntp)
+{
+	td_debug_print(LS_DBGLVL_INFO, "td umount: %s\n", mntp->mntpnt);
+	if (umount2(mntp->mntpnt, 0) != 0) {
+		mntp->errcode = errno;
+		td_debug_print(LS_DBGLVL_ERR, "umount of %s failed errno=%d\n",
+		    mntp->mntdev, mntp->errcode);
+	}
+	return (0);
+}
+
+/*
+ * mount_below()
+ *	Tell whether mount point path is below mount point dir
+ * Parameters:
+ *	path, dir	- mount points
+ *	same_ok		- B_TRUE if path being dir counts as below
+ * Return:
+ *	B_TRUE or B_FALSE
+ * Status:
+ *	private
+ */
+static boolean_t
+mount_below(const char *path, const char *dir, boolean_t same_ok)
+{
+	size_t	len = strlen(dir);
+
+	if (strncmp(path, dir, len) != 0)
+		return (B_FALSE);
+	if (path[len] == '\0')
+		return (same_ok);
+	return (path[len] == '/' || (len > 0 && dir[len - 1] == '/'));
+}
+
+/*
+ * mount_tree_thread()
+ *	Handle entries of a mount tree as they become ready, until all
+ *	are handled or an operation fails
+ * Parameters:
+ *	arg	- struct mounttree
+ * Return:
+ *	NULL
+ * Status:
+ *	private
+ */
+static void *
+mount_tree_thread(void *arg)
+{
+	struct mounttree	*mt = arg;
+	struct mountentry	*mntp;
+	int			status;
+	int			i;
+
+	(void) pthread_mutex_lock(&mt->lock);
+	for (;;) {
+		while (mt->nready == 0 && mt->remaining > 0 && mt->status == 0)
+			(void) pthread_cond_wait(&mt->cv, &mt->lock);
+		if (mt->nready == 0 || mt->status != 0)
+			break;
+
+		mntp = mt->ready[--mt->nready];
+		(void) pthread_mutex_unlock(&mt->lock);
+		status = mt->op(mntp);
+		(void) pthread_mutex_lock(&mt->lock);
+
+		mt->remaining--;
+		if (status != 0 && mt->status == 0) {
+			mt->status = status;
+			mt->failed = mntp;
+		}
+		/* release the entries which waited for this one */
+		if (mt->order == MOUNT_TREE_DOWN) {
+			for (i = 0; i < mt->nentries; i++)
+				if (mt->entries[i]->parent == mntp)
+					mt->ready[mt->nready++] =
+					    mt->entries[i];
+		} else if (mntp->parent != NULL &&
+		    --mntp->parent->pending == 0) {
+			mt->ready[mt->nready++] = mntp->parent;
+		}
+		(void) pthread_cond_broadcast(&mt->cv);
+	}
+	(void) pthread_cond_broadcast(&mt->cv);
+	(void) pthread_mutex_unlock(&mt->lock);
+	return (NULL);
+}
+
+/*
+ * run_mount_tree()
+ *	Apply an operation to a list of file systems, several at a time.
+ *	A file system whose mount point is below the mount point of
+ *	another one is its child. When mounting, a file system is handled
+ *	after its parent; when unmounting, after all its children. File
+ *	systems in separate subtrees are handled by up to MOUNT_THREADS
+ *	threads in parallel.
+ * Parameters:
+ *	list	- file systems, mntpnt being the full mount point
+ *	order	- MOUNT_TREE_DOWN or MOUNT_TREE_UP
+ *	op	- operation; a non-zero return stops handing out entries
+ *	failedp	- if not NULL, set to the entry op failed for
+ * Return:
+ *	0, or the first non-zero value returned by op
+ * Status:
+ *	private
+ */
+static int
+run_mount_tree(struct mountentry *list, int order,
+    int (*op)(struct mountentry *), struct mountentry **failedp)
+{
+	struct mounttree	mt;
+	struct mountentry	*mntp, *q;
+	pthread_t		tids[MOUNT_THREADS];
+	int			nthreads, started;
+	int			n = 0;
+	int			i, j;
+
+	for (mntp = list; mntp != NULL; mntp = mntp->next)
+		n++;
+	if (n == 0)
+		return (0);
+
+	bzero(&mt, sizeof (mt));
+	mt.entries = malloc(n * sizeof (*mt.entries));
+	mt.ready = malloc(n * sizeof (*mt.ready));
+	if (mt.entries == NULL || mt.ready == NULL) {
+		free(mt.entries);
+		free(mt.ready);
+		/*
+		 * Handle them one at a time, in list order: vfstab order
+		 * for mounting, most recent first for unmounting.
+		 */
+		for (mntp = list; mntp != NULL; mntp = mntp->next) {
+			mntp->parent = NULL;
+			if ((mt.status = op(mntp)) != 0)
+				break;
+		}
+		if (failedp != NULL)
+			*failedp = mntp;
+		return (mt.status);
+	}
+
+	/* find the parent of each entry */
+	for (mntp = list, i = 0; mntp != NULL; mntp = mntp->next, i++) {
+		mntp->parent = NULL;
+		mntp->pending = 0;
+		mt.entries[i] = mntp;
+	}
+	for (i = 0; i < n; i++) {
+		mntp = mt.entries[i];
+		for (j = 0; j < n; j++) {
+			q = mt.entries[j];
+			if (j == i || !mount_below(mntp->mntpnt, q->mntpnt,
+			    j < i))
+				continue;
+			if (mntp->parent == NULL || strlen(q->mntpnt) >=
+			    strlen(mntp->parent->mntpnt))
+				mntp->parent = q;
+		}
+	}
+	for (i = 0; i < n; i++)
+		if (mt.entries[i]->parent != NULL)
+			mt.entries[i]->parent->pending++;
+
+	/* entries ready at start; the first ones are taken first */
+	for (i = n - 1; i >= 0; i--) {
+		mntp = mt.entries[i];
+		if (order == MOUNT_TREE_DOWN ? mntp->parent == NULL :
+		    mntp->pending == 0)
+			mt.ready[mt.nready++] = mntp;
+	}
+	mt.nentries = n;
+	mt.remaining = n;
+	mt.order = order;
+	mt.op = op;
+	(void) pthread_mutex_init(&mt.lock, NULL);
+	(void) pthread_cond_init(&mt.cv, NULL);
+
+	nthreads = (n < MOUNT_THREADS) ? n : MOUNT_THREADS;
+	for (started = 0; started < nthreads - 1; started++) {
+		if (pthread_create(&tids[started], NULL, mount_tree_thread,
+		    &mt) != 0)
+			break;
+	}
+	/* this thread works too - alone if no thread could start */
+	(void) mount_tree_thread(&mt);
+	while (started > 0)
+		(void) pthread_join(tids[--started], NULL);
+
+	(void) pthread_cond_destroy(&mt.cv);
+	(void) pthread_mutex_destroy(&mt.lock);
+	free(mt.entries);
+	free(mt.ready);
+	if (failedp != NULL)
+		*failedp = mt.failed;
+	return (mt.status);
+}
+
 /*
  * Function:	td_safe_system()
  *
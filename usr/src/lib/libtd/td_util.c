@@ -40,6 +40,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <dlfcn.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/fcntl.h>
 #include <sys/filio.h>
@@ -62,6 +63,7 @@
 #define	ERR_NODIR	2
 #define	DEVMAP_SCRIPTS_DIRECTORY	"/usr/sadm/install/devmap_scripts"
 #define	DEVMAP_TABLE_NAME		"devmap_table"
+#define	DEVMAP_HASH_SIZE		1021
 
 /* globals */
 
@@ -83,10 +85,53 @@ static int (*install2target)(const char *, const char *, char *, size_t);
 
 static int	run_devmap_scripts(void);
 
+/*
+ * Device name mappings found so far, so that each vfstab entry doesn't
+ * walk /dev and run the nawk scripts again.  The /dev links are read
+ * once; the devmap table and the results of the mapping functions are
+ * kept for the current root (td_get_rootdir()) and dropped when the root
+ * changes or by td_devmap_release() at the end of the discovery session.
+ */
+typedef enum {
+	DEVMAP_LINK,		/* /dev/<r>dsk/... link to a device node */
+	DEVMAP_TABLE,		/* line of the devmap table */
+	DEVMAP_OLD_TO_NEW,	/* td_map_old_device_to_new() result */
+	DEVMAP_EFFECTIVE	/* td_map_to_effective_dev() result */
+} devmap_kind_t;
+
+struct devmap_entry {
+	struct devmap_entry *next;
+	devmap_kind_t	kind;
+	int		status;		/* return value of the mapping */
+	char		*value;		/* mapped name */
+	char		key[1];
+};
+
+static struct devmap_cache {
+	pthread_mutex_t	lock;
+	char		root[MAXPATHLEN];
+	boolean_t	links_read;	/* /dev links entered */
+	boolean_t	table_read;	/* devmap table of root entered */
+	uint64_t	hits;
+	uint64_t	misses;
+	struct devmap_entry *hash[DEVMAP_HASH_SIZE];
+} devmap = { PTHREAD_MUTEX_INITIALIZER };
+
 /* private prototypes */
 
 static char	*_find_abs_path(char *);
 static int	_is_bsd_device(char *path);
+static int	_map_to_effective_dev(char *, char *, int);
+static int	_map_by_nawk_scripts(char *, char *, int);
+static boolean_t devmap_find(devmap_kind_t, const char *, char *, int,
+		    int *);
+static void	devmap_enter(devmap_kind_t, const char *, const char *, int);
+static struct devmap_entry *devmap_get(devmap_kind_t, const char *);
+static void	devmap_put(devmap_kind_t, const char *, const char *, int);
+static void	devmap_flush(boolean_t);
+static void	devmap_read_links(void);
+static void	devmap_read_table(void);
+static int	run_devmap_batch(char *);
 
 /* ---------------------- public functions ----------------------- */
 
@@ -157,6 +202,27 @@ mapping_supported(void)
  */
 int
 td_map_to_effective_dev(char *dev, char *edevbuf, int edevln)
+{
+	int	status;
+
+	if (devmap_find(DEVMAP_EFFECTIVE, dev, edevbuf, edevln, &status))
+		return (status);
+
+	status = _map_to_effective_dev(dev, edevbuf, edevln);
+	devmap_enter(DEVMAP_EFFECTIVE, dev, edevbuf, status);
+	return (status);
+}
+
+/*
+ * Function:	_map_to_effective_dev
+ * Description:	Do the work of td_map_to_effective_dev() for a device not
+ *		mapped before.
+ * Scope:	private
+ * Parameters:	as for td_map_to_effective_dev()
+ * Return:	as for td_map_to_effective_dev()
+ */
+static int
+_map_to_effective_dev(char *dev, char *edevbuf, int edevln)
 {
 	static char	deviceslnk[] = "../devices/";
 	static char	devlnk[] = "../dev/";
@@ -293,13 +359,11 @@ td_map_to_effective_dev(char *dev, char *edevbuf, int edevln)
 int
 td_map_node_to_devlink(char *devpath, char *edevbuf, int edevln)
 {
-	struct dirent	*dp;
-	char		elink[MAXPATHLEN];
+	char		key[2 * MAXPATHLEN];
 	char		linkbuf[MAXPATHLEN];
-	DIR		*dirp;
 	char		*dirname;
 	char		*c;
-	int		len;
+	int		status;
 
 	/*
 	 * Figure out the /dev directory to use for searching
@@ -351,33 +415,18 @@ td_map_node_to_devlink(char *devpath, char *edevbuf, int edevln)
 	}
 
 	/*
-	 * Search the search directory for a link whose target is the
+	 * Look for a link in the search directory whose target is the
 	 * passed device node.
 	 */
-	if ((dirp = opendir(dirname)) == NULL)
+	(void) snprintf(key, sizeof (key), "%s%s", dirname, linkbuf);
+	if (devmap_find(DEVMAP_LINK, key, edevbuf, edevln, &status))
 		return (0);
 
-	while ((dp = readdir(dirp)) != (struct dirent *)0) {
-		if (strcmp(dp->d_name, ".") == 0 ||
-		    strcmp(dp->d_name, "..") == 0)
-			continue;
-
-		(void) snprintf(edevbuf, edevln, "%s%s", dirname, dp->d_name);
-
-		if ((len = readlink(edevbuf, elink, MAXNAMELEN)) == -1) {
-			edevbuf[0] = '\0';
-			(void) closedir(dirp);
-			return (1);
-		}
-		elink[len] = '\0';
+	/* the search directory couldn't be read */
+	if (devmap_find(DEVMAP_LINK, dirname, NULL, 0, &status))
+		return (0);
 
-		if (strcmp(linkbuf, elink) == 0) {
-			(void) closedir(dirp);
-			return (0);
-		}
-	}
 	edevbuf[0] = '\0';
-	(void) closedir(dirp);
 	return (1);
 }
 
@@ -394,180 +443,94 @@ td_map_node_to_devlink(char *devpath, char *edevbuf, int edevln)
  *			  new, equivalent name for same device.
  *		n_size	- [RO]
  *			  size of newdev buffer
- * Return:	 none
- * Note:	If this is the first call to this routine, use the
- *		/tmp/physdevmap.nawk.* files to build a mapping array.
- *		Once the mapping array is built, use it to map olddev
- *		to the new device name.
+ * Return:	0	- olddev was mapped
+ *		1	- olddev couldn't be mapped
+ * Note:	The devmap scripts are run and their table is read on the
+ *		first lookup for a root, before any nawk script is run.
+ *		If no nawk script maps olddev, it is looked up in the
+ *		table.  The result for each olddev is kept until the root
+ *		changes.
  */
 int
 td_map_old_device_to_new(char *olddev, char *newdev, int n_size)
 {
-	static boolean_t	nawk_script_known_not_to_exist = B_FALSE;
-	static boolean_t	devmap_table_known_not_to_exist = B_FALSE;
-	static boolean_t	devmap_scripts_run = B_FALSE;
-	static char	nawkfile[] = "physdevmap.nawk.";
-	static char	sh_env_value[] = "SHELL=/sbin/sh";
-	char		cmd[512];
-	char		line[DDM_CMD_LEN];
-	DIR		*dirp;
-	FILE		*pipe_fp;
-	FILE		*fp;
-	char		*p;
-	boolean_t	nawk_script_found;
+	char		mapped[MAXPATHLEN];
 	int		status;
-	boolean_t	devmap_table_found;
-	struct dirent	*dp;
-	char		*envp;
-	char		*shell_save = NULL;
+	int		table_status;
+	boolean_t	in_table;
 
 	if (TLI)
 		td_debug_print(LS_DBGLVL_INFO,
 		    "Size of newdev buffer is %d\n", n_size);
 
-	if (nawk_script_known_not_to_exist &&
-	    devmap_table_known_not_to_exist)
-		return (1);
-
-	/*
-	 * Initialize device mapping table by running devmap scripts.
-	 * Mapping table is created in /tmp directory.
-	 */
-
-	if (!devmap_scripts_run) {
-		devmap_scripts_run = B_TRUE;
-
-		if (TLI)
-			td_debug_print(LS_DBGLVL_INFO,
-			    "Running devmap scripts...\n");
-
-		if ((status = run_devmap_scripts()) != 0 &&
-		    status != ERR_NODIR) {
-			devmap_table_known_not_to_exist = B_TRUE;
-
-			if (TLW)
-				td_debug_print(LS_DBGLVL_WARN,
-				    "devmap scripts failed with error %d\n",
-				    status);
-		}
-	}
-
-	if ((dirp = opendir("/tmp")) == NULL) {
-		nawk_script_known_not_to_exist = B_TRUE;
-		devmap_table_known_not_to_exist = B_TRUE;
-		return (1);
-	}
-	nawk_script_found = B_FALSE;
-	devmap_table_found = B_FALSE;
+	if (devmap_find(DEVMAP_OLD_TO_NEW, olddev, newdev, n_size, &status))
+		return (status);
 
 	/*
-	 * Temporarily set the value of the SHELL environment variable to
-	 * "/sbin/sh" to ensure that the Bourne shell will interpret the
-	 * commands passed to popen.  Then set it back to whatever it was
-	 * before after doing all the popens.
+	 * Look in the table first: that runs the devmap scripts, which may
+	 * leave nawk scripts in /tmp, before the nawk scripts are looked
+	 * for.
 	 */
+	in_table = devmap_find(DEVMAP_TABLE, olddev, mapped, sizeof (mapped),
+	    &table_status);
 
-	if ((envp = getenv("SHELL")) != NULL) {
-		shell_save = malloc(strlen(envp) + 6 + 1);
-		(void) strcpy(shell_save, "SHELL=");
-		(void) strcat(shell_save, envp);
-		(void) putenv(sh_env_value);
-	}
-	while ((dp = readdir(dirp)) != (struct dirent *)0) {
-		if (strcmp(dp->d_name, ".") == 0 ||
-		    strcmp(dp->d_name, "..") == 0)
-			continue;
-
-		if (strcmp(DEVMAP_TABLE_NAME, dp->d_name) == 0) {
-			devmap_table_found = B_TRUE;
-			continue;
-		}
-
-		if (strncmp(nawkfile, dp->d_name, strlen(nawkfile)) != 0)
-			continue;
-
-		nawk_script_found = B_TRUE;
-
-		/*
-		 * This is a nawk script for mapping old device names to new.
-		 * Now use it to try to map olddev to a new name.
-		 */
-
-		(void) snprintf(cmd, sizeof (cmd),
-		    "/usr/bin/echo \"%s\" | "
-		    "/usr/bin/nawk -f /tmp/%s -v 'rootdir=\"%s\"' "
-		    "2>/dev/null", olddev, dp->d_name,
-		    streq(td_get_rootdir(), "") ? "/" : td_get_rootdir());
-
-		if ((pipe_fp = (FILE *)popen(cmd, "r")) == NULL)
-			continue;
-
-		if (fgets(newdev, n_size, pipe_fp) != NULL) {
-			/* remove the trailing new-line */
-			newdev[strlen(newdev) - 1] = '\0';
-			(void) pclose(pipe_fp);
-			(void) closedir(dirp);
-			if (shell_save != NULL)
-				(void) putenv(shell_save);
-			return (0);
-		}
-		(void) pclose(pipe_fp);
-	}
-	(void) closedir(dirp);
-
-	if (shell_save != NULL)
-		(void) putenv(shell_save);
-
-	if (!nawk_script_found)
-		nawk_script_known_not_to_exist = B_TRUE;
-
-	if (!devmap_table_found) {
-		devmap_table_known_not_to_exist = B_TRUE;
-
-		return (1);
-	}
-
-	fp = (FILE *)fopen("/tmp/" DEVMAP_TABLE_NAME, "r");
-	if (fp == NULL) {
-		if (TLW)
-			td_debug_print(LS_DBGLVL_WARN,
-			    "File %s was created, "
-			    "but can't be opened\n",
-			    "</tmp/" DEVMAP_TABLE_NAME ">");
-
-		devmap_table_known_not_to_exist = B_TRUE;
-		return (1);
-	}
-
-	while (fgets(line, sizeof (line), fp) != NULL) {
-		if ((p = strtok(line, "\t")) == NULL)
-			continue;
-
-		if (strcmp(p, olddev) != 0)
-			continue;
-
-		p = strtok(NULL, "\t");
-		if (strlcpy(newdev, p, n_size) >= n_size) {
+	if ((status = _map_by_nawk_scripts(olddev, newdev, n_size)) != 0 &&
+	    in_table) {
+		status = table_status;
+		if (strlcpy(newdev, mapped, n_size) >= n_size) {
 			if (TLW)
 				td_debug_print(LS_DBGLVL_WARN,
 				    "New device pathname too "
 				    "long, it was truncated. "
 				    "Mapping will fail\n");
-
-			(void) fclose(fp);
-			return (1);
+			status = 1;
 		}
+	}
 
-		/* Remove trailing newline */
+	devmap_enter(DEVMAP_OLD_TO_NEW, olddev, status == 0 ? newdev : NULL,
+	    status);
+	return (status);
+}
 
-		newdev[strlen(newdev) - 1] = '\0';
+/*
+ * Function:	td_devmap_stats
+ * Description:	Report how many device name lookups were answered from the
+ *		mapping cache and how many had to be worked out.
+ * Scope:	public
+ * Parameters:	hits	- [WO] lookups found in the cache
+ *		misses	- [WO] lookups not found in the cache
+ * Return:	none
+ */
+void
+td_devmap_stats(uint64_t *hits, uint64_t *misses)
+{
+	(void) pthread_mutex_lock(&devmap.lock);
+	*hits = devmap.hits;
+	*misses = devmap.misses;
+	(void) pthread_mutex_unlock(&devmap.lock);
+}
 
-		(void) fclose(fp);
-		return (0);
-	}
+/*
+ * Function:	td_devmap_release
+ * Description:	Forget all the device name mappings, at the end of a
+ *		discovery session.
+ * Scope:	public
+ * Parameters:	none
+ * Return:	none
+ */
+void
+td_devmap_release(void)
+{
+	(void) pthread_mutex_lock(&devmap.lock);
+	if (TLI)
+		td_debug_print(LS_DBGLVL_INFO,
+		    "device mapping cache: %llu hits, %llu misses\n",
+		    (u_longlong_t)devmap.hits, (u_longlong_t)devmap.misses);
 
-	(void) fclose(fp);
-	return (1);
+	devmap_flush(B_TRUE);
+	devmap.hits = 0;
+	devmap.misses = 0;
+	(void) pthread_mutex_unlock(&devmap.lock);
 }
 
 /* ---------------------- private functions ----------------------- */
@@ -719,8 +682,391 @@ td_GetExemptSwapdisk()
 	return (exempt_swapdisk);
 }
 
+/*
+ * Function:	_map_by_nawk_scripts
+ * Description:	Use the /tmp/physdevmap.nawk.* scripts (if any) to map a
+ *		device name to the new name for the same device.
+ * Scope:	private
+ * Parameters:	olddev	- [RO] device name to be mapped
+ *		newdev	- [WO] new, equivalent name for same device
+ *		n_size	- [RO] size of newdev buffer
+ * Return:	0	- a script mapped olddev
+ *		1	- olddev couldn't be mapped
+ */
+static int
+_map_by_nawk_scripts(char *olddev, char *newdev, int n_size)
+{
+	static boolean_t	nawk_script_known_not_to_exist = B_FALSE;
+	static char	nawkfile[] = "physdevmap.nawk.";
+	static char	sh_env_value[] = "SHELL=/sbin/sh";
+	char		cmd[512];
+	DIR		*dirp;
+	FILE		*pipe_fp;
+	boolean_t	nawk_script_found;
+	struct dirent	*dp;
+	char		*envp;
+	char		*shell_save = NULL;
+
+	if (nawk_script_known_not_to_exist)
+		return (1);
+
+	if ((dirp = opendir("/tmp")) == NULL) {
+		nawk_script_known_not_to_exist = B_TRUE;
+		return (1);
+	}
+	nawk_script_found = B_FALSE;
+
+	/*
+	 * Temporarily set the value of the SHELL environment variable to
+	 * "/sbin/sh" to ensure that the Bourne shell will interpret the
+	 * commands passed to popen.  Then set it back to whatever it was
+	 * before after doing all the popens.
+	 */
+
+	if ((envp = getenv("SHELL")) != NULL) {
+		shell_save = malloc(strlen(envp) + 6 + 1);
+		(void) strcpy(shell_save, "SHELL=");
+		(void) strcat(shell_save, envp);
+		(void) putenv(sh_env_value);
+	}
+	while ((dp = readdir(dirp)) != (struct dirent *)0) {
+		if (strncmp(nawkfile, dp->d_name, strlen(nawkfile)) != 0)
+			continue;
+
+		nawk_script_found = B_TRUE;
+
+		/*
+		 * This is a nawk script for mapping old device names to new.
+		 * Now use it to try to map olddev to a new name.
+		 */
+
+		(void) snprintf(cmd, sizeof (cmd),
+		    "/usr/bin/echo \"%s\" | "
+		    "/usr/bin/nawk -f /tmp/%s -v 'rootdir=\"%s\"' "
+		    "2>/dev/null", olddev, dp->d_name,
+		    streq(td_get_rootdir(), "") ? "/" : td_get_rootdir());
+
+		if ((pipe_fp = (FILE *)popen(cmd, "r")) == NULL)
+			continue;
+
+		if (fgets(newdev, n_size, pipe_fp) != NULL) {
+			/* remove the trailing new-line */
+			newdev[strlen(newdev) - 1] = '\0';
+			(void) pclose(pipe_fp);
+			(void) closedir(dirp);
+			if (shell_save != NULL)
+				(void) putenv(shell_save);
+			return (0);
+		}
+		(void) pclose(pipe_fp);
+	}
+	(void) closedir(dirp);
+
+	if (shell_save != NULL)
+		(void) putenv(shell_save);
+
+	if (!nawk_script_found)
+		nawk_script_known_not_to_exist = B_TRUE;
+
+	return (1);
+}
+
+/*
+ * devmap_find()
+ *	Look up a device name in the mapping cache, first dropping the
+ *	mappings of the previous root if the root has changed since the
+ *	last lookup.  The /dev links and the devmap table are read into
+ *	the cache the first time they are looked up.
+ * Parameters:
+ *	kind	- kind of mapping
+ *	key	- name to look up
+ *	buf	- buffer the mapped name is copied to, or NULL
+ *	buflen	- size of buf
+ *	statusp	- set to the status kept with the mapping
+ * Return:
+ *	B_TRUE	- key was found
+ *	B_FALSE	- key isn't in the cache
+ * Status:
+ *	private
+ */
+static boolean_t
+devmap_find(devmap_kind_t kind, const char *key, char *buf, int buflen,
+    int *statusp)
+{
+	struct devmap_entry	*ep;
+
+	(void) pthread_mutex_lock(&devmap.lock);
+
+	if (!streq(devmap.root, td_get_rootdir())) {
+		devmap_flush(B_FALSE);
+		(void) strlcpy(devmap.root, td_get_rootdir(),
+		    sizeof (devmap.root));
+	}
+	if (kind == DEVMAP_LINK && !devmap.links_read)
+		devmap_read_links();
+	if (kind == DEVMAP_TABLE && !devmap.table_read)
+		devmap_read_table();
+
+	if ((ep = devmap_get(kind, key)) != NULL) {
+		devmap.hits++;
+		*statusp = ep->status;
+		if (buf != NULL)
+			(void) strlcpy(buf, ep->value != NULL ? ep->value : "",
+			    buflen);
+	} else {
+		devmap.misses++;
+	}
+
+	(void) pthread_mutex_unlock(&devmap.lock);
+	return (ep != NULL);
+}
+
+/*
+ * devmap_enter()
+ *	Remember a mapping worked out for the current root.
+ * Parameters:
+ *	kind	- kind of mapping
+ *	key	- name mapped
+ *	value	- mapped name, or NULL
+ *	status	- status to return with the mapping
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+devmap_enter(devmap_kind_t kind, const char *key, const char *value,
+    int status)
+{
+	(void) pthread_mutex_lock(&devmap.lock);
+	if (devmap_get(kind, key) == NULL)
+		devmap_put(kind, key, value, status);
+	(void) pthread_mutex_unlock(&devmap.lock);
+}
+
+/*
+ * devmap_hash()
+ *	Hash a key of the mapping cache.
+ * Parameters:
+ *	kind	- kind of mapping
+ *	key	- name mapped
+ * Return:
+ *	index of the hash bucket
+ * Status:
+ *	private
+ */
+static uint_t
+devmap_hash(devmap_kind_t kind, const char *key)
+{
+	uint_t	h = kind;
+
+	while (*key != '\0')
+		h = h * 31 + (uchar_t)*key++;
+	return (h % DEVMAP_HASH_SIZE);
+}
+
+/*
+ * devmap_get()
+ *	Find a mapping in the cache.  Called with the cache locked.
+ * Parameters:
+ *	kind	- kind of mapping
+ *	key	- name mapped
+ * Return:
+ *	the mapping, or NULL
+ * Status:
+ *	private
+ */
+static struct devmap_entry *
+devmap_get(devmap_kind_t kind, const char *key)
+{
+	struct devmap_entry	*ep;
+
+	for (ep = devmap.hash[devmap_hash(kind, key)]; ep != NULL;
+	    ep = ep->next) {
+		if (ep->kind == kind && streq(ep->key, key))
+			return (ep);
+	}
+	return (NULL);
+}
+
+/*
+ * devmap_put()
+ *	Add a mapping to the cache.  Called with the cache locked.  If
+ *	memory runs out the mapping is just not cached.
+ * Parameters:
+ *	kind	- kind of mapping
+ *	key	- name mapped
+ *	value	- mapped name, or NULL
+ *	status	- status to return with the mapping
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+devmap_put(devmap_kind_t kind, const char *key, const char *value,
+    int status)
+{
+	struct devmap_entry	*ep;
+	uint_t			h;
+
+	if ((ep = malloc(sizeof (*ep) + strlen(key))) == NULL)
+		return;
+	if (value == NULL) {
+		ep->value = NULL;
+	} else if ((ep->value = strdup(value)) == NULL) {
+		free(ep);
+		return;
+	}
+	(void) strcpy(ep->key, key);
+	ep->kind = kind;
+	ep->status = status;
+
+	h = devmap_hash(kind, key);
+	ep->next = devmap.hash[h];
+	devmap.hash[h] = ep;
+}
+
+/*
+ * devmap_flush()
+ *	Drop the mappings of the current root from the cache.  Called with
+ *	the cache locked.
+ * Parameters:
+ *	all	- B_TRUE to drop the /dev links too
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+devmap_flush(boolean_t all)
+{
+	struct devmap_entry	*ep, **epp;
+	int			h;
+
+	for (h = 0; h < DEVMAP_HASH_SIZE; h++) {
+		epp = &devmap.hash[h];
+		while ((ep = *epp) != NULL) {
+			if (!all && ep->kind == DEVMAP_LINK) {
+				epp = &ep->next;
+				continue;
+			}
+			*epp = ep->next;
+			free(ep->value);
+			free(ep);
+		}
+	}
+	devmap.table_read = B_FALSE;
+	if (all) {
+		devmap.links_read = B_FALSE;
+		devmap.root[0] = '\0';
+	}
+}
+
+/*
+ * devmap_read_links()
+ *	Enter the links of the local /dev/<r>dsk and /dev/vx/<r>dsk
+ *	directories in the cache, keyed by directory and link target as
+ *	td_map_node_to_devlink() looks them up.  A directory that can't be
+ *	read is entered under its own name.  Called with the cache locked.
+ * Parameters:
+ *	none
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+devmap_read_links(void)
+{
+	static char	*dirs[] = {
+		blkdevdir, rawdevdir, blkvxdevdir, rawvxdevdir, NULL };
+	char		path[MAXPATHLEN];
+	char		link[MAXPATHLEN];
+	char		key[2 * MAXPATHLEN];
+	struct dirent	*dp;
+	DIR		*dirp;
+	char		**dir;
+	int		len;
+
+	devmap.links_read = B_TRUE;
+
+	for (dir = dirs; *dir != NULL; dir++) {
+		if ((dirp = opendir(*dir)) == NULL) {
+			devmap_put(DEVMAP_LINK, *dir, NULL, 0);
+			continue;
+		}
+		while ((dp = readdir(dirp)) != NULL) {
+			if (strcmp(dp->d_name, ".") == 0 ||
+			    strcmp(dp->d_name, "..") == 0)
+				continue;
+
+			(void) snprintf(path, sizeof (path), "%s%s", *dir,
+			    dp->d_name);
+			if ((len = readlink(path, link, sizeof (link) - 1)) ==
+			    -1)
+				continue;
+			link[len] = '\0';
+
+			(void) snprintf(key, sizeof (key), "%s%s", *dir, link);
+			if (devmap_get(DEVMAP_LINK, key) == NULL)
+				devmap_put(DEVMAP_LINK, key, path, 0);
+		}
+		(void) closedir(dirp);
+	}
+}
+
+/*
+ * devmap_read_table()
+ *	Run the devmap scripts for the current root and enter the device
+ *	mapping table they generate in the cache.  Called with the cache
+ *	locked.
+ * Parameters:
+ *	none
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+devmap_read_table(void)
+{
+	char	line[DDM_CMD_LEN];
+	char	*olddev, *newdev;
+	FILE	*fp;
+	int	status;
+
+	devmap.table_read = B_TRUE;
+
+	if (TLI)
+		td_debug_print(LS_DBGLVL_INFO, "Running devmap scripts...\n");
+
+	if ((status = run_devmap_scripts()) != 0 && status != ERR_NODIR) {
+		if (TLW)
+			td_debug_print(LS_DBGLVL_WARN,
+			    "devmap scripts failed with error %d\n", status);
+		return;
+	}
+
+	if ((fp = fopen("/tmp/" DEVMAP_TABLE_NAME, "r")) == NULL)
+		return;
+
+	while (fgets(line, sizeof (line), fp) != NULL) {
+		if ((olddev = strtok(line, "\t")) == NULL ||
+		    (newdev = strtok(NULL, "\t\n")) == NULL)
+			continue;
+
+		if (devmap_get(DEVMAP_TABLE, olddev) == NULL)
+			devmap_put(DEVMAP_TABLE, olddev, newdev, 0);
+	}
+	(void) fclose(fp);
+}
+
 /*
  * run_devmap_scripts()
+ *	Run the devmap scripts for the current root.  As many scripts as
+ *	fit in a command line are run by a single shell, stopping at the
+ *	first one which fails.
  * Parameters:
  *    none
  * Return:
@@ -735,6 +1081,9 @@ run_devmap_scripts(void)
 	struct dirent	*dp;
 	int		status;
 	char		cmd[DDM_CMD_LEN];
+	char		script[MAXPATHLEN];
+	size_t		len = 0;
+	int		batched = 0;
 	boolean_t	script_run = B_FALSE;
 
 	if ((dirp = opendir(DEVMAP_SCRIPTS_DIRECTORY)) == NULL) {
@@ -751,45 +1100,42 @@ run_devmap_scripts(void)
 		    strcmp(dp->d_name, "..") == 0)
 		continue;
 
-		(void) snprintf(cmd, sizeof (cmd), "%s/%s %s",
+		(void) snprintf(script, sizeof (script), "%s/%s %s",
 		    DEVMAP_SCRIPTS_DIRECTORY,
 		    dp->d_name,
 		    td_get_rootdir());
 
-		status = td_safe_system(cmd, B_TRUE);
-
-		if (status == -1) {
-			if (TLW)
-				td_debug_print(LS_DBGLVL_WARN,
-				    "popen(3C) for command %s failed\n", cmd);
-
-			(void) closedir(dirp);
-			return (status);
-		}
-
-		if (WEXITSTATUS(status) != 0) {
-			if (TLW)
-				td_debug_print(LS_DBGLVL_WARN,
-				    "Command %s exited with error code %d\n",
-				    cmd, WEXITSTATUS(status));
-
-			(void) closedir(dirp);
-			return (WEXITSTATUS(status));
-		}
-
 		/*
-		 * Script was run and finished successfully, set the flag
+		 * The scripts are run as "{ script && script ...; }", so
+		 * that td_safe_system() redirects the output of all of them.
 		 */
+		if (batched > 0 &&
+		    len + strlen(" && ") + strlen(script) + strlen("; }") >=
+		    sizeof (cmd)) {
+			(void) strlcat(cmd, "; }", sizeof (cmd));
+			if ((status = run_devmap_batch(cmd)) != 0) {
+				(void) closedir(dirp);
+				return (status);
+			}
+			batched = 0;
+		}
 
+		(void) snprintf(cmd + (batched > 0 ? len : 0),
+		    sizeof (cmd) - (batched > 0 ? len : 0), "%s%s",
+		    batched > 0 ? " && " : "{ ", script);
+		len = strlen(cmd);
+		batched++;
 		script_run = B_TRUE;
-		if (TLI)
-			td_debug_print(LS_DBGLVL_INFO,
-			    "Command %s finished successfully\n",
-			    cmd);
 	}
 
 	(void) closedir(dirp);
 
+	if (batched > 0) {
+		(void) strlcat(cmd, "; }", sizeof (cmd));
+		if ((status = run_devmap_batch(cmd)) != 0)
+			return (status);
+	}
+
 	/*
 	 * If there was no script to run, mapping table was not
 	 * generated - return with failure in this case. Otherwise
@@ -800,3 +1146,46 @@ run_devmap_scripts(void)
 	else
 		return (1);
 }
+
+/*
+ * run_devmap_batch()
+ *	Run a command line of devmap scripts.
+ * Parameters:
+ *	cmd	- command line to run
+ * Return:
+ *	0	- all the scripts finished successfully
+ *	-1	- the command couldn't be run
+ *	other	- exit code of the script which failed
+ * Status:
+ *	private
+ */
+static int
+run_devmap_batch(char *cmd)
+{
+	int	status;
+
+	status = td_safe_system(cmd, B_TRUE);
+
+	if (status == -1) {
+		if (TLW)
+			td_debug_print(LS_DBGLVL_WARN,
+			    "popen(3C) for command %s failed\n", cmd);
+
+		return (status);
+	}
+
+	if (WEXITSTATUS(status) != 0) {
+		if (TLW)
+			td_debug_print(LS_DBGLVL_WARN,
+			    "Command %s exited with error code %d\n",
+			    cmd, WEXITSTATUS(status));
+
+		return (WEXITSTATUS(status));
+	}
+
+	if (TLI)
+		td_debug_print(LS_DBGLVL_INFO,
+		    "Command %s finished successfully\n",
+		    cmd);
+	return (0);
+}
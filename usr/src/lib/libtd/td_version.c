@@ -38,16 +38,20 @@
 
 static  int	prod_tokenize(char **, char *);
 static  int	chk_prod_toks(char **);
-static  int	vstrcoll(char *, char *);
+static	int	vkey_num_index(int);
+static	int	vkey_tokcmp(const td_vkey_t *, const td_vkey_t *, int);
+static	int	vkey_numcmp(const uint32_t *, const uint32_t *);
 static  int	is_empty(char *);
 static	void	strip_trailing_blanks(char **);
 #ifdef DEBUG_V
 static	void	print_tokens(char **);
 #endif
 
-#define	MAX_VERSION_LEN		256
 #define	MAX_TOKENS		10
 
+#define	VK_TOK(k, i)	((k)->vk_buf + (k)->vk_tok[i])
+#define	VK_EMPTY(k, i)	(*VK_TOK(k, i) == '\0')
+
 #define	PROD_SUN_NAME_TOK	0
 #define	PROD_SUN_VER_TOK	1
 #define	PROD_SUN_IVER_TOK	2
@@ -273,70 +277,137 @@ td_get_build_id(const char *rootdir, char *build_id, size_t maxlen)
 int
 td_prod_vcmp(const char *v1, const char *v2)
 {
-	int	ret, i, state;
-	char	v1_buf[MAX_VERSION_LEN + 1];
-	char	v2_buf[MAX_VERSION_LEN + 1];
-	char	*v1_tokens[MAX_TOKENS + 2], *v2_tokens[MAX_TOKENS + 2];
+	td_vkey_t	k1, k2;
+
+	if (td_prod_vkey(v1, &k1) != 0)
+		return (k1.vk_status);
+	(void) td_prod_vkey(v2, &k2);
 
-	(void) memset(v1_buf, '\0', sizeof (v1_buf));
-	(void) memset(v2_buf, '\0', sizeof (v2_buf));
-	(void) memset(v1_tokens, '\0', sizeof (v1_tokens));
-	(void) memset(v2_tokens, '\0', sizeof (v2_tokens));
+	return (td_prod_vkey_cmp(&k1, &k2));
+}
 
-	(void) strcpy(v1_buf, v1);
-	if ((ret = prod_tokenize(v1_tokens, v1_buf)) < 0)
-		return (ret);
+/*
+ * td_prod_vkey() - parse a product version string into a key
+ *
+ * Parameters:
+ *	v	- version string
+ *	key	- key to fill in
+ * Returns:
+ *   0 - v was parsed
+ *   ERR_STR_TOO_LONG, V_NOT_UPGRADEABLE - v isn't a product version,
+ *	and the key will compare as such.  The error is also kept in
+ *	key->vk_status.
+ *
+ * Status:
+ *	public
+ */
+int
+td_prod_vkey(const char *v, td_vkey_t *key)
+{
+	char	*toks[MAX_TOKENS + 2];
+	char	*cp;
+	int	i, n, c;
 
-	(void) strcpy(v2_buf, v2);
-	if ((ret = prod_tokenize(v2_tokens, v2_buf)) < 0)
-		return (ret);
+	(void) memset(key, '\0', sizeof (*key));
+	(void) memset(toks, '\0', sizeof (toks));
 
+	if (strlen(v) > MAX_VERSION_LEN) {
+		key->vk_status = ERR_STR_TOO_LONG;
+		return (key->vk_status);
+	}
+	(void) strcpy(key->vk_buf, v);
+	if ((key->vk_status = prod_tokenize(toks, key->vk_buf)) != 0)
+		return (key->vk_status);
 
 #ifdef DEBUG_V
-	print_tokens(v1_tokens);
-	(void) printf("\n");
-	print_tokens(v2_tokens);
+	print_tokens(toks);
 #endif
 
-	for (i = 0; v1_tokens[i]; i++) {
-		if (is_empty(v1_tokens[i]))
+	for (i = 0; i < VKEY_NUM_TOKS; i++) {
+		/* empty tokens refer to the NUL ending vk_buf */
+		if (is_empty(toks[i])) {
+			key->vk_tok[i] = MAX_VERSION_LEN;
+			continue;
+		}
+		key->vk_tok[i] = toks[i] - key->vk_buf;
+
+		if ((n = vkey_num_index(i)) < 0)
+			continue;
+
+		/* "2..10" has the components 2, 0 and 10 */
+		for (c = 0, cp = toks[i]; *cp != '\0'; cp++) {
+			if (*cp != '.') {
+				key->vk_num[n][c] =
+				    key->vk_num[n][c] * 10 + (*cp - '0');
+			} else if (++c == VKEY_NUM_COMPS) {
+				key->vk_status = V_NOT_UPGRADEABLE;
+				return (key->vk_status);
+			}
+		}
+	}
+	return (0);
+}
+
+/*
+ * td_prod_vkey_cmp() - compare two keys made by td_prod_vkey()
+ *
+ * Parameters:
+ *	k1	- first key
+ *	k2	- second key
+ * Returns:
+ *   as td_prod_vcmp() for the version strings of k1 and k2
+ *
+ * Status:
+ *	public
+ */
+int
+td_prod_vkey_cmp(const td_vkey_t *k1, const td_vkey_t *k2)
+{
+	int	i, state = V_EQUAL_TO;
+
+	if (k1->vk_status != 0)
+		return (k1->vk_status);
+	if (k2->vk_status != 0)
+		return (k2->vk_status);
+
+	for (i = 0; i < VKEY_NUM_TOKS; i++) {
+		if (VK_EMPTY(k1, i))
 			continue;
 
 		switch (i) {
 		case PROD_SUN_NAME_TOK:
-			state = vstrcoll(v1_tokens[i], v2_tokens[i]);
+			state = vkey_tokcmp(k1, k2, i);
 			if (state != V_EQUAL_TO)
 				return (V_NOT_UPGRADEABLE);
 			break;
 
 		case PROD_SUN_VER_TOK:
-			if (is_empty(v2_tokens[i]))
+			if (VK_EMPTY(k2, i))
 				return (V_NOT_UPGRADEABLE);
-			state = vstrcoll(v1_tokens[i], v2_tokens[i]);
+			state = vkey_tokcmp(k1, k2, i);
 			break;
 
 		case PROD_SUN_IVER_TOK:
 			/* Solaris_2.0.1_5.0  Solaris_2.0.1 */
-			if (is_empty(v2_tokens[i]))
+			if (VK_EMPTY(k2, i))
 				return (V_NOT_UPGRADEABLE);
 			if (state == V_EQUAL_TO) {
-				state = vstrcoll(v1_tokens[i], v2_tokens[i]);
+				state = vkey_tokcmp(k1, k2, i);
 			}
 			break;
 		case PROD_VENDOR_NAME_TOK:
 			/* Solaris_2.0.1_5.0  Solaris_2.0.1_Dell_A */
-			if (!is_empty(v2_tokens[PROD_SUN_IVER_TOK]))
+			if (!VK_EMPTY(k2, PROD_SUN_IVER_TOK))
 				return (V_NOT_UPGRADEABLE);
 
-			if (is_empty(v2_tokens[i])) {
+			if (VK_EMPTY(k2, i)) {
 				/* Solaris_2.0.1_Dell_A  Solaris_2.0.1 */
 				if (state == V_EQUAL_TO)
 					return (V_GREATER_THAN);
-				i = MAX_TOKENS;
+				i = VKEY_NUM_TOKS;
 				continue;
 			}
-			ret = strcoll(v1_tokens[i], v2_tokens[i]);
-			if (ret != 0) {
+			if (vkey_tokcmp(k1, k2, i) != V_EQUAL_TO) {
 				/*
 				 * Solaris_2.0.1_Soulbourne_A
 				 * Solaris_2.0.1_Dell_A
@@ -354,56 +425,54 @@ td_prod_vcmp(const char *v1, const char *v2)
 
 		case PROD_VENDOR_VER_TOK:
 			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_Dell */
-			if (is_empty(v2_tokens[i]))
+			if (VK_EMPTY(k2, i))
 				return (V_NOT_UPGRADEABLE);
 			if (state == V_EQUAL_TO) {
-				state = vstrcoll(v1_tokens[i], v2_tokens[i]);
+				state = vkey_tokcmp(k1, k2, i);
 			}
 			break;
 
 		case PROD_VENDOR_IVER_TOK:
 			/* Solaris_2.0.1_Dell_A_1.0  Solaris_2.0.1_Dell_A */
-			if (is_empty(v2_tokens[i]))
+			if (VK_EMPTY(k2, i))
 				return (V_NOT_UPGRADEABLE);
 			if (state == V_EQUAL_TO) {
-				state = vstrcoll(v1_tokens[i], v2_tokens[i]);
+				state = vkey_tokcmp(k1, k2, i);
 			}
 			break;
-		default:
-			return (V_NOT_UPGRADEABLE);
 		}
 	}
 
-	for (i = 0; v2_tokens[i]; i++) {
-		if (is_empty(v2_tokens[i]))
+	for (i = 0; i < VKEY_NUM_TOKS; i++) {
+		if (VK_EMPTY(k2, i))
 			continue;
 		switch (i) {
 		case PROD_SUN_NAME_TOK:
 		case PROD_SUN_VER_TOK:
 		case PROD_SUN_IVER_TOK:
-			if (is_empty(v1_tokens[i]))
+			if (VK_EMPTY(k1, i))
 				return (V_NOT_UPGRADEABLE);
 			break;
 		case PROD_VENDOR_NAME_TOK:
 			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_5.1 */
-			if (!is_empty(v1_tokens[PROD_SUN_IVER_TOK]))
+			if (!VK_EMPTY(k1, PROD_SUN_IVER_TOK))
 				return (V_NOT_UPGRADEABLE);
-			if (is_empty(v1_tokens[i])) {
+			if (VK_EMPTY(k1, i)) {
 				/* Solaris_2.0.1  Solaris_2.0.1_Dell_A */
 				if (state == V_EQUAL_TO)
 					return (V_LESS_THAN);
 				else
-					i = MAX_TOKENS;
+					i = VKEY_NUM_TOKS;
 			}
 			break;
 		case PROD_VENDOR_VER_TOK:
 			/* Solaris_2.0.1_Dell  Solaris_2.0.1_Dell_A */
-			if (is_empty(v1_tokens[i]))
+			if (VK_EMPTY(k1, i))
 				return (V_NOT_UPGRADEABLE);
 			break;
 		case PROD_VENDOR_IVER_TOK:
 			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_Dell_A_1.0 */
-			if (is_empty(v1_tokens[i]))
+			if (VK_EMPTY(k1, i))
 				return (V_NOT_UPGRADEABLE);
 			break;
 		}
@@ -411,6 +480,37 @@ td_prod_vcmp(const char *v1, const char *v2)
 	return (state);
 }
 
+/*
+ * td_prod_vkey_order() - total order of keys made by td_prod_vkey()
+ *
+ * Unlike td_prod_vcmp(), this orders versions which can't be upgraded
+ * to one another, so it can be used to sort them: by release, then by
+ * vendor.  Keys of strings which didn't parse sort last.
+ *
+ * Parameters:
+ *	k1	- first key
+ *	k2	- second key
+ * Returns:
+ *   V_LESS_THAN, V_EQUAL_TO or V_GREATER_THAN
+ *
+ * Status:
+ *	public
+ */
+int
+td_prod_vkey_order(const td_vkey_t *k1, const td_vkey_t *k2)
+{
+	int	i, ret;
+
+	if (k1->vk_status != 0 || k2->vk_status != 0)
+		return ((k1->vk_status != 0) - (k2->vk_status != 0));
+
+	for (i = 0; i < VKEY_NUM_TOKS; i++) {
+		if ((ret = vkey_tokcmp(k1, k2, i)) != V_EQUAL_TO)
+			return (ret);
+	}
+	return (V_EQUAL_TO);
+}
+
 /* ******************************************************************** */
 /*			INTERNAL SUPPORT FUNCTIONS			*/
 /* ******************************************************************** */
@@ -558,79 +658,83 @@ chk_prod_toks(char *toks[])
 
 
 /*
- * vstrcoll()
+ * vkey_num_index()
  *
  * Parameters:
- *	s1	-
- *	s2	-
+ *	tok	- index of a product version token
  * Return:
- *
+ *	index in vk_num of a numeric token, or -1
  * Status:
  *	private
  */
 static int
-vstrcoll(char *s1, char *s2)
+vkey_num_index(int tok)
 {
-	int 	ret, i;
-	int 	s1num[20], s2num[20];
-	char	*cp_beg, *cp_end;
+	switch (tok) {
+	case PROD_SUN_VER_TOK:
+		return (0);
+	case PROD_SUN_IVER_TOK:
+		return (1);
+	case PROD_VENDOR_IVER_TOK:
+		return (2);
+	default:
+		return (-1);
+	}
+}
 
-	if (isalpha((uchar_t)*s1)) {
-		ret = strcoll(s1, s2);
-		if (ret < 0)
-			return (V_LESS_THAN);
-		else if (ret > 0)
-			return (V_GREATER_THAN);
+/*
+ * vkey_tokcmp()
+ *
+ * Parameters:
+ *	k1	- first key
+ *	k2	- second key
+ *	tok	- index of the token to compare
+ * Return:
+ *	V_LESS_THAN, V_EQUAL_TO or V_GREATER_THAN
+ * Status:
+ *	private
+ */
+static int
+vkey_tokcmp(const td_vkey_t *k1, const td_vkey_t *k2, int tok)
+{
+	int	n, ret;
 
-		return (V_EQUAL_TO);
-	}
+	if ((n = vkey_num_index(tok)) >= 0)
+		return (vkey_numcmp(k1->vk_num[n], k2->vk_num[n]));
 
-	for (i = 0; i < 20; i++) {
-		s1num[i] = -1;
-		s2num[i] = -1;
-	}
+	ret = strcoll(VK_TOK(k1, tok), VK_TOK(k2, tok));
+	if (ret < 0)
+		return (V_LESS_THAN);
+	else if (ret > 0)
+		return (V_GREATER_THAN);
 
-	i = 0; cp_beg = s1; cp_end = s1;
-	while (cp_beg != NULL) {
-		cp_end = strchr(cp_beg, '.');
-		if (cp_end != NULL) {
-			*cp_end = '\0';
-			cp_end++;
-		}
-		s1num[i++] = atoi(cp_beg);
-		cp_beg = cp_end;
-	}
+	return (V_EQUAL_TO);
+}
 
-	i = 0; cp_beg = s2; cp_end = s2;
-	while (cp_beg != NULL) {
-		cp_end = strchr(cp_beg, '.');
-		if (cp_end != NULL) {
-			*cp_end = '\0';
-			cp_end++;
-		}
-		s2num[i++] = atoi(cp_beg);
-		cp_beg = cp_end;
-	}
+/*
+ * vkey_numcmp()
+ *	Compare the components of two numeric tokens.  Missing components
+ *	are zero, so "2.1" and "2.1.0" are equal.
+ *
+ * Parameters:
+ *	n1	- components of the first token
+ *	n2	- components of the second token
+ * Return:
+ *	V_LESS_THAN, V_EQUAL_TO or V_GREATER_THAN
+ * Status:
+ *	private
+ */
+static int
+vkey_numcmp(const uint32_t *n1, const uint32_t *n2)
+{
+	int	i;
 
-	for (i = 0; s1num[i] != -1; i++) {
-		if (s2num[i] == -1) break;
-		if (s1num[i] > s2num[i])
+	for (i = 0; i < VKEY_NUM_COMPS; i++) {
+		if (n1[i] > n2[i])
 			return (V_GREATER_THAN);
-		if (s1num[i] < s2num[i])
+		if (n1[i] < n2[i])
 			return (V_LESS_THAN);
 	}
-
-	if ((s1num[i] != -1) || (s2num[i] != -1)) {
-		if (s1num[i] == -1) {
-			while (s2num[i] == 0) i++;
-			if (s2num[i] != -1)
-				return (V_LESS_THAN);
-		} else {
-			while (s1num[i] == 0) i++;
-			if (s1num[i] != -1)
-				return (V_GREATER_THAN);
-		}
-	}
 	return (V_EQUAL_TO);
 }
 
@@ -34,6 +34,8 @@
  *    used in td_version.c main module
  */
 
+#include <sys/types.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -45,7 +47,32 @@ extern "C" {
 #define	V_EQUAL_TO		0
 #define	V_GREATER_THAN		1
 
+#define	MAX_VERSION_LEN		256
+
+/*
+ * A product version string parsed once, so that it can be compared many
+ * times (for instance while sorting OS instances) without tokenizing it
+ * again.  td_prod_vkey_cmp() orders two keys as td_prod_vcmp() orders
+ * the strings they were made from.
+ *
+ * Numeric tokens ("2.10.1") are kept as components padded with zeros,
+ * which compare equal to missing components as they do in a string
+ * comparison.  The other tokens are kept in vk_buf.
+ */
+#define	VKEY_NUM_TOKS		6	/* tokens of a product version */
+#define	VKEY_NUM_COMPS		20	/* components of a numeric token */
+
+typedef struct td_vkey {
+	int		vk_status;	/* 0, or error returned by the parse */
+	uint32_t	vk_num[3][VKEY_NUM_COMPS]; /* ver, iver, vendor iver */
+	uint16_t	vk_tok[VKEY_NUM_TOKS];	/* token offsets in vk_buf */
+	char		vk_buf[MAX_VERSION_LEN + 1];
+} td_vkey_t;
+
 int	td_prod_vcmp(const char *, const char *);
+int	td_prod_vkey(const char *, td_vkey_t *);
+int	td_prod_vkey_cmp(const td_vkey_t *, const td_vkey_t *);
+int	td_prod_vkey_order(const td_vkey_t *, const td_vkey_t *);
 
 #ifdef __cplusplus
 }
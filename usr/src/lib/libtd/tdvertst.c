@@ -0,0 +1,659 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * this is a test program for the product version comparison of
+ * Target Discovery, for development use only
+ *
+ * Random version strings are compared with td_prod_vcmp() and through
+ * the keys of td_prod_vkey(), and the results checked against the
+ * comparison td_prod_vcmp() made before it used keys.  The sort order
+ * of td_prod_vkey_order() is checked as well.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <td_version.h>
+
+#define	MAX_TOKENS		10
+
+#define	PROD_SUN_NAME_TOK	0
+#define	PROD_SUN_VER_TOK	1
+#define	PROD_SUN_IVER_TOK	2
+#define	PROD_VENDOR_NAME_TOK	3
+#define	PROD_VENDOR_VER_TOK	4
+#define	PROD_VENDOR_IVER_TOK	5
+
+#define	POOL_SIZE		64
+
+static int	ref_tokenize(char **, char *);
+static int	ref_chk_toks(char **);
+static int	ref_vstrcoll(char *, char *);
+static int	ref_is_empty(char *);
+static void	ref_strip_blanks(char **);
+
+static char	*names[] = { "Solaris", "SOLARIS", "solaris", "Sunos", "S" };
+static char	*vendors[] = { "Dell", "Cray", "Toshiba", "dell", "A", "D3" };
+static char	*vendor_vers[] = { "A", "B", "a", "AB", "1" };
+static char	mutations[] = "_.0123456789AaZz ";
+
+/*
+ * The comparison of version strings td_prod_vcmp() made before it used
+ * version keys, which the keys must reproduce.
+ */
+
+/*
+ * ref_prod_vcmp() - compare two product version strings
+ *
+ * Parameters:
+ *	v1	- first version string
+ *	v2	- second version string
+ * Returns:
+ *   V_EQUAL_TO - v1 and v2 are equal
+ *   V_GREATER_THAN - v1 is greater than v2.
+ *   V_LESS_THAN - v1 is less than v2.
+ *   V_NOT_UPGRADEABLE - v1 and v2 don't have a clear order relationship.
+ *	This would be the case if we were comparing, say, Cray's
+ *	version of Solaris to Toshiba's version of Solaris.  Since
+ *	neither of them is a descendent of the other, we can't upgrade
+ *	one to the other.
+ *
+ * Status:
+ *	private
+ */
+static int
+ref_prod_vcmp(const char *v1, const char *v2)
+{
+	int	ret, i, state;
+	char	v1_buf[MAX_VERSION_LEN + 1];
+	char	v2_buf[MAX_VERSION_LEN + 1];
+	char	*v1_tokens[MAX_TOKENS + 2], *v2_tokens[MAX_TOKENS + 2];
+
+	(void) memset(v1_buf, '\0', sizeof (v1_buf));
+	(void) memset(v2_buf, '\0', sizeof (v2_buf));
+	(void) memset(v1_tokens, '\0', sizeof (v1_tokens));
+	(void) memset(v2_tokens, '\0', sizeof (v2_tokens));
+
+	(void) strcpy(v1_buf, v1);
+	if ((ret = ref_tokenize(v1_tokens, v1_buf)) < 0)
+		return (ret);
+
+	(void) strcpy(v2_buf, v2);
+	if ((ret = ref_tokenize(v2_tokens, v2_buf)) < 0)
+		return (ret);
+
+
+
+	for (i = 0; v1_tokens[i]; i++) {
+		if (ref_is_empty(v1_tokens[i]))
+			continue;
+
+		switch (i) {
+		case PROD_SUN_NAME_TOK:
+			state = ref_vstrcoll(v1_tokens[i], v2_tokens[i]);
+			if (state != V_EQUAL_TO)
+				return (V_NOT_UPGRADEABLE);
+			break;
+
+		case PROD_SUN_VER_TOK:
+			if (ref_is_empty(v2_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			state = ref_vstrcoll(v1_tokens[i], v2_tokens[i]);
+			break;
+
+		case PROD_SUN_IVER_TOK:
+			/* Solaris_2.0.1_5.0  Solaris_2.0.1 */
+			if (ref_is_empty(v2_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			if (state == V_EQUAL_TO) {
+				state = ref_vstrcoll(v1_tokens[i],
+				    v2_tokens[i]);
+			}
+			break;
+		case PROD_VENDOR_NAME_TOK:
+			/* Solaris_2.0.1_5.0  Solaris_2.0.1_Dell_A */
+			if (!ref_is_empty(v2_tokens[PROD_SUN_IVER_TOK]))
+				return (V_NOT_UPGRADEABLE);
+
+			if (ref_is_empty(v2_tokens[i])) {
+				/* Solaris_2.0.1_Dell_A  Solaris_2.0.1 */
+				if (state == V_EQUAL_TO)
+					return (V_GREATER_THAN);
+				i = MAX_TOKENS;
+				continue;
+			}
+			ret = strcoll(v1_tokens[i], v2_tokens[i]);
+			if (ret != 0) {
+				/*
+				 * Solaris_2.0.1_Soulbourne_A
+				 * Solaris_2.0.1_Dell_A
+				 */
+				if (state == V_EQUAL_TO)
+					return (V_NOT_UPGRADEABLE);
+				/*
+				 * Solaris_2.0.1_Soulbourne_A
+				 * Solaris_2.0.2_Dell_A
+				 */
+				else
+					return (state);
+			}
+			break;
+
+		case PROD_VENDOR_VER_TOK:
+			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_Dell */
+			if (ref_is_empty(v2_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			if (state == V_EQUAL_TO) {
+				state = ref_vstrcoll(v1_tokens[i],
+				    v2_tokens[i]);
+			}
+			break;
+
+		case PROD_VENDOR_IVER_TOK:
+			/* Solaris_2.0.1_Dell_A_1.0  Solaris_2.0.1_Dell_A */
+			if (ref_is_empty(v2_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			if (state == V_EQUAL_TO) {
+				state = ref_vstrcoll(v1_tokens[i],
+				    v2_tokens[i]);
+			}
+			break;
+		default:
+			return (V_NOT_UPGRADEABLE);
+		}
+	}
+
+	for (i = 0; v2_tokens[i]; i++) {
+		if (ref_is_empty(v2_tokens[i]))
+			continue;
+		switch (i) {
+		case PROD_SUN_NAME_TOK:
+		case PROD_SUN_VER_TOK:
+		case PROD_SUN_IVER_TOK:
+			if (ref_is_empty(v1_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			break;
+		case PROD_VENDOR_NAME_TOK:
+			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_5.1 */
+			if (!ref_is_empty(v1_tokens[PROD_SUN_IVER_TOK]))
+				return (V_NOT_UPGRADEABLE);
+			if (ref_is_empty(v1_tokens[i])) {
+				/* Solaris_2.0.1  Solaris_2.0.1_Dell_A */
+				if (state == V_EQUAL_TO)
+					return (V_LESS_THAN);
+				else
+					i = MAX_TOKENS;
+			}
+			break;
+		case PROD_VENDOR_VER_TOK:
+			/* Solaris_2.0.1_Dell  Solaris_2.0.1_Dell_A */
+			if (ref_is_empty(v1_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			break;
+		case PROD_VENDOR_IVER_TOK:
+			/* Solaris_2.0.1_Dell_A  Solaris_2.0.1_Dell_A_1.0 */
+			if (ref_is_empty(v1_tokens[i]))
+				return (V_NOT_UPGRADEABLE);
+			break;
+		}
+	}
+	return (state);
+}
+
+
+/*
+ * ref_tokenize()
+ * Parameters:
+ *	toks	-
+ *	buf	-
+ * Return:
+ * Status:
+ *	private
+ */
+static int
+ref_tokenize(char *toks[], char buf[])
+{
+	static	char	*empty_str = "";
+	char		*bp, *cp;
+	int		len, i;
+
+	len = (int)strlen(buf);
+	if (len > MAX_VERSION_LEN)
+		return (ERR_STR_TOO_LONG);
+
+	toks[PROD_SUN_NAME_TOK] = empty_str;
+	toks[PROD_SUN_VER_TOK] = empty_str;
+	toks[PROD_SUN_IVER_TOK] = empty_str;
+	toks[PROD_VENDOR_NAME_TOK] = empty_str;
+	toks[PROD_VENDOR_VER_TOK] = empty_str;
+	toks[PROD_VENDOR_IVER_TOK] = empty_str;
+
+	bp = buf;
+	if (!isalpha((unsigned)*bp))
+		return (V_NOT_UPGRADEABLE);
+	toks[PROD_SUN_NAME_TOK] = bp;
+
+	for (i = 1; (cp = strchr(bp, '_')); i++) {
+		*cp = '\0';
+		bp = cp + 1;
+		if (bp > (buf + len)) {
+			return (V_NOT_UPGRADEABLE);
+		}
+		switch (i) {
+		case PROD_SUN_VER_TOK:
+			if (!isdigit((unsigned)(*bp))) {
+				return (V_NOT_UPGRADEABLE);
+			}
+			toks[i] = bp;
+			break;
+		case PROD_SUN_IVER_TOK:
+			if (isdigit((unsigned)(*bp))) {
+				toks[i] = bp;
+			} else {
+				i++;
+				toks[i] = bp;	/* Vendor name */
+			}
+			break;
+		case PROD_VENDOR_NAME_TOK:
+			if (isdigit((unsigned)(*bp))) {
+				return (V_NOT_UPGRADEABLE);
+			}
+			toks[i] = bp;
+			break;
+		case PROD_VENDOR_VER_TOK:
+			if (!isalpha((unsigned)(*bp))) {
+				return (V_NOT_UPGRADEABLE);
+			}
+			toks[i] = bp;
+			break;
+
+		case PROD_VENDOR_IVER_TOK:
+			if (!isdigit((unsigned)(*bp))) {
+				return (V_NOT_UPGRADEABLE);
+			}
+			toks[i] = bp;
+			break;
+		}
+	}
+
+	if (i < 2)
+		return (V_NOT_UPGRADEABLE);
+
+	for (i = 0; toks[i]; i++) {
+		cp = toks[i];
+		while (*cp) {
+			if (isalpha((unsigned)*cp)) {
+				*cp = toupper((unsigned)*cp);
+			}
+			cp++;
+		}
+	}
+	ref_strip_blanks(toks);
+
+	return (ref_chk_toks(toks));
+}
+
+/*
+ * ref_chk_toks()
+ *
+ * Parameters:
+ *	toks	-
+ * Return:
+ *
+ * Status:
+ *	private
+ */
+static int
+ref_chk_toks(char *toks[])
+{
+	int	i;
+	char	*cp;
+
+	for (i = 0; toks[i]; i++) {
+		if (*toks[i] == '\0')
+			continue;
+
+		switch (i) {
+		case PROD_SUN_NAME_TOK:
+			if ((strcoll(toks[i], "SOLARIS") == 0))
+				break;
+			else
+				return (V_NOT_UPGRADEABLE);
+
+		case PROD_SUN_VER_TOK:
+		case PROD_SUN_IVER_TOK:
+		case PROD_VENDOR_IVER_TOK:
+			for (cp = toks[i]; *cp; cp++) {
+				if (*cp == '.')
+					continue;
+				if (!isdigit((unsigned)(*cp)))
+					return (V_NOT_UPGRADEABLE);
+			}
+			break;
+		case PROD_VENDOR_NAME_TOK:
+		case PROD_VENDOR_VER_TOK:
+			for (cp = toks[i]; *cp; cp++) {
+				if (!isalpha((unsigned)(*cp)))
+					return (V_NOT_UPGRADEABLE);
+			}
+			break;
+		}
+	}
+	return (0);
+}
+
+
+/*
+ * ref_vstrcoll()
+ *
+ * Parameters:
+ *	s1	-
+ *	s2	-
+ * Return:
+ *
+ * Status:
+ *	private
+ */
+static int
+ref_vstrcoll(char *s1, char *s2)
+{
+	int 	ret, i;
+	int 	s1num[20], s2num[20];
+	char	*cp_beg, *cp_end;
+
+	if (isalpha((uchar_t)*s1)) {
+		ret = strcoll(s1, s2);
+		if (ret < 0)
+			return (V_LESS_THAN);
+		else if (ret > 0)
+			return (V_GREATER_THAN);
+
+		return (V_EQUAL_TO);
+	}
+
+	for (i = 0; i < 20; i++) {
+		s1num[i] = -1;
+		s2num[i] = -1;
+	}
+
+	i = 0; cp_beg = s1; cp_end = s1;
+	while (cp_beg != NULL) {
+		cp_end = strchr(cp_beg, '.');
+		if (cp_end != NULL) {
+			*cp_end = '\0';
+			cp_end++;
+		}
+		s1num[i++] = atoi(cp_beg);
+		cp_beg = cp_end;
+	}
+
+	i = 0; cp_beg = s2; cp_end = s2;
+	while (cp_beg != NULL) {
+		cp_end = strchr(cp_beg, '.');
+		if (cp_end != NULL) {
+			*cp_end = '\0';
+			cp_end++;
+		}
+		s2num[i++] = atoi(cp_beg);
+		cp_beg = cp_end;
+	}
+
+	for (i = 0; s1num[i] != -1; i++) {
+		if (s2num[i] == -1) break;
+		if (s1num[i] > s2num[i])
+			return (V_GREATER_THAN);
+		if (s1num[i] < s2num[i])
+			return (V_LESS_THAN);
+	}
+
+	if ((s1num[i] != -1) || (s2num[i] != -1)) {
+		if (s1num[i] == -1) {
+			while (s2num[i] == 0) i++;
+			if (s2num[i] != -1)
+				return (V_LESS_THAN);
+		} else {
+			while (s1num[i] == 0) i++;
+			if (s1num[i] != -1)
+				return (V_GREATER_THAN);
+		}
+	}
+	return (V_EQUAL_TO);
+}
+
+/*
+ * ref_strip_blanks()
+ *
+ * Parameters:
+ *	toks	-
+ * Return:
+ *	none
+ * Status:
+ *	private
+ */
+static void
+ref_strip_blanks(char *toks[])
+{
+	int	i;
+	char	*cp;
+
+	for (i = 0; toks[i]; i++) {
+		if (ref_is_empty(toks[i]))
+			continue;
+		cp = toks[i] + (strlen(toks[i]) - 1);
+		if (isspace((unsigned)*cp)) {
+			while (isspace((unsigned)*cp)) cp--;
+			cp++;
+			*cp = '\0';
+		}
+	}
+}
+
+/*
+ * ref_is_empty()
+ *
+ * Parameters:
+ *	cp	-
+ * Return:
+ *	0	-
+ *	1	-
+ * Status:
+ *	private
+ */
+static int
+ref_is_empty(char *cp)
+{
+	if (*cp == '\0')
+		return (1);
+	return (0);
+}
+
+/*
+ * add_numeric()
+ *	Append a random numeric version token, such as "2.10.0", to buf.
+ */
+static void
+add_numeric(char *buf, size_t len)
+{
+	char	comp[16];
+	int	i, ncomps;
+
+	ncomps = 1 + lrand48() % 4;
+	for (i = 0; i < ncomps; i++) {
+		if (i > 0)
+			(void) strlcat(buf, ".", len);
+		switch (lrand48() % 8) {
+		case 0:
+			comp[0] = '\0';		/* empty component */
+			break;
+		case 1:
+			(void) snprintf(comp, sizeof (comp), "0%ld",
+			    lrand48() % 10);
+			break;
+		default:
+			(void) snprintf(comp, sizeof (comp), "%ld",
+			    lrand48() % (lrand48() % 4 == 0 ? 1000 : 12));
+			break;
+		}
+		(void) strlcat(buf, comp, len);
+	}
+}
+
+/*
+ * random_version()
+ *	Make a random product version string, mostly well formed.
+ */
+static void
+random_version(char *buf, size_t len)
+{
+	size_t	n;
+
+	(void) strlcpy(buf,
+	    names[lrand48() % 8 < 5 ? 0 : lrand48() % 5], len);
+
+	if (lrand48() % 16 != 0) {
+		(void) strlcat(buf, "_", len);
+		add_numeric(buf, len);
+	}
+	if (lrand48() % 3 == 0) {
+		(void) strlcat(buf, "_", len);
+		add_numeric(buf, len);
+	}
+	if (lrand48() % 2 == 0) {
+		(void) strlcat(buf, "_", len);
+		(void) strlcat(buf, vendors[lrand48() % 6], len);
+		if (lrand48() % 4 != 0) {
+			(void) strlcat(buf, "_", len);
+			(void) strlcat(buf, vendor_vers[lrand48() % 5], len);
+			if (lrand48() % 2 == 0) {
+				(void) strlcat(buf, "_", len);
+				add_numeric(buf, len);
+			}
+		}
+	}
+	if (lrand48() % 16 == 0)
+		(void) strlcat(buf, lrand48() % 2 ? "  " : "_X", len);
+
+	/* and sometimes damage it */
+	if (lrand48() % 8 == 0 && (n = strlen(buf)) > 0)
+		buf[lrand48() % n] = mutations[lrand48() %
+		    (sizeof (mutations) - 1)];
+}
+
+/*
+ * check()
+ *	Compare two version strings all the ways there are.
+ * Return:
+ *	0 if all the comparisons agree, 1 otherwise
+ */
+static int
+check(const char *v1, const char *v2, td_vkey_t *k1, td_vkey_t *k2)
+{
+	int	ref, cmp, keycmp, order, rorder;
+
+	ref = ref_prod_vcmp(v1, v2);
+	cmp = td_prod_vcmp(v1, v2);
+	keycmp = td_prod_vkey_cmp(k1, k2);
+	order = td_prod_vkey_order(k1, k2);
+	rorder = td_prod_vkey_order(k2, k1);
+
+	if (cmp != ref || keycmp != ref) {
+		(void) printf("\"%s\" \"%s\": expected %d, "
+		    "td_prod_vcmp %d, td_prod_vkey_cmp %d\n",
+		    v1, v2, ref, cmp, keycmp);
+		return (1);
+	}
+	/*
+	 * td_prod_vcmp() only orders versions of one vendor, which the
+	 * sort order must agree with.
+	 */
+	if (order != -rorder ||
+	    ((ref == V_LESS_THAN || ref == V_GREATER_THAN) &&
+	    strcmp(k1->vk_buf + k1->vk_tok[PROD_VENDOR_NAME_TOK],
+	    k2->vk_buf + k2->vk_tok[PROD_VENDOR_NAME_TOK]) == 0 &&
+	    order != ref)) {
+		(void) printf("\"%s\" \"%s\": td_prod_vcmp %d, "
+		    "td_prod_vkey_order %d and %d\n",
+		    v1, v2, ref, order, rorder);
+		return (1);
+	}
+	return (0);
+}
+
+static void
+usage(void)
+{
+	(void) printf("Usage: tdvertst [-n <rounds>] [-s <seed>]\n"
+	    " -n <rounds> number of pools of versions to compare\n"
+	    " -s <seed> seed of the random versions\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	static char	pool[POOL_SIZE][MAX_VERSION_LEN];
+	static td_vkey_t keys[POOL_SIZE];
+	long		seed = (long)getpid();
+	int		rounds = 1000;
+	int		c, i, j, round;
+	int		failures = 0;
+
+	while ((c = getopt(argc, argv, "n:s:")) != EOF) {
+		switch (c) {
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atol(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	(void) printf("seed %ld\n", seed);
+	srand48(seed);
+
+	for (round = 0; round < rounds && failures < 10; round++) {
+		/* a small pool, so that equal versions are compared too */
+		for (i = 0; i < POOL_SIZE; i++) {
+			if (i > 0 && lrand48() % 4 == 0)
+				(void) strlcpy(pool[i],
+				    pool[lrand48() % i], MAX_VERSION_LEN);
+			else
+				random_version(pool[i], MAX_VERSION_LEN);
+			(void) td_prod_vkey(pool[i], &keys[i]);
+		}
+		for (i = 0; i < POOL_SIZE; i++)
+			for (j = 0; j < POOL_SIZE; j++)
+				failures += check(pool[i], pool[j],
+				    &keys[i], &keys[j]);
+	}
+
+	(void) printf("%d rounds, %d failures\n", round, failures);
+	return (failures == 0 ? 0 : 1);
+}
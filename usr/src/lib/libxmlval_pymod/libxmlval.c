@@ -0,0 +1,210 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Copyright (c) 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+/*
+ * RelaxNG validation of XML files from python, using libxml2 (the library
+ * behind xmllint) in-process.  A schema is compiled once by compile() and
+ * can then validate any number of documents.
+ *
+ * Validation errors are reported on stderr by libxml2, as xmllint does.
+ */
+
+#include <Python.h>
+#include <libxml/parser.h>
+#include <libxml/relaxng.h>
+#include <libxml/tree.h>
+
+#define	SCHEMA_CAPSULE	"libxmlval.schema"
+
+static PyObject *xmlval_compile(PyObject *self, PyObject *args);
+static PyObject *xmlval_validate(PyObject *self, PyObject *args);
+
+static PyObject *XmlvalError;
+
+/*
+ * Create the method table that translates the method called
+ * by the python program to the associated c function
+ */
+static PyMethodDef libxmlvalMethods[] = {
+	{"compile", (PyCFunction)xmlval_compile, METH_VARARGS,
+	"Compile a RelaxNG schema file"},
+	{"validate", (PyCFunction)xmlval_validate, METH_VARARGS,
+	"Validate an XML file against a compiled schema"},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef libxmlval_module = {
+	PyModuleDef_HEAD_INIT,
+	"libxmlval",
+	NULL,
+	-1,
+	libxmlvalMethods
+};
+
+PyMODINIT_FUNC
+PyInit_libxmlval(void)
+{
+	PyObject *module;
+
+	xmlInitParser();
+
+	if ((module = PyModule_Create(&libxmlval_module)) == NULL) {
+		return (NULL);
+	}
+
+	XmlvalError = PyErr_NewException("libxmlval.error", NULL, NULL);
+	if (XmlvalError == NULL) {
+		Py_DECREF(module);
+		return (NULL);
+	}
+	Py_INCREF(XmlvalError);
+	if (PyModule_AddObject(module, "error", XmlvalError) != 0) {
+		Py_DECREF(XmlvalError);
+		Py_DECREF(module);
+		return (NULL);
+	}
+	return (module);
+}
+
+/*
+ * schema_free
+ *
+ * Description: Destructor of schema capsules.  Frees the compiled schema.
+ */
+static void
+schema_free(PyObject *capsule)
+{
+	xmlRelaxNGPtr schema;
+
+	schema = PyCapsule_GetPointer(capsule, SCHEMA_CAPSULE);
+	if (schema != NULL) {
+		xmlRelaxNGFree(schema);
+	}
+}
+
+/*
+ * xmlval_compile
+ *
+ * Description: Parse and compile a RelaxNG schema.
+ * Parameters:
+ *   args - schema_file: name of the schema file
+ * Returns:
+ *	On success: schema object, to pass to validate()
+ *	On failure: NULL, with libxmlval.error raised
+ */
+static PyObject *
+xmlval_compile(PyObject *self, PyObject *args)
+{
+	char *schema_file;
+	xmlRelaxNGParserCtxtPtr pctxt;
+	xmlRelaxNGPtr schema = NULL;
+
+	if (!PyArg_ParseTuple(args, "s", &schema_file)) {
+		return (NULL);
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pctxt = xmlRelaxNGNewParserCtxt(schema_file);
+	if (pctxt != NULL) {
+		schema = xmlRelaxNGParse(pctxt);
+		xmlRelaxNGFreeParserCtxt(pctxt);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (schema == NULL) {
+		PyErr_Format(XmlvalError, "Cannot compile schema %s",
+		    schema_file);
+		return (NULL);
+	}
+	return (PyCapsule_New(schema, SCHEMA_CAPSULE, schema_free));
+}
+
+/*
+ * xmlval_validate
+ *
+ * Description: Validate an XML file against a compiled schema, and
+ *		optionally write out a reformatted copy of it, as
+ *		"xmllint --relaxng <schema> --format <file> > <out_file>" does.
+ * Parameters:
+ *   args - schema: schema object returned by compile()
+ *	    doc_file: name of the XML file to validate
+ *	    out_file: (optional) name of the file to write the reformatted
+ *		document to, or None
+ * Returns:
+ *	True: the file is valid
+ *	False: the file can't be parsed or is not valid
+ *	NULL, with libxmlval.error raised: out_file can't be written, or
+ *		out of memory
+ */
+static PyObject *
+xmlval_validate(PyObject *self, PyObject *args)
+{
+	PyObject *capsule;
+	char *doc_file;
+	char *out_file = NULL;
+	xmlRelaxNGPtr schema;
+	xmlRelaxNGValidCtxtPtr vctxt;
+	xmlDocPtr doc;
+	int options;
+	int rval;
+
+	if (!PyArg_ParseTuple(args, "Os|z", &capsule, &doc_file, &out_file)) {
+		return (NULL);
+	}
+	if ((schema = PyCapsule_GetPointer(capsule, SCHEMA_CAPSULE)) == NULL) {
+		return (NULL);
+	}
+
+	/* Like xmllint --format, drop ignorable blanks when reformatting. */
+	options = (out_file != NULL) ? XML_PARSE_NOBLANKS : 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	if ((doc = xmlReadFile(doc_file, NULL, options)) == NULL) {
+		rval = 1;
+	} else {
+		if ((vctxt = xmlRelaxNGNewValidCtxt(schema)) == NULL) {
+			rval = -1;
+		} else {
+			rval = xmlRelaxNGValidateDoc(vctxt, doc);
+			xmlRelaxNGFreeValidCtxt(vctxt);
+		}
+		if ((rval == 0) && (out_file != NULL) &&
+		    (xmlSaveFormatFile(out_file, doc, 1) < 0)) {
+			rval = -2;
+		}
+		xmlFreeDoc(doc);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (rval == -1) {
+		PyErr_Format(XmlvalError, "Cannot validate %s", doc_file);
+		return (NULL);
+	}
+	if (rval == -2) {
+		PyErr_Format(XmlvalError, "Cannot write %s", out_file);
+		return (NULL);
+	}
+	return (PyBool_FromLong(rval == 0));
+}